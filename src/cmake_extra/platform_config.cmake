@@ -20,7 +20,24 @@ if (DEFINED T2H_INT_WORKAROUND)
 	add_definitions(-DT2H_INT_WORKAROUND)
 endif()
 
+# io_uring file reads backend(linux only, runtime fall back to pread if kernel does not support it)
+if (UNIX AND NOT APPLE)
+	include(CheckIncludeFile)
+	check_include_file(linux/io_uring.h T2H_HAVE_IO_URING_H)
+	if (T2H_HAVE_IO_URING_H)
+		message(STATUS "Enable io_uring reads backend")
+		add_definitions(-DT2H_HAVE_IO_URING)
+	endif()
+endif()
+
 set(USE_MONGOOSE_HTTP_TRANSPORT TRUE)
+
+# epoll based http transport(linux only, selected at runtime by the hc_transport setting)
+if (CMAKE_SYSTEM_NAME MATCHES "Linux")
+	message(STATUS "Enable epoll http transport")
+	set(USE_EPOLL_HTTP_TRANSPORT TRUE)
+	add_definitions(-DUSE_EPOLL_HTTP_TRANSPORT)
+endif()
 add_definitions(-DLC_NO_USE_MONGOOSE_C_API -DNO_CGI -DLC_USE_CSF_TRANSLATOR)
 
 # Generic_config allow to setup envt. for the libraries, envt_config allow to setup paths to libraries
@@ -38,7 +55,7 @@ set(Boost_USE_STATIC_RUNTIME OFF)
 # Also add to link abainst t2h platform libraries as part of Boost link rule.
 add_definitions(-DBOOST_ASIO_ENABLE_CANCELIO -DBOOST_DISABLE_EXCEPTION -DBOOST_ASIO_SEPARATE_COMPILATION)
 
-find_package(Boost 1.45.0 COMPONENTS
+find_package(Boost 1.53.0 COMPONENTS
 	filesystem
 	program_options
 	thread
@@ -49,6 +66,7 @@ find_package(Boost 1.45.0 COMPONENTS
 	random
 	regex
 	unit_test_framework
+	atomic
 	REQUIRED)
 
 if (UNIX OR APPLE)
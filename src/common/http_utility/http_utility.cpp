@@ -1,8 +1,11 @@
 #include "http_utility.hpp"
 
 #include <ctime>
+#include <cctype>
 #include <cstdio>
+#include <cstring>
 #include <sstream>
+#include <algorithm>
 #include <boost/filesystem.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -15,6 +18,25 @@ namespace utility {
 /**
  *
  */
+static bool parse_hex_info_hash(char const * hex, unsigned char * info_hash) 
+{
+	/*  hex must have 2 * http_info_hash_size chars */
+	for (std::size_t it = 0; it < 2 * http_info_hash_size; ++it) {
+		int digit = 0;
+		if (hex[it] >= '0' && hex[it] <= '9')
+			digit = hex[it] - '0';
+		else if (hex[it] >= 'a' && hex[it] <= 'f')
+			digit = hex[it] - 'a' + 10;
+		else if (hex[it] >= 'A' && hex[it] <= 'F')
+			digit = hex[it] - 'A' + 10;
+		else 
+			return false;
+		info_hash[it / 2] = (it % 2 == 0) ? 
+			(unsigned char)(digit << 4) : (unsigned char)(info_hash[it / 2] | digit);
+	} // for
+	return true;
+}
+
 static boost::int64_t cast_string_range_to_int(std::string const & str, std::size_t first, std::size_t last) 
 {
 	boost::int64_t result = range_header::bad;
@@ -25,7 +47,9 @@ static boost::int64_t cast_string_range_to_int(std::string const & str, std::siz
 			tmp_buf.push_back(str.at(first));
 		if (tmp_buf == "*" || tmp_buf.size() == 0)
 			return range_header::all;
-		result = boost::lexical_cast<boost::int64_t>(tmp_buf);
+		/* Negative values are not valid, '-1' also must not be taken as range_header::all */
+		if ((result = boost::lexical_cast<boost::int64_t>(tmp_buf)) < 0)
+			return range_header::bad;
 	} 
 	catch (std::exception const &) 
 	{
@@ -81,88 +105,96 @@ boost::tuple<bool, http_header>
 	return boost::make_tuple(false, http_header());
 }
 
-bool http_range_header_value_parser(
-		range_header & rheader, 
+static inline bool is_range_space(char c) 
+	{ return (c == ' ' || c == '\t'); }
+
+static bool http_range_header_value_parser(
+		byte_range & range, 
 		std::string const & value, 
 		std::string::size_type start_range, 
-		std::string::size_type end_range,
-		bool is_second_part) 
+		std::string::size_type end_range) 
 {
 	std::string value_range; 
 	std::string::size_type first = 0, range_delim_pos = 0;
-	boost::int64_t bstart = range_header::bad, bend = range_header::bad;
 	
 	for(;start_range != end_range; ++start_range) 
-		value_range.push_back(value.at(start_range));
+		if (!is_range_space(value.at(start_range)))
+			value_range.push_back(value.at(start_range));
 	
 	if ((range_delim_pos = value_range.find_first_of("-")) == std::string::npos) 
 		return false;
 	
-	bstart = cast_string_range_to_int(value_range, first, range_delim_pos);	
-	bend = cast_string_range_to_int(value_range, range_delim_pos + 1, value_range.size());
+	range.first = cast_string_range_to_int(value_range, first, range_delim_pos);	
+	range.last = cast_string_range_to_int(value_range, range_delim_pos + 1, value_range.size());
 	
-	if (bstart == range_header::bad || bend == range_header::bad) 
+	/* Range with the last byte before the first one is not valid(not just not satisfiable) */
+	if (range.first != range_header::all && range.last != range_header::all && range.last < range.first)
 		return false;
-	
-	is_second_part ? rheader.bstart_2 = bstart : rheader.bstart_1 = bstart;
-	is_second_part ? rheader.bend_2 = bend : rheader.bend_1 = bend;
-	
-	return true;
+	return (range.first != range_header::bad && range.last != range_header::bad);
 }
 
-bool http_translate_range_header(range_header & rheader, header_list_type const & headers)
+static bool is_bytes_unit(std::string const & header, std::string::size_type end) 
 {
-	http_header header;
-	bool state = false;
-
-	boost::tie(state, header) = http_get_header(headers, "Range");
-	if (state) {
-		std::string::size_type const end = header.value.size();
-		std::string::size_type start = std::string::npos, delim_pos = std::string::npos;
-
-		if ((start = header.value.find_first_of("=")) == std::string::npos)
-			return false;
-
-		if ((delim_pos = header.value.find_first_of(",")) != std::string::npos) { 
-			if (delim_pos + 1 == end)
-				return false;
-			state = http_range_header_value_parser(rheader, header.value, delim_pos + 1, end, true);
-			delim_pos = delim_pos;
-		} else delim_pos = end;
-		if (state) 
-			return http_range_header_value_parser(rheader, header.value, start + 1, delim_pos, false);
-	} 
-
-	return false;
+	/*  Range of the other units is ignored, unit is case insensitive */
+	std::string unit;
+	for (std::string::size_type it = 0; it != end; ++it)
+		if (!is_range_space(header.at(it)))
+			unit.push_back((char)std::tolower((unsigned char)header.at(it)));
+	return (unit == "bytes");
 }
 
 static bool http_translate_range_header_(range_header & rheader, std::string const & header) 
 {	
-	bool state = true;
+	/*  Range : bytes=<range>[,<range>]..., each range parsed to byte_range as is, 
+	 	first two ranges also stored to bstart_1/bend_1, bstart_2/bend_2. 
+		Header with more than http_max_ranges ranges is not valid */
 	std::string::size_type const end = header.size();
 	std::string::size_type start = std::string::npos, delim_pos = std::string::npos;
 	
-	if ((start = header.find_first_of("=")) == std::string::npos)
+	rheader.bstart_1 = rheader.bend_1 = rheader.bstart_2 = rheader.bend_2 = range_header::bad;
+	rheader.ranges.clear();
+
+	if ((start = header.find_first_of("=")) == std::string::npos || !is_bytes_unit(header, start))
 		return false;
 
-	if ((delim_pos = header.find_first_of(",")) != std::string::npos) { 
-		if (delim_pos + 1 == end)
+	for (byte_range range = { range_header::bad, range_header::bad }; start != end; start = delim_pos) {
+		if ((delim_pos = header.find_first_of(",", start + 1)) == std::string::npos) 
+			delim_pos = end;
+		if (rheader.ranges.size() == http_max_ranges || 
+			!http_range_header_value_parser(range, header, start + 1, delim_pos)) 
+		{
+			rheader.ranges.clear();
 			return false;
-		state = http_range_header_value_parser(rheader, header, delim_pos + 1, end, true);
-		delim_pos = delim_pos;
-	} 
-	else 
-		delim_pos = end;
-
-	if (state)
-		state = http_range_header_value_parser(rheader, header, start + 1, delim_pos, false);
+		} // if
+		rheader.ranges.push_back(range);
+	} // for
+	
+	if (rheader.ranges.empty())
+		return false;
 	
-	return state;
+	rheader.bstart_1 = rheader.ranges.at(0).first;
+	rheader.bend_1 = rheader.ranges.at(0).last;
+	if (rheader.ranges.size() > 1) {
+		rheader.bstart_2 = rheader.ranges.at(1).first;
+		rheader.bend_2 = rheader.ranges.at(1).last;
+	}
+	return true;
+}
+
+bool http_translate_range_header(range_header & rheader, header_list_type const & headers)
+{
+	http_header header;
+	bool state = false;
+
+	boost::tie(state, header) = http_get_header(headers, "Range");
+	if (state) 
+		return http_translate_range_header_(rheader, header.value);
+	return false;
 }
 
 bool http_translate_range_header(range_header & rheader, std::string const & header) 
 {
-	rheader.bstart_1 = rheader.bend_1 = rheader.bstart_2 = rheader.bend_1 = range_header::bad;
+	rheader.bstart_1 = rheader.bend_1 = rheader.bstart_2 = rheader.bend_2 = range_header::bad;
 #if defined(LC_USE_CF_UNSAFE_FUNCTIONS)
 	return (std::sscanf(header.c_str(), "bytes=" LC_INTMAX_SF "-" LC_INTMAX_SF, 
 		&rheader.bstart_1, &rheader.bend_1) > 0 ? true : false);
@@ -170,6 +202,49 @@ bool http_translate_range_header(range_header & rheader, std::string const & hea
 	return http_translate_range_header_(rheader, header);
 }
 
+static inline bool byte_range_less(byte_range const & a, byte_range const & b) 
+	{ return (a.first < b.first); }
+
+bool http_resolve_ranges(range_header const & rheader, boost::int64_t file_size, byte_ranges_type & resolved) 
+{
+	resolved.clear();
+	for (byte_ranges_type::const_iterator first = rheader.ranges.begin(), last = rheader.ranges.end(); 
+		first != last; 
+		++first) 
+	{
+		byte_range range = *first;
+		if (range.first == range_header::all && range.last == range_header::all) 
+			/* 'bytes=-' has no bytes at all */
+			continue;
+		
+		if (range.first == range_header::all) {
+			/* Suffix range '-N' last N bytes */
+			range.first = (range.last > file_size) ? 0 : file_size - range.last;
+			range.last = file_size - 1;
+		} else if (range.last == range_header::all || range.last >= file_size) 
+			range.last = file_size - 1;
+		
+		if (range.first >= file_size || range.first > range.last) 
+			continue;
+		resolved.push_back(range);
+	} // for
+	
+	if (resolved.empty())
+		return false;
+	
+	std::sort(resolved.begin(), resolved.end(), byte_range_less);
+	byte_ranges_type::iterator merged = resolved.begin();
+	for (byte_ranges_type::iterator it = merged + 1; it != resolved.end(); ++it) {
+		if (it->first <= merged->last + 1) {
+			if (it->last > merged->last) 
+				merged->last = it->last;
+		} else 
+			*(++merged) = *it;
+	} // for
+	resolved.erase(merged + 1, resolved.end());
+	return true;
+}
+
 bool http_translate_accept_header(range_header & rheader, char const * header) 
 {
 	// TODO add parsing of data
@@ -196,28 +271,105 @@ std::string http_normalize_uri(std::string const & uri)
 }
 
 std::string http_get_gmt_time_string() 
+{
+ 	std::time_t const curtime = std::time(NULL);
+	return http_get_gmt_time_string(curtime);
+}
+
+std::string http_get_gmt_time_string(std::time_t const & time) 
 {
 	static const std::size_t gmt_time_len = 1024*2;	
 	char gmt_time[gmt_time_len]; std::memset(gmt_time, '\0', gmt_time_len);
- 	std::time_t const curtime = std::time(NULL);
 
-	return (std::strftime(gmt_time, 
-		gmt_time_len, "%a, %d %b %Y %H:%M:%S GMT", 
-		std::gmtime(&curtime)) == 0) ? std::string() : gmt_time;
+	std::tm const * tm = std::gmtime(&time);
+	return (!tm || std::strftime(gmt_time, 
+		gmt_time_len, "%a, %d %b %Y %H:%M:%S GMT", tm) == 0) ? std::string() : gmt_time;
+}
+
+std::size_t http_format_gmt_time(std::time_t const & time, char * out) 
+{
+	/*  Civil date from the days since epoch(proleptic Gregorian calendar, eras of the 400 years) */
+	static char const * const wdays = "ThuFriSatSunMonTueWed";
+	static char const * const months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+	if (time < 0)
+		return 0;
+
+	boost::int64_t const days = (boost::int64_t)time / 86400, secs = (boost::int64_t)time % 86400;
+	boost::int64_t const shifted = days + 719468, era = shifted / 146097, doe = shifted - era * 146097;
+	boost::int64_t const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+	boost::int64_t const doy = doe - (365 * yoe + yoe / 4 - yoe / 100), mp = (5 * doy + 2) / 153;
+	int const day = (int)(doy - (153 * mp + 2) / 5 + 1), month = (int)(mp < 10 ? mp + 3 : mp - 9);
+	boost::int64_t const year = yoe + era * 400 + (month <= 2 ? 1 : 0);
+	if (year > 9999)
+		return 0;
+	
+	int const hour = (int)(secs / 3600), min = (int)(secs % 3600 / 60), sec = (int)(secs % 60);
+	std::memcpy(out, wdays + (days % 7) * 3, 3);
+	out[3] = ','; out[4] = ' ';
+	out[5] = '0' + day / 10; out[6] = '0' + day % 10; out[7] = ' ';
+	std::memcpy(out + 8, months + (month - 1) * 3, 3);
+	out[11] = ' ';
+	out[12] = '0' + (int)(year / 1000); out[13] = '0' + (int)(year / 100 % 10); 
+	out[14] = '0' + (int)(year / 10 % 10); out[15] = '0' + (int)(year % 10); out[16] = ' ';
+	out[17] = '0' + hour / 10; out[18] = '0' + hour % 10; out[19] = ':';
+	out[20] = '0' + min / 10; out[21] = '0' + min % 10; out[22] = ':';
+	out[23] = '0' + sec / 10; out[24] = '0' + sec % 10;
+	std::memcpy(out + 25, " GMT", 5);
+	return http_gmt_time_size;
+}
+
+std::size_t http_format_int(boost::int64_t value, char * out) 
+{
+	/*  Digits generated from the end, unsigned magnitude so the min value does not overflow */
+	char digits[http_int_max_size];
+	std::size_t size = 0, writed = 0;
+	boost::uint64_t magnitude = (value < 0) ? 0 - (boost::uint64_t)value : (boost::uint64_t)value;
+	do {
+		digits[size++] = '0' + (char)(magnitude % 10);
+		magnitude /= 10;
+	} while (magnitude != 0);
+	
+	if (value < 0)
+		out[writed++] = '-';
+	while (size > 0)
+		out[writed++] = digits[--size];
+	out[writed] = '\0';
+	return writed;
+}
+
+std::time_t http_parse_gmt_time(std::string const & gmt_time) 
+{
+	static char const * const months[] = 
+		{ "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+	char wday[4] = { 0 }, month[4] = { 0 }, zone[4] = { 0 };
+	int day = 0, year = 0, hour = 0, min = 0, sec = 0, mon = 0;
+	
+	if (std::sscanf(gmt_time.c_str(), "%3s, %d %3s %d %d:%d:%d %3s", 
+			wday, &day, month, &year, &hour, &min, &sec, zone) != 8 || std::strcmp(zone, "GMT") != 0)
+		return (std::time_t)-1;
+	for (; mon < 12 && std::strcmp(months[mon], month) != 0; ++mon) 
+		{ /**/ }
+	if (mon == 12 || day < 1 || day > 31 || year < 1970 || hour > 23 || min > 59 || sec > 60)
+		return (std::time_t)-1;
+
+	/*  Days from the epoch of the civil date(timegm is not portable) */
+	int const y = (mon < 2) ? year - 1 : year, m = (mon < 2) ? mon + 13 : mon + 1; 
+	boost::int64_t const days = 365 * (boost::int64_t)y + y / 4 - y / 100 + y / 400 
+		+ (153 * (m - 3) + 2) / 5 + day - 719469;
+	return (std::time_t)(days * 86400 + hour * 3600 + min * 60 + sec);
 }
 
 std::string http_etag(boost::int64_t file_size, std::time_t const & last_write_time) 
 {
-	static const std::size_t etag_len = 1024*2;	
+	/*  NOTE : LC_INTMAX_SF is not portable int64 format, so file size formatted by the lexical_cast */
+	static const std::size_t etag_len = 64;	
 	char etag[etag_len]; std::memset(etag, '\0', etag_len);
 #if defined(WIN32)
-	return (_snprintf_s(etag, etag_len, "\"%lx.%" LC_INTMAX_SF "\"", 
-			(unsigned long) last_write_time, file_size) > 0)
-		? std::string() : etag;
+	return (_snprintf_s(etag, etag_len, "\"%lx.", (unsigned long) last_write_time) > 0)
+		? etag + boost::lexical_cast<std::string>(file_size) + "\"" : std::string();
 #else
-	return (snprintf(etag, etag_len, "\"%lx.%" LC_INTMAX_SF "\"", 
-			(unsigned long) last_write_time, file_size) > 0)
-		? std::string() : etag;
+	return (snprintf(etag, etag_len, "\"%lx.", (unsigned long) last_write_time) > 0)
+		? etag + boost::lexical_cast<std::string>(file_size) + "\"" : std::string();
 #endif // WIN32
 }
 
@@ -231,5 +383,80 @@ std::string http_etag(std::string const & file_path)
 	return http_etag(s, t);
 }
 
+std::string http_etag(std::string const & info_hash, int file_index, bool completed) 
+{
+	if (info_hash.empty())
+		return std::string();
+	return "\"" + info_hash + "-" + boost::lexical_cast<std::string>(file_index) + 
+		(completed ? "\"" : "-partial\"");
+}
+
+bool http_etag_match(std::string const & etags, std::string const & etag, bool weak_comparison) 
+{
+	if (etag.empty())
+		return false;
+
+	std::string const opaque_tag = (etag.compare(0, 2, "W/") == 0) ? etag.substr(2) : etag;
+	if (!weak_comparison && opaque_tag.size() != etag.size())
+		return false;
+
+	for (std::size_t first = 0, last = 0; first < etags.size(); first = last + 1) {
+		if ((last = etags.find(',', first)) == std::string::npos)
+			last = etags.size();
+		std::size_t tag_first = first, tag_last = last;
+		for (; tag_first < tag_last && is_range_space(etags[tag_first]); ++tag_first) 
+			{ /**/ }
+		for (; tag_last > tag_first && is_range_space(etags[tag_last - 1]); --tag_last) 
+			{ /**/ }
+		std::string tag = etags.substr(tag_first, tag_last - tag_first);
+		if (tag == "*")
+			return true;
+		if (tag.compare(0, 2, "W/") == 0) {
+			if (!weak_comparison)
+				continue;
+			tag.erase(0, 2);
+		} // if
+		if (tag == opaque_tag)
+			return true;
+	} // for
+	return false;
+}
+
+std::string http_file_route(std::string const & info_hash, int file_index) 
+{
+	if (info_hash.empty() || file_index < 0)
+		return std::string();
+	return "/f/" + info_hash + "/" + boost::lexical_cast<std::string>(file_index);
+}
+
+bool http_parse_file_route(std::string const & uri, unsigned char * info_hash, int & file_index) 
+{
+	/*  Parsed in place : the route is checked on each request before the path lookup */
+	static std::size_t const prefix_size = 3, hex_size = 2 * http_info_hash_size;
+	static std::size_t const max_index_digits = 9;
+	if (uri.size() <= prefix_size + hex_size + 1 || uri.compare(0, prefix_size, "/f/") != 0 || 
+		uri[prefix_size + hex_size] != '/')
+		return false;
+	if (!parse_hex_info_hash(uri.data() + prefix_size, info_hash))
+		return false;
+
+	std::size_t const index_pos = prefix_size + hex_size + 1;
+	if (uri.size() - index_pos > max_index_digits)
+		return false;
+	int index = 0;
+	for (std::size_t it = index_pos; it < uri.size(); ++it) {
+		if (uri[it] < '0' || uri[it] > '9')
+			return false;
+		index = index * 10 + (uri[it] - '0');
+	} // for
+	file_index = index;
+	return true;
+}
+
+bool http_parse_info_hash(std::string const & hex, unsigned char * info_hash) 
+{
+	return (hex.size() == 2 * http_info_hash_size && parse_hex_info_hash(hex.data(), info_hash));
+}
+
 } // namespace utility
 
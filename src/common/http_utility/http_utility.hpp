@@ -8,6 +8,7 @@
 #include "http_request_parser.hpp" 
 
 #include <ctime>
+#include <vector>
 #include <boost/cstdint.hpp>
 
 #define LC_INTMAX_SF				"%Ld"
@@ -15,6 +16,17 @@
 
 namespace utility {
 
+/**
+ * One byte range, as it came in the Range header or resolved against the file size
+ */
+struct byte_range 
+{
+	boost::int64_t first;			// First byte(range_header::all means suffix range '-N')
+	boost::int64_t last;			// Last byte, inclusive(range_header::all means up to the end of file)
+};
+
+typedef std::vector<byte_range> byte_ranges_type;
+
 /**
  * Range header as data struct representation.
  */
@@ -30,6 +42,18 @@ struct range_header
 
 	boost::int64_t bstart_2;
 	boost::int64_t bend_2;
+
+	byte_ranges_type ranges;		// All ranges of the header in order of appearance(first two also above)
+};
+
+/**
+ * Conditional request headers as data struct representation, empty string means header not present
+ */
+struct conditional_header 
+{
+	std::string if_none_match;
+	std::string if_modified_since;
+	std::string if_range;
 };
 
 /**
@@ -40,6 +64,10 @@ bool url_decode(std::string const & in, std::string & out);
 
 boost::tuple<bool, http_header> http_get_header(std::string const & name);
 
+/* Max ranges of the one Range header, header with more ranges is not valid(whole content sent), 
+ 	so the request could not blow up to thousands of multipart parts */
+static std::size_t const http_max_ranges = 64;
+
 bool http_translate_range_header(range_header & rheader, header_list_type const & headers);
 
 bool http_translate_range_header(range_header & rheader, std::string const & range_header);
@@ -49,6 +77,12 @@ inline bool http_translate_range_header_c(range_header & rheader, std::string co
 
 bool http_translate_accept_header(range_header & rheader, char const * range_header);
 
+/* Resolve ranges of the header against the file size : suffix ranges('-N') and open ranges('N-') 
+ 	converted to absolute ones, not satisfiable ranges and ranges without both ends('-') dropped, 
+	overlapping and adjacent ranges merged.
+	Returns false if there are no satisfiable ranges(416) */
+bool http_resolve_ranges(range_header const & rheader, boost::int64_t file_size, byte_ranges_type & resolved);
+
 std::string http_normalize_uri(std::string const & uri); 
 
 static inline std::string http_normalize_uri_c(char const * uri) 
@@ -56,10 +90,48 @@ static inline std::string http_normalize_uri_c(char const * uri)
 
 std::string http_get_gmt_time_string(); 
 
+std::string http_get_gmt_time_string(std::time_t const & time); 
+
+/* Size of the HTTP-date in the preferred RFC 1123 format, without the terminating zero */
+enum { http_gmt_time_size = 29, http_int_max_size = 20 };
+
+/* Format HTTP-date(RFC 1123) to the out buffer(at least http_gmt_time_size + 1 bytes) without allocation 
+ 	and the C library time functions, returns size of the date or 0 if the time is not valid */
+std::size_t http_format_gmt_time(std::time_t const & time, char * out);
+
+/* Format the decimal integer to the out buffer(at least http_int_max_size + 1 bytes), returns size of the number */
+std::size_t http_format_int(boost::int64_t value, char * out);
+
+/* Parse HTTP-date in the preferred RFC 1123 format(eg 'Sun, 06 Nov 1994 08:49:37 GMT'), 
+ 	returns (std::time_t)-1 if the date is not valid */
+std::time_t http_parse_gmt_time(std::string const & gmt_time);
+
 std::string http_etag(std::string const & file_path);
 
 std::string http_etag(boost::int64_t file_size, std::time_t const & last_write_time);
 
+/* Stable entity tag of the torrent file, which does not depend on the time : 
+ 	content of the file is defined by the info hash and the file index, 
+	completion state added to revalidate the cached partial content once the file completed */
+std::string http_etag(std::string const & info_hash, int file_index, bool completed);
+
+/* Match the entity tag against the If-None-Match/If-Range value('*' or list of entity tags),
+ 	weak comparison ignore 'W/' prefixes, strong comparison never match weak tags */
+bool http_etag_match(std::string const & etags, std::string const & etag, bool weak_comparison);
+
+/* Size of the raw info hash(SHA-1) of the torrent */
+enum { http_info_hash_size = 20 };
+
+/* Route of the torrent file which does not depend on its path : '/f/<hex info hash>/<file index>' */
+std::string http_file_route(std::string const & info_hash, int file_index);
+
+/* Parse the route of the torrent file(see http_file_route), info_hash gets the raw info hash 
+ 	(http_info_hash_size bytes). Returns false if the uri is not the file route */
+bool http_parse_file_route(std::string const & uri, unsigned char * info_hash, int & file_index);
+
+/* Raw info hash(http_info_hash_size bytes) of the hex one, returns false if the hex is not valid */
+bool http_parse_info_hash(std::string const & hex, unsigned char * info_hash);
+
 } // namespace utility
 
 #endif
@@ -32,5 +32,11 @@ base_transport::~base_transport()
 {
 }
 
+transport_workers_stat base_transport::get_workers_stat() const 
+{
+	transport_workers_stat const empty = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	return empty;
+}
+
 } // namespace common
 
@@ -6,6 +6,7 @@
 
 #include <string>
 #include <exception>
+#include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 
@@ -29,6 +30,24 @@ struct transport_config {
 	std::string port;
 	std::size_t max_threads;
 	transport_context_ptr context;
+	std::size_t min_threads;		// Workers kept even if idle(elastic pool), 0 means max_threads
+	std::size_t idle_timeout;		// Idle worker above min_threads exits after it, in secs
+};
+
+/**
+ * transport_workers_stat snapshot of the transport workers pool, queue means requests(connections) 
+ * which were accepted but not taken by any worker yet
+ */
+struct transport_workers_stat {
+	std::size_t threads;			// Current count of workers
+	std::size_t idle_threads;		// Workers which wait for work
+	std::size_t peak_threads;		// Max count of workers since start
+	std::size_t min_threads;
+	std::size_t max_threads;
+	std::size_t queued;				// Current queue length
+	boost::uint64_t dequeued;		// Total count of requests taken from the queue
+	double wait_ms_total;			// Total time requests spent in the queue, in ms
+	double wait_ms_max;				// Max time request spent in the queue, in ms
 };
 
 class base_transport : private boost::noncopyable {
@@ -44,6 +63,8 @@ public :
 	virtual void stop_connection() = 0;
 	virtual void wait() = 0;
 
+	virtual transport_workers_stat get_workers_stat() const;
+
 private :
 
 };
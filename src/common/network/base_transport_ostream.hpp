@@ -2,6 +2,7 @@
 #define BASE_TRANSPORT_OSTREAM_HPP_INCLUDED
 
 #include <cstddef>
+#include <boost/cstdint.hpp>
 #include <boost/function.hpp>
 #include <boost/shared_ptr.hpp>
 
@@ -21,6 +22,35 @@ public :
 	virtual void async_write(
 		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine) = 0;
 	
+	/* Zero-copy capability : send bytes_size bytes of the file(fd) from offset directly to the client.
+	 	Transports which can not do this keep defaults, so callers must fall back to the write */
+	virtual bool is_zero_copy_supported() const 
+		{ return false; }
+	virtual std::size_t write_file(int fd, boost::int64_t offset, std::size_t bytes_size) 
+		{ return 0; }
+
+	/* Gather capability : the head(reply headers) and the first body bytes sended together(one writev or 
+	 	under TCP_CORK), so the small reply goes to the client by one packet instead of two. 
+		Returns count of the body bytes writed, 0 if the head or the body failed. 
+		Transports which can not do this keep defaults : the head and the body writed one by one */
+	virtual std::size_t write_gather(
+		char const * head, std::size_t head_size, char const * bytes, std::size_t bytes_size) 
+		{ return (write(head, head_size) == head_size) ? write(bytes, bytes_size) : 0; }
+	virtual std::size_t write_file_gather(
+		char const * head, std::size_t head_size, int fd, boost::int64_t offset, std::size_t bytes_size) 
+		{ return (write(head, head_size) == head_size) ? write_file(fd, offset, bytes_size) : 0; }
+
+	/* Suspend capability : the reply could be finished after the request handler returned(from any thread).
+	 	Each suspend must be paired with the complete, the transport finishes the request only when
+		the handler returned and all suspends completed. Transports which can not do this keep defaults,
+		so callers must write the whole reply before the handler return */
+	virtual bool is_suspend_supported() const
+		{ return false; }
+	virtual void suspend()
+		{ }
+	virtual void complete()
+		{ }
+
 };
 
 typedef boost::shared_ptr<base_transport_ostream> base_transport_ostream_ptr;
@@ -0,0 +1,332 @@
+#include "http_epoll_socket_ostream.hpp"
+#include "zero_copy_transfer.hpp"
+
+#include <cstdlib>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/assert.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <poll.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+#define HTTP_EPOLL_SEND_TIMEOUT 60				// Seconds without progress of the client before connection broken
+#define HTTP_EPOLL_MAX_REPLY_HEADERS 64 * 1024
+
+namespace common { namespace details {
+
+std::size_t const epoll_connection::max_input_size;
+std::size_t const epoll_connection::output_watermark;
+
+/**
+ * Public epoll_connection api
+ */
+
+epoll_connection::epoll_connection(int sock_, int epoll_fd_)
+	: sock(sock_),
+	epoll_fd(epoll_fd_),
+	events(0),
+	busy(false),
+	broken(false),
+	closed(false),
+	keep_alive(true),
+	last_activity(std::time(NULL)),
+	in(),
+	out(),
+	out_bytes(0),
+	lock(),
+	drained()
+{
+}
+
+epoll_connection::~epoll_connection()
+{
+}
+
+bool epoll_connection::flush_unsafe(completions_type & completed)
+{
+	while (!broken && !out.empty()) {
+		segment & front = out.front();
+		ssize_t const sended = ::send(sock, front.bytes.data() + front.offset,
+			front.bytes.size() - front.offset, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (sended < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+			break_unsafe(completed);
+			return false;
+		} // if
+		front.offset += sended;
+		out_bytes -= sended;
+		if (front.offset == front.bytes.size()) {
+			if (front.com_routine)
+				completed.push_back(boost::bind(front.com_routine, 0, front.bytes.size()));
+			out.pop_front();
+		} // if
+	} // while
+	update_events_unsafe();
+	drained.notify_all();
+	return !broken;
+}
+
+void epoll_connection::break_unsafe(completions_type & completed)
+{
+	broken = true;
+	for (segments_type::iterator first = out.begin(), last = out.end(); first != last; ++first)
+		if (first->com_routine)
+			completed.push_back(boost::bind(first->com_routine, -1, 0));
+	out.clear();
+	out_bytes = 0;
+	update_events_unsafe();
+	drained.notify_all();
+}
+
+void epoll_connection::update_events_unsafe()
+{
+	/*  Broken connection removed from the epoll at all, otherwise level triggered EPOLLHUP
+	 	would wake up the event loop again and again while the worker still owns the connection */
+	if (closed || (broken && events == 0))
+		return;
+	if (broken) {
+		::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+		events = 0;
+		return;
+	}
+
+	unsigned const new_events = EPOLLRDHUP |
+		(in.size() < max_input_size ? (unsigned)EPOLLIN : 0u) |
+		(out.empty() ? 0u : (unsigned)EPOLLOUT);
+	if (new_events == events)
+		return;
+
+	struct epoll_event ev;
+	ev.events = new_events;
+	ev.data.ptr = this;
+	if (::epoll_ctl(epoll_fd, events == 0 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD, sock, &ev) == 0)
+		events = new_events;
+}
+
+/**
+ * Public epoll_socket_ostream api
+ */
+
+epoll_socket_ostream::epoll_socket_ostream(
+		epoll_connection_ptr conn, bool head_request, reply_done_routine_type done_routine)
+	: base_transport_ostream(),
+	conn_(conn),
+	head_request_(head_request),
+	headers_done_(false),
+	headers_(),
+	content_length_(-1),
+	body_writed_(0),
+	done_routine_(done_routine),
+	pending_lock_(),
+	pending_(1)
+{
+	BOOST_ASSERT(conn_ != NULL);
+}
+
+epoll_socket_ostream::~epoll_socket_ostream()
+{
+}
+
+std::size_t epoll_socket_ostream::write(char const * bytes, std::size_t bytes_size)
+{
+	return write_gather(NULL, 0, bytes, bytes_size);
+}
+
+std::size_t epoll_socket_ostream::write_gather(
+	char const * head, std::size_t head_size, char const * bytes, std::size_t bytes_size)
+{
+	/*  Head and body queued as one segment, so they go to the socket by the one send */
+	if (!enqueue(head, head_size, bytes, bytes_size, write_compeletion_routine_type()))
+		return 0;
+
+	/*  Bytes already copied to the queue, so block only if the client
+	 	does not drain it fast enough(keep memory per connection bounded) */
+	epoll_connection::completions_type completed;
+	boost::system_time const deadline =
+		boost::get_system_time() + boost::posix_time::seconds(HTTP_EPOLL_SEND_TIMEOUT);
+	boost::mutex::scoped_lock guard(conn_->lock);
+	while (!conn_->broken && conn_->out_bytes > epoll_connection::output_watermark)
+		if (!conn_->drained.timed_wait(guard, deadline))
+			conn_->break_unsafe(completed);
+	bool const broken = conn_->broken;
+	guard.unlock();
+
+	std::for_each(completed.begin(), completed.end(), boost::bind(&boost::function<void ()>::operator(), _1));
+	return broken ? 0 : bytes_size;
+}
+
+void epoll_socket_ostream::async_write(
+		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine)
+{
+	/*  Never blocks, the routine called by the event loop then bytes sended(or connection broken) */
+	if (!enqueue(NULL, 0, bytes, bytes_size, com_routine) && com_routine)
+		com_routine(-1, 0);
+}
+
+bool epoll_socket_ostream::is_zero_copy_supported() const
+{
+	return true;
+}
+
+std::size_t epoll_socket_ostream::write_file(int fd, boost::int64_t offset, std::size_t bytes_size)
+{
+	/*  sendfile(2) performed by the worker itself : wait till the queued bytes sended,
+	 	then the event loop does not touch the socket output until something queued again */
+	boost::system_time const deadline =
+		boost::get_system_time() + boost::posix_time::seconds(HTTP_EPOLL_SEND_TIMEOUT);
+	boost::mutex::scoped_lock guard(conn_->lock);
+	while (!conn_->broken && !conn_->out.empty())
+		if (!conn_->drained.timed_wait(guard, deadline))
+			return 0;
+	if (conn_->broken)
+		return 0;
+	int const sock = conn_->sock;
+	guard.unlock();
+
+	off_t off = offset;
+	std::size_t sended = 0;
+	while (sended < bytes_size) {
+		ssize_t const res = ::sendfile(sock, fd, &off, bytes_size - sended);
+		if (res > 0) {
+			sended += res;
+			continue;
+		}
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			struct pollfd pfd = { sock, POLLOUT, 0 };
+			if (::poll(&pfd, 1, HTTP_EPOLL_SEND_TIMEOUT * 1000) <= 0 || (pfd.revents & (POLLERR | POLLHUP)))
+				break;
+			continue;
+		} // if
+		break;
+	} // while
+
+	if (headers_done_)
+		body_writed_ += sended;
+	return sended;
+}
+
+std::size_t epoll_socket_ostream::write_file_gather(
+	char const * head, std::size_t head_size, int fd, boost::int64_t offset, std::size_t bytes_size)
+{
+	/*  Queued head held by the cork till the first sendfile bytes, then both pushed together */
+	bool const corked = socket_cork(conn_->sock, true);
+	std::size_t writed = 0;
+	if (write(head, head_size) == head_size)
+		writed = write_file(fd, offset, bytes_size);
+	if (corked)
+		socket_cork(conn_->sock, false);
+	return writed;
+}
+
+bool epoll_socket_ostream::is_suspend_supported() const
+{
+	return true;
+}
+
+void epoll_socket_ostream::suspend()
+{
+	boost::lock_guard<boost::mutex> guard(pending_lock_);
+	++pending_;
+}
+
+void epoll_socket_ostream::complete()
+{
+	/*  The handler completes own reference at return, so the last complete 
+	 	(from the handler or from the thread which finished the suspended reply) done the reply */
+	boost::mutex::scoped_lock guard(pending_lock_);
+	BOOST_ASSERT(pending_ > 0);
+	if (--pending_ > 0)
+		return;
+	guard.unlock();
+
+	reply_done_routine_type done_routine;
+	done_routine.swap(done_routine_);
+	if (done_routine)
+		done_routine(*this);
+}
+
+bool epoll_socket_ostream::is_reply_completed() const
+{
+	return (headers_done_ && content_length_ >= 0 && body_writed_ == content_length_);
+}
+
+/**
+ * Private epoll_socket_ostream api
+ */
+
+bool epoll_socket_ostream::enqueue(char const * head, std::size_t head_size, 
+	char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine)
+{
+	if (head_size > 0)
+		track_reply(head, head_size);
+	track_reply(bytes, bytes_size);
+
+	epoll_connection::completions_type completed;
+	boost::mutex::scoped_lock guard(conn_->lock);
+	if (conn_->broken)
+		return false;
+	conn_->out.push_back(epoll_connection::segment());
+	epoll_connection::segment & back = conn_->out.back();
+	back.bytes.reserve(head_size + bytes_size);
+	if (head_size > 0)
+		back.bytes.assign(head, head_size);
+	back.bytes.append(bytes, bytes_size);
+	back.offset = 0;
+	back.com_routine = com_routine;
+	conn_->out_bytes += head_size + bytes_size;
+	conn_->flush_unsafe(completed);
+	guard.unlock();
+
+	/*  If connection broken while flushing, routine of this segment also called here */
+	std::for_each(completed.begin(), completed.end(), boost::bind(&boost::function<void ()>::operator(), _1));
+	return true;
+}
+
+void epoll_socket_ostream::track_reply(char const * bytes, std::size_t bytes_size)
+{
+	/*  Reply headers written by the core as is, so Content-Length taken from them
+	 	to know is the whole reply was sended(keep-alive possible) or not */
+	if (headers_done_) {
+		body_writed_ += bytes_size;
+		return;
+	}
+
+	headers_.append(bytes, bytes_size);
+	std::size_t const headers_end = headers_.find("\r\n\r\n");
+	if (headers_end == std::string::npos) {
+		if (headers_.size() > HTTP_EPOLL_MAX_REPLY_HEADERS) {
+			headers_done_ = true;
+			std::string().swap(headers_);
+		}
+		return;
+	} // if
+
+	headers_done_ = true;
+	body_writed_ = headers_.size() - (headers_end + 4);
+
+	std::string lower_headers = headers_.substr(0, headers_end + 2);
+	std::transform(lower_headers.begin(), lower_headers.end(), lower_headers.begin(), ::tolower);
+	int const status = (lower_headers.size() > 9) ? std::atoi(lower_headers.c_str() + 9) : 0;
+	std::size_t const found = lower_headers.find("\r\ncontent-length:");
+	if (head_request_ || status == 304 || status == 204 || status < 200)
+		content_length_ = 0;
+	else if (found != std::string::npos)
+		content_length_ = std::strtoll(lower_headers.c_str() + found + 17, NULL, 10);
+	std::string().swap(headers_);
+}
+
+} } // namespace common, details
+
+#undef HTTP_EPOLL_SEND_TIMEOUT
+#undef HTTP_EPOLL_MAX_REPLY_HEADERS
+
@@ -0,0 +1,126 @@
+#ifndef HTTP_EPOLL_SOCKET_OSTREAM_HPP_INCLUDED
+#define HTTP_EPOLL_SOCKET_OSTREAM_HPP_INCLUDED
+
+#include "base_transport_ostream.hpp"
+
+#include <ctime>
+#include <list>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace common { namespace details {
+
+/**
+ * epoll_connection state of the one client connection of the http_epoll_transport.
+ * Socket IO(read of requests, flush of queued replies) performed by the transport event loop,
+ * reply bytes queued by the worker which handle the current request. Idle/waiting connection
+ * holds only this struct, so it costs a few hundred bytes instead of a thread.
+ */
+struct epoll_connection : boost::noncopyable {
+	typedef base_transport_ostream::write_compeletion_routine_type write_compeletion_routine_type;
+
+	struct segment {
+		std::string bytes;
+		std::size_t offset;
+		write_compeletion_routine_type com_routine;
+	};
+	typedef std::list<segment> segments_type;
+	/* Completion routines bound with the result, called outside of the connection lock */
+	typedef std::vector<boost::function<void ()> > completions_type;
+
+	static std::size_t const max_input_size = 16 * 1024;		// Max size of the not parsed input(request headers)
+	static std::size_t const output_watermark = 256 * 1024;	// Writer blocked while queued reply bytes above it
+
+	epoll_connection(int sock_, int epoll_fd_);
+	~epoll_connection();
+
+	/* Send queued segments without blocking, completion routines of the sended segments moved to completed.
+	 	Returns false if the connection is broken */
+	bool flush_unsafe(completions_type & completed);
+
+	/* Mark the connection broken, all queued segments dropped and waiters of the output woken up */
+	void break_unsafe(completions_type & completed);
+
+	/* Sync epoll interest with the connection state :
+	 	EPOLLIN till the input buffer not full, EPOLLOUT while there are queued bytes */
+	void update_events_unsafe();
+
+	int sock;
+	int epoll_fd;
+	unsigned events;					// Current epoll interest
+	bool busy;							// Request of the connection handled by a worker
+	bool broken;						// Peer closed connection or socket error
+	bool closed;						// Socket closed by the event loop
+	bool keep_alive;					// Keep the connection after the current reply
+	std::time_t last_activity;			// For keep-alive idle timeout
+	std::string in;						// Not parsed input bytes(pipelined requests)
+	segments_type out;					// Queued reply bytes
+	std::size_t out_bytes;				// Count of the queued reply bytes
+	boost::mutex lock;
+	boost::condition_variable drained;	// Signaled when queued reply bytes sended or connection broken
+};
+
+typedef boost::shared_ptr<epoll_connection> epoll_connection_ptr;
+
+/**
+ * epoll_socket_ostream reply stream of the one request of the epoll_connection.
+ * Bytes copied to the connection output queue(sended right away if the socket writable),
+ * write blocks only while the queue is above the watermark. The stream tracks framing
+ * of the reply(headers, Content-Length) so the transport knows can the connection be kept alive.
+ * The reply could be suspended by the handler and finished later by other thread,
+ * the connection stays busy(next pipelined request not dispatched) till then.
+ */
+class epoll_socket_ostream : public base_transport_ostream {
+public :
+	/* Called once then the handler returned and all suspends of the stream completed */
+	typedef boost::function<void (epoll_socket_ostream &)> reply_done_routine_type;
+
+	epoll_socket_ostream(epoll_connection_ptr conn, bool head_request, reply_done_routine_type done_routine);
+	~epoll_socket_ostream();
+
+	virtual std::size_t write(char const * bytes, std::size_t bytes_size);
+	virtual void async_write(
+		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine);
+
+	virtual bool is_zero_copy_supported() const;
+	virtual std::size_t write_file(int fd, boost::int64_t offset, std::size_t bytes_size);
+
+	virtual std::size_t write_gather(
+		char const * head, std::size_t head_size, char const * bytes, std::size_t bytes_size);
+	virtual std::size_t write_file_gather(
+		char const * head, std::size_t head_size, int fd, boost::int64_t offset, std::size_t bytes_size);
+
+	virtual bool is_suspend_supported() const;
+	virtual void suspend();
+	virtual void complete();
+
+	/* Something was written to the client */
+	inline bool is_reply_started() const
+		{ return (!headers_.empty() || headers_done_); }
+
+	/* Whole reply(headers and Content-Length bytes of the body) was written */
+	bool is_reply_completed() const;
+
+private :
+	bool enqueue(char const * head, std::size_t head_size, 
+		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine);
+	void track_reply(char const * bytes, std::size_t bytes_size);
+
+	epoll_connection_ptr conn_;
+	bool head_request_;
+	bool headers_done_;
+	std::string headers_;
+	boost::int64_t content_length_;
+	boost::int64_t body_writed_;
+	reply_done_routine_type done_routine_;
+	boost::mutex pending_lock_;
+	int pending_;					// Handler itself plus not completed suspends
+
+};
+
+} } // namespace common, details
+
+#endif
+
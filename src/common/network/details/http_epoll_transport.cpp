@@ -0,0 +1,657 @@
+#include "http_epoll_transport.hpp"
+
+#include "lc_trace.hpp"
+#include "http_request_parser.hpp"
+
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/assert.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+
+#include <netdb.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#define HTTP_EPOLL_MAX_EVENTS 256
+#define HTTP_EPOLL_KEEP_ALIVE_TIMEOUT 30		// Seconds of idle keep-alive connection before close
+#define STD_EXCEPTION_HANDLE_START try {
+#define STD_EXCEPTION_HANDLE_END } catch (std::exception const & extp) { }
+
+//#define T2H_DEEP_DEBUG
+
+namespace common { namespace details {
+
+/**
+ * Hidden private http_epoll_transport api
+ */
+
+static char const * epoll_get_header(utility::header_list_type const & headers, char const * name)
+{
+	for (utility::header_list_type::const_iterator first = headers.begin(), last = headers.end();
+		first != last;
+		++first)
+	{
+		if (boost::algorithm::iequals(first->name, name))
+			return first->value.c_str();
+	}
+	return NULL;
+}
+
+static bool epoll_has_dot_segment(std::string const & uri)
+{
+	/*  Only the whole '..' segment escapes the doc root, names like 'a..b.mkv' are valid */
+	for (std::size_t pos = uri.find("/.."); pos != std::string::npos; pos = uri.find("/..", pos + 1))
+		if (pos + 3 == uri.size() || uri[pos + 3] == '/')
+			return true;
+	return false;
+}
+
+static inline void epoll_run_completions(epoll_connection::completions_type const & completed)
+{
+	for (epoll_connection::completions_type::const_iterator first = completed.begin(), last = completed.end();
+		first != last;
+		++first)
+	{
+		(*first)();
+	}
+}
+
+/**
+ * Public http_epoll_transport api
+ */
+
+http_epoll_transport::http_epoll_transport(transport_config const & config) :
+	base_transport(config),
+	lock_(),
+	waiter_(),
+	waiter_lock_(),
+	config_(config),
+	http_context_(),
+	stop_(true),
+	listen_fd_(-1),
+	epoll_fd_(-1),
+	wakeup_fd_(-1),
+	accept_paused_(false),
+	connections_(),
+	closing_(),
+	jobs_lock_(),
+	jobs_waiter_(),
+	jobs_(),
+	jobs_stat_(),
+	finished_(),
+	loop_thread_(),
+	workers_()
+{
+	BOOST_ASSERT(config_.context != NULL);
+	transport_workers_stat const empty = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	jobs_stat_ = empty;
+}
+
+http_epoll_transport::~http_epoll_transport()
+{
+	stop_connection();
+}
+
+void http_epoll_transport::initialize()
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	validate_config();
+}
+
+void http_epoll_transport::establish_connection()
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (!stop_)
+		throw transport_exception("this transport already in use");
+
+	if (!config_.context)
+		throw transport_exception("http_*_transport::context not valid or ill configurated");
+
+	http_context_ =
+			transport_context_cast<http_transport_event_handler>(config_.context);
+	if (!http_context_)
+		throw transport_exception("http_*_transport::context not valid or ill configurated");
+
+	open_listener();
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	if ((epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC)) == -1 ||
+		(wakeup_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) == -1 ||
+		(ev.data.ptr = &listen_fd_, ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev)) == -1 ||
+		(ev.data.ptr = &wakeup_fd_, ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &ev)) == -1)
+	{
+		close_all();
+		throw transport_exception("can not create epoll event loop");
+	}
+
+	stop_ = false;
+	accept_paused_ = false;
+	loop_thread_.reset(new boost::thread(boost::bind(&http_epoll_transport::event_loop, this)));
+	for (std::size_t it = 0; it < std::max<std::size_t>(config_.max_threads, 1); ++it)
+		workers_.push_back(boost::make_shared<boost::thread>(boost::bind(&http_epoll_transport::worker_loop, this)));
+}
+
+bool http_epoll_transport::is_connected() const
+{
+	return (!stop_);
+}
+
+void http_epoll_transport::stop_connection()
+{
+	/*  Event loop breaks all connections before exit, so workers blocked on
+	 	the client output wake up, then all sockets closed after workers joined */
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (stop_)
+		return;
+
+	stop_ = true;
+	wakeup_loop();
+	loop_thread_->join();
+	loop_thread_.reset();
+
+	{
+		boost::lock_guard<boost::mutex> jobs_guard(jobs_lock_);
+		jobs_.clear();
+	}
+	jobs_waiter_.notify_all();
+	for (std::size_t it = 0; it < workers_.size(); ++it)
+		workers_[it]->join();
+	workers_.clear();
+
+	close_all();
+
+	boost::lock_guard<boost::mutex> waiter_guard(waiter_lock_);
+	waiter_.notify_all();
+}
+
+transport_workers_stat http_epoll_transport::get_workers_stat() const
+{
+	/*  Workers count is fixed, handlers do not block on the torrent data(requests are parked by the core) */
+	boost::lock_guard<boost::mutex> guard(jobs_lock_);
+	transport_workers_stat stat = jobs_stat_;
+	stat.threads = stat.peak_threads = stat.min_threads = stat.max_threads = workers_.size();
+	stat.queued = jobs_.size();
+	return stat;
+}
+
+void http_epoll_transport::wait()
+{
+	boost::unique_lock<boost::mutex> locker(waiter_lock_);
+	while (!stop_)
+		waiter_.wait(locker);
+}
+
+/**
+ * Private http_epoll_transport api
+ */
+
+void http_epoll_transport::validate_config() const
+{
+	if (config_.port.empty())
+		throw transport_exception("http_epoll_transport::port not set");
+}
+
+void http_epoll_transport::open_listener()
+{
+	struct addrinfo hints, * result = NULL;
+	std::memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	if (::getaddrinfo(config_.ip_addr.empty() ? NULL : config_.ip_addr.c_str(),
+			config_.port.c_str(), &hints, &result) != 0)
+		throw transport_exception("can not resolve listening address");
+
+	for (struct addrinfo * it = result; it && listen_fd_ == -1; it = it->ai_next) {
+		int const sock = ::socket(it->ai_family, it->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, it->ai_protocol);
+		if (sock == -1)
+			continue;
+		int const reuse = 1;
+		::setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (::bind(sock, it->ai_addr, it->ai_addrlen) == 0 && ::listen(sock, SOMAXCONN) == 0)
+			listen_fd_ = sock;
+		else
+			::close(sock);
+	} // for
+	::freeaddrinfo(result);
+
+	if (listen_fd_ == -1)
+		throw transport_exception("can not listen port " + config_.port);
+}
+
+void http_epoll_transport::close_all()
+{
+	for (connections_type::iterator first = connections_.begin(), last = connections_.end();
+		first != last;
+		++first)
+	{
+		if (!first->second->closed)
+			::close(first->second->sock);
+		first->second->closed = true;
+	}
+	connections_.clear();
+	closing_.clear();
+
+	/* Suspended replies could be finished by the core threads even now(see finish_request) */
+	{
+		boost::lock_guard<boost::mutex> guard(jobs_lock_);
+		finished_.clear();
+		if (wakeup_fd_ != -1)
+			::close(wakeup_fd_);
+		wakeup_fd_ = -1;
+	}
+
+	if (listen_fd_ != -1)
+		::close(listen_fd_);
+	if (epoll_fd_ != -1)
+		::close(epoll_fd_);
+	listen_fd_ = epoll_fd_ = -1;
+}
+
+void http_epoll_transport::event_loop()
+{
+	struct epoll_event events[HTTP_EPOLL_MAX_EVENTS];
+	std::time_t last_sweep = std::time(NULL);
+
+	while (!stop_) {
+		int const ready = ::epoll_wait(epoll_fd_, events, HTTP_EPOLL_MAX_EVENTS, 1000);
+		if (ready < 0 && errno != EINTR) {
+			LC_WARNING("epoll_wait failed, errno '%i'", errno)
+			break;
+		}
+
+		for (int it = 0; it < ready; ++it) {
+			if (events[it].data.ptr == &listen_fd_)
+				accept_connections();
+			else if (events[it].data.ptr == &wakeup_fd_)
+				handle_finished();
+			else {
+				connections_type::iterator const found =
+					connections_.find(static_cast<epoll_connection *>(events[it].data.ptr));
+				if (found != connections_.end())
+					handle_io(found->second, events[it].events);
+			}
+		} // for
+
+		std::time_t const now = std::time(NULL);
+		if (now != last_sweep) {
+			sweep_idle_connections();
+			resume_accept();
+			last_sweep = now;
+		}
+
+		for (std::size_t it = 0; it < closing_.size(); ++it)
+			close_connection(closing_[it]);
+		closing_.clear();
+	} // while
+
+	/*  Stop : break all connections, workers get write errors and finish theirs requests */
+	for (connections_type::iterator first = connections_.begin(), last = connections_.end();
+		first != last;
+		++first)
+	{
+		epoll_connection::completions_type completed;
+		boost::mutex::scoped_lock guard(first->second->lock);
+		first->second->break_unsafe(completed);
+		::shutdown(first->second->sock, SHUT_RDWR);
+		guard.unlock();
+		epoll_run_completions(completed);
+	}
+}
+
+void http_epoll_transport::accept_connections()
+{
+	for (;;) {
+		int const sock = ::accept4(listen_fd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (sock == -1) {
+			int const error = errno;
+			if (error == EINTR)
+				continue;
+			if (error == EMFILE || error == ENFILE || error == ENOBUFS || error == ENOMEM)
+				pause_accept(error);
+			else if (error != EAGAIN && error != EWOULDBLOCK)
+				LC_WARNING("accept failed, errno '%i'", error)
+			return;
+		} // if
+
+		int const no_delay = 1;
+		::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &no_delay, sizeof(no_delay));
+
+		epoll_connection_ptr conn(new epoll_connection(sock, epoll_fd_));
+		boost::mutex::scoped_lock guard(conn->lock);
+		conn->update_events_unsafe();
+		if (conn->events == 0) {
+			::close(sock);
+			continue;
+		}
+		connections_[conn.get()] = conn;
+	} // for
+}
+
+void http_epoll_transport::pause_accept(int error)
+{
+	/*  Listen socket is level triggered : while descriptors are exhausted the pending client 
+	 	wakes the loop again at once, so accepting paused till the next sweep(clients wait in the backlog) */
+	struct epoll_event ev;
+	ev.events = 0;
+	ev.data.ptr = &listen_fd_;
+	if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, listen_fd_, &ev) == 0)
+		accept_paused_ = true;
+	LC_WARNING("accept failed, errno '%i', accepting paused", error)
+}
+
+void http_epoll_transport::resume_accept()
+{
+	if (!accept_paused_)
+		return;
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listen_fd_;
+	if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, listen_fd_, &ev) == 0)
+		accept_paused_ = false;
+}
+
+void http_epoll_transport::handle_io(epoll_connection_ptr conn, unsigned events)
+{
+	epoll_connection::completions_type completed;
+	boost::mutex::scoped_lock guard(conn->lock);
+	if (conn->closed)
+		return;
+
+	conn->last_activity = std::time(NULL);
+	if (events & (EPOLLERR | EPOLLHUP))
+		conn->break_unsafe(completed);
+
+	/*  Read all avaliable bytes(up to the input limit), while the connection busy
+	 	pipelined requests just stay in the input buffer */
+	if (!conn->broken && (events & (EPOLLIN | EPOLLRDHUP))) {
+		char buffer[4096];
+		while (conn->in.size() < epoll_connection::max_input_size) {
+			std::size_t const to_read =
+				std::min<std::size_t>(sizeof(buffer), epoll_connection::max_input_size - conn->in.size());
+			ssize_t const readed = ::recv(conn->sock, buffer, to_read, MSG_DONTWAIT);
+			if (readed > 0) {
+				conn->in.append(buffer, readed);
+				continue;
+			}
+			if (readed < 0 && errno == EINTR)
+				continue;
+			if (readed < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+			conn->break_unsafe(completed);
+			break;
+		} // while
+	} // if
+
+	if (!conn->broken && (events & EPOLLOUT))
+		conn->flush_unsafe(completed);
+
+	if (!conn->broken) {
+		conn->update_events_unsafe();
+		if (!conn->busy)
+			try_dispatch_unsafe(conn);
+	}
+	close_if_done_unsafe(conn);
+	guard.unlock();
+
+	epoll_run_completions(completed);
+}
+
+void http_epoll_transport::handle_finished()
+{
+	boost::uint64_t counter = 0;
+	while (::read(wakeup_fd_, &counter, sizeof(counter)) > 0)
+		{ /**/ }
+
+	std::vector<epoll_connection_ptr> finished;
+	{
+		boost::lock_guard<boost::mutex> guard(jobs_lock_);
+		finished.swap(finished_);
+	}
+
+	/*  Reply of the connection completed, so next pipelined request could be dispatched */
+	for (std::size_t it = 0; it < finished.size(); ++it) {
+		epoll_connection_ptr conn = finished[it];
+		boost::mutex::scoped_lock guard(conn->lock);
+		if (conn->closed)
+			continue;
+		if (!conn->broken && !conn->busy) {
+			conn->update_events_unsafe();
+			try_dispatch_unsafe(conn);
+		}
+		close_if_done_unsafe(conn);
+	} // for
+}
+
+void http_epoll_transport::sweep_idle_connections()
+{
+	std::time_t const now = std::time(NULL);
+	for (connections_type::iterator first = connections_.begin(), last = connections_.end();
+		first != last;
+		++first)
+	{
+		epoll_connection_ptr const & conn = first->second;
+		boost::mutex::scoped_lock guard(conn->lock);
+		if (!conn->closed && !conn->busy && conn->out.empty() &&
+			now - conn->last_activity > HTTP_EPOLL_KEEP_ALIVE_TIMEOUT)
+		{
+			conn->keep_alive = false;
+			close_if_done_unsafe(conn);
+		}
+	} // for
+}
+
+void http_epoll_transport::try_dispatch_unsafe(epoll_connection_ptr conn)
+{
+	/*  One request at time per connection : the next pipelined request
+	 	dispatched only after the reply of the previous one was completed */
+	std::size_t const headers_end = conn->in.find("\r\n\r\n");
+	if (headers_end == std::string::npos) {
+		if (conn->in.size() >= epoll_connection::max_input_size)
+			stock_reply_unsafe(conn, "431 Request Header Fields Too Large");
+		return;
+	}
+
+	request_job job;
+	job.conn = conn;
+	job.request.http_version_major = job.request.http_version_minor = 0;
+	utility::http_request_parser parser;
+	boost::tribool parsed = boost::indeterminate;
+	boost::tie(parsed, boost::tuples::ignore) =
+		parser.parse(job.request, conn->in.begin(), conn->in.begin() + headers_end + 4);
+	if (!(parsed == true)) {
+		stock_reply_unsafe(conn, "400 Bad Request");
+		return;
+	}
+
+	/*  Request body(eg POST) is not used, but it must be skipped. The chunked body could not be
+	 	skipped without decoding, which is not supported(and not needed by players) */
+	char const * transfer_encoding = epoll_get_header(job.request.headers, "Transfer-Encoding");
+	if (transfer_encoding && !boost::algorithm::iequals(transfer_encoding, "identity")) {
+		stock_reply_unsafe(conn, "501 Not Implemented");
+		return;
+	}
+	char const * content_length = epoll_get_header(job.request.headers, "Content-Length");
+	boost::int64_t const body_size = content_length ? std::strtoll(content_length, NULL, 10) : 0;
+	if (body_size < 0 || headers_end + 4 + body_size > epoll_connection::max_input_size) {
+		stock_reply_unsafe(conn, "413 Request Entity Too Large");
+		return;
+	}
+	if (conn->in.size() < headers_end + 4 + body_size)
+		return;
+	conn->in.erase(0, headers_end + 4 + body_size);
+
+	char const * connection = epoll_get_header(job.request.headers, "Connection");
+	bool const http_11 = (job.request.http_version_major == 1 && job.request.http_version_minor == 1);
+	conn->keep_alive = http_11 && !(connection && boost::algorithm::iequals(connection, "close"));
+	conn->busy = true;
+	conn->update_events_unsafe();
+
+#if defined(T2H_DEEP_DEBUG)
+	LC_TRACE("new request dispatched, method '%s', uri '%s'",
+		job.request.method.c_str(), job.request.uri.c_str())
+#endif // T2H_DEEP_DEBUG
+
+	job.queued_at = boost::get_system_time();
+	boost::lock_guard<boost::mutex> guard(jobs_lock_);
+	jobs_.push_back(job);
+	jobs_waiter_.notify_one();
+}
+
+void http_epoll_transport::close_if_done_unsafe(epoll_connection_ptr conn)
+{
+	/*  Connection owned by the worker never closed, it closed after the request finished */
+	if (conn->closed || conn->busy)
+		return;
+	if (conn->broken || (!conn->keep_alive && conn->out.empty())) {
+		conn->closed = true;
+		closing_.push_back(conn);
+	}
+}
+
+void http_epoll_transport::close_connection(epoll_connection_ptr conn)
+{
+	if (conn->events != 0)
+		::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn->sock, NULL);
+	::close(conn->sock);
+	connections_.erase(conn.get());
+}
+
+void http_epoll_transport::stock_reply_unsafe(epoll_connection_ptr conn, char const * status)
+{
+	epoll_connection::completions_type completed;
+	conn->out.push_back(epoll_connection::segment());
+	conn->out.back().bytes = std::string("HTTP/1.1 ") + status +
+		"\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+	conn->out.back().offset = 0;
+	conn->out_bytes += conn->out.back().bytes.size();
+	conn->keep_alive = false;
+	conn->in.clear();
+	conn->flush_unsafe(completed);
+}
+
+void http_epoll_transport::wakeup_loop()
+{
+	boost::uint64_t const counter = 1;
+	if (::write(wakeup_fd_, &counter, sizeof(counter)) != sizeof(counter))
+		LC_WARNING("event loop wakeup failed, errno '%i'", errno)
+}
+
+void http_epoll_transport::worker_loop()
+{
+	for (;;) {
+		request_job job;
+		{
+			boost::unique_lock<boost::mutex> guard(jobs_lock_);
+			++jobs_stat_.idle_threads;
+			while (!stop_ && jobs_.empty())
+				jobs_waiter_.wait(guard);
+			--jobs_stat_.idle_threads;
+			if (stop_)
+				return;
+			job = jobs_.front();
+			jobs_.pop_front();
+			double const wait_ms = (boost::get_system_time() - job.queued_at).total_microseconds() / 1000.0;
+			++jobs_stat_.dequeued;
+			jobs_stat_.wait_ms_total += wait_ms;
+			jobs_stat_.wait_ms_max = std::max(jobs_stat_.wait_ms_max, wait_ms);
+		}
+		handle_request(job);
+	} // for
+}
+
+void http_epoll_transport::handle_request(request_job & job)
+{
+	/*  Same dispatching as the mongoose transport does, but exactly one handler per request,
+	 	if the handler did not reply at all(eg file not found) 404 sent */
+	utility::http_request const & request = job.request;
+	bool const http_11 = (request.http_version_major == 1 && request.http_version_minor == 1),
+		http_10 = (request.http_version_major == 1 && request.http_version_minor == 0);
+	utility::conditional_header conditions;
+	char const * header = NULL;
+	if ((header = epoll_get_header(request.headers, "If-None-Match")))
+		conditions.if_none_match = header;
+	if ((header = epoll_get_header(request.headers, "If-Modified-Since")))
+		conditions.if_modified_since = header;
+	if ((header = epoll_get_header(request.headers, "If-Range")))
+		conditions.if_range = header;
+
+	std::string uri;
+	utility::range_header rheader;
+	char const * error_reply = NULL;
+	if (!http_11 && !http_10)
+		error_reply = "HTTP/1.1 505 HTTP Version Not Supported\r\n";
+	else if (!utility::url_decode(request.uri.substr(0, request.uri.find('?')), uri) ||
+		uri.empty() || uri[0] != '/' || epoll_has_dot_segment(uri))
+		error_reply = "HTTP/1.1 400 Bad Request\r\n";
+	else if (request.mtype == utility::http_request::munknown)
+		error_reply = "HTTP/1.1 501 Not Implemented\r\n";
+
+	/*  The handler could suspend the reply(eg request waits for the torrent bytes), 
+	 	so the request finished by the reply_done when the last reference of the reply completed */
+	boost::shared_ptr<epoll_socket_ostream> socket_ostream = boost::make_shared<epoll_socket_ostream>(
+		job.conn, 
+		request.mtype == utility::http_request::mhead, 
+		boost::bind(&http_epoll_transport::reply_done, this, _1, job.conn, error_reply));
+
+	STD_EXCEPTION_HANDLE_START
+	if (!error_reply) {
+		uri = utility::http_normalize_uri(uri);
+		char const * range = epoll_get_header(request.headers, "Range");
+		if (http_11 && request.mtype == utility::http_request::mget &&
+			range && utility::http_translate_range_header(rheader, std::string(range)))
+			http_context_->on_partial_content_request(socket_ostream, uri, rheader, conditions);
+		else if (request.mtype == utility::http_request::mhead)
+			http_context_->on_head_request(socket_ostream, uri, conditions);
+		else
+			http_context_->on_content_request(socket_ostream, uri, conditions);
+	} // if
+	STD_EXCEPTION_HANDLE_END
+
+	socket_ostream->complete();
+}
+
+void http_epoll_transport::reply_done(
+	epoll_socket_ostream & socket_ostream, epoll_connection_ptr conn, char const * error_reply)
+{
+	if (!socket_ostream.is_reply_started()) {
+		std::string const reply = std::string(error_reply ? error_reply : "HTTP/1.1 404 Not Found\r\n") +
+			"Content-Length: 0\r\n\r\n";
+		socket_ostream.write(reply.c_str(), reply.size());
+	}
+	finish_request(conn, socket_ostream.is_reply_completed());
+}
+
+void http_epoll_transport::finish_request(epoll_connection_ptr conn, bool reply_completed)
+{
+	/*  Not completed reply(eg the core failed in the middle of the body)
+	 	breaks framing of the connection, so it can not be kept alive */
+	{
+		boost::lock_guard<boost::mutex> guard(conn->lock);
+		conn->busy = false;
+		conn->keep_alive = conn->keep_alive && reply_completed;
+		conn->last_activity = std::time(NULL);
+	}
+	boost::lock_guard<boost::mutex> guard(jobs_lock_);
+	if (stop_)
+		return;
+	finished_.push_back(conn);
+	wakeup_loop();
+}
+
+} } // namespace common, details
+
+#undef HTTP_EPOLL_MAX_EVENTS
+#undef HTTP_EPOLL_KEEP_ALIVE_TIMEOUT
+#undef STD_EXCEPTION_HANDLE_START
+#undef STD_EXCEPTION_HANDLE_END
+
@@ -0,0 +1,98 @@
+#ifndef HTTP_EPOLL_TRANSPORT_HPP_INCLUDED
+#define HTTP_EPOLL_TRANSPORT_HPP_INCLUDED
+
+#include "http_utility.hpp"
+#include "base_transport.hpp"
+#include "http_transport_context.hpp"
+#include "http_epoll_socket_ostream.hpp"
+
+#include <deque>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace common { namespace details {
+
+/**
+ * http_epoll_transport event driven http transport(Linux only).
+ * One event loop thread owns all non-blocking sockets : accepts clients, reads requests,
+ * flushes queued replies and closes idle keep-alive connections. Complete requests handed
+ * to the config.max_threads workers, pipelined requests of the one connection handled in order.
+ */
+class http_epoll_transport : public base_transport {
+public :
+	explicit http_epoll_transport(transport_config const & config);
+	virtual ~http_epoll_transport();
+
+	virtual void initialize();
+	virtual void establish_connection();
+	virtual bool is_connected() const;
+	virtual void stop_connection();
+	virtual void wait();
+
+	virtual transport_workers_stat get_workers_stat() const;
+
+private :
+	struct request_job {
+		epoll_connection_ptr conn;
+		utility::http_request request;
+		boost::system_time queued_at;
+	};
+
+	typedef boost::unordered_map<epoll_connection *, epoll_connection_ptr> connections_type;
+	typedef std::deque<request_job> jobs_type;
+
+	void validate_config() const;
+	void open_listener();
+	void close_all();
+
+	/* Event loop thread */
+	void event_loop();
+	void accept_connections();
+	void pause_accept(int error);
+	void resume_accept();
+	void handle_io(epoll_connection_ptr conn, unsigned events);
+	void handle_finished();
+	void sweep_idle_connections();
+	void try_dispatch_unsafe(epoll_connection_ptr conn);
+	void close_if_done_unsafe(epoll_connection_ptr conn);
+	void close_connection(epoll_connection_ptr conn);
+	void stock_reply_unsafe(epoll_connection_ptr conn, char const * status);
+	void wakeup_loop();
+
+	/* Worker threads */
+	void worker_loop();
+	void handle_request(request_job & job);
+	void reply_done(epoll_socket_ostream & socket_ostream, epoll_connection_ptr conn, char const * error_reply);
+	void finish_request(epoll_connection_ptr conn, bool reply_completed);
+
+	boost::mutex mutable lock_;
+	boost::condition_variable mutable waiter_;
+	boost::mutex mutable waiter_lock_;
+	transport_config mutable config_;
+	http_transport_event_handler_ptr http_context_;
+	bool volatile stop_;
+
+	int listen_fd_;
+	int epoll_fd_;
+	int wakeup_fd_;
+	bool accept_paused_;						// Listen socket disarmed till the next sweep(descriptors exhausted)
+	connections_type connections_;				// Owned by the event loop thread
+	std::vector<epoll_connection_ptr> closing_;	// Closed after the current epoll_wait batch
+
+	boost::mutex mutable jobs_lock_;
+	boost::condition_variable jobs_waiter_;
+	jobs_type jobs_;
+	transport_workers_stat jobs_stat_;				// Idle workers and queue wait time(guarded by jobs_lock_)
+	std::vector<epoll_connection_ptr> finished_;	// Connections which request handled by worker(guarded by jobs_lock_)
+
+	boost::scoped_ptr<boost::thread> loop_thread_;
+	std::vector<boost::shared_ptr<boost::thread> > workers_;
+
+};
+
+} } // namespace common, details
+
+#endif
+
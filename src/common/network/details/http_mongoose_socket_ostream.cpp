@@ -1,4 +1,5 @@
 #include "http_mongoose_socket_ostream.hpp"
+#include "zero_copy_transfer.hpp"
 
 namespace common { namespace details {
 
@@ -19,6 +20,7 @@ std::size_t mongoose_socket_ostream::write(char const * bytes, std::size_t bytes
 	int writed = 0;
 	if ((writed = mg_write(conn_, bytes, bytes_size)) <= 0)
 		return 0;
+	mg_add_bytes_sent(conn_, writed);
 	return writed;
 }
 
@@ -30,5 +32,51 @@ void mongoose_socket_ostream::async_write(
 	com_routine(-1, 0);
 }
 
+bool mongoose_socket_ostream::is_zero_copy_supported() const 
+{
+	BOOST_ASSERT(conn_ != NULL);
+	return (zero_copy_supported() && mg_get_raw_socket(conn_) != -1);
+}
+
+std::size_t mongoose_socket_ostream::write_file(int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	BOOST_ASSERT(conn_ != NULL);
+	boost::int64_t writed = 0;
+	if ((writed = zero_copy_transfer(mg_get_raw_socket(conn_), fd, offset, bytes_size)) <= 0)
+		return 0;
+	/* Bytes bypassed mg_write, so the connection does not know about them */
+	mg_add_bytes_sent(conn_, writed);
+	return writed;
+}
+
+std::size_t mongoose_socket_ostream::write_gather(
+	char const * head, std::size_t head_size, char const * bytes, std::size_t bytes_size) 
+{
+	/*  mg_write sends at once, so the head and the body coalesced under the cork of the raw socket */
+	BOOST_ASSERT(conn_ != NULL);
+	int const sock = mg_get_raw_socket(conn_);
+	bool const corked = socket_cork(sock, true);
+	std::size_t writed = 0;
+	if (write(head, head_size) == head_size)
+		writed = write(bytes, bytes_size);
+	if (corked)
+		socket_cork(sock, false);
+	return writed;
+}
+
+std::size_t mongoose_socket_ostream::write_file_gather(
+	char const * head, std::size_t head_size, int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	BOOST_ASSERT(conn_ != NULL);
+	int const sock = mg_get_raw_socket(conn_);
+	bool const corked = socket_cork(sock, true);
+	std::size_t writed = 0;
+	if (write(head, head_size) == head_size)
+		writed = write_file(fd, offset, bytes_size);
+	if (corked)
+		socket_cork(sock, false);
+	return writed;
+}
+
 } } // nemespace common, details 
 
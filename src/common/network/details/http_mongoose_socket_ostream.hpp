@@ -25,6 +25,14 @@ public :
 	virtual void async_write(
 		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine);
 
+	virtual bool is_zero_copy_supported() const;
+	virtual std::size_t write_file(int fd, boost::int64_t offset, std::size_t bytes_size);
+
+	virtual std::size_t write_gather(
+		char const * head, std::size_t head_size, char const * bytes, std::size_t bytes_size);
+	virtual std::size_t write_file_gather(
+		char const * head, std::size_t head_size, int fd, boost::int64_t offset, std::size_t bytes_size);
+
 private :
 	struct mg_connection * conn_;
 
@@ -3,8 +3,11 @@
 #include "lc_trace.hpp"
 #include "http_utility.hpp"
 #include "http_reply_resources.hpp"
+#include "request_arena.hpp"
 
 #include <boost/assert.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
 
 #define NOT_NULL (void *)1
 #define STD_EXCEPTION_HANDLE_START try {
@@ -41,6 +44,17 @@ static inline bool mon_is_range_request(
 	return false;
 }
 
+static inline void mon_get_conditional_headers(struct mg_connection * conn, utility::conditional_header & conditions) 
+{
+	char const * header = NULL;
+	if ((header = mg_get_header(conn, "If-None-Match")))
+		conditions.if_none_match = header;
+	if ((header = mg_get_header(conn, "If-Modified-Since")))
+		conditions.if_modified_since = header;
+	if ((header = mg_get_header(conn, "If-Range")))
+		conditions.if_range = header;
+}
+
 static inline bool mon_is_head_request(struct mg_connection * conn, struct mg_request_info const * ri) 
 {
 	BOOST_ASSERT(ri != NULL);
@@ -102,17 +116,26 @@ void http_mongoose_transport::establish_connection()
 	if (mg_handle_)
 		throw transport_exception("this transport already in use");
 	
+	/*  Elastic workers pool : min_threads workers always avaliable, more workers(up to max_threads)
+	 	started then all workers are busy(eg blocked on the torrent data), idle ones exit after idle_timeout */
+	std::size_t const min_threads = (config_.min_threads == 0 || config_.min_threads > config_.max_threads) ? 
+		config_.max_threads : config_.min_threads;
+	std::string const num_threads = boost::lexical_cast<std::string>(min_threads), 
+		max_threads = boost::lexical_cast<std::string>(config_.max_threads), 
+		idle_timeout = boost::lexical_cast<std::string>(config_.idle_timeout == 0 ? 60 : config_.idle_timeout);
 	const char * mongoose_options[] = {
 		"document_root", config_.doc_root.c_str(),		// doc root
 		"listening_ports", config_.port.c_str(),		// avaliavle ports
 		"enable_directory_listing", "no",				// off directory listing
-		"num_threads", "6",								// number of wrokers
+		"num_threads", num_threads.c_str(),				// number of workers kept even if idle
+		"max_threads", max_threads.c_str(),				// max number of workers
+		"thread_idle_timeout", idle_timeout.c_str(),	// idle time before extra worker exit, in secs
 		NULL											// options end
 	};
 
 	mg_handle_ = mg_start(&redirect_to_http_mongoose_transport_dispatcher, 
 						static_cast<void*>(this), mongoose_options);
-	if (!mg_start) 
+	if (!mg_handle_) 
 		throw transport_exception("can not start mongoose");
 
 	if (!config_.context)
@@ -151,6 +174,27 @@ void http_mongoose_transport::wait()
 	} // wait loop
 }
 	
+transport_workers_stat http_mongoose_transport::get_workers_stat() const 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	transport_workers_stat stat = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+	if (!mg_handle_)
+		return stat;
+	
+	struct mg_pool_stat mstat;
+	mg_get_pool_stat(mg_handle_, &mstat);
+	stat.threads = mstat.threads;
+	stat.idle_threads = mstat.idle_threads;
+	stat.peak_threads = mstat.peak_threads;
+	stat.min_threads = mstat.min_threads;
+	stat.max_threads = mstat.max_threads;
+	stat.queued = mstat.queued;
+	stat.dequeued = mstat.consumed;
+	stat.wait_ms_total = mstat.wait_ms_total;
+	stat.wait_ms_max = mstat.wait_ms_max;
+	return stat;
+}
+	
 void * http_mongoose_transport::dispatch_http_message(
 	enum mg_event event, struct mg_connection * conn, struct mg_request_info const * ri) 
 {
@@ -158,8 +202,14 @@ void * http_mongoose_transport::dispatch_http_message(
 	 	we must prevent any chance to lose exception from context functions */
 	STD_EXCEPTION_HANDLE_START
 
+	/*  The socket ostream allocated from the request arena, 
+	 	all owners of the ostream must release it till the request handled */
+	typedef utility::request_arena<256> socket_ostream_arena;
+	socket_ostream_arena arena;
 	utility::range_header rheader;	
-	base_transport_ostream_ptr socket_ostream(new details::mongoose_socket_ostream(conn));
+	utility::conditional_header conditions;
+	base_transport_ostream_ptr socket_ostream = boost::allocate_shared<details::mongoose_socket_ostream>(
+		utility::arena_allocator<details::mongoose_socket_ostream, socket_ostream_arena>(arena), conn);
 	std::string const uri = utility::http_normalize_uri_c(ri->uri);
 	switch (event) 
 	{	
@@ -170,12 +220,14 @@ void * http_mongoose_transport::dispatch_http_message(
 			LC_TRACE("new request came from '%i', method '%s', uri '%s'", 
 				ri->remote_ip, ri->request_method, ri->uri)
 #endif // T2H_DEEP_DEBUG
+			/*  NOTE : Exactly one reply per request, range request is also content request */
+			mon_get_conditional_headers(conn, conditions);
 			if (mon_is_range_request(conn, ri, rheader)) 
-				http_context_->on_partial_content_request(socket_ostream, uri , rheader);
-			if (mon_is_head_request(conn, ri))
-				http_context_->on_head_request(socket_ostream, uri);
-			if (mon_is_content_requst(conn, ri))
-				http_context_->on_content_request(socket_ostream, uri);
+				http_context_->on_partial_content_request(socket_ostream, uri, rheader, conditions);
+			else if (mon_is_head_request(conn, ri))
+				http_context_->on_head_request(socket_ostream, uri, conditions);
+			else if (mon_is_content_requst(conn, ri))
+				http_context_->on_content_request(socket_ostream, uri, conditions);
 #if defined(T2H_DEEP_DEBUG)
 			LC_TRACE("reply was sended for '%i', method '%s', uri '%s'", 
 				ri->remote_ip, ri->request_method, ri->uri)
@@ -28,6 +28,8 @@ public :
 	virtual void stop_connection();
 	virtual void wait();
 
+	virtual transport_workers_stat get_workers_stat() const;
+
 	void * dispatch_http_message(enum mg_event event, struct mg_connection * conn, struct mg_request_info const * ri);
 
 private :
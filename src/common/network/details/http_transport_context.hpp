@@ -29,10 +29,12 @@ public :
 	 */
 
 	/* Over HTTP headers operations */
-	virtual void on_partial_content_request(
-		base_transport_ostream_ptr ostream, std::string const & uri, utility::range_header const & range) = 0;
-	virtual void on_head_request(base_transport_ostream_ptr ostream, std::string const & uri) = 0;
-	virtual void on_content_request(base_transport_ostream_ptr ostream, std::string const & uri) = 0;	
+	virtual void on_partial_content_request(base_transport_ostream_ptr ostream, 
+		std::string const & uri, utility::range_header const & range, utility::conditional_header const & conditions) = 0;
+	virtual void on_head_request(
+		base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions) = 0;
+	virtual void on_content_request(
+		base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions) = 0;	
 
 };
 
@@ -442,6 +442,7 @@ enum {
   GLOBAL_PASSWORDS_FILE, INDEX_FILES, ENABLE_KEEP_ALIVE, ACCESS_CONTROL_LIST,
   EXTRA_MIME_TYPES, LISTENING_PORTS, DOCUMENT_ROOT, SSL_CERTIFICATE,
   NUM_THREADS, RUN_AS_USER, REWRITE, HIDE_FILES,
+  MAX_THREADS, THREAD_IDLE_TIMEOUT,
   NUM_OPTIONS
 };
 
@@ -469,6 +470,8 @@ static const char *config_options[] = {
   "u", "run_as_user", NULL,
   "w", "url_rewrite_patterns", NULL,
   "x", "hide_files_patterns", NULL,
+  "y", "max_threads", NULL,
+  "z", "thread_idle_timeout", "60",
   NULL
 };
 #define ENTRIES_PER_CONFIG_OPTION 3
@@ -487,11 +490,24 @@ struct mg_context {
   pthread_mutex_t mutex;     // Protects (max|num)_threads
   pthread_cond_t  cond;      // Condvar for tracking workers terminations
 
+  // Elastic pool: workers started on demand up to max_threads,
+  // idle workers above min_threads exit after idle_timeout
+  int min_threads;           // Workers kept even if idle (num_threads option)
+  int max_threads;           // Upper bound of workers (max_threads option)
+  int idle_timeout;          // Seconds, thread_idle_timeout option
+  volatile int idle_threads; // Workers waiting in consume_socket()
+  int peak_threads;          // Max of num_threads since start
+
   struct socket queue[20];   // Accepted sockets
+  int64_t sq_time[20];       // Time (ms) when socket was queued
   volatile int sq_head;      // Head of the socket queue
   volatile int sq_tail;      // Tail of the socket queue
   pthread_cond_t sq_full;    // Signaled when socket is produced
   pthread_cond_t sq_empty;   // Signaled when socket is consumed
+
+  unsigned long sq_consumed; // Total count of consumed sockets
+  double sq_wait_total;      // Total time (ms) sockets spent in the queue
+  double sq_wait_max;        // Max time (ms) socket spent in the queue
 };
 
 struct mg_connection {
@@ -984,6 +1000,21 @@ static int pthread_cond_wait(pthread_cond_t *cv, pthread_mutex_t *mutex) {
   return WaitForSingleObject(*mutex, INFINITE) == WAIT_OBJECT_0? 0 : -1;
 }
 
+// Wait at most ms milliseconds, return non-zero on timeout
+static int mg_cond_timedwait(pthread_cond_t *cv, pthread_mutex_t *mutex,
+                             int ms) {
+  HANDLE handles[] = {cv->signal, cv->broadcast};
+  DWORD res;
+  ReleaseMutex(*mutex);
+  res = WaitForMultipleObjects(2, handles, FALSE, (DWORD) ms);
+  (void) WaitForSingleObject(*mutex, INFINITE);
+  return res == WAIT_TIMEOUT;
+}
+
+static int64_t mg_time_ms(void) {
+  return (int64_t) GetTickCount();
+}
+
 static int pthread_cond_signal(pthread_cond_t *cv) {
   return SetEvent(cv->signal) == 0 ? -1 : 0;
 }
@@ -1348,6 +1379,28 @@ static void set_close_on_exec(int fd) {
   fcntl(fd, F_SETFD, FD_CLOEXEC);
 }
 
+// Wait at most ms milliseconds, return non-zero on timeout
+static int mg_cond_timedwait(pthread_cond_t *cv, pthread_mutex_t *mutex,
+                             int ms) {
+  struct timeval now;
+  struct timespec abstime;
+
+  gettimeofday(&now, NULL);
+  abstime.tv_sec = now.tv_sec + ms / 1000;
+  abstime.tv_nsec = now.tv_usec * 1000 + (long) (ms % 1000) * 1000000;
+  if (abstime.tv_nsec >= 1000000000) {
+    abstime.tv_sec++;
+    abstime.tv_nsec -= 1000000000;
+  }
+  return pthread_cond_timedwait(cv, mutex, &abstime) == ETIMEDOUT;
+}
+
+static int64_t mg_time_ms(void) {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
 int mg_start_thread(mg_thread_func_t func, void *param) {
   pthread_t thread_id;
   pthread_attr_t attr;
@@ -1574,6 +1627,33 @@ int mg_write(struct mg_connection *conn, const void *buf, size_t len) {
   return (int) total;
 }
 
+void mg_get_pool_stat(struct mg_context *ctx, struct mg_pool_stat *stat) {
+  (void) pthread_mutex_lock(&ctx->mutex);
+  stat->threads = ctx->num_threads;
+  stat->idle_threads = ctx->idle_threads;
+  stat->peak_threads = ctx->peak_threads;
+  stat->min_threads = ctx->min_threads;
+  stat->max_threads = ctx->max_threads;
+  stat->queued = ctx->sq_head - ctx->sq_tail;
+  stat->consumed = ctx->sq_consumed;
+  stat->wait_ms_total = ctx->sq_wait_total;
+  stat->wait_ms_max = ctx->sq_wait_max;
+  (void) pthread_mutex_unlock(&ctx->mutex);
+}
+
+int mg_get_raw_socket(const struct mg_connection *conn) {
+  if (conn == NULL || conn->ssl != NULL || conn->throttle > 0) {
+    return -1;
+  }
+  return (int) conn->client.sock;
+}
+
+void mg_add_bytes_sent(struct mg_connection *conn, long long bytes) {
+  if (conn != NULL && bytes > 0) {
+    conn->num_bytes_sent += bytes;
+  }
+}
+
 int mg_printf(struct mg_connection *conn, const char *fmt, ...) {
   char mem[MG_BUF_LEN], *buf = mem;
   int len;
@@ -4701,20 +4781,46 @@ static void process_new_connection(struct mg_connection *conn) {
            should_keep_alive(conn));
 }
 
-// Worker threads take accepted socket from the queue
-static int consume_socket(struct mg_context *ctx, struct socket *sp) {
+// Worker threads take accepted socket from the queue.
+// Return 0 if the worker must exit: server is stopping, or the worker was
+// idle for idle_timeout and there are more than min_threads workers
+// (in that case the worker already removed itself from num_threads).
+static int consume_socket(struct mg_context *ctx, struct socket *sp,
+                          int *retired) {
+  double wait_ms;
+
   (void) pthread_mutex_lock(&ctx->mutex);
   DEBUG_TRACE(("going idle"));
 
   // If the queue is empty, wait. We're idle at this point.
+  ctx->idle_threads++;
   while (ctx->sq_head == ctx->sq_tail && ctx->stop_flag == 0) {
-    pthread_cond_wait(&ctx->sq_full, &ctx->mutex);
+    if (mg_cond_timedwait(&ctx->sq_full, &ctx->mutex,
+                          ctx->idle_timeout * 1000) &&
+        ctx->sq_head == ctx->sq_tail &&
+        ctx->num_threads > ctx->min_threads) {
+      DEBUG_TRACE(("idle timeout, exiting"));
+      ctx->idle_threads--;
+      ctx->num_threads--;
+      *retired = 1;
+      (void) pthread_cond_signal(&ctx->cond);
+      (void) pthread_mutex_unlock(&ctx->mutex);
+      return 0;
+    }
   }
+  ctx->idle_threads--;
 
   // If we're stopping, sq_head may be equal to sq_tail.
   if (ctx->sq_head > ctx->sq_tail) {
     // Copy socket from the queue and increment tail
     *sp = ctx->queue[ctx->sq_tail % ARRAY_SIZE(ctx->queue)];
+    wait_ms = (double) (mg_time_ms() -
+      ctx->sq_time[ctx->sq_tail % ARRAY_SIZE(ctx->queue)]);
+    ctx->sq_consumed++;
+    ctx->sq_wait_total += wait_ms;
+    if (wait_ms > ctx->sq_wait_max) {
+      ctx->sq_wait_max = wait_ms;
+    }
     ctx->sq_tail++;
     DEBUG_TRACE(("grabbed socket %d, going busy", sp->sock));
 
@@ -4733,6 +4839,7 @@ static int consume_socket(struct mg_context *ctx, struct socket *sp) {
 
 static void worker_thread(struct mg_context *ctx) {
   struct mg_connection *conn;
+  int retired = 0;
 
   conn = (struct mg_connection *) calloc(1, sizeof(*conn) + MAX_REQUEST_SIZE);
   if (conn == NULL) {
@@ -4743,7 +4850,7 @@ static void worker_thread(struct mg_context *ctx) {
 
     // Call consume_socket() even when ctx->stop_flag > 0, to let it signal
     // sq_empty condvar to wake up the master waiting in produce_socket()
-    while (consume_socket(ctx, &conn->client)) {
+    while (consume_socket(ctx, &conn->client, &retired)) {
       conn->birth_time = time(NULL);
       conn->ctx = ctx;
 
@@ -4769,30 +4876,58 @@ static void worker_thread(struct mg_context *ctx) {
   }
 
   // Signal master that we're done with connection and exiting
-  (void) pthread_mutex_lock(&ctx->mutex);
-  ctx->num_threads--;
-  (void) pthread_cond_signal(&ctx->cond);
-  assert(ctx->num_threads >= 0);
-  (void) pthread_mutex_unlock(&ctx->mutex);
+  // (retired worker already did it in consume_socket())
+  if (!retired) {
+    (void) pthread_mutex_lock(&ctx->mutex);
+    ctx->num_threads--;
+    (void) pthread_cond_signal(&ctx->cond);
+    assert(ctx->num_threads >= 0);
+    (void) pthread_mutex_unlock(&ctx->mutex);
+  }
 
   DEBUG_TRACE(("exiting"));
 }
 
+// Start one more worker if queued sockets outnumber idle workers
+// (all workers are busy, e.g. blocked on slow data). Called under ctx->mutex
+static void grow_workers(struct mg_context *ctx) {
+  if (ctx->sq_head - ctx->sq_tail <= ctx->idle_threads ||
+      ctx->num_threads >= ctx->max_threads) {
+    return;
+  }
+  if (mg_start_thread((mg_thread_func_t) worker_thread, ctx) != 0) {
+    cry(fc(ctx), "Cannot start worker thread: %d", ERRNO);
+  } else {
+    ctx->num_threads++;
+    if (ctx->num_threads > ctx->peak_threads) {
+      ctx->peak_threads = ctx->num_threads;
+    }
+    DEBUG_TRACE(("started worker, %d workers", ctx->num_threads));
+  }
+}
+
 // Master thread adds accepted socket to a queue
 static void produce_socket(struct mg_context *ctx, const struct socket *sp) {
+  int64_t const accepted_time = mg_time_ms();
+
   (void) pthread_mutex_lock(&ctx->mutex);
 
   // If the queue is full, wait
   while (ctx->stop_flag == 0 &&
          ctx->sq_head - ctx->sq_tail >= (int) ARRAY_SIZE(ctx->queue)) {
+    grow_workers(ctx);
     (void) pthread_cond_wait(&ctx->sq_empty, &ctx->mutex);
   }
 
   if (ctx->sq_head - ctx->sq_tail < (int) ARRAY_SIZE(ctx->queue)) {
     // Copy socket to the queue and increment head
     ctx->queue[ctx->sq_head % ARRAY_SIZE(ctx->queue)] = *sp;
+    ctx->sq_time[ctx->sq_head % ARRAY_SIZE(ctx->queue)] = accepted_time;
     ctx->sq_head++;
     DEBUG_TRACE(("queued socket %d", sp->sock));
+    if (ctx->stop_flag == 0) {
+      grow_workers(ctx);
+    }
   }
 
   (void) pthread_cond_signal(&ctx->sq_full);
@@ -5020,14 +5155,27 @@ struct mg_context *mg_start(mg_callback_t user_callback, void *user_data,
   // Start master (listening) thread
   mg_start_thread((mg_thread_func_t) master_thread, ctx);
 
-  // Start worker threads
-  for (i = 0; i < atoi(ctx->config[NUM_THREADS]); i++) {
+  // Start min_threads worker threads, the rest started on demand
+  ctx->min_threads = atoi(ctx->config[NUM_THREADS]);
+  ctx->max_threads = ctx->config[MAX_THREADS] == NULL ?
+    ctx->min_threads : atoi(ctx->config[MAX_THREADS]);
+  if (ctx->max_threads < ctx->min_threads) {
+    ctx->max_threads = ctx->min_threads;
+  }
+  ctx->idle_timeout = atoi(ctx->config[THREAD_IDLE_TIMEOUT]);
+  if (ctx->idle_timeout <= 0) {
+    ctx->idle_timeout = 1;
+  }
+  (void) pthread_mutex_lock(&ctx->mutex);
+  for (i = 0; i < ctx->min_threads; i++) {
     if (mg_start_thread((mg_thread_func_t) worker_thread, ctx) != 0) {
       cry(fc(ctx), "Cannot start worker thread: %d", ERRNO);
     } else {
       ctx->num_threads++;
     }
   }
+  ctx->peak_threads = ctx->num_threads;
+  (void) pthread_mutex_unlock(&ctx->mutex);
 
   return ctx;
 }
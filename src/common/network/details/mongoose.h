@@ -230,6 +230,40 @@ struct mg_request_info *mg_get_request_info(struct mg_connection *);
 int mg_write(struct mg_connection *, const void *buf, size_t len);
 
 
+// Statistics of the worker threads pool.
+struct mg_pool_stat {
+  int threads;              // Current count of workers
+  int idle_threads;         // Workers waiting for a connection
+  int peak_threads;         // Max count of workers since start
+  int min_threads;          // Workers kept even if idle (num_threads)
+  int max_threads;          // Upper bound of workers (max_threads)
+  int queued;               // Accepted connections waiting for a worker
+  unsigned long consumed;   // Total count of connections taken by workers
+  double wait_ms_total;     // Total time connections spent in the queue, ms
+  double wait_ms_max;       // Max time connection spent in the queue, ms
+};
+
+
+// Get statistics of the worker threads pool.
+// Workers are started on demand (when all workers are busy) from
+// num_threads up to max_threads, idle workers above num_threads exit
+// after thread_idle_timeout seconds.
+void mg_get_pool_stat(struct mg_context *, struct mg_pool_stat *stat);
+
+
+// Return plain socket of the connection, to let the caller move bytes
+// to the client without mg_write() (e.g. sendfile()).
+// Return:
+//  -1  when the connection is SSL or throttled(the socket can not be used directly)
+//  socket descriptor otherwise
+int mg_get_raw_socket(const struct mg_connection *);
+
+
+// Account bytes sent to the client without mg_printf()/mg_write() of mongoose
+// itself (e.g. via the raw socket), so the access log shows the real size.
+void mg_add_bytes_sent(struct mg_connection *, long long bytes);
+
+
 // Send data to the browser using printf() semantics.
 //
 // Works exactly like mg_write(), but allows to do message formatting.
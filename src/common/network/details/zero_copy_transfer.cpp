@@ -0,0 +1,166 @@
+#include "zero_copy_transfer.hpp"
+
+#if defined(__linux__)
+#	include <poll.h>
+#	include <fcntl.h>
+#	include <errno.h>
+#	include <unistd.h>
+#	include <sys/sendfile.h>
+#	include <sys/socket.h>
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#elif defined(__APPLE__)
+#	include <poll.h>
+#	include <errno.h>
+#	include <sys/types.h>
+#	include <sys/socket.h>
+#	include <sys/uio.h>
+#	include <netinet/in.h>
+#	include <netinet/tcp.h>
+#endif 
+
+#define HTTP_ZERO_COPY_SEND_TIMEOUT 60			// Seconds without progress of the client before transfer broken
+
+namespace common { namespace details {
+
+/**
+ * Private hidden zero-copy api
+ */
+
+#if defined(__linux__) || defined(__APPLE__)
+
+static bool wait_writable(int sock) 
+{
+	/*  Socket could be non-blocking(or has the send timeout), so on EAGAIN 
+	 	wait for the client drain instead of the busy loop */
+	struct pollfd pfd = { sock, POLLOUT, 0 };
+	int res = 0;
+	while ((res = ::poll(&pfd, 1, HTTP_ZERO_COPY_SEND_TIMEOUT * 1000)) < 0 && errno == EINTR)
+		{ /**/ }
+	return (res > 0 && !(pfd.revents & (POLLERR | POLLHUP)));
+}
+
+#endif
+
+#if defined(__linux__)
+
+static boost::int64_t splice_transfer(int sock, int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	/*  splice(2) can not move data from file to socket directly, 
+	 	so pipe used as in-kernel buffer between file and socket */
+	int pipe_fds[2] = { -1, -1 };
+	if (::pipe(pipe_fds) == -1) 
+		return -1;
+
+	loff_t off = offset;
+	boost::int64_t sended = 0;
+	while (sended < (boost::int64_t)bytes_size) {
+		ssize_t in_pipe = ::splice(fd, &off, pipe_fds[1], NULL, 
+			bytes_size - sended, SPLICE_F_MOVE | SPLICE_F_MORE);
+		if (in_pipe <= 0) {
+			if (in_pipe < 0 && errno == EINTR) 
+				continue;
+			break;
+		}
+		while (in_pipe > 0) {
+			ssize_t const out_pipe = ::splice(pipe_fds[0], NULL, sock, NULL, 
+				in_pipe, SPLICE_F_MOVE | SPLICE_F_MORE);
+			if (out_pipe <= 0) {
+				if (out_pipe < 0 && errno == EINTR)
+					continue;
+				if (out_pipe < 0 && errno == EAGAIN && wait_writable(sock))
+					continue;
+				::close(pipe_fds[0]); ::close(pipe_fds[1]);
+				return (sended == 0) ? -1 : sended;
+			}
+			in_pipe -= out_pipe;
+			sended += out_pipe;
+		} // while
+	} // while
+
+	::close(pipe_fds[0]); ::close(pipe_fds[1]);
+	return (sended == 0) ? -1 : sended;
+}
+
+static boost::int64_t sendfile_transfer(int sock, int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	off_t off = offset;
+	boost::int64_t sended = 0;
+	while (sended < (boost::int64_t)bytes_size) {
+		ssize_t const res = ::sendfile(sock, fd, &off, bytes_size - sended);
+		if (res < 0) { 
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN && wait_writable(sock))
+				continue;
+			/* EINVAL/ENOSYS means sendfile(2) not work for this pair of descriptors, 
+			 	try splice(2) if nothing was sended */
+			if (sended == 0 && (errno == EINVAL || errno == ENOSYS))
+				return splice_transfer(sock, fd, offset, bytes_size);
+			break;
+		}
+		if (res == 0)
+			break;
+		sended += res;
+	} // while
+	return (sended == 0) ? -1 : sended;
+}
+
+#endif // __linux__
+
+/**
+ * Public zero-copy api
+ */
+
+bool zero_copy_supported() 
+{
+#if defined(__linux__) || defined(__APPLE__)
+	return true;
+#else
+	return false;
+#endif
+}
+
+boost::int64_t zero_copy_transfer(int sock, int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	if (sock < 0 || fd < 0)
+		return -1;
+#if defined(__linux__)
+	return sendfile_transfer(sock, fd, offset, bytes_size);
+#elif defined(__APPLE__)
+	boost::int64_t sended = 0;
+	while (sended < (boost::int64_t)bytes_size) {
+		off_t len = bytes_size - sended;
+		int const res = ::sendfile(fd, sock, offset + sended, &len, NULL, 0);
+		sended += len;
+		if (res == -1 && errno == EAGAIN && !wait_writable(sock))
+			break;
+		if (res == -1 && errno != EINTR && errno != EAGAIN)
+			break;
+		if (res == 0 && len == 0)
+			break;
+	} // while
+	return (sended == 0) ? -1 : sended;
+#else
+	return -1;
+#endif
+}
+
+bool socket_cork(int sock, bool on) 
+{
+	if (sock < 0)
+		return false;
+	int const value = on ? 1 : 0;
+#if defined(__linux__)
+	return (::setsockopt(sock, IPPROTO_TCP, TCP_CORK, &value, sizeof(value)) == 0);
+#elif defined(__APPLE__)
+	return (::setsockopt(sock, IPPROTO_TCP, TCP_NOPUSH, &value, sizeof(value)) == 0);
+#else
+	return false;
+#endif
+}
+
+} } // namespace common, details
+
+#undef HTTP_ZERO_COPY_SEND_TIMEOUT
+
@@ -0,0 +1,28 @@
+#ifndef ZERO_COPY_TRANSFER_HPP_INCLUDED
+#define ZERO_COPY_TRANSFER_HPP_INCLUDED
+
+#include <cstddef>
+#include <boost/cstdint.hpp>
+
+namespace common { namespace details {
+
+/**
+ * Zero-copy helpers, move bytes from a file descriptor straight to a socket
+ * (sendfile(2), splice(2) as fallback under Linux, sendfile(2) under Mac OS X).
+ */
+
+/* true if current platform have zero-copy primitives */
+bool zero_copy_supported();
+
+/* Transfer bytes_size bytes of file fd from offset to socket sock. 
+	Returns count of sended bytes, or -1 if zero-copy not avaliable for such pair(nothing was sended) */
+boost::int64_t zero_copy_transfer(int sock, int fd, boost::int64_t offset, std::size_t bytes_size);
+
+/* Hold(on) or push(off) partial frames of the socket(TCP_CORK under Linux, TCP_NOPUSH under Mac OS X),
+ 	so the reply headers and the first body bytes go by one packet. Returns false if not supported */
+bool socket_cork(int sock, bool on);
+
+} } // namespace common, details
+
+#endif
+
@@ -5,10 +5,16 @@
 #include "http_transport_context.hpp"
 #include "base_transport_ostream.hpp"
 #include "http_mongoose_transport.hpp"
+#if defined(USE_EPOLL_HTTP_TRANSPORT)
+#	include "http_epoll_transport.hpp"
+#endif // USE_EPOLL_HTTP_TRANSPORT
 
 namespace common {
 	/*  */
 	typedef details::http_mongoose_transport http_mongoose_transport;
+#if defined(USE_EPOLL_HTTP_TRANSPORT)
+	typedef details::http_epoll_transport http_epoll_transport;
+#endif // USE_EPOLL_HTTP_TRANSPORT
 
 } // namespace common
 
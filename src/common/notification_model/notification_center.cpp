@@ -71,10 +71,8 @@ bool notification_center::send_message(std::string const & recv_name, notificati
 	boost::lock_guard<boost::mutex> guard(lock_);
 	if (!stop_ && notification) {
 		units_type::iterator found = receivers_.find(recv_name);
-		if (receivers_.end() != found) {
-			found->second->add_notification(notification);
-			return true;
-		} // found
+		if (receivers_.end() != found) 
+			return found->second->add_notification(notification);
 	}
 	return false;
 
@@ -85,10 +83,8 @@ bool notification_center::post_message(std::string const & recv_name, notificati
 	boost::lock_guard<boost::mutex> guard(lock_);
 	if (!stop_ && notification) {
 		units_type::iterator found = receivers_.find(recv_name);
-		if (receivers_.end() != found) {
-			found->second->add_notification(notification);
-			return true;
-		} // found
+		if (receivers_.end() != found) 
+			return found->second->add_notification(notification);
 	}
 	return false;
 }
@@ -43,13 +43,15 @@ notification_unit::~notification_unit()
 	pn_lock_.unlock();
 }
 
-void notification_unit::add_notification(notification_ptr notification) 
+bool notification_unit::add_notification(notification_ptr notification) 
 {
 	boost::lock_guard<boost::mutex> guard(pn_lock_);
 	if (!stop_work_ && pending_notifications_.size() <= p_.max_notifications) {
 		pending_notifications_.push_back(notification);
 		waiters_.notify_all();
+		return true;
 	}
+	return false;
 }
 
 void notification_unit::execution_loop_run() 
@@ -111,9 +113,13 @@ void notification_unit::execution_loop()
 		if (has_pending_notifications) 
 			notify_receiver();
 		else if (!has_pending_notifications) {
+			/*  Queue checked again under the lock of the pending notifications, 
+			 	otherwise notification added after the copy does not wake the loop till the timeout */
 			boost::system_time const check_timeout = 	
 				boost::get_system_time() + boost::posix_time::milliseconds(p_.notification_check_timeout);
-			waiters_.timed_wait(guard, check_timeout);
+			boost::unique_lock<boost::mutex> pn_guard(pn_lock_);
+			if (pending_notifications_.empty() && !stop_work_)
+				waiters_.timed_wait(pn_guard, check_timeout);
 		}
 	} // loop
 
@@ -30,7 +30,8 @@ public :
 	explicit notification_unit(notification_unit_param const & param);
 	~notification_unit();
 
-	void add_notification(notification_ptr notification);
+	/* Returns false if the notification dropped(unit stopped or the queue is full) */
+	bool add_notification(notification_ptr notification);
 	void execution_loop_run();
 	
 	inline std::string const & get_name() const 
@@ -0,0 +1,120 @@
+#ifndef REQUEST_ARENA_HPP_INCLUDED
+#define REQUEST_ARENA_HPP_INCLUDED
+
+#include <new>
+#include <cstddef>
+#include <boost/noncopyable.hpp>
+#include <boost/type_traits/aligned_storage.hpp>
+
+namespace utility {
+
+/**
+ * request_arena bump allocator for short-lived objects of the one request.
+ * Lives on the stack of the request handler, so all objects allocated from the arena
+ * must be destroyed before the handler returns. If the inline storage is exhausted
+ * allocations fall back to the heap.
+ */
+template <std::size_t Size>
+class request_arena : boost::noncopyable {
+public :
+	enum { alignment = 16 };
+
+	request_arena() : storage_(), used_(0) { }
+
+	~request_arena() { }
+
+	inline void * allocate(std::size_t bytes)
+	{
+		std::size_t const aligned = (bytes + alignment - 1) & ~(std::size_t)(alignment - 1);
+		if (used_ + aligned > Size)
+			return ::operator new(bytes);
+		void * ptr = static_cast<char *>(storage_.address()) + used_;
+		used_ += aligned;
+		return ptr;
+	}
+
+	inline void deallocate(void * ptr)
+	{
+		/*  Memory of the inline storage returned only with the arena */
+		if (!owns(ptr))
+			::operator delete(ptr);
+	}
+
+	inline bool owns(void const * ptr) const
+	{
+		char const * begin = static_cast<char const *>(storage_.address());
+		return (static_cast<char const *>(ptr) >= begin && static_cast<char const *>(ptr) < begin + Size);
+	}
+
+	inline std::size_t used() const
+		{ return used_; }
+
+private :
+	typename boost::aligned_storage<Size, alignment>::type storage_;
+	std::size_t used_;
+
+};
+
+/**
+ * arena_allocator std allocator over request_arena, eg for boost::allocate_shared
+ */
+template <class T, class Arena>
+class arena_allocator {
+public :
+	typedef T value_type;
+	typedef T * pointer;
+	typedef T const * const_pointer;
+	typedef T & reference;
+	typedef T const & const_reference;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <class U>
+	struct rebind { typedef arena_allocator<U, Arena> other; };
+
+	explicit arena_allocator(Arena & arena) : arena_(&arena) { }
+
+	template <class U>
+	arena_allocator(arena_allocator<U, Arena> const & other) : arena_(other.arena()) { }
+
+	inline pointer allocate(size_type n, void const * = 0)
+		{ return static_cast<pointer>(arena_->allocate(n * sizeof(T))); }
+
+	inline void deallocate(pointer ptr, size_type)
+		{ arena_->deallocate(ptr); }
+
+	inline void construct(pointer ptr, T const & value)
+		{ new (ptr) T(value); }
+
+	inline void destroy(pointer ptr)
+		{ ptr->~T(); }
+
+	inline pointer address(reference value) const
+		{ return &value; }
+
+	inline const_pointer address(const_reference value) const
+		{ return &value; }
+
+	inline size_type max_size() const
+		{ return static_cast<size_type>(-1) / sizeof(T); }
+
+	inline Arena * arena() const
+		{ return arena_; }
+
+private :
+	Arena * arena_;
+
+};
+
+template <class T, class U, class Arena>
+inline bool operator==(arena_allocator<T, Arena> const & a, arena_allocator<U, Arena> const & b)
+	{ return a.arena() == b.arena(); }
+
+template <class T, class U, class Arena>
+inline bool operator!=(arena_allocator<T, Arena> const & a, arena_allocator<U, Arena> const & b)
+	{ return a.arena() != b.arena(); }
+
+} // namespace utility
+
+#endif
+
@@ -2,7 +2,10 @@
 #define CORE_FILE_STATE_CHANGE_NOTIFICATION_HPP_INCLUDED
 
 #include "base_notification.hpp"
+#include "core_progress_channel.hpp"
+
 #include <boost/cstdint.hpp>
+#include <boost/shared_array.hpp>
 
 namespace t2h_core {
 
@@ -10,11 +13,13 @@ struct core_file_change_notification : public common::base_notification {
 	enum change_state {
 		file_update,
 		file_remove,
-		file_add
+		file_add,
+		file_range_verified
 	};
 
 	core_file_change_notification() 
-		: common::base_notification(__LINE__), state_(base_notification::executeable) { }
+		: common::base_notification(__LINE__), state_(base_notification::executeable), file_index(-1), 
+		range_offset(0), range_size(0), piece(), piece_offset(0), progress() { }
 
 	virtual notification_state get_state() const  { return state_; }
 	virtual void set_state(notification_state state) { state_ = state; }
@@ -24,6 +29,13 @@ struct core_file_change_notification : public common::base_notification {
 	std::string file_path;
 	boost::int64_t file_size;
 	boost::int64_t avaliable_bytes;
+	std::string info_hash;			// Hex info hash of the torrent(file_add only)
+	int file_index;					// Index of the file in the torrent(file_add only)
+	boost::int64_t range_offset;	// Offset of the verified bytes in the file(file_range_verified only)
+	boost::int64_t range_size;		// Count of the verified bytes(file_range_verified only)
+	boost::shared_array<char> piece;// Verified piece which contains the range, could be empty(file_range_verified only)
+	std::size_t piece_offset;		// Offset of the range in the piece(file_range_verified only)
+	core_progress_slot_ptr progress;// Newest avaliable bytes, if set they must be taken from it(file_update only)
 }; 
 
 typedef boost::shared_ptr<core_file_change_notification> core_file_change_notification_ptr;
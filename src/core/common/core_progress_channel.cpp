@@ -0,0 +1,52 @@
+#include "core_progress_channel.hpp"
+
+namespace t2h_core {
+
+/**
+ * Public core_progress_channel api
+ */
+
+core_progress_channel::core_progress_channel()
+	: lock_(), slots_(), updates_(0), conflated_(0)
+{
+}
+
+core_progress_channel::~core_progress_channel()
+{
+}
+
+core_progress_slot_ptr core_progress_channel::update(std::string const & file_path, boost::int64_t avaliable_bytes)
+{
+	/*  Slot of the file created once, so the update of the file with the pending slot
+	 	is one lookup without any allocation */
+	boost::lock_guard<boost::mutex> guard(lock_);
+	++updates_;
+	core_progress_slot_ptr & slot = slots_[file_path];
+	if (!slot)
+		slot.reset(new core_progress_slot());
+
+	boost::lock_guard<boost::mutex> slot_guard(slot->lock);
+	slot->avaliable_bytes = avaliable_bytes;
+	if (slot->pending) {
+		++conflated_;
+		return core_progress_slot_ptr();
+	} // if
+	slot->pending = true;
+	return slot;
+}
+
+void core_progress_channel::reset(std::string const & file_path)
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	slots_.erase(file_path);
+}
+
+core_progress_channel_stat core_progress_channel::get_stat() const
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	core_progress_channel_stat const stat = { slots_.size(), updates_, conflated_ };
+	return stat;
+}
+
+} // namespace t2h_core
+
@@ -0,0 +1,78 @@
+#ifndef CORE_PROGRESS_CHANNEL_HPP_INCLUDED
+#define CORE_PROGRESS_CHANNEL_HPP_INCLUDED
+
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace t2h_core {
+
+/**
+ * core_progress_slot newest progress(avaliable bytes) of the one file, which is not delivered yet.
+ * Slot sent to the receiver inside the file_update notification, while it pending
+ * newer updates of the file overwrite its value in place.
+ */
+struct core_progress_slot : boost::noncopyable {
+	core_progress_slot() : lock(), avaliable_bytes(0), pending(false) { }
+
+	/* Called by the receiver : newest avaliable bytes, next update sends the new notification */
+	inline boost::int64_t take()
+	{
+		boost::lock_guard<boost::mutex> guard(lock);
+		pending = false;
+		return avaliable_bytes;
+	}
+
+	boost::mutex lock;
+	boost::int64_t avaliable_bytes;
+	bool pending;					// Notification with the slot is in the receiver queue
+};
+
+typedef boost::shared_ptr<core_progress_slot> core_progress_slot_ptr;
+
+/**
+ * core_progress_channel_stat counters of the progress channel
+ */
+struct core_progress_channel_stat {
+	std::size_t files;				// Files which have the slot
+	boost::uint64_t updates;		// All progress updates
+	boost::uint64_t conflated;		// Updates merged into the pending slot(without notification)
+};
+
+/**
+ * core_progress_channel conflates progress updates of the files : only the first update of the file
+ * goes to the receiver queue, all updates which come before its delivery overwrite it in place,
+ * so the receiver sees only the newest watermark of the file.
+ * Add/remove of the file must reset its slot, so the updates never cross them.
+ */
+class core_progress_channel : boost::noncopyable {
+public :
+	core_progress_channel();
+	~core_progress_channel();
+
+	/* Slot which must be sent to the receiver, empty if the update merged into the pending one */
+	core_progress_slot_ptr update(std::string const & file_path, boost::int64_t avaliable_bytes);
+	/* Next updates of the file go to the new slot, pending slot still delivered in order */
+	void reset(std::string const & file_path);
+
+	core_progress_channel_stat get_stat() const;
+
+private :
+	typedef boost::unordered_map<std::string, core_progress_slot_ptr> slots_type;
+
+	boost::mutex mutable lock_;
+	slots_type slots_;
+	boost::uint64_t updates_;
+	boost::uint64_t conflated_;
+
+};
+
+typedef boost::shared_ptr<core_progress_channel> core_progress_channel_ptr;
+
+} // namespace t2h_core
+
+#endif
+
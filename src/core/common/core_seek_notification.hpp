@@ -0,0 +1,44 @@
+#ifndef CORE_SEEK_NOTIFICATION_HPP_INCLUDED
+#define CORE_SEEK_NOTIFICATION_HPP_INCLUDED
+
+#include "base_notification.hpp"
+#include <boost/cstdint.hpp>
+
+namespace t2h_core {
+
+/**
+ * core_seek_notification sended by the http server core to the torrent core about readers of the file :
+ * client requests bytes which are not downloaded yet(eg seek of the player) or 
+ * client reads the file from offset with some rate
+ */
+struct core_seek_notification : public common::base_notification {
+	enum reader_event {
+		seek,
+		reading
+	};
+
+	core_seek_notification() 
+		: common::base_notification(__LINE__), state_(base_notification::executeable), event_type(seek), 
+		offset(0), file_size(0), bytes_per_sec(0) { }
+
+	virtual notification_state get_state() const  { return state_; }
+	virtual void set_state(notification_state state) { state_ = state; }
+	
+	/* Name of the torrent core receiver of this notification */
+	static inline char const * receiver_name() 
+		{ return "tcore_seek_recv"; }
+
+	notification_state state_;
+	reader_event event_type;
+	std::string file_path;
+	boost::int64_t offset;			// Requested(seek) or current(reading) offset in the file
+	boost::int64_t file_size;
+	double bytes_per_sec;			// Consumption rate of the reader(reading only)
+}; 
+
+typedef boost::shared_ptr<core_seek_notification> core_seek_notification_ptr;
+
+} // namespace t2h_core
+
+#endif
+
@@ -0,0 +1,161 @@
+#include "core_watermark.hpp"
+
+#include <climits>
+
+#if defined(__linux__)
+#	include <ctime>
+#	include <unistd.h>
+#	include <sys/syscall.h>
+#	include <linux/futex.h>
+#endif // __linux__
+
+namespace t2h_core {
+
+namespace details {
+
+#if defined(__linux__)
+
+static inline void futex_wait(int volatile * word, int expected, boost::posix_time::time_duration const & timeout)
+{
+	struct timespec ts;
+	ts.tv_sec = timeout.total_seconds();
+	ts.tv_nsec = (timeout - boost::posix_time::seconds(ts.tv_sec)).total_microseconds() * 1000;
+	::syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, expected, &ts, NULL, 0);
+}
+
+static inline void futex_wake_all(int volatile * word)
+{
+	::syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#endif // __linux__
+
+static core_watermark_table watermarks;
+
+} // namespace details
+
+/**
+ * Public core_watermark api
+ */
+
+core_watermark::core_watermark()
+	: value_(0), closed_(false), waiters_(0), epoch_(0)
+#if !defined(__linux__)
+	, lock_(), changed_()
+#endif // __linux__
+{
+}
+
+core_watermark::~core_watermark()
+{
+}
+
+void core_watermark::publish(boost::int64_t avaliable_bytes)
+{
+	boost::int64_t current = value_.load(boost::memory_order_relaxed);
+	do {
+		if (avaliable_bytes <= current)
+			return;
+	} while (!value_.compare_exchange_weak(current, avaliable_bytes, boost::memory_order_release));
+	notify_all();
+}
+
+void core_watermark::notify_all()
+{
+	/*  Epoch changed before the waiters check, so the waiter which came after the check
+	 	sees the new epoch(and the new value) and does not sleep */
+#if defined(__linux__)
+	__sync_fetch_and_add(&epoch_, 1);
+	if (waiters_.load(boost::memory_order_seq_cst) > 0)
+		details::futex_wake_all(&epoch_);
+#else
+	boost::lock_guard<boost::mutex> guard(lock_);
+	++epoch_;
+	if (waiters_.load(boost::memory_order_relaxed) > 0)
+		changed_.notify_all();
+#endif // __linux__
+}
+
+void core_watermark::close()
+{
+	closed_.store(true, boost::memory_order_release);
+	notify_all();
+}
+
+int core_watermark::prepare_wait()
+{
+#if defined(__linux__)
+	waiters_.fetch_add(1, boost::memory_order_seq_cst);
+	return __sync_fetch_and_add(&epoch_, 0);
+#else
+	boost::lock_guard<boost::mutex> guard(lock_);
+	waiters_.fetch_add(1, boost::memory_order_relaxed);
+	return epoch_;
+#endif // __linux__
+}
+
+void core_watermark::cancel_wait()
+{
+	waiters_.fetch_sub(1, boost::memory_order_relaxed);
+}
+
+void core_watermark::wait(int epoch, boost::posix_time::time_duration const & timeout)
+{
+#if defined(__linux__)
+	details::futex_wait(&epoch_, epoch, timeout);
+#else
+	boost::unique_lock<boost::mutex> guard(lock_);
+	if (epoch_ == epoch)
+		changed_.timed_wait(guard, timeout);
+#endif // __linux__
+	waiters_.fetch_sub(1, boost::memory_order_relaxed);
+}
+
+/**
+ * Public core_watermark_table api
+ */
+
+core_watermark_table::core_watermark_table()
+	: lock_(), watermarks_()
+{
+}
+
+core_watermark_table::~core_watermark_table()
+{
+}
+
+core_watermark_ptr core_watermark_table::acquire(std::string const & file_path)
+{
+	core_watermark_ptr watermark(new core_watermark());
+	boost::lock_guard<boost::mutex> guard(lock_);
+	core_watermark_ptr & slot = watermarks_[file_path];
+	if (slot)
+		slot->close();
+	slot = watermark;
+	return watermark;
+}
+
+core_watermark_ptr core_watermark_table::find(std::string const & file_path) const
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	watermarks_type::const_iterator const found = watermarks_.find(file_path);
+	return (found != watermarks_.end()) ? found->second : core_watermark_ptr();
+}
+
+void core_watermark_table::release(std::string const & file_path)
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	watermarks_type::iterator const found = watermarks_.find(file_path);
+	if (found == watermarks_.end())
+		return;
+	found->second->close();
+	watermarks_.erase(found);
+}
+
+core_watermark_table & core_watermarks()
+{
+	return details::watermarks;
+}
+
+} // namespace t2h_core
+
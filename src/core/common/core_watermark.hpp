@@ -0,0 +1,88 @@
+#ifndef CORE_WATERMARK_HPP_INCLUDED
+#define CORE_WATERMARK_HPP_INCLUDED
+
+#include <string>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace t2h_core {
+
+/**
+ * core_watermark avaliable bytes(verified prefix) of the one file, published by the torrent core
+ * right from the piece handler and read by the http core without any lock,
+ * so the blocked reader does not wait for the notification center.
+ * Waiting is the eventcount : the waiter takes the epoch, checks own condition and sleeps
+ * till the epoch changed(futex on linux, condition variable otherwise).
+ */
+class core_watermark : boost::noncopyable {
+public :
+	core_watermark();
+	~core_watermark();
+
+	/* Torrent core : moves the watermark forward(never back) and wakes all waiters */
+	void publish(boost::int64_t avaliable_bytes);
+	/* Wakes all waiters, they recheck own condition */
+	void notify_all();
+	/* File removed : watermark is not published anymore, all waiters woken */
+	void close();
+
+	inline boost::int64_t get() const
+		{ return value_.load(boost::memory_order_acquire); }
+	inline bool is_closed() const
+		{ return closed_.load(boost::memory_order_acquire); }
+
+	/* Waiter : the epoch must be taken before the check of the condition,
+	 	each prepare_wait must be followed by the wait or cancel_wait */
+	int prepare_wait();
+	void cancel_wait();
+	/* Returns then the epoch changed, timeout came or spuriously */
+	void wait(int epoch, boost::posix_time::time_duration const & timeout);
+
+private :
+	boost::atomic<boost::int64_t> value_;
+	boost::atomic<bool> closed_;
+	boost::atomic<int> waiters_;
+	int volatile epoch_;					// Futex word, changed by each publish/notify
+#if !defined(__linux__)
+	boost::mutex lock_;
+	boost::condition_variable changed_;
+#endif // __linux__
+
+};
+
+typedef boost::shared_ptr<core_watermark> core_watermark_ptr;
+
+/**
+ * core_watermark_table watermarks of the files which the torrent core serves,
+ * torrent core acquires the watermark of the file before the file add notification
+ * and releases it with the file remove, http core only finds them.
+ */
+class core_watermark_table : boost::noncopyable {
+public :
+	core_watermark_table();
+	~core_watermark_table();
+
+	/* New watermark of the file, watermark of the previous add closed */
+	core_watermark_ptr acquire(std::string const & file_path);
+	core_watermark_ptr find(std::string const & file_path) const;
+	void release(std::string const & file_path);
+
+private :
+	typedef boost::unordered_map<std::string, core_watermark_ptr> watermarks_type;
+
+	boost::mutex mutable lock_;
+	watermarks_type watermarks_;
+
+};
+
+core_watermark_table & core_watermarks();
+
+} // namespace t2h_core
+
+#endif
+
@@ -24,6 +24,8 @@ namespace t2h_core_details {
 
 // http server keys, with some defaults values
 ADD_KEY_TYPE(workers, "20", "", false)
+ADD_KEY_TYPE(min_workers, "4", "", false)
+ADD_KEY_TYPE(workers_idle_timeout, "60", "", false)
 ADD_KEY_TYPE(doc_root, "", "", true)
 ADD_KEY_TYPE(server_addr, "", "", true)
 ADD_KEY_TYPE(server_port, "8080", "", false)
@@ -34,6 +36,32 @@ ADD_KEY_TYPE(tc_port_end, "", "", true)
 ADD_KEY_TYPE(cores_sync_timeout, "360", "", false)
 ADD_KEY_TYPE(hc_chunked, "true", "", false)
 ADD_KEY_TYPE(hc_max_chunk_size, "1024000", "", false)
+ADD_KEY_TYPE(hc_zero_copy, "true", "", false)
+ADD_KEY_TYPE(hc_max_cached_fds, "128", "", false)
+ADD_KEY_TYPE(hc_mmap_completed, "true", "", false)
+ADD_KEY_TYPE(hc_read_ahead, "false", "", false)
+ADD_KEY_TYPE(hc_read_ahead_buffers, "2", "", false)
+ADD_KEY_TYPE(hc_read_ahead_depth, "2", "", false)
+ADD_KEY_TYPE(hc_read_ahead_threads, "4", "", false)
+ADD_KEY_TYPE(hc_io_uring, "false", "", false)
+ADD_KEY_TYPE(hc_io_uring_entries, "64", "", false)
+ADD_KEY_TYPE(hc_io_buffers_per_slab, "4", "", false)
+ADD_KEY_TYPE(hc_io_max_free_slabs, "2", "", false)
+ADD_KEY_TYPE(hc_adaptive_chunk, "false", "", false)
+ADD_KEY_TYPE(hc_min_chunk_size, "65536", "", false)
+ADD_KEY_TYPE(hc_stream_as_avaliable, "false", "", false)
+ADD_KEY_TYPE(hc_transport, "mongoose", "", false)
+ADD_KEY_TYPE(hc_park_stalled, "true", "", false)
+ADD_KEY_TYPE(hc_resume_threads, "2", "", false)
+ADD_KEY_TYPE(hc_piece_cache_size, "67108864", "", false)
+ADD_KEY_TYPE(hc_block_cache_size, "67108864", "", false)
+ADD_KEY_TYPE(hc_block_cache_block_size, "262144", "", false)
+ADD_KEY_TYPE(hc_egress_rate, "0", "", false)
+ADD_KEY_TYPE(hc_egress_file_rate, "0", "", false)
+ADD_KEY_TYPE(hc_egress_connection_rate, "0", "", false)
+ADD_KEY_TYPE(hc_egress_quantum, "262144", "", false)
+ADD_KEY_TYPE(hc_file_routes, "true", "", false)
+ADD_KEY_TYPE(hc_watermark_fast_path, "true", "", false)
 ADD_KEY_TYPE(tc_max_alert_wait_time, "15", "", false)
 ADD_KEY_TYPE(tc_max_partial_download_size, "22242880", "", false)
 ADD_KEY_TYPE(tc_root, "", "doc_root", false)
@@ -48,6 +76,12 @@ ADD_KEY_TYPE(tc_resolve_countries, "true", "", false)
 ADD_KEY_TYPE(tc_resolve_checkout, "6", "", false)
 ADD_KEY_TYPE(tc_auto_error_resolving, "true", "", false)
 ADD_KEY_TYPE(tc_loadable_session, "true", "", false)
+ADD_KEY_TYPE(tc_seek_window_pieces, "8", "", false)
+ADD_KEY_TYPE(tc_seek_deadline, "1000", "", false)
+ADD_KEY_TYPE(tc_seek_probe_bytes, "2097152", "", false)
+ADD_KEY_TYPE(tc_read_ahead_secs, "30", "", false)
+ADD_KEY_TYPE(tc_read_ahead_max_pieces, "64", "", false)
+ADD_KEY_TYPE(tc_reader_idle_timeout, "10", "", false)
 
 static inline void set_key(boost::property_tree::ptree & parser, 
 			setting_manager::key_base_ptr key) 
@@ -156,12 +190,40 @@ void setting_manager::init_keys_storage()
 	using namespace t2h_core_details;
 	// http server settings
 	key_storage_->reg<key_workers>("workers");
+	key_storage_->reg<key_min_workers>("min_workers");
+	key_storage_->reg<key_workers_idle_timeout>("workers_idle_timeout");
 	key_storage_->reg<key_doc_root>("doc_root");
 	key_storage_->reg<key_server_addr>("server_addr");
 	key_storage_->reg<key_server_port>("server_port");
 	key_storage_->reg<key_cores_sync_timeout>("cores_sync_timeout");
 	key_storage_->reg<key_hc_max_chunk_size>("hc_max_chunk_size");
 	key_storage_->reg<key_hc_chunked>("hc_chunked");
+	key_storage_->reg<key_hc_zero_copy>("hc_zero_copy");
+	key_storage_->reg<key_hc_max_cached_fds>("hc_max_cached_fds");
+	key_storage_->reg<key_hc_mmap_completed>("hc_mmap_completed");
+	key_storage_->reg<key_hc_read_ahead>("hc_read_ahead");
+	key_storage_->reg<key_hc_read_ahead_buffers>("hc_read_ahead_buffers");
+	key_storage_->reg<key_hc_read_ahead_depth>("hc_read_ahead_depth");
+	key_storage_->reg<key_hc_read_ahead_threads>("hc_read_ahead_threads");
+	key_storage_->reg<key_hc_io_uring>("hc_io_uring");
+	key_storage_->reg<key_hc_io_uring_entries>("hc_io_uring_entries");
+	key_storage_->reg<key_hc_io_buffers_per_slab>("hc_io_buffers_per_slab");
+	key_storage_->reg<key_hc_io_max_free_slabs>("hc_io_max_free_slabs");
+	key_storage_->reg<key_hc_adaptive_chunk>("hc_adaptive_chunk");
+	key_storage_->reg<key_hc_min_chunk_size>("hc_min_chunk_size");
+	key_storage_->reg<key_hc_stream_as_avaliable>("hc_stream_as_avaliable");
+	key_storage_->reg<key_hc_transport>("hc_transport");
+	key_storage_->reg<key_hc_park_stalled>("hc_park_stalled");
+	key_storage_->reg<key_hc_resume_threads>("hc_resume_threads");
+	key_storage_->reg<key_hc_piece_cache_size>("hc_piece_cache_size");
+	key_storage_->reg<key_hc_block_cache_size>("hc_block_cache_size");
+	key_storage_->reg<key_hc_block_cache_block_size>("hc_block_cache_block_size");
+	key_storage_->reg<key_hc_egress_rate>("hc_egress_rate");
+	key_storage_->reg<key_hc_egress_file_rate>("hc_egress_file_rate");
+	key_storage_->reg<key_hc_egress_connection_rate>("hc_egress_connection_rate");
+	key_storage_->reg<key_hc_egress_quantum>("hc_egress_quantum");
+	key_storage_->reg<key_hc_file_routes>("hc_file_routes");
+	key_storage_->reg<key_hc_watermark_fast_path>("hc_watermark_fast_path");
 
 	// torrent core settings 
 	key_storage_->reg<key_tc_port_start>("tc_port_start");
@@ -180,6 +242,12 @@ void setting_manager::init_keys_storage()
 	key_storage_->reg<key_tc_resolve_checkout>("tc_resolve_checkout");
 	key_storage_->reg<key_tc_auto_error_resolving>("tc_auto_error_resolving");
 	key_storage_->reg<key_tc_loadable_session>("tc_loadable_session");
+	key_storage_->reg<key_tc_seek_window_pieces>("tc_seek_window_pieces");
+	key_storage_->reg<key_tc_seek_deadline>("tc_seek_deadline");
+	key_storage_->reg<key_tc_seek_probe_bytes>("tc_seek_probe_bytes");
+	key_storage_->reg<key_tc_read_ahead_secs>("tc_read_ahead_secs");
+	key_storage_->reg<key_tc_read_ahead_max_pieces>("tc_read_ahead_max_pieces");
+	key_storage_->reg<key_tc_reader_idle_timeout>("tc_reader_idle_timeout");
 }
 
 } // namespace t2h_core
@@ -113,7 +113,7 @@ static inline std::string create_url(
 	return std::string(http_protocol_prefix + 
 		sets_manager->get_value<std::string>("server_addr") + 
 		+ ":" + sets_manager->get_value<std::string>("server_port") + 
-		"/" + well_formed_fp);
+		(well_formed_fp[0] == '/' ? "" : "/") + well_formed_fp);
 }
 
 static inline t2h_handle_t t2h_init_(char const * config, bool load_from_file) 
@@ -240,8 +240,16 @@ T2H_STD_API_(char *) t2h_start_download(t2h_handle_t handle, T2H_SIZE_TYPE torre
 		underlying_info_ptr info; bool result = false; 
 		boost::tie(info, result) = h->get_info(torrent_id);
 		if (result) { 
-			std::string const url = details::create_url(h->core_handle->get_setting_manager(), 
-										tcore->start_torrent_download(info->tid, file_id));
+			/*  Route of the file(by the torrent identity) does not need the path escaping, 
+			 	so it handed out instead of the path if enabled */
+			t2h_core::setting_manager_ptr sets_manager = h->core_handle->get_setting_manager();
+			std::string file_path = tcore->start_torrent_download(info->tid, file_id);
+			if (!file_path.empty() && sets_manager->get_value<bool>("hc_file_routes")) {
+				std::string const route = tcore->get_file_route(info->tid, file_id);
+				if (!route.empty())
+					file_path = route;
+			} // if
+			std::string const url = details::create_url(sets_manager, file_path);
 			if ((mem = details::string_to_c_string(url)) != NULL) 
 				info->mem_collector.push_back(boost::shared_array<char>(mem));
 		} // result
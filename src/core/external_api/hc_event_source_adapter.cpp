@@ -16,7 +16,8 @@ namespace t2h_core { namespace details {
 hc_event_source_adapter::hc_event_source_adapter() 
 	: torrent_core_event_handler(), 
 	recv_name_("hcore_notification_recv"),
-	notification_center_(core_notification_center())
+	notification_center_(core_notification_center()),
+	progress_()
 { 
 }
 
@@ -25,12 +26,21 @@ hc_event_source_adapter::~hc_event_source_adapter()
 }
 
 void hc_event_source_adapter::on_file_add(std::string const & file_path, boost::int64_t file_size) 
+{
+	on_file_add(file_path, file_size, std::string(), -1);
+}
+
+void hc_event_source_adapter::on_file_add(
+	std::string const & file_path, boost::int64_t file_size, std::string const & info_hash, int file_index) 
 {
 	core_file_change_notification_ptr add_notification(new core_file_change_notification());
 	add_notification->event_type = core_file_change_notification::file_add;
 	add_notification->file_path = file_path;
 	add_notification->file_size = file_size;
 	add_notification->avaliable_bytes = 0;
+	add_notification->info_hash = info_hash;
+	add_notification->file_index = file_index;
+	progress_.reset(file_path);
 	SEND_NOTIFICATION(recv_name_, add_notification)
 }
 
@@ -40,6 +50,7 @@ void hc_event_source_adapter::on_file_remove(std::string const & file_path)
 	remove_notification->event_type = core_file_change_notification::file_remove;
 	remove_notification->file_path = file_path;
 	remove_notification->file_size = remove_notification->avaliable_bytes = 0;
+	progress_.reset(file_path);
 	SEND_NOTIFICATION(recv_name_, remove_notification)
 }
 
@@ -55,11 +66,42 @@ void hc_event_source_adapter::on_pause(std::string const & file_path)
 	
 void hc_event_source_adapter::on_progress_update(std::string const & file_path, boost::int64_t avaliable_bytes) 
 {
+	/*  Notification sent only if there is no pending one for the file, otherwise the update 
+	 	just overwrites the pending value. Dropped notification releases the slot, so the next update is sent */
+	core_progress_slot_ptr progress = progress_.update(file_path, avaliable_bytes);
+	if (!progress)
+		return;
+
 	core_file_change_notification_ptr update_notification(new core_file_change_notification());
 	update_notification->event_type = core_file_change_notification::file_update;
 	update_notification->file_path = file_path;
 	update_notification->avaliable_bytes = avaliable_bytes;
-	SEND_NOTIFICATION(recv_name_, update_notification)
+	update_notification->progress = progress;
+	if (!notification_center_->send_message(recv_name_, update_notification))
+		progress->take();
+}
+
+void hc_event_source_adapter::on_range_verified(
+	std::string const & file_path, boost::int64_t offset, boost::int64_t size) 
+{
+	on_range_verified(file_path, offset, size, boost::shared_array<char>(), 0);
+}
+
+void hc_event_source_adapter::on_range_verified(std::string const & file_path, 
+	boost::int64_t offset, 
+	boost::int64_t size, 
+	boost::shared_array<char> const & piece, 
+	std::size_t piece_offset) 
+{
+	core_file_change_notification_ptr range_notification(new core_file_change_notification());
+	range_notification->event_type = core_file_change_notification::file_range_verified;
+	range_notification->file_path = file_path;
+	range_notification->file_size = range_notification->avaliable_bytes = 0;
+	range_notification->range_offset = offset;
+	range_notification->range_size = size;
+	range_notification->piece = piece;
+	range_notification->piece_offset = piece_offset;
+	SEND_NOTIFICATION(recv_name_, range_notification)
 }
 
 } } // namespace t2h_core, details
@@ -2,12 +2,14 @@
 #define HC_EVENT_SOURCE_ADAPTER_HPP_INCLUDED
 
 #include "torrent_core_event_handler.hpp"
+#include "core_progress_channel.hpp"
 #include "core_notification_center.hpp"
 
 namespace t2h_core { namespace details {
 
 /**
- *
+ * hc_event_source_adapter sends the torrent core events to the http core, 
+ * progress updates conflated per file(see core_progress_channel)
  */
 class hc_event_source_adapter : public torrent_core_event_handler {
 public :
@@ -15,16 +17,25 @@ public :
 	virtual ~hc_event_source_adapter();
 	
 	virtual void on_file_add(std::string const & file_path, boost::int64_t file_size);
+	virtual void on_file_add(
+		std::string const & file_path, boost::int64_t file_size, std::string const & info_hash, int file_index);
 	virtual void on_file_remove(std::string const & file_path);
 
 	virtual void on_file_complete(std::string const & file_path, boost::int64_t avaliable_bytes); 
 	virtual void on_pause(std::string const & file_path);
 	
 	virtual void on_progress_update(std::string const & file_path, boost::int64_t avaliable_bytes);
+	virtual void on_range_verified(std::string const & file_path, boost::int64_t offset, boost::int64_t size);
+	virtual void on_range_verified(std::string const & file_path, 
+		boost::int64_t offset, 
+		boost::int64_t size, 
+		boost::shared_array<char> const & piece, 
+		std::size_t piece_offset);
 
 private :
 	std::string const recv_name_;
 	common::notification_center_ptr notification_center_;
+	core_progress_channel progress_;
 
 };
 
@@ -17,6 +17,8 @@ public :
 	virtual ~async_file_info_subscriber() { }
 	
 	virtual void on_bytes_avaliable_change(boost::int64_t avaliable_bytes) = 0;
+	/* Verified [first, last) bytes beyond the avaliable prefix(piece downloaded out of order) */
+	virtual void on_range_avaliable(boost::int64_t first, boost::int64_t last) { }
 	virtual void on_break() = 0;
 	virtual async_file_info_subscriber * clone() = 0;
 	
@@ -2,16 +2,44 @@
 #define BASE_CHUNKED_OSTREAM_HPP_INCLUDED
 
 #include "http_server_ostream_policy.hpp"
+#include "io_uring_reader.hpp"
+#include "resume_pool.hpp"
+#include "deadline_wheel.hpp"
+#include "egress_shaper.hpp"
+#include "io_buffers_pool.hpp"
 #include "async_file_info_subscriber.hpp"
 
+#include <string>
+#include <boost/function.hpp>
+
 namespace t2h_core { namespace details {
 
+/* Position of the reader in the file and its consumption rate(bytes per sec) */
+typedef boost::function<void (std::string const &, boost::int64_t, double)> reader_progress_routine_type;
+
 /**
  * http_chunked_ostream chunked outout stream for http reply 
  */
 struct hs_chunked_ostream_params {
-	boost::int64_t max_chunk_size;
-	std::size_t cores_sync_timeout;
+	boost::int64_t max_chunk_size;			// Max bytes per one transport IO
+	std::size_t cores_sync_timeout;			// Max wait time for bytes, in secs
+	bool adaptive_chunk;					// Size chunks by the client drain rate, in [min_chunk_size, max_chunk_size]
+	boost::int64_t min_chunk_size;			// Min bytes per one transport IO in adaptive mode
+	bool stream_as_avaliable;				// Send any new verified bytes at once, block only if there are none
+	bool zero_copy;							// Use zero-copy transfer if the transport support it
+	bool mmap_completed;					// Serve completed files from the shared memory mapping, if zero-copy is not used
+	bool read_ahead;						// Read next chunks by the dedicated IO thread while writing current
+	std::size_t read_ahead_buffers;			// Count of chunk buffers in the read ahead ring
+	std::size_t read_ahead_depth;			// Count of chunks after the ring hinted to the kernel(fadvise)
+	bool watermark_fast_path;				// Blocked reader waits on the watermark of the file(see core_watermark)
+	io_uring_reader_ptr io_reader;			// Shared batched reader, NULL if reads performed via pread
+	io_buffers_pool_ptr io_buffers;			// Shared pool of the chunk buffers(buffer size is max_chunk_size)
+	deadline_wheel_ptr deadlines;			// Shared timer of the bytes waiting deadlines(cores_sync_timeout)
+	resume_pool_ptr resume_pool;			// Threads which continue parked requests, NULL if parking disabled
+	resume_pool_ptr read_ahead_pool;		// Threads which read ahead chunks of all pipelines, NULL if read ahead disabled
+	egress_shaper_ptr egress;				// Shared rate shaper of the content, NULL if shaping disabled
+	deadline_wheel_ptr egress_deadlines;	// Shared fine timer which resumes parked throttled requests, NULL if parking disabled
+	reader_progress_routine_type reader_progress;	// Called about once per second while the content sending, could be empty
 };
 
 class base_chunked_ostream : 
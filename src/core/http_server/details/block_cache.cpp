@@ -0,0 +1,251 @@
+#include "block_cache.hpp"
+
+#include "io_uring_reader.hpp"
+#include "file_info_buffer.hpp"
+#include "file_handles_cache.hpp"
+
+#include <cstring>
+#include <algorithm>
+#include <boost/functional/hash.hpp>
+
+/* Count of the independent shards, each one has own lock */
+#define HCORE_BLOCK_CACHE_SHARDS 16
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public block_cache api
+ */
+
+block_cache::block_cache(std::size_t max_bytes, std::size_t block_size) 
+	: shards_(), block_size_(0)
+{
+	for (std::size_t it = 0; it < HCORE_BLOCK_CACHE_SHARDS; ++it)
+		shards_.push_back(shard_ptr(new shard()));
+	set_limits(max_bytes, block_size);
+}
+
+block_cache::~block_cache() 
+{
+	clear();
+}
+
+hc_cached_block_ptr block_cache::acquire(hc_file_info_ptr fi, 
+	hc_file_handle & file_handle, 
+	io_uring_reader * io_reader, 
+	boost::int64_t pos, 
+	boost::int64_t avaliable_end) 
+{
+	/*  Miss : the block readed without the shard lock, so the disk IO of the one reader does not 
+	 	block other readers of the shard. Readers of the block which is loading now wait for the load
+		and take its result, if the loaded bytes do not hold their pos they try again(own load). 
+		Verified bytes of the cached block which reach the pos copied to the new block, 
+		so only new bytes readed from the disk. The block allocated only by the loading reader */
+	BOOST_ASSERT(fi != NULL);
+	std::size_t const block_size = block_size_;
+	if (block_size == 0 || pos >= avaliable_end)
+		return hc_cached_block_ptr();
+
+	block_key const key = { fi.get(), pos / (boost::int64_t)block_size };
+	shard & s = get_shard(key);
+	boost::shared_ptr<hc_cached_block> previous;
+	block_flight_ptr flight;
+	{
+		boost::mutex::scoped_lock guard(s.lock);
+		for (;;) {
+			if (s.max_bytes == 0 || s.block_size != block_size)
+				return hc_cached_block_ptr();
+			if (hc_cached_block_ptr found = find_unsafe(s, fi, key, pos))
+				return found;
+			flights_type::iterator const in_flight = s.flights.find(key);
+			if (in_flight == s.flights.end())
+				break;
+			
+			block_flight_ptr const other = in_flight->second;
+			++s.coalesced;
+			while (!other->done)
+				other->waiter.wait(guard);
+			if (other->epoch == s.epoch && 
+				other->block && other->block->first <= pos && pos < other->block->last)
+				return other->block;
+		} // for
+
+		++s.misses;
+		flight.reset(new block_flight(s.epoch));
+		s.flights[key] = flight;
+		blocks_type::iterator const found = s.blocks.find(key);
+		if (found != s.blocks.end() && found->second.block->first <= pos && found->second.block->last >= pos)
+			previous = found->second.block;
+	}
+	
+	boost::shared_ptr<hc_cached_block> loaded(new hc_cached_block(key.block * block_size, block_size));
+	if (previous) {
+		std::memcpy(loaded->data.get() + (previous->first - loaded->offset), 
+			previous->bytes_at(previous->first), previous->last - previous->first);
+		loaded->first = previous->first;
+		loaded->last = previous->last;
+	} else 
+		loaded->first = loaded->last = pos;
+	
+	boost::int64_t const end = std::min(loaded->offset + (boost::int64_t)block_size, avaliable_end);
+	char * const buffer = loaded->data.get() + (loaded->last - loaded->offset);
+	boost::int64_t const readed = (io_reader && io_reader->is_open()) ? 
+		io_reader->read_at(file_handle.native_handle(), buffer, end - loaded->last, loaded->last) :
+		file_handle.read_at(buffer, end - loaded->last, loaded->last);
+	if (readed > 0)
+		loaded->last += readed;
+	else 
+		loaded.reset();
+
+	/*  Waiters woken in any case, the block cached only if the file was not invalidated meanwhile */
+	boost::lock_guard<boost::mutex> guard(s.lock);
+	s.flights.erase(key);
+	flight->block = loaded;
+	flight->done = true;
+	flight->waiter.notify_all();
+	if (!loaded || s.epoch != flight->epoch || s.max_bytes == 0 || s.block_size != block_size)
+		return loaded;
+
+	blocks_type::iterator const found = s.blocks.find(key);
+	if (found != s.blocks.end())
+		erase_unsafe(s, found);
+	cached_entry & entry = s.blocks[key];
+	entry.block = loaded;
+	entry.fi = fi;
+	entry.lru_pos = s.lru.insert(s.lru.begin(), key);
+	s.bytes += block_size;
+	evict_unsafe(s);
+	return loaded;
+}
+
+void block_cache::invalidate(hc_file_info_ptr fi) 
+{
+	/* Readers which still own the block continue to work with it */
+	BOOST_ASSERT(fi != NULL);
+	for (std::size_t it = 0; it < shards_.size(); ++it) {
+		shard & s = *shards_[it];
+		boost::lock_guard<boost::mutex> guard(s.lock);
+		++s.epoch;
+		for (blocks_type::iterator first = s.blocks.begin(), last = s.blocks.end(); first != last;) {
+			blocks_type::iterator const current = first++;
+			if (current->first.fi == fi.get())
+				erase_unsafe(s, current);
+		} // for
+	} // for
+}
+
+void block_cache::clear() 
+{
+	for (std::size_t it = 0; it < shards_.size(); ++it) {
+		shard & s = *shards_[it];
+		boost::lock_guard<boost::mutex> guard(s.lock);
+		++s.epoch;
+		s.blocks.clear();
+		s.lru.clear();
+		s.bytes = 0;
+	} // for
+}
+
+void block_cache::set_limits(std::size_t max_bytes, std::size_t block_size) 
+{
+	/*  Each shard gets equal part of the limit, but not less than one block */
+	std::size_t const shard_max_bytes = (max_bytes == 0 || block_size == 0) ? 
+		0 : std::max(max_bytes / shards_.size(), block_size);
+	for (std::size_t it = 0; it < shards_.size(); ++it) {
+		shard & s = *shards_[it];
+		boost::lock_guard<boost::mutex> guard(s.lock);
+		if (s.block_size != block_size) {
+			s.blocks.clear();
+			s.lru.clear();
+			s.bytes = 0;
+			s.block_size = block_size;
+		} // if
+		s.max_bytes = shard_max_bytes;
+		evict_unsafe(s);
+	} // for
+	block_size_ = block_size;
+}
+
+block_cache_stat block_cache::get_stat() const 
+{
+	block_cache_stat stat = { 0, 0, 0, block_size_, 0, 0, 0, 0, 0 };
+	for (std::size_t it = 0; it < shards_.size(); ++it) {
+		shard & s = *shards_[it];
+		boost::lock_guard<boost::mutex> guard(s.lock);
+		stat.blocks += s.blocks.size();
+		stat.bytes += s.bytes;
+		stat.max_bytes += s.max_bytes;
+		stat.hits += s.hits;
+		stat.misses += s.misses;
+		stat.evictions += s.evictions;
+		stat.pinned_skips += s.pinned_skips;
+		stat.coalesced += s.coalesced;
+	} // for
+	return stat;
+}
+
+/**
+ * Private block_cache api
+ */
+
+std::size_t block_cache::block_key_hash::operator()(block_key const & key) const 
+{
+	std::size_t seed = 0;
+	boost::hash_combine(seed, key.fi);
+	boost::hash_combine(seed, key.block);
+	return seed;
+}
+
+block_cache::shard & block_cache::get_shard(block_key const & key) const 
+{
+	return *shards_[block_key_hash()(key) % shards_.size()];
+}
+
+hc_cached_block_ptr block_cache::find_unsafe(
+	shard & s, hc_file_info_ptr fi, block_key const & key, boost::int64_t pos) 
+{
+	/*  Block of the gone file(which address reused by the new one) dropped. 
+	 	Hit moves the block to the front of lru */
+	blocks_type::iterator const found = s.blocks.find(key);
+	if (found == s.blocks.end())
+		return hc_cached_block_ptr();
+	if (found->second.fi.lock() != fi) {
+		erase_unsafe(s, found);
+		return hc_cached_block_ptr();
+	} // if
+	if (pos < found->second.block->first || pos >= found->second.block->last)
+		return hc_cached_block_ptr();
+
+	++s.hits;
+	s.lru.splice(s.lru.begin(), s.lru, found->second.lru_pos);
+	return found->second.block;
+}
+
+void block_cache::erase_unsafe(shard & s, blocks_type::iterator it) 
+{
+	s.bytes -= s.block_size;
+	s.lru.erase(it->second.lru_pos);
+	s.blocks.erase(it);
+}
+
+void block_cache::evict_unsafe(shard & s) 
+{
+	/*  Least recently used blocks dropped first, but the pinned ones(owned by readers) skipped */
+	lru_type::iterator it = s.lru.end();
+	while (s.bytes > s.max_bytes && it != s.lru.begin()) {
+		blocks_type::iterator const found = s.blocks.find(*--it);
+		BOOST_ASSERT(found != s.blocks.end());
+		if (!found->second.block.unique()) {
+			++s.pinned_skips;
+			continue;
+		} // if
+		++s.evictions;
+		++it;
+		erase_unsafe(s, found);
+	} // while
+}
+
+} } // namespace t2h_core, details
+
+#undef HCORE_BLOCK_CACHE_SHARDS
+
@@ -0,0 +1,152 @@
+#ifndef BLOCK_CACHE_HPP_INCLUDED
+#define BLOCK_CACHE_HPP_INCLUDED
+
+#include <list>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace t2h_core { namespace details {
+
+struct hc_file_info;
+class hc_file_handle;
+class io_uring_reader;
+
+/**
+ * hc_cached_block aligned block of the file readed from the disk, shared between all readers of the file.
+ * Only verified bytes [first, last) of the block are readed, the rest of the block is undefined.
+ */
+struct hc_cached_block : boost::noncopyable {
+	hc_cached_block(boost::int64_t offset_, std::size_t block_size)
+		: data(new char[block_size]), offset(offset_), first(offset_), last(offset_) { }
+
+	inline char const * bytes_at(boost::int64_t pos) const
+		{ return data.get() + (pos - offset); }
+
+	boost::scoped_array<char> data;		// Bytes of the block from its aligned offset
+	boost::int64_t offset;				// Aligned offset of the block in the file
+	boost::int64_t first;				// First readed byte
+	boost::int64_t last;				// End(exclusive) of the readed bytes
+};
+
+typedef boost::shared_ptr<hc_cached_block const> hc_cached_block_ptr;
+
+/**
+ * block_cache_stat counters of the block cache(sum of all shards)
+ */
+struct block_cache_stat {
+	std::size_t blocks;					// Count of cached blocks
+	std::size_t bytes;					// Bytes held by the cached blocks
+	std::size_t max_bytes;				// Limit of the cached bytes, 0 = cache off
+	std::size_t block_size;				// Size of the one block
+	boost::uint64_t hits;				// Reads served from the cached blocks
+	boost::uint64_t misses;				// Reads which loaded the block from the disk
+	boost::uint64_t evictions;			// Blocks dropped by the LRU
+	boost::uint64_t pinned_skips;		// Eviction candidates skipped, because some reader still writes them
+	boost::uint64_t coalesced;			// Reads which waited for the load of the other reader instead of own IO
+};
+
+/**
+ * block_cache process wide LRU cache of the aligned file blocks, readed once and shared by all
+ * concurrent streams of the file. Cache splitted to the shards by (hc_file_info, block),
+ * each shard has own lock, LRU and bytes limit. Blocks which readers still hold are pinned :
+ * LRU skips them, so the popular block is not reloaded while its readers write it.
+ * Loads are single-flight : the first reader of the missed block performs the IO, 
+ * all other readers of the same block(of the same hc_file_info) wait for its completion.
+ */
+class block_cache : boost::noncopyable {
+public :
+	block_cache(std::size_t max_bytes, std::size_t block_size);
+	~block_cache();
+
+	/* Cached block which holds the byte at pos, on miss the block loaded from the file : verified bytes 
+	 	from pos till the avaliable_end(but not beyond the block), via the io_reader if it open(NULL = pread). 
+		Empty if the cache is off or the read failed */
+	hc_cached_block_ptr acquire(boost::shared_ptr<hc_file_info> fi,
+		hc_file_handle & file_handle,
+		io_uring_reader * io_reader,
+		boost::int64_t pos,
+		boost::int64_t avaliable_end);
+	void invalidate(boost::shared_ptr<hc_file_info> fi);
+	void clear();
+
+	/* Drops all cached blocks if the block size changed */
+	void set_limits(std::size_t max_bytes, std::size_t block_size);
+	block_cache_stat get_stat() const;
+
+private :
+	struct block_key {
+		hc_file_info const * fi;
+		boost::int64_t block;
+
+		inline bool operator==(block_key const & other) const
+			{ return (fi == other.fi && block == other.block); }
+	};
+
+	struct block_key_hash {
+		std::size_t operator()(block_key const & key) const;
+	};
+
+	struct cached_entry;
+	typedef std::list<block_key> lru_type;
+	typedef boost::unordered_map<block_key, cached_entry, block_key_hash> blocks_type;
+
+	struct cached_entry {
+		boost::shared_ptr<hc_cached_block> block;
+		boost::weak_ptr<hc_file_info> fi;
+		lru_type::iterator lru_pos;
+	};
+
+	struct block_flight : boost::noncopyable {
+		explicit block_flight(boost::uint64_t epoch_) : done(false), epoch(epoch_), block(), waiter() { }
+
+		bool done;
+		boost::uint64_t epoch;					// Epoch of the shard at the load start
+		hc_cached_block_ptr block;				// Loaded block, empty if the load failed
+		boost::condition_variable waiter;
+	};
+
+	typedef boost::shared_ptr<block_flight> block_flight_ptr;
+	typedef boost::unordered_map<block_key, block_flight_ptr, block_key_hash> flights_type;
+
+	struct shard : boost::noncopyable {
+		shard() : lock(), blocks(), lru(), flights(), epoch(0), max_bytes(0), block_size(0), bytes(0),
+			hits(0), misses(0), evictions(0), pinned_skips(0), coalesced(0) { }
+
+		boost::mutex lock;
+		blocks_type blocks;
+		lru_type lru;
+		flights_type flights;					// Loads in progress
+		boost::uint64_t epoch;					// Changed by each invalidation, loads of the older epoch not cached
+		std::size_t max_bytes;
+		std::size_t block_size;
+		std::size_t bytes;
+		boost::uint64_t hits;
+		boost::uint64_t misses;
+		boost::uint64_t evictions;
+		boost::uint64_t pinned_skips;
+		boost::uint64_t coalesced;
+	};
+
+	typedef boost::shared_ptr<shard> shard_ptr;
+
+	shard & get_shard(block_key const & key) const;
+	hc_cached_block_ptr find_unsafe(shard & s,
+		boost::shared_ptr<hc_file_info> fi, block_key const & key, boost::int64_t pos);
+	void erase_unsafe(shard & s, blocks_type::iterator it);
+	void evict_unsafe(shard & s);
+
+	std::vector<shard_ptr> shards_;
+	std::size_t volatile block_size_;
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
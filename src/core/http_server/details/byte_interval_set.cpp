@@ -0,0 +1,59 @@
+#include "byte_interval_set.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public byte_interval_set api
+ */
+
+void byte_interval_set::insert(boost::int64_t first, boost::int64_t last)
+{
+	if (first >= last)
+		return;
+
+	/*  Swallow the previous interval if it touches the new one, then all next intervals
+	 	which start inside of the new one */
+	intervals_type::iterator it = intervals_.upper_bound(first);
+	if (it != intervals_.begin()) {
+		intervals_type::iterator prev = it;
+		--prev;
+		if (prev->second >= first) {
+			if (prev->second >= last)
+				return;
+			first = prev->first;
+			it = prev;
+		} // if
+	} // if
+
+	while (it != intervals_.end() && it->first <= last) {
+		if (it->second > last)
+			last = it->second;
+		intervals_.erase(it++);
+	} // while
+	intervals_[first] = last;
+}
+
+boost::int64_t byte_interval_set::contiguous_end(boost::int64_t pos) const
+{
+	intervals_type::const_iterator it = intervals_.upper_bound(pos);
+	if (it == intervals_.begin())
+		return pos;
+	--it;
+	return (it->second > pos) ? it->second : pos;
+}
+
+void byte_interval_set::erase_before(boost::int64_t last)
+{
+	for (intervals_type::iterator it = intervals_.begin(); it != intervals_.end() && it->first < last;) {
+		if (it->second > last) {
+			boost::int64_t const end = it->second;
+			intervals_.erase(it);
+			intervals_[last] = end;
+			return;
+		} // if
+		intervals_.erase(it++);
+	} // for
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,51 @@
+#ifndef BYTE_INTERVAL_SET_HPP_INCLUDED
+#define BYTE_INTERVAL_SET_HPP_INCLUDED
+
+#include <map>
+#include <boost/cstdint.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * byte_interval_set set of the disjoint [first, last) byte intervals of the file.
+ * Touching or overlapping intervals merged at insert, so the set stays small :
+ * one item per hole of the file, not per verified piece. Not thread safe.
+ */
+class byte_interval_set {
+public :
+	typedef std::map<boost::int64_t, boost::int64_t> intervals_type;
+	typedef intervals_type::const_iterator const_iterator;
+
+	byte_interval_set() : intervals_() { }
+
+	void insert(boost::int64_t first, boost::int64_t last);
+
+	/* End(exclusive) of the interval which contains pos, or pos if pos not in the set */
+	boost::int64_t contiguous_end(boost::int64_t pos) const;
+
+	inline bool contains(boost::int64_t first, boost::int64_t last) const
+		{ return (first >= last || contiguous_end(first) >= last); }
+
+	/* Drop bytes before last, used then the bytes became part of the avaliable prefix */
+	void erase_before(boost::int64_t last);
+
+	inline void clear()
+		{ intervals_.clear(); }
+	inline bool empty() const
+		{ return intervals_.empty(); }
+	inline std::size_t size() const
+		{ return intervals_.size(); }
+	inline const_iterator begin() const
+		{ return intervals_.begin(); }
+	inline const_iterator end() const
+		{ return intervals_.end(); }
+
+private :
+	intervals_type intervals_;				// first -> last
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
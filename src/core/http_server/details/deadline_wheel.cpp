@@ -0,0 +1,137 @@
+#include "deadline_wheel.hpp"
+
+#include <boost/bind.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public deadline_wheel api
+ */
+
+deadline_wheel::deadline_wheel(std::size_t slots, std::size_t tick_ms)
+	: lock_(),
+	waiter_(),
+	fired_(),
+	stop_(false),
+	tick_ms_(tick_ms == 0 ? (std::size_t)default_tick_ms : tick_ms),
+	tick_(0),
+	last_id_(invalid_timer),
+	firing_(invalid_timer),
+	slots_(slots == 0 ? (std::size_t)default_slots : slots),
+	index_(),
+	thread_()
+{
+	thread_.reset(new boost::thread(boost::bind(&deadline_wheel::tick_loop, this)));
+}
+
+deadline_wheel::~deadline_wheel()
+{
+	stop();
+}
+
+deadline_wheel::timer_id deadline_wheel::schedule(std::size_t secs, callback_type callback)
+{
+	return schedule_ms(secs * 1000, callback);
+}
+
+deadline_wheel::timer_id deadline_wheel::schedule_ms(std::size_t ms, callback_type callback)
+{
+	std::size_t const ticks = (ms + tick_ms_ - 1) / tick_ms_;
+	boost::mutex::scoped_lock guard(lock_);
+	timer const new_timer = { ++last_id_, tick_ + (ticks == 0 ? 1 : ticks), callback };
+	std::size_t const slot = new_timer.expire_tick % slots_.size();
+	slots_[slot].push_back(new_timer);
+	index_[new_timer.id] = std::make_pair(slot, --slots_[slot].end());
+	return new_timer.id;
+}
+
+bool deadline_wheel::cancel(timer_id id)
+{
+	boost::mutex::scoped_lock guard(lock_);
+	index_type::iterator found = index_.find(id);
+	if (found != index_.end()) {
+		slots_[found->second.first].erase(found->second.second);
+		index_.erase(found);
+		return true;
+	} // if
+
+	/*  Callback could cancel own timer, do not wait self */
+	if (thread_ && thread_->get_id() == boost::this_thread::get_id())
+		return false;
+	while (id != invalid_timer && firing_ == id)
+		fired_.wait(guard);
+	return false;
+}
+
+void deadline_wheel::stop()
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (stop_)
+		return;
+	stop_ = true;
+	guard.unlock();
+	waiter_.notify_one();
+	thread_->join();
+
+	guard.lock();
+	index_.clear();
+	for (std::size_t it = 0; it < slots_.size(); ++it)
+		slots_[it].clear();
+}
+
+std::size_t deadline_wheel::size() const
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return index_.size();
+}
+
+/**
+ * Private deadline_wheel api
+ */
+
+void deadline_wheel::tick_loop()
+{
+	/*  Ticks counted from the start time, so slow callbacks does not shift the wheel.
+	 	Timers of the slot which expire at later rounds stay in the slot */
+	boost::system_time next_tick = boost::get_system_time();
+	boost::mutex::scoped_lock guard(lock_);
+	for (;;) {
+		next_tick += boost::posix_time::milliseconds(tick_ms_);
+		while (!stop_ && boost::get_system_time() < next_tick)
+			waiter_.timed_wait(guard, next_tick);
+		if (stop_)
+			return;
+
+		++tick_;
+		slot_type expired;
+		slot_type & slot = slots_[tick_ % slots_.size()];
+		for (slot_type::iterator first = slot.begin(), last = slot.end(); first != last;) {
+			if (first->expire_tick > tick_) {
+				++first;
+				continue;
+			}
+			index_.erase(first->id);
+			expired.splice(expired.end(), slot, first++);
+		} // for
+
+		for (slot_type::iterator first = expired.begin(), last = expired.end(); first != last; ++first) {
+			firing_ = first->id;
+			guard.unlock();
+			/*  Bound state released before cancel of the timer returns, so the owner could go away right after it */
+			first->callback();
+			first->callback.clear();
+			guard.lock();
+			firing_ = invalid_timer;
+			fired_.notify_all();
+		} // for
+
+		/* Fired timers released outside of the lock too */
+		guard.unlock();
+		expired.clear();
+		guard.lock();
+	} // for
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,74 @@
+#ifndef DEADLINE_WHEEL_HPP_INCLUDED
+#define DEADLINE_WHEEL_HPP_INCLUDED
+
+#include <list>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/function.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * deadline_wheel hashed timing wheel with the fixed tick(one second by default), shared by all requests.
+ * Scheduling/cancel are O(1) and the wheel thread wakes up once per tick, so thousands
+ * of the waiting requests cost one thread instead of the timed wait per request.
+ * Callbacks called by the wheel thread outside of the wheel lock, one at a time.
+ */
+class deadline_wheel : boost::noncopyable {
+public :
+	typedef boost::uint64_t timer_id;
+	typedef boost::function<void ()> callback_type;
+
+	enum { invalid_timer = 0, default_slots = 64, default_tick_ms = 1000 };
+
+	explicit deadline_wheel(std::size_t slots = default_slots, std::size_t tick_ms = default_tick_ms);
+	~deadline_wheel();
+
+	/* Call the callback after secs(with the one tick precision), returns id of the timer */
+	timer_id schedule(std::size_t secs, callback_type callback);
+	/* Same as schedule, delay in ms rounded up to the tick */
+	timer_id schedule_ms(std::size_t ms, callback_type callback);
+
+	/* Remove the timer, false if the timer already fired. If the callback of the timer is running
+	 	right now waits till it done, so after cancel the callback never touch its owner */
+	bool cancel(timer_id id);
+
+	void stop();
+	std::size_t size() const;
+
+private :
+	struct timer {
+		timer_id id;
+		boost::uint64_t expire_tick;
+		callback_type callback;
+	};
+
+	typedef std::list<timer> slot_type;
+	typedef boost::unordered_map<timer_id, std::pair<std::size_t, slot_type::iterator> > index_type;
+
+	void tick_loop();
+
+	boost::mutex mutable lock_;
+	boost::condition_variable waiter_;
+	boost::condition_variable fired_;
+	bool stop_;
+	std::size_t const tick_ms_;
+	boost::uint64_t tick_;
+	timer_id last_id_;
+	timer_id firing_;						// Timer which callback is running now
+	std::vector<slot_type> slots_;
+	index_type index_;
+	boost::scoped_ptr<boost::thread> thread_;
+
+};
+
+typedef boost::shared_ptr<deadline_wheel> deadline_wheel_ptr;
+
+} } // namespace t2h_core, details
+
+#endif
+
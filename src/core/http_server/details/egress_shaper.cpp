@@ -0,0 +1,272 @@
+#include "egress_shaper.hpp"
+
+#include <algorithm>
+
+/* Max bytes of the full bucket : the rate per the burst time, but not less than the one grant */
+#define HCORE_EGRESS_BURST_SECS 0.1
+/* Bounds of the one waiting for the budget, limits could be changed while the stream waits */
+#define HCORE_EGRESS_MIN_WAIT_MS 1
+#define HCORE_EGRESS_MAX_WAIT_MS 100
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public egress_shaper api
+ */
+
+egress_shaper::egress_shaper(egress_limits const & limits, std::size_t quantum)
+	: lock_(),
+	waiter_(),
+	limits_(limits),
+	quantum_(quantum == 0 ? 1 : quantum),
+	enabled_(false),
+	stopped_(false),
+	global_(),
+	files_(),
+	waiters_(),
+	stat_()
+{
+	enabled_ = (limits_.global_rate > 0 || limits_.file_rate > 0 || limits_.connection_rate > 0);
+}
+
+egress_shaper::~egress_shaper()
+{
+	stop();
+}
+
+void egress_shaper::attach(egress_stream & stream, std::string const & file_path)
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (stream.attached)
+		return;
+	stream.file_path = file_path;
+	stream.file = &files_[file_path];
+	++stream.file->streams;
+	stream.attached = true;
+	++stat_.streams;
+}
+
+void egress_shaper::detach(egress_stream & stream)
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (!stream.attached)
+		return;
+	bool const waiting = stream.waiting;
+	dequeue_unsafe(stream, boost::posix_time::microsec_clock::universal_time());
+	if (--stream.file->streams == 0)
+		files_.erase(stream.file_path);
+	stream.file = NULL;
+	stream.attached = false;
+	--stat_.streams;
+	++stat_.finished;
+	stat_.bytes += stream.bytes;
+	stat_.throttled_ms += stream.throttled.total_microseconds() / 1000.0;
+	stat_.starved_ms += stream.starved.total_microseconds() / 1000.0;
+	guard.unlock();
+	if (waiting)
+		waiter_.notify_all();
+}
+
+boost::int64_t egress_shaper::acquire(egress_stream & stream, boost::int64_t wanted)
+{
+	if (!is_enabled() || !stream.attached || wanted <= 0)
+		return wanted;
+
+	boost::mutex::scoped_lock guard(lock_);
+	for (;;) {
+		double delay_ms = 0;
+		boost::int64_t const granted = grant_unsafe(stream, wanted, delay_ms);
+		if (granted > 0) {
+			guard.unlock();
+			/* Next waiting stream could take the rest of the global budget */
+			waiter_.notify_all();
+			return granted;
+		} // if
+		waiter_.timed_wait(guard, boost::posix_time::microseconds((boost::int64_t)(delay_ms * 1000.0)));
+	} // for
+}
+
+boost::int64_t egress_shaper::try_acquire(egress_stream & stream, boost::int64_t wanted, std::size_t & delay_ms)
+{
+	/*  Waiting stream goes through the lock even if the shaping is off now, it must leave the waiting streams */
+	if ((!is_enabled() && !stream.waiting) || !stream.attached || wanted <= 0)
+		return wanted;
+
+	boost::mutex::scoped_lock guard(lock_);
+	double wait_ms = 0;
+	boost::int64_t const granted = grant_unsafe(stream, wanted, wait_ms);
+	guard.unlock();
+	if (granted > 0) {
+		waiter_.notify_all();
+		return granted;
+	} // if
+	delay_ms = (std::size_t)(wait_ms + 0.5);
+	return 0;
+}
+
+void egress_shaper::cancel_wait(egress_stream & stream)
+{
+	if (!stream.waiting)
+		return;
+	boost::mutex::scoped_lock guard(lock_);
+	dequeue_unsafe(stream, boost::posix_time::microsec_clock::universal_time());
+	guard.unlock();
+	waiter_.notify_all();
+}
+
+void egress_shaper::settle(egress_stream & stream, boost::int64_t granted, boost::int64_t writed)
+{
+	if (writed < 0)
+		writed = 0;
+	stream.bytes += writed;
+	if (!is_enabled() || !stream.attached || writed == granted)
+		return;
+
+	boost::mutex::scoped_lock guard(lock_);
+	charge_unsafe(stream, (double)(writed - granted));
+	guard.unlock();
+	if (writed < granted)
+		waiter_.notify_all();
+}
+
+void egress_shaper::set_limits(egress_limits const & limits)
+{
+	boost::mutex::scoped_lock guard(lock_);
+	limits_ = limits;
+	enabled_ = !stopped_ && (limits_.global_rate > 0 || limits_.file_rate > 0 || limits_.connection_rate > 0);
+	guard.unlock();
+	waiter_.notify_all();
+}
+
+egress_limits egress_shaper::get_limits() const
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return limits_;
+}
+
+void egress_shaper::stop()
+{
+	boost::mutex::scoped_lock guard(lock_);
+	stopped_ = true;
+	enabled_ = false;
+	guard.unlock();
+	waiter_.notify_all();
+}
+
+egress_shaper_stat egress_shaper::get_stat() const
+{
+	boost::mutex::scoped_lock guard(lock_);
+	egress_shaper_stat stat = stat_;
+	stat.limits = limits_;
+	stat.waiting = waiters_.size();
+	return stat;
+}
+
+/**
+ * Private egress_shaper api
+ */
+
+void egress_shaper::refill_unsafe(token_bucket & bucket, std::size_t rate, boost::posix_time::ptime const & now) const
+{
+	/*  Unlimited bucket forgets its state, so after the limit set it starts full */
+	if (rate == 0) {
+		bucket.last = boost::posix_time::ptime();
+		return;
+	} // if
+
+	double const burst = std::max(rate * HCORE_EGRESS_BURST_SECS, (double)quantum_);
+	if (bucket.last.is_not_a_date_time()) {
+		bucket.tokens = burst;
+		bucket.last = now;
+		return;
+	} // if
+
+	if (now <= bucket.last)
+		return;
+	bucket.tokens = std::min(burst, bucket.tokens + rate * ((now - bucket.last).total_microseconds() / 1000000.0));
+	bucket.last = now;
+}
+
+bool egress_shaper::is_allowed_unsafe(egress_stream & stream, boost::posix_time::ptime const & now) const
+{
+	refill_unsafe(stream.bucket, limits_.connection_rate, now);
+	refill_unsafe(stream.file->bucket, limits_.file_rate, now);
+	return ((limits_.connection_rate == 0 || stream.bucket.tokens > 0) &&
+		(limits_.file_rate == 0 || stream.file->bucket.tokens > 0));
+}
+
+double egress_shaper::get_delay_unsafe(egress_stream const & stream) const
+{
+	/*  Time till all budgets of the stream are positive, in secs */
+	double delay = 0;
+	if (limits_.global_rate > 0 && global_.tokens <= 0)
+		delay = std::max(delay, -global_.tokens / limits_.global_rate);
+	if (limits_.file_rate > 0 && stream.file->bucket.tokens <= 0)
+		delay = std::max(delay, -stream.file->bucket.tokens / limits_.file_rate);
+	if (limits_.connection_rate > 0 && stream.bucket.tokens <= 0)
+		delay = std::max(delay, -stream.bucket.tokens / limits_.connection_rate);
+	return delay;
+}
+
+void egress_shaper::charge_unsafe(egress_stream & stream, double bytes)
+{
+	if (limits_.global_rate > 0)
+		global_.tokens -= bytes;
+	if (limits_.file_rate > 0)
+		stream.file->bucket.tokens -= bytes;
+	if (limits_.connection_rate > 0)
+		stream.bucket.tokens -= bytes;
+}
+
+boost::int64_t egress_shaper::grant_unsafe(egress_stream & stream, boost::int64_t wanted, double & delay_ms)
+{
+	/*  Global budget taken by the first waiting stream which own(connection and file) budgets allow to send,
+	 	so the stream limited by own budget does not block other streams. Grant charged at once,
+		the debt of the budgets paid by the next waiting. Stream stays in the waiting streams till the grant */
+	using boost::posix_time::ptime;
+	using boost::posix_time::microsec_clock;
+	ptime const now = microsec_clock::universal_time();
+	if (!stream.waiting) {
+		stream.wait_pos = waiters_.insert(waiters_.end(), &stream);
+		stream.wait_started = now;
+		stream.waiting = true;
+	} // if
+
+	boost::int64_t const granted = std::min(wanted, (boost::int64_t)quantum_);
+	if (!enabled_) {
+		dequeue_unsafe(stream, now);
+		return granted;
+	} // if
+
+	refill_unsafe(global_, limits_.global_rate, now);
+	if (limits_.global_rate == 0 || global_.tokens > 0) {
+		waiters_type::iterator first = waiters_.begin();
+		while (first != waiters_.end() && !is_allowed_unsafe(**first, now))
+			++first;
+		if (first == stream.wait_pos) {
+			charge_unsafe(stream, (double)granted);
+			dequeue_unsafe(stream, now);
+			return granted;
+		}
+	} // if
+
+	delay_ms = std::min(std::max(get_delay_unsafe(stream) * 1000.0,
+		(double)HCORE_EGRESS_MIN_WAIT_MS), (double)HCORE_EGRESS_MAX_WAIT_MS);
+	return 0;
+}
+
+void egress_shaper::dequeue_unsafe(egress_stream & stream, boost::posix_time::ptime const & now)
+{
+	if (!stream.waiting)
+		return;
+	waiters_.erase(stream.wait_pos);
+	stream.waiting = false;
+	stream.throttled += now - stream.wait_started;
+}
+
+} } // namespace t2h_core, details
+
+#undef HCORE_EGRESS_BURST_SECS
+#undef HCORE_EGRESS_MIN_WAIT_MS
+#undef HCORE_EGRESS_MAX_WAIT_MS
+
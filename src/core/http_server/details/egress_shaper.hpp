@@ -0,0 +1,142 @@
+#ifndef EGRESS_SHAPER_HPP_INCLUDED
+#define EGRESS_SHAPER_HPP_INCLUDED
+
+#include <list>
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * egress_limits rates of the egress budgets, in bytes per sec, 0 = unlimited
+ */
+struct egress_limits {
+	std::size_t global_rate;			// All streams of the server
+	std::size_t file_rate;				// All streams of the one file
+	std::size_t connection_rate;		// One stream
+};
+
+/**
+ * egress_shaper_stat counters of the egress shaper, time of the finished streams included
+ */
+struct egress_shaper_stat {
+	egress_limits limits;				// Current limits
+	std::size_t streams;				// Count of attached streams
+	std::size_t waiting;				// Count of streams which wait for the budget now
+	boost::uint64_t finished;			// Count of detached streams
+	boost::uint64_t bytes;				// Bytes sended by the detached streams
+	double throttled_ms;				// Time the detached streams waited for the budget, in ms
+	double starved_ms;					// Time the detached streams waited for the torrent bytes, in ms
+};
+
+/**
+ * token_bucket budget of the one rate, refilled by the time. Tokens could go below zero :
+ * the chunk granted at once and the debt paid by the next waiting.
+ */
+struct token_bucket {
+	token_bucket() : tokens(0), last() { }
+
+	double tokens;
+	boost::posix_time::ptime last;		// Time of the last refill, not_a_date_time if bucket is not used yet
+};
+
+/**
+ * egress_file_budget budget shared by all streams of the one file
+ */
+struct egress_file_budget {
+	egress_file_budget() : bucket(), streams(0) { }
+
+	token_bucket bucket;
+	std::size_t streams;				// Count of attached streams of the file
+};
+
+/**
+ * egress_stream egress state of the one reply, owned by the ostream.
+ * Budget fields managed by the egress_shaper under its lock.
+ */
+struct egress_stream : boost::noncopyable {
+	egress_stream()
+		: file_path(), bytes(0), throttled(), starved(), attached(false), bucket(), file(NULL),
+		waiting(false), wait_pos(), wait_started() { }
+
+	std::string file_path;
+	boost::int64_t bytes;							// Bytes sended by the stream
+	boost::posix_time::time_duration throttled;		// Time of the waiting for the budget
+	boost::posix_time::time_duration starved;		// Time of the waiting for the torrent bytes, updated by the ostream
+	bool attached;
+	token_bucket bucket;							// Connection budget
+	egress_file_budget * file;						// Budget of the file, set by the attach
+	bool waiting;									// Queued in the waiting streams
+	std::list<egress_stream *>::iterator wait_pos;	// Place of the stream in the waiting streams
+	boost::posix_time::ptime wait_started;
+};
+
+/**
+ * egress_shaper token bucket shaping of the replies content : global, per file and per connection budgets.
+ * Streams which wait for the budget served in FIFO order, the first waiting stream which own budgets
+ * allow to send takes the global budget, so the fast client does not starve other viewers.
+ * Each grant limited by the quantum, limits could be changed at any time.
+ */
+class egress_shaper : boost::noncopyable {
+public :
+	egress_shaper(egress_limits const & limits, std::size_t quantum);
+	~egress_shaper();
+
+	void attach(egress_stream & stream, std::string const & file_path);
+	void detach(egress_stream & stream);
+
+	/* Blocks till the budgets allow to send, returns count of bytes(<= wanted) which the stream could send now */
+	boost::int64_t acquire(egress_stream & stream, boost::int64_t wanted);
+	/* Same as acquire, but never blocks : returns 0 and the delay before the next try if the budgets 
+	   do not allow to send, the stream keeps its place in the waiting streams till the grant or cancel_wait */
+	boost::int64_t try_acquire(egress_stream & stream, boost::int64_t wanted, std::size_t & delay_ms);
+	void cancel_wait(egress_stream & stream);
+	/* Corrects budgets by the really sended bytes(the write path could send less or more than granted) */
+	void settle(egress_stream & stream, boost::int64_t granted, boost::int64_t writed);
+
+	void set_limits(egress_limits const & limits);
+	egress_limits get_limits() const;
+
+	/* Wakes all waiting streams, after the stop streams are not shaped */
+	void stop();
+
+	egress_shaper_stat get_stat() const;
+
+private :
+	typedef boost::unordered_map<std::string, egress_file_budget> files_type;
+	typedef std::list<egress_stream *> waiters_type;
+
+	void refill_unsafe(token_bucket & bucket, std::size_t rate, boost::posix_time::ptime const & now) const;
+	bool is_allowed_unsafe(egress_stream & stream, boost::posix_time::ptime const & now) const;
+	double get_delay_unsafe(egress_stream const & stream) const;
+	void charge_unsafe(egress_stream & stream, double bytes);
+	boost::int64_t grant_unsafe(egress_stream & stream, boost::int64_t wanted, double & delay_ms);
+	void dequeue_unsafe(egress_stream & stream, boost::posix_time::ptime const & now);
+
+	inline bool is_enabled() const
+		{ return enabled_; }
+
+	boost::mutex mutable lock_;
+	boost::condition_variable waiter_;
+	egress_limits limits_;
+	std::size_t const quantum_;
+	bool volatile enabled_;					// Any limit set and the shaper is not stopped
+	bool stopped_;
+	token_bucket global_;
+	files_type files_;
+	waiters_type waiters_;
+	egress_shaper_stat stat_;
+
+};
+
+typedef boost::shared_ptr<egress_shaper> egress_shaper_ptr;
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -0,0 +1,255 @@
+#include "file_handles_cache.hpp"
+
+#include "file_info_buffer.hpp"
+#include "http_server_macroses.hpp"
+
+#include <fcntl.h>
+#include <climits>
+#include <algorithm>
+#if defined(WIN32)
+#	include <io.h>
+#else
+#	include <errno.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#endif // WIN32
+
+/* Do not map files which do not fit well to 32 bit address space */
+#define HCORE_FHC_MAX_MAPPING_SIZE_32 (boost::int64_t)(512 * 1024 * 1024)
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public hc_file_handle api
+ */
+
+hc_file_handle::hc_file_handle(std::string const & file_path) 
+	: fd_(-1)
+{
+#if defined(WIN32)
+	fd_ = ::_open(file_path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+	fd_ = ::open(file_path.c_str(), O_RDONLY);
+#endif // WIN32
+}
+
+hc_file_handle::~hc_file_handle() 
+{
+	if (fd_ != -1)
+#if defined(WIN32)
+		::_close(fd_);
+#else
+		::close(fd_);
+#endif // WIN32
+}
+
+boost::int64_t hc_file_handle::read_at(char * buffer, std::size_t bytes_size, boost::int64_t offset) 
+{
+#if defined(WIN32)
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (::_lseeki64(fd_, offset, SEEK_SET) < 0)
+		return -1;
+	return ::_read(fd_, buffer, bytes_size);
+#else
+	boost::int64_t readed = 0;
+	while (readed < (boost::int64_t)bytes_size) {
+		ssize_t const res = ::pread(fd_, buffer + readed, bytes_size - readed, offset + readed);
+		if (res < 0 && errno == EINTR)
+			continue;
+		if (res <= 0)
+			return (readed == 0) ? res : readed;
+		readed += res;
+	} // while
+	return readed;
+#endif // WIN32
+}
+
+void hc_file_handle::advise_willneed(boost::int64_t offset, boost::int64_t bytes_size) const 
+{
+	if (fd_ == -1 || bytes_size <= 0)
+		return;
+#if defined(__APPLE__)
+	struct radvisory advisory = { (off_t)offset, (int)std::min<boost::int64_t>(bytes_size, INT_MAX) };
+	::fcntl(fd_, F_RDADVISE, &advisory);
+#elif defined(POSIX_FADV_WILLNEED)
+	::posix_fadvise(fd_, offset, bytes_size, POSIX_FADV_WILLNEED);
+#endif 
+}
+
+/**
+ * Public hc_file_mapping api
+ */
+
+hc_file_mapping::hc_file_mapping(std::string const & file_path, boost::int64_t file_size) 
+	: mapping_()
+{
+	if (file_size <= 0 || (sizeof(void *) < 8 && file_size > HCORE_FHC_MAX_MAPPING_SIZE_32))
+		return;
+	try 
+	{
+		mapping_.open(file_path, file_size);
+	}
+	catch (std::exception const & expt) 
+	{
+		HCORE_WARNING("failed to map file '%s', with reason '%s'", file_path.c_str(), expt.what())
+	}
+}
+
+hc_file_mapping::~hc_file_mapping() 
+{
+	if (mapping_.is_open())
+		mapping_.close();
+}
+
+void hc_file_mapping::advise(boost::int64_t offset, boost::int64_t bytes_size, advice_type advice) const 
+{
+#if !defined(WIN32)
+	/* madvise needs page aligned address */
+	static long const page_size = ::sysconf(_SC_PAGESIZE);
+	if (!mapping_.is_open() || page_size <= 0)
+		return;
+	boost::int64_t const aligned_offset = offset - (offset % page_size);
+	boost::int64_t aligned_size = bytes_size + (offset - aligned_offset);
+	if (aligned_offset + aligned_size > size())
+		aligned_size = size() - aligned_offset;
+	if (aligned_size <= 0)
+		return;
+	::posix_madvise(const_cast<char *>(mapping_.data()) + aligned_offset, aligned_size,
+		(advice == advice_sequential) ? POSIX_MADV_SEQUENTIAL : POSIX_MADV_WILLNEED);
+#endif // WIN32
+}
+
+/**
+ * Public file_handles_cache api
+ */
+
+file_handles_cache::file_handles_cache(std::size_t max_handles) 
+	: lock_(), lru_(), max_handles_(max_handles)
+{
+}
+
+file_handles_cache::~file_handles_cache() 
+{
+	clear();
+}
+
+hc_file_handle_ptr file_handles_cache::acquire(hc_file_info_ptr fi) 
+{
+	/*  Hit : move item to the front of lru and return shared handle. 
+	 	Miss : open new handle, attach it to the hc_file_info and evict least recently used handles */
+	BOOST_ASSERT(fi != NULL);
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (fi->file_handle) {
+		touch_unsafe(fi);
+		return fi->file_handle;
+	}
+	
+	hc_file_handle_ptr handle(new hc_file_handle(fi->file_path));
+	if (!handle->is_open()) {
+		HCORE_WARNING("failed to open file '%s'", fi->file_path.c_str())
+		return hc_file_handle_ptr();
+	}
+	
+	if (max_handles_ == 0)
+		return handle;
+
+	touch_unsafe(fi);
+	fi->file_handle = handle;
+	evict_unsafe();
+	return handle;
+}
+
+hc_file_mapping_ptr file_handles_cache::acquire_mapping(hc_file_info_ptr fi) 
+{
+	/*  Same as acquire, but for the mapping. 
+	 	The whole file mapped and advised for the sequential read once. 
+		Size of the file guarded by the lock of the file, it never taken under the lock of the cache */
+	BOOST_ASSERT(fi != NULL);
+	boost::int64_t file_size = 0;
+	{
+		boost::lock_guard<boost::mutex> fi_guard(fi->lock);
+		file_size = fi->file_size;
+	}
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (fi->file_mapping) {
+		touch_unsafe(fi);
+		return fi->file_mapping;
+	}
+
+	hc_file_mapping_ptr mapping(new hc_file_mapping(fi->file_path, file_size));
+	if (!mapping->is_open())
+		return hc_file_mapping_ptr();
+	mapping->advise(0, mapping->size(), hc_file_mapping::advice_sequential);
+
+	if (max_handles_ == 0)
+		return mapping;
+
+	touch_unsafe(fi);
+	fi->file_mapping = mapping;
+	evict_unsafe();
+	return mapping;
+}
+
+void file_handles_cache::invalidate(hc_file_info_ptr fi) 
+{
+	/*  Readers which still own the handle continue to work with it, 
+	 	the descriptor will be closed then last reader release it */
+	BOOST_ASSERT(fi != NULL);
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (fi->file_handle || fi->file_mapping) {
+		lru_.erase(fi->file_handle_lru_pos);
+		fi->file_handle.reset();
+		fi->file_mapping.reset();
+	}
+}
+
+void file_handles_cache::clear() 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	for (lru_type::iterator first = lru_.begin(), last = lru_.end(); 
+		first != last; 
+		++first) 
+	{
+		if (hc_file_info_ptr fi = first->lock()) {
+			fi->file_handle.reset();
+			fi->file_mapping.reset();
+		}
+	}
+	lru_.clear();
+}
+
+void file_handles_cache::set_max_handles(std::size_t max_handles) 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	max_handles_ = max_handles;
+	evict_unsafe();
+}
+
+/**
+ * Private file_handles_cache api
+ */
+
+void file_handles_cache::touch_unsafe(hc_file_info_ptr fi) 
+{
+	/* hc_file_info in lru only if it have cached handle or mapping */
+	if (fi->file_handle || fi->file_mapping)
+		lru_.splice(lru_.begin(), lru_, fi->file_handle_lru_pos);
+	else
+		fi->file_handle_lru_pos = lru_.insert(lru_.begin(), fi);
+}
+
+void file_handles_cache::evict_unsafe() 
+{
+	while (lru_.size() > max_handles_) {
+		if (hc_file_info_ptr fi = lru_.back().lock()) {
+			fi->file_handle.reset();
+			fi->file_mapping.reset();
+		}
+		lru_.pop_back();
+	} // while
+}
+
+} } // namespace t2h_core, details
+
+#undef HCORE_FHC_MAX_MAPPING_SIZE_32
+
@@ -0,0 +1,111 @@
+#ifndef FILE_HANDLES_CACHE_HPP_INCLUDED
+#define FILE_HANDLES_CACHE_HPP_INCLUDED
+
+#include <list>
+#include <string>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
+
+namespace t2h_core { namespace details {
+
+struct hc_file_info;
+
+/**
+ * hc_file_handle read-only file descriptor, shared between all readers of the file.
+ * The descriptor closed then the last owner(cache or reader) release the handle.
+ */
+class hc_file_handle : boost::noncopyable {
+public :
+	explicit hc_file_handle(std::string const & file_path);
+	~hc_file_handle();
+
+	inline bool is_open() const 
+		{ return (fd_ != -1); }
+
+	inline int native_handle() const 
+		{ return fd_; }
+	
+	/* Positional read(pread), does not move the file offset, so it safe to call from several threads.
+	 	Returns count of readed bytes or -1 on error */
+	boost::int64_t read_at(char * buffer, std::size_t bytes_size, boost::int64_t offset);
+	
+	/* Hint to the kernel about the range will be readed soon(posix_fadvise WILLNEED/F_RDADVISE), 
+	 	no-op on platforms without such hints */
+	void advise_willneed(boost::int64_t offset, boost::int64_t bytes_size) const;
+
+private :
+	int fd_;
+#if defined(WIN32)
+	boost::mutex lock_;
+#endif // WIN32
+
+};
+
+typedef boost::shared_ptr<hc_file_handle> hc_file_handle_ptr;
+
+/**
+ * hc_file_mapping read-only memory mapping of the completed file, shared between all readers of the file.
+ */
+class hc_file_mapping : boost::noncopyable {
+public :
+	enum advice_type { advice_sequential, advice_willneed };
+
+	hc_file_mapping(std::string const & file_path, boost::int64_t file_size);
+	~hc_file_mapping();
+	
+	inline bool is_open() const 
+		{ return mapping_.is_open(); }
+
+	inline char const * data() const 
+		{ return mapping_.data(); }
+
+	inline boost::int64_t size() const 
+		{ return mapping_.size(); }
+	
+	/* Hint to the kernel(madvise) about how the range will be readed, no-op on platforms without madvise */
+	void advise(boost::int64_t offset, boost::int64_t bytes_size, advice_type advice) const;
+
+private :
+	boost::iostreams::mapped_file_source mapping_;
+
+};
+
+typedef boost::shared_ptr<hc_file_mapping> hc_file_mapping_ptr;
+
+/**
+ * file_handles_cache LRU cache of the hc_file_handle and hc_file_mapping, 
+ * each cached handle/mapping attached to hc_file_info
+ */
+class file_handles_cache : boost::noncopyable {
+public :
+	typedef std::list<boost::weak_ptr<hc_file_info> > lru_type;
+
+	explicit file_handles_cache(std::size_t max_handles);
+	~file_handles_cache();
+	
+	hc_file_handle_ptr acquire(boost::shared_ptr<hc_file_info> fi);
+	/* Map file, caller must be sure about the file is completed(eg will not grow) */
+	hc_file_mapping_ptr acquire_mapping(boost::shared_ptr<hc_file_info> fi);
+	void invalidate(boost::shared_ptr<hc_file_info> fi);
+	void clear();
+
+	void set_max_handles(std::size_t max_handles);
+
+private :
+	void touch_unsafe(boost::shared_ptr<hc_file_info> fi);
+	void evict_unsafe();
+
+	boost::mutex mutable lock_;
+	lru_type lru_;
+	std::size_t max_handles_;
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
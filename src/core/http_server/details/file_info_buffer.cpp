@@ -1,15 +1,26 @@
 #include "file_info_buffer.hpp"
 
+#include "http_utility.hpp"
 #include "http_server_macroses.hpp"
 #include "core_notification_center.hpp"
 #include "file_info_buffer_realtime_updater.hpp"
 
+#include <ctime>
+#include <algorithm>
 #include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/functional/hash.hpp>
 #include <boost/date_time/posix_time/posix_time_io.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 
 //#define T2H_DEEP_DEBUG
 #define HCORE_FIB_UPDATER_NAME "hcore_notification_recv";
+#define HCORE_FIB_DEFAULT_MAX_CACHED_FILE_HANDLES 128
+#define HCORE_FIB_DEFAULT_MAX_CACHED_PIECE_BYTES 0
+#define HCORE_FIB_DEFAULT_MAX_CACHED_BLOCK_BYTES 0
+#define HCORE_FIB_DEFAULT_CACHED_BLOCK_SIZE 262144
+/* Count of the independent snapshots of the files map, each one has own writer lock */
+#define HCORE_FIB_SHARDS 16
 
 namespace t2h_core { namespace details {
 
@@ -25,8 +36,17 @@ file_info_buffer_ptr shared_file_info_buffer()
 
 
 file_info_buffer::file_info_buffer() 
-	: is_stoped_(false), lock_(), infos_(), updater_()
+	: is_stoped_(false), 
+	lock_(), 
+	shards_(), 
+	routes_(), 
+	file_handles_(HCORE_FIB_DEFAULT_MAX_CACHED_FILE_HANDLES), 
+	cached_pieces_(HCORE_FIB_DEFAULT_MAX_CACHED_PIECE_BYTES), 
+	cached_blocks_(HCORE_FIB_DEFAULT_MAX_CACHED_BLOCK_BYTES, HCORE_FIB_DEFAULT_CACHED_BLOCK_SIZE), 
+	updater_()
 {
+	for (std::size_t it = 0; it < HCORE_FIB_SHARDS; ++it)
+		shards_.push_back(infos_shard_ptr(new infos_shard()));
 	updater_.recv_name = HCORE_FIB_UPDATER_NAME;
 	updater_.nr.reset(new file_info_buffer_realtime_updater(*this, updater_.recv_name));
 	core_notification_center()->add_notification_receiver(updater_.nr);
@@ -37,28 +57,34 @@ file_info_buffer::~file_info_buffer()
 	stop_force();
 }
 
-int file_info_buffer::registr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber) 
+void file_info_buffer::registr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber) 
 {
+	/*  Registr new subscriber and send notification about bytes avaliable, 
+	 	notifications of the file are blocked till the subscriber gets current state */
 	BOOST_ASSERT(fi != NULL);
-	// Registr new subscriber and send notification about bytes avaliable
-	boost::lock_guard<boost::mutex> guard(lock_);
-	fi->subscribers.push_back(subscriber);
-	subscriber->on_bytes_avaliable_change(fi->avaliable_bytes);
-	return fi->subscribers.size();
-}
+	boost::lock_guard<boost::mutex> notify_guard(fi->notify_lock);
+	boost::int64_t avaliable_bytes = 0;
+	byte_interval_set avaliable_ranges;
+	{
+		boost::lock_guard<boost::mutex> guard(fi->lock);
+		avaliable_bytes = fi->avaliable_bytes;
+		avaliable_ranges = fi->avaliable_ranges;
+	}
 
-void file_info_buffer::unregistr_subscriber(hc_file_info_ptr fi, int sid) 
-{
-	BOOST_ASSERT(fi != NULL);
-	boost::lock_guard<boost::mutex> guard(lock_);
-	if (sid > fi->subscribers.size())
-		fi->subscribers.erase(fi->subscribers.begin() + sid);
+	fi->subscribers.push_back(subscriber);
+	subscriber->on_bytes_avaliable_change(avaliable_bytes);
+	for (byte_interval_set::const_iterator first = avaliable_ranges.begin(), last = avaliable_ranges.end();
+		first != last; 
+		++first)
+	{
+		subscriber->on_range_avaliable(first->first, first->second);
+	}
 }
 
 void file_info_buffer::unregistr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber) 
 {
 	BOOST_ASSERT(fi != NULL);
-	boost::lock_guard<boost::mutex> guard(lock_);
+	boost::lock_guard<boost::mutex> guard(fi->notify_lock);
 	std::vector<async_file_info_subscriber_ptr>::iterator first = fi->subscribers.begin(), 
 		last = fi->subscribers.end();
 	for (;
@@ -73,48 +99,249 @@ void file_info_buffer::unregistr_subscriber(hc_file_info_ptr fi, async_file_info
 	} // for
 }
 
+void file_info_buffer::on_file_add(
+	std::string const & file_path, 
+	boost::int64_t file_size, 
+	boost::int64_t avaliable_bytes, 
+	std::string const & info_hash, 
+	int file_index) 
+{ 
+	/*  Do not overwrite item at file_path exists just update data, 
+	 	new item published by the replace of the shard snapshot */
+	infos_shard & shard = get_shard(file_path);
+	boost::lock_guard<boost::mutex> writer_guard(shard.writer_lock);
+	infos_snapshot_ptr const infos = boost::atomic_load(&shard.infos);
+	infos_type::const_iterator const found = infos->find(file_path);
+	if (found != infos->end()) {
+		hc_file_info_ptr fi = found->second;
+		file_handles_.invalidate(fi);
+		cached_pieces_.invalidate(fi);
+		cached_blocks_.invalidate(fi);
+		std::string previous_info_hash;
+		int previous_file_index = -1;
+		{
+			boost::lock_guard<boost::mutex> guard(fi->lock);
+			previous_info_hash.swap(fi->info_hash);
+			previous_file_index = fi->file_index;
+			fi->file_size = file_size;
+			fi->avaliable_bytes = avaliable_bytes;
+			fi->avaliable_ranges.clear();
+			fi->info_hash = info_hash;
+			fi->file_index = file_index;
+			fi->last_modified = 0;
+		}
+		update_last_modified(fi);
+		if (previous_info_hash != info_hash || previous_file_index != file_index)
+			set_route(previous_info_hash, previous_file_index, fi, true);
+		set_route(info_hash, file_index, fi, false);
+		return;
+	} // if
+	
+	hc_file_info_ptr fi(new hc_file_info(file_path, file_size, avaliable_bytes)); 
+	fi->info_hash = info_hash;
+	fi->file_index = file_index;
+	update_last_modified(fi);
+	
+	boost::shared_ptr<infos_type> updated(new infos_type(*infos));
+	(*updated)[file_path] = fi;
+	boost::atomic_store(&shard.infos, infos_snapshot_ptr(updated));
+	set_route(info_hash, file_index, fi, false);
+}
+
 void file_info_buffer::remove_info(std::string const & path) 
 {
-	boost::lock_guard<boost::mutex> guard(lock_);
-
 	if (is_stoped_)
 		return;
 
-	infos_type::iterator found = infos_.find(path);
-	if (found != infos_.end()) 
-		infos_.erase(found); 
+	infos_shard & shard = get_shard(path);
+	hc_file_info_ptr fi;
+	{
+		boost::lock_guard<boost::mutex> writer_guard(shard.writer_lock);
+		infos_snapshot_ptr const infos = boost::atomic_load(&shard.infos);
+		infos_type::const_iterator const found = infos->find(path);
+		if (found == infos->end()) 
+			return;
+		fi = found->second;
+		boost::shared_ptr<infos_type> updated(new infos_type(*infos));
+		updated->erase(path);
+		boost::atomic_store(&shard.infos, infos_snapshot_ptr(updated));
+	}
+
+	std::string info_hash;
+	int file_index = -1;
+	{
+		boost::lock_guard<boost::mutex> guard(fi->lock);
+		info_hash = fi->info_hash;
+		file_index = fi->file_index;
+	}
+	set_route(info_hash, file_index, fi, true);
+	file_handles_.invalidate(fi);
+	cached_pieces_.invalidate(fi);
+	cached_blocks_.invalidate(fi);
 	
-	std::for_each(found->second->subscribers.begin(), found->second->subscribers.end(), 
-		boost::bind(&async_file_info_subscriber::on_break, _1));
+	boost::lock_guard<boost::mutex> notify_guard(fi->notify_lock);
+	hc_file_info_notify_subscribers(fi, boost::bind(&async_file_info_subscriber::on_break, _1));
 }
 
 void file_info_buffer::update_info(std::string const & file_path, boost::int64_t avaliable_bytes) 
 {
-	boost::mutex::scoped_lock guard(lock_);
-	
 	if (is_stoped_)
 		return;
 
-	infos_type::iterator found = infos_.find(file_path);
-	if (found == infos_.end()) {
+	hc_file_info_ptr fi = find_info(file_path);
+	if (!fi) {
 		HCORE_WARNING("update info failed, item not found", file_path.c_str())
 		return;
 	}
-	found->second->avaliable_bytes = avaliable_bytes;
+	/*  Verified bytes never disappear(till the file re-added), so the prefix could be already 
+	 	longer than the torrent core reports, if out of order pieces were merged into it */
+	boost::lock_guard<boost::mutex> notify_guard(fi->notify_lock);
+	{
+		boost::lock_guard<boost::mutex> guard(fi->lock);
+		if (avaliable_bytes > fi->avaliable_bytes)
+			fi->avaliable_bytes = avaliable_bytes;
+		merge_avaliable_ranges_unsafe(fi);
+		avaliable_bytes = fi->avaliable_bytes;
+	}
+	update_last_modified(fi);
 	
-	std::for_each(found->second->subscribers.begin(), found->second->subscribers.end(), 
+	hc_file_info_notify_subscribers(fi, 
 		boost::bind(&async_file_info_subscriber::on_bytes_avaliable_change, _1, avaliable_bytes));
 }
+
+void file_info_buffer::update_range(std::string const & file_path, 
+	boost::int64_t offset, 
+	boost::int64_t size, 
+	boost::shared_array<char> const & piece, 
+	std::size_t piece_offset) 
+{
+	/*  Range which continues the prefix just moves the prefix, otherwise subscribers 
+	 	get the range itself, so a request far beyond the prefix is not waiting for it. 
+		Bytes of the range(if the torrent core sent them) cached before any subscriber wakes up. 
+		Torrent core sends the bytes after the range published, so they cached even for the avaliable range */
+	if (is_stoped_)
+		return;
+
+	hc_file_info_ptr fi = find_info(file_path);
+	if (!fi) {
+		HCORE_WARNING("update range failed, item '%s' not found", file_path.c_str())
+		return;
+	}
+	
+	boost::lock_guard<boost::mutex> notify_guard(fi->notify_lock);
+	boost::int64_t first = 0, last = 0, avaliable_bytes = 0, file_size = 0;
+	bool changed = false, extended = false;
+	{
+		boost::lock_guard<boost::mutex> guard(fi->lock);
+		file_size = fi->file_size;
+		first = std::max(offset, (boost::int64_t)0); 
+		last = std::min(offset + size, file_size);
+		if (last > fi->avaliable_bytes && first < last) {
+			fi->avaliable_ranges.insert(first, last);
+			extended = merge_avaliable_ranges_unsafe(fi);
+			changed = true;
+		} // if
+		avaliable_bytes = fi->avaliable_bytes;
+	}
+	if (extended)
+		update_last_modified(fi);
+
+	if (piece && offset >= 0 && size > 0 && offset + size <= file_size)
+		cached_pieces_.insert(fi, 
+			hc_cached_piece_ptr(new hc_cached_piece(piece, piece.get() + piece_offset, offset, size)));
+
+	if (!changed)
+		return;
+	
+	if (extended)
+		hc_file_info_notify_subscribers(fi, 
+			boost::bind(&async_file_info_subscriber::on_bytes_avaliable_change, _1, avaliable_bytes));
+	else
+		hc_file_info_notify_subscribers(fi, 
+			boost::bind(&async_file_info_subscriber::on_range_avaliable, _1, first, last));
+}
 	
 hc_file_info_ptr file_info_buffer::get_info(std::string const & path) const 
 {
-	boost::mutex::scoped_lock guard(lock_);
-	
 	if (is_stoped_) 
 		return hc_file_info_ptr();
+	return find_info(path);
+}
 
-	infos_type::const_iterator found = infos_.find(path);
-	return (found != infos_.end()) ? found->second : hc_file_info_ptr();
+hc_file_info_ptr file_info_buffer::get_info(hc_torrent_id const & id, int file_index) const 
+{
+	if (is_stoped_ || file_index < 0) 
+		return hc_file_info_ptr();
+
+	routes_snapshot_ptr const routes = boost::atomic_load(&routes_.routes);
+	routes_type::const_iterator const found = routes->find(id);
+	if (found == routes->end() || (std::size_t)file_index >= found->second->size())
+		return hc_file_info_ptr();
+	return (*found->second)[file_index];
+}
+
+hc_file_handle_ptr file_info_buffer::acquire_file_handle(hc_file_info_ptr fi) 
+{
+	return file_handles_.acquire(fi);
+}
+
+hc_file_mapping_ptr file_info_buffer::acquire_file_mapping(hc_file_info_ptr fi) 
+{
+	return file_handles_.acquire_mapping(fi);
+}
+
+hc_cached_piece_ptr file_info_buffer::find_cached_piece(hc_file_info_ptr fi, boost::int64_t pos) 
+{
+	return cached_pieces_.find(fi, pos);
+}
+
+hc_cached_block_ptr file_info_buffer::acquire_cached_block(hc_file_info_ptr fi, 
+	hc_file_handle & file_handle, 
+	io_uring_reader * io_reader, 
+	boost::int64_t pos, 
+	boost::int64_t avaliable_end) 
+{
+	return cached_blocks_.acquire(fi, file_handle, io_reader, pos, avaliable_end);
+}
+
+hc_file_validators file_info_buffer::get_validators(hc_file_info_ptr fi) const 
+{
+	boost::lock_guard<boost::mutex> guard(fi->lock);
+	bool const completed = (fi->avaliable_bytes >= fi->file_size);
+	hc_file_validators const validators = { 
+		utility::http_etag(fi->info_hash, fi->file_index, completed), fi->last_modified, completed };
+	return validators;
+}
+
+boost::int64_t file_info_buffer::get_avaliable_end(hc_file_info_ptr fi, boost::int64_t pos) const 
+{
+	boost::lock_guard<boost::mutex> guard(fi->lock);
+	return (pos < fi->avaliable_bytes) ? fi->avaliable_bytes : fi->avaliable_ranges.contiguous_end(pos);
+}
+
+void file_info_buffer::set_max_cached_file_handles(std::size_t max_handles) 
+{
+	file_handles_.set_max_handles(max_handles);
+}
+
+void file_info_buffer::set_max_cached_piece_bytes(std::size_t max_bytes) 
+{
+	cached_pieces_.set_max_bytes(max_bytes);
+}
+
+piece_cache_stat file_info_buffer::get_piece_cache_stat() const 
+{
+	return cached_pieces_.get_stat();
+}
+
+void file_info_buffer::set_block_cache_limits(std::size_t max_bytes, std::size_t block_size) 
+{
+	cached_blocks_.set_limits(max_bytes, block_size);
+}
+
+block_cache_stat file_info_buffer::get_block_cache_stat() const 
+{
+	return cached_blocks_.get_stat();
 }
 
 /**
@@ -123,22 +350,124 @@ hc_file_info_ptr file_info_buffer::get_info(std::string const & path) const
 
 void file_info_buffer::stop(bool graceful) 
 {
-	/*  If still somebody waits a bites we must notify about buffer does not work,
-	 	also remove self updater from notification center and clear all data in buffer */
+	/*  If still somebody waits a bites we must notify about buffer does not work. 
+	 	Graceful stop(stop of the http core) keeps the files and the updater, 
+		the buffer is shared and the torrent core does not add the files again on the next start. 
+		Force stop also removes self updater from notification center and clears all data in buffer */
 	boost::mutex::scoped_lock guard(lock_);
-	core_notification_center()->remove_notification_receiver(updater_.recv_name);
+	if (!graceful)
+		core_notification_center()->remove_notification_receiver(updater_.recv_name);
 	is_stoped_ = true;
-	for (infos_type::iterator first = infos_.begin(), last = infos_.end(); 
-		first != last; 
-		++first) 
+	for (std::size_t it = 0; it < shards_.size(); ++it) {
+		infos_snapshot_ptr infos;
+		{
+			boost::lock_guard<boost::mutex> writer_guard(shards_[it]->writer_lock);
+			infos = boost::atomic_load(&shards_[it]->infos);
+			if (!graceful)
+				boost::atomic_store(&shards_[it]->infos, infos_snapshot_ptr(new infos_type()));
+		}
+		for (infos_type::const_iterator first = infos->begin(), last = infos->end(); 
+			first != last; 
+			++first) 
+		{
+			boost::lock_guard<boost::mutex> notify_guard(first->second->notify_lock);
+			hc_file_info_notify_subscribers(first->second, 
+				boost::bind(&async_file_info_subscriber::on_break, _1));
+		}
+	} // for
+	if (!graceful) {
+		boost::lock_guard<boost::mutex> writer_guard(routes_.writer_lock);
+		boost::atomic_store(&routes_.routes, routes_snapshot_ptr(new routes_type()));
+	} // if
+	file_handles_.clear();
+	cached_pieces_.clear();
+	cached_blocks_.clear();
+	is_stoped_ = false;
+}
+
+file_info_buffer::infos_shard & file_info_buffer::get_shard(std::string const & path) const 
+{
+	return *shards_[boost::hash<std::string>()(path) % shards_.size()];
+}
+
+hc_file_info_ptr file_info_buffer::find_info(std::string const & path) const 
+{
+	/*  Snapshot is never changed after the publish, so it readed without any lock */
+	infos_snapshot_ptr const infos = boost::atomic_load(&get_shard(path).infos);
+	infos_type::const_iterator const found = infos->find(path);
+	return (found != infos->end()) ? found->second : hc_file_info_ptr();
+}
+
+void file_info_buffer::set_route(std::string const & info_hash, int file_index, hc_file_info_ptr fi, bool remove) 
+{
+	/*  Routes snapshot replaced same as the files snapshots, 
+	 	only the files of the changed torrent copied, other torrents shared with the previous snapshot */
+	hc_torrent_id id;
+	if (file_index < 0 || !utility::http_parse_info_hash(info_hash, id.bytes))
+		return;
+
+	boost::lock_guard<boost::mutex> writer_guard(routes_.writer_lock);
+	routes_snapshot_ptr const routes = boost::atomic_load(&routes_.routes);
+	routes_type::const_iterator const found = routes->find(id);
+	boost::shared_ptr<torrent_files_type> files(found != routes->end() ? 
+		new torrent_files_type(*found->second) : new torrent_files_type());
+	if (remove) {
+		if ((std::size_t)file_index >= files->size() || (*files)[file_index] != fi)
+			return;
+		(*files)[file_index].reset();
+		while (!files->empty() && !files->back())
+			files->pop_back();
+	} else {
+		if ((std::size_t)file_index >= files->size())
+			files->resize(file_index + 1);
+		(*files)[file_index] = fi;
+	} // if
+
+	boost::shared_ptr<routes_type> updated(new routes_type(*routes));
+	if (files->empty())
+		updated->erase(id);
+	else 
+		(*updated)[id] = torrent_files_ptr(files);
+	boost::atomic_store(&routes_.routes, routes_snapshot_ptr(updated));
+}
+
+bool file_info_buffer::merge_avaliable_ranges_unsafe(hc_file_info_ptr fi) 
+{
+	/*  Ranges covered by the prefix dropped, range which starts at(or before) the end of the prefix extends it. 
+	 	Returns true if the prefix was extended */
+	boost::int64_t const avaliable_bytes = 
+		std::min(fi->avaliable_ranges.contiguous_end(fi->avaliable_bytes), fi->file_size);
+	bool const extended = (avaliable_bytes > fi->avaliable_bytes);
+	fi->avaliable_bytes = std::max(avaliable_bytes, fi->avaliable_bytes);
+	fi->avaliable_ranges.erase_before(fi->avaliable_bytes);
+	return extended;
+}
+
+void file_info_buffer::update_last_modified(hc_file_info_ptr fi) 
+{
+	/*  Content of the torrent file never changes after the completion, 
+	 	so Last-Modified fixed once at the moment of the completion. 
+		File stated without the lock, readers of the info are not waiting for the disk */
 	{
-		hc_file_info_notify_subscribers(first->second, 
-			boost::bind(&async_file_info_subscriber::on_break, _1));
+		boost::lock_guard<boost::mutex> guard(fi->lock);
+		if (fi->last_modified != 0 || fi->avaliable_bytes < fi->file_size)
+			return;
 	}
-	infos_.clear();
-	is_stoped_ = false;
+	boost::system::error_code error;
+	std::time_t write_time = boost::filesystem::last_write_time(fi->file_path, error);
+	if (error || write_time <= 0)
+		write_time = std::time(NULL);
+	
+	boost::lock_guard<boost::mutex> guard(fi->lock);
+	if (fi->last_modified == 0 && fi->avaliable_bytes >= fi->file_size)
+		fi->last_modified = write_time;
 }
 
 } } // namespace t2h_core, details
 
 #undef HCORE_FIB_UPDATER_NAME
+#undef HCORE_FIB_DEFAULT_MAX_CACHED_FILE_HANDLES
+#undef HCORE_FIB_DEFAULT_MAX_CACHED_PIECE_BYTES
+#undef HCORE_FIB_DEFAULT_MAX_CACHED_BLOCK_BYTES
+#undef HCORE_FIB_DEFAULT_CACHED_BLOCK_SIZE
+#undef HCORE_FIB_SHARDS
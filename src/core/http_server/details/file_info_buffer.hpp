@@ -1,13 +1,22 @@
 #ifndef FILE_INFO_BUFFER_HPP_INCLUDED
 #define FILE_INFO_BUFFER_HPP_INCLUDED
 
+#include "block_cache.hpp"
+#include "piece_cache.hpp"
+#include "http_utility.hpp"
+#include "byte_interval_set.hpp"
+#include "file_handles_cache.hpp"
 #include "notification_receiver.hpp"
 #include "async_file_info_subscriber.hpp"
 #include "core_file_change_notification.hpp"
 
+#include <ctime>
+#include <string>
+#include <cstring>
 #include <vector>
 #include <boost/thread.hpp>
 #include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/unordered_map.hpp>
 
@@ -15,11 +24,15 @@ namespace t2h_core { namespace details {
 
 /**
  * hc_file_info is file_info_buffer item, contain useful information for 
- * syncing/getting information about files(real-time)
+ * syncing/getting information about files(real-time). 
+ * Avaliable bytes, validators are guarded by the lock, subscribers by the notify_lock : 
+ * notifications of the file serialized by the notify_lock, so the slow subscriber 
+ * does not block lookups and other files.
  */
 struct hc_file_info : boost::noncopyable {
 	hc_file_info() 
-		: file_path(""), file_size(0), avaliable_bytes(0), subscribers()
+		: file_path(""), file_size(0), avaliable_bytes(0), avaliable_ranges(), subscribers(), file_handle(), file_mapping(), 
+		file_handle_lru_pos(), cached_pieces(), info_hash(), file_index(-1), last_modified(0), lock(), notify_lock()
 	{ 
 	}
 
@@ -28,24 +41,77 @@ struct hc_file_info : boost::noncopyable {
 		file_path(file_path_), 
 		file_size(file_size_), 
 		avaliable_bytes(avaliable_bytes_),
-		subscribers()
+		avaliable_ranges(),
+		subscribers(),
+		file_handle(),
+		file_mapping(),
+		file_handle_lru_pos(),
+		cached_pieces(),
+		info_hash(),
+		file_index(-1),
+		last_modified(0),
+		lock(),
+		notify_lock()
 	{ 
 	}
 			
 	std::string file_path;										// Path to file(this use as key to find hc_file_info) 
 	boost::int64_t file_size;									// File size(real)
 	boost::int64_t avaliable_bytes;								// Current file_size	
+	byte_interval_set avaliable_ranges;							// Verified bytes beyond the avaliable_bytes(out of order pieces)
 	std::vector<async_file_info_subscriber_ptr> subscribers;	// list of subscribers
+	hc_file_handle_ptr file_handle;								// Cached shared file descriptor(owned by file_handles_cache)
+	hc_file_mapping_ptr file_mapping;							// Cached shared mapping of the completed file(owned by file_handles_cache)
+	file_handles_cache::lru_type::iterator file_handle_lru_pos;	// Position of the file_handle in file_handles_cache LRU
+	piece_cache::pieces_type cached_pieces;						// Verified pieces held in memory, by offset(owned by piece_cache)
+	std::string info_hash;										// Hex info hash of the torrent, empty if unknown
+	int file_index;												// Index of the file in the torrent
+	std::time_t last_modified;									// Time of the file completion, 0 till the file completed
+	boost::mutex mutable lock;									// Guards avaliable bytes/ranges, file size and validators
+	boost::mutex mutable notify_lock;							// Guards subscribers, held while they are notified
+};
+
+/**
+ * hc_file_validators snapshot of the cache validators of the file(see file_info_buffer::get_validators)
+ */
+struct hc_file_validators {
+	std::string etag;				// Stable entity tag, empty if the torrent identity of the file unknown
+	std::time_t last_modified;		// Last-Modified of the completed file, 0 for not completed file
+	bool completed;
 };
 
 typedef boost::shared_ptr<hc_file_info> hc_file_info_ptr;
 
+/**
+ * hc_torrent_id raw info hash of the torrent, key of the file routes(see utility::http_file_route)
+ */
+struct hc_torrent_id {
+	unsigned char bytes[utility::http_info_hash_size];
+
+	inline bool operator==(hc_torrent_id const & other) const
+		{ return (std::memcmp(bytes, other.bytes, sizeof(bytes)) == 0); }
+};
+
+struct hc_torrent_id_hash {
+	/* Info hash is uniformly distributed, so its first bytes are the hash */
+	inline std::size_t operator()(hc_torrent_id const & id) const
+	{ 
+		std::size_t hash = 0;
+		std::memcpy(&hash, id.bytes, sizeof(hash));
+		return hash;
+	}
+};
+
+/* Caller must hold the notify_lock of the fi */
 template <class F>
 inline void hc_file_info_notify_subscribers(hc_file_info_ptr fi, F f) 
 	{ std::for_each(fi->subscribers.begin(), fi->subscribers.end(), f); }
 
 /**
- * file_info_buffer 
+ * file_info_buffer map of the served files. Map splitted to the shards by the path, each shard is 
+ * a read-only snapshot replaced(copy on write) only by the add/remove of the file, 
+ * so lookups and updates of the files never wait for the writer lock. 
+ * Updates take only the locks of the one file and notify its subscribers outside of any shared lock.
  */
 class file_info_buffer : boost::noncopyable {
 public :
@@ -57,37 +123,53 @@ public :
 	/**
 	 * Controlling api
 	 */
-	int registr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber);
+	void registr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber);
 	void unregistr_subscriber(hc_file_info_ptr fi, async_file_info_subscriber_ptr subscriber);
-	void unregistr_subscriber(hc_file_info_ptr fi, int sid);
 
 	hc_file_info_ptr get_info(std::string const & path) const;
+	/* File by the torrent identity(route), the files of the torrent indexed by the file index */
+	hc_file_info_ptr get_info(hc_torrent_id const & id, int file_index) const;
+	hc_file_handle_ptr acquire_file_handle(hc_file_info_ptr fi);
+	hc_file_mapping_ptr acquire_file_mapping(hc_file_info_ptr fi);
+	/* Verified piece which contains the byte at pos if it still in memory, empty otherwise */
+	hc_cached_piece_ptr find_cached_piece(hc_file_info_ptr fi, boost::int64_t pos);
+	/* Block of the file shared between readers, see block_cache */
+	hc_cached_block_ptr acquire_cached_block(hc_file_info_ptr fi, 
+		hc_file_handle & file_handle, 
+		io_uring_reader * io_reader, 
+		boost::int64_t pos, 
+		boost::int64_t avaliable_end);
+	hc_file_validators get_validators(hc_file_info_ptr fi) const;
+	/* End of the verified bytes which go from pos without holes, pos if byte at pos not verified */
+	boost::int64_t get_avaliable_end(hc_file_info_ptr fi, boost::int64_t pos) const;
+	void set_max_cached_file_handles(std::size_t max_handles);
+	void set_max_cached_piece_bytes(std::size_t max_bytes);
+	piece_cache_stat get_piece_cache_stat() const;
+	void set_block_cache_limits(std::size_t max_bytes, std::size_t block_size);
+	block_cache_stat get_block_cache_stat() const;
+
 	void update_info(std::string const & file_path, boost::int64_t avaliable_bytes);
+	void update_range(std::string const & file_path, 
+		boost::int64_t offset, 
+		boost::int64_t size, 
+		boost::shared_array<char> const & piece = boost::shared_array<char>(), 
+		std::size_t piece_offset = 0);
 	void remove_info(std::string const & path);	
 
 	inline void stop_graceful() 
-		{ close(true); }
+		{ stop(true); }
 	inline void stop_force() 
-		{ close(false); }
+		{ stop(false); }
 
 	/**
 	 * Callbacks for the notification reciever
 	 */
-	inline void on_file_add(
+	void on_file_add(
 		std::string const & file_path, 
 		boost::int64_t file_size, 
-		boost::int64_t avaliable_bytes) 
-	{ 
-		// do not overwrite item at file_path exists just update data 
-		boost::lock_guard<boost::mutex> guard(lock_);
-		infos_type::iterator f; 
-		if ((f = infos_.find(file_path)) != infos_.end()) {
-			f->second->file_size = file_size;
-			f->second->avaliable_bytes = avaliable_bytes;
-			return;
-		}
-		infos_[file_path].reset(new hc_file_info(file_path, file_size, avaliable_bytes)); 
-	}
+		boost::int64_t avaliable_bytes, 
+		std::string const & info_hash = std::string(), 
+		int file_index = -1);
 
 	inline void on_file_remove(std::string const & file_path) 
 		{ remove_info(file_path); }	
@@ -97,14 +179,56 @@ public :
 		boost::int64_t file_size, 
 		boost::int64_t avaliable_bytes) 
 		{ update_info(file_path, avaliable_bytes); }
+
+	inline void on_file_range_verified(
+		std::string const & file_path, 
+		boost::int64_t offset, 
+		boost::int64_t size, 
+		boost::shared_array<char> const & piece, 
+		std::size_t piece_offset) 
+		{ update_range(file_path, offset, size, piece, piece_offset); }
 	
 private :
+	typedef boost::shared_ptr<infos_type const> infos_snapshot_ptr;
+
+	struct infos_shard : boost::noncopyable {
+		infos_shard() : writer_lock(), infos(new infos_type()) { }
+
+		boost::mutex writer_lock;				// Serializes replaces of the snapshot
+		infos_snapshot_ptr infos;				// Loaded/stored atomically
+	};
+
+	typedef boost::shared_ptr<infos_shard> infos_shard_ptr;
+
+	typedef std::vector<hc_file_info_ptr> torrent_files_type;
+	typedef boost::shared_ptr<torrent_files_type const> torrent_files_ptr;
+	typedef boost::unordered_map<hc_torrent_id, torrent_files_ptr, hc_torrent_id_hash> routes_type;
+	typedef boost::shared_ptr<routes_type const> routes_snapshot_ptr;
+
+	struct routes_table : boost::noncopyable {
+		routes_table() : writer_lock(), routes(new routes_type()) { }
+
+		boost::mutex writer_lock;				// Serializes replaces of the snapshot
+		routes_snapshot_ptr routes;				// Loaded/stored atomically
+	};
+
 	void stop(bool graceful);
+	infos_shard & get_shard(std::string const & path) const;
+	hc_file_info_ptr find_info(std::string const & path) const;
+	/* Sets the route of the file, or removes it(only if the route still points to the fi) */
+	void set_route(std::string const & info_hash, int file_index, hc_file_info_ptr fi, bool remove);
+	bool merge_avaliable_ranges_unsafe(hc_file_info_ptr fi);
+	/* Takes the lock of the file itself, must be called without it */
+	void update_last_modified(hc_file_info_ptr fi);
 		
 	bool volatile mutable is_stoped_;
-	boost::mutex mutable lock_;
+	boost::mutex mutable lock_;					// Serializes stop
 	
-	infos_type infos_;
+	std::vector<infos_shard_ptr> shards_;
+	routes_table routes_;
+	file_handles_cache file_handles_;
+	piece_cache cached_pieces_;
+	block_cache cached_blocks_;
 	struct {
 		std::string mutable recv_name;
 		common::notification_receiver_ptr nr;
@@ -26,11 +26,19 @@ void file_info_buffer_realtime_updater::on_notify(common::notification_ptr notif
 			break;
 			case core_file_change_notification::file_add :
 				fib_.on_file_add(file_change_notification->file_path, 
-					file_change_notification->file_size, file_change_notification->avaliable_bytes);
+					file_change_notification->file_size, file_change_notification->avaliable_bytes, 
+					file_change_notification->info_hash, file_change_notification->file_index);
 			break;
 			case core_file_change_notification::file_update :
 				fib_.on_file_update(file_change_notification->file_path, 
-					file_change_notification->file_size, file_change_notification->avaliable_bytes);
+					file_change_notification->file_size, 
+					file_change_notification->progress ? 
+						file_change_notification->progress->take() : file_change_notification->avaliable_bytes);
+			break;
+			case core_file_change_notification::file_range_verified :
+				fib_.on_file_range_verified(file_change_notification->file_path, 
+					file_change_notification->range_offset, file_change_notification->range_size, 
+					file_change_notification->piece, file_change_notification->piece_offset);
 			break;
 		} // switch
 		file_change_notification->set_state(common::base_notification::done);
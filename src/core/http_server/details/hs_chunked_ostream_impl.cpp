@@ -1,13 +1,22 @@
 #include "hs_chunked_ostream_impl.hpp"
 
+#include "http_server_utility.hpp"
 #include "http_server_macroses.hpp"
 
-#include <boost/iostreams/operations.hpp>  
-#include <boost/iostreams/device/file.hpp>
-#include <boost/iostreams/device/file_descriptor.hpp> 
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
 
 //#define T2H_DEEP_DEBUG
 
+/* Adaptive chunk size : time of one chunk transfer which we aim and weight of the new drain rate sample */
+#define HCORE_ADAPTIVE_CHUNK_TARGET_SECS 0.1
+#define HCORE_ADAPTIVE_DRAIN_RATE_WEIGHT 0.3
+/* Reader progress : measure interval of the consumption rate */
+#define HCORE_READER_PROGRESS_SECS 1
+/* Max sleep on the watermark, lost wakeup could only delay the blocked reader */
+#define HCORE_WATERMARK_WAIT_SLICE_MS 500
+
 namespace t2h_core { namespace details {
 
 /**
@@ -20,27 +29,93 @@ namespace t2h_core { namespace details {
 
 hs_chunked_ostream_impl::hs_chunked_ostream_impl(
 	http_server_ostream_policy_params const & base_params, hs_chunked_ostream_params const & params) 
-	: base_chunked_ostream(base_params, params), params_(params), ex_data_() 
+	: base_chunked_ostream(base_params, params), 
+	boost::enable_shared_from_this<hs_chunked_ostream_impl>(), 
+	params_(params), 
+	ex_data_(), 
+	cursor_(), 
+	watermark_(), 
+	parked_hd_(), 
+	suspended_(false), 
+	finished_(false), 
+	adaptive_(), 
+	reading_(), 
+	egress_() 
 {
+	BOOST_ASSERT(params_.deadlines != NULL);
 	// Make sure about ZERO init of ex_data_ struct 
 	ex_data_.avaliable_bytes = 0;
 	ex_data_.state = hs_chunked_ostream_impl::state_default;
+	ex_data_.needed_from = ex_data_.needed_bytes = 0;
+	ex_data_.progressed = false;
+	ex_data_.timed_out = false;
+	ex_data_.fast_waiting = false;
+	ex_data_.armed_watermark = 0;
+	ex_data_.deadline = ex_data_.throttle = deadline_wheel::invalid_timer;
+	cursor_.hd = NULL;
+	cursor_.range = 0;
+	cursor_.range_started = false;
+	cursor_.start = cursor_.seek_pos = cursor_.end = 0;
+	cursor_.zero_copy = cursor_.mapping_tried = false;
+	/* Start from the small chunk, so first bytes go to the client as soon as possible */
+	adaptive_.chunk_size = params_.adaptive_chunk ? params_.min_chunk_size : params_.max_chunk_size;
+	adaptive_.drain_rate = 0;
+	reading_.bytes = 0;
 }
 
 hs_chunked_ostream_impl::~hs_chunked_ostream_impl() 
 {
-	on_break();
+	/*  Parked request could be dropped without finish only if the resume pool stopped, 
+	 	the transport must get its reply back anyway */
+	disarm_deadline();
+	disarm_throttle();
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	ex_data_.state = hs_chunked_ostream_impl::is_breaked;
+	guard.unlock();
+	if (suspended_ && !finished_ && ostream_impl_)
+		ostream_impl_->complete();
+	
+	if (egress_.attached) {
+		HCORE_TRACE("egress of '%s' : sended '%li', throttled '%li' ms, starved '%li' ms", 
+			egress_.file_path.c_str(), (long)egress_.bytes, 
+			(long)egress_.throttled.total_milliseconds(), (long)egress_.starved.total_milliseconds())
+		params_.egress->detach(egress_);
+	} // if
 }
 
 void hs_chunked_ostream_impl::on_bytes_avaliable_change(boost::int64_t avaliable_bytes) 
 {
 #if defined(T2H_DEEP_DEBUG)
-	HCORE_TRACE("bytes updated notification : avaliable_bytes is '%i'", avaliable_bytes)
+	HCORE_TRACE("bytes updated notification : avaliable_bytes is '%lld'", (long long)avaliable_bytes)
 #endif // T2H_DEEP_DEBUG
+	/*  Called under the notify lock of the file, so parked request only posted to the resume pool.
+	 	Bytes already known from the watermark are not a progress, otherwise the late notification 
+		restarts the deadline of the stalled reader */
 	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	if (avaliable_bytes > avaliable_prefix_unsafe())
+		ex_data_.progressed = true;
 	ex_data_.avaliable_bytes = avaliable_bytes;
+	ex_data_.avaliable_ranges.erase_before(avaliable_bytes);
+	check_parked_unsafe();
+	bool const fast_waiting = ex_data_.fast_waiting;
+	guard.unlock();
+	notify_waiter(fast_waiting);
+}
+
+void hs_chunked_ostream_impl::on_range_avaliable(boost::int64_t first, boost::int64_t last) 
+{
+#if defined(T2H_DEEP_DEBUG)
+	HCORE_TRACE("range updated notification : '%lld' - '%lld'", (long long)first, (long long)last)
+#endif // T2H_DEEP_DEBUG
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	if (last <= avaliable_prefix_unsafe())
+		return;
+	ex_data_.avaliable_ranges.insert(first, last);
+	ex_data_.progressed = true;
+	check_parked_unsafe();
+	bool const fast_waiting = ex_data_.fast_waiting;
 	guard.unlock();
-	ex_data_.waiter.notify_one();
+	notify_waiter(fast_waiting);
 }
 
 void hs_chunked_ostream_impl::on_break() 
@@ -49,9 +124,14 @@ void hs_chunked_ostream_impl::on_break()
 	HCORE_TRACE("stop notificatation") 
 #endif // T2H_DEEP_DEBUG
 	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	bool const parked = (ex_data_.state == hs_chunked_ostream_impl::is_parked || 
+		ex_data_.state == hs_chunked_ostream_impl::is_throttled);
 	ex_data_.state = hs_chunked_ostream_impl::is_breaked;
+	if (parked)
+		post_resume_unsafe();
+	bool const fast_waiting = ex_data_.fast_waiting;
 	guard.unlock();
-	ex_data_.waiter.notify_one();
+	notify_waiter(fast_waiting);
 }
 
 /**
@@ -60,92 +140,659 @@ void hs_chunked_ostream_impl::on_break()
 
 bool hs_chunked_ostream_impl::write_content_impl(http_data & hd) 
 {
-	/*  First we must to ensure about we have needed bytes in file,
-	 	because real file size could be less then bytes_end(at moment of call). 
-		if file size > than request/chunk then we 
-		sync with torrent_core via blocking call 'wait_avaliable_bytes'.
-		If bytes are avaliable then just send block to clien otherwise error. */
-	namespace io = boost::iostreams;
-		
-	bool eof = false;	
-	std::vector<char> iobuffer(params_.max_chunk_size + 10);
-	std::ios::openmode const open_mode = std::ios::in | std::ios::binary;
-	boost::int64_t read_offset = params_.max_chunk_size, seek_pos = hd.read_start;
-	for(boost::int64_t readed = 0, writed = 0, bytes_wait = 0;
-		ex_data_.state != hs_chunked_ostream_impl::is_breaked;) 
-	{	
-		if ((seek_pos + read_offset) >= hd.read_end) {
-			bytes_wait = hd.read_end;
-			eof = true;
-		} else 
-			bytes_wait = seek_pos + read_offset;
-	
-		if (!wait_for_bytes(bytes_wait)) {
-			HCORE_WARNING("failed for bytes waiting for file '%s'", 
-				hd.fi->file_path.c_str())		
-			return false;
-		} // if	
+	/*  If the request parked it is finished by the resume pool(see finish_parked), 
+	 	so for the caller the request is in progress */
+	cursor_.hd = &hd;
+	cursor_.zero_copy = params_.zero_copy && ostream_impl_->is_zero_copy_supported();
+	if (params_.egress)
+		params_.egress->attach(egress_, hd.fi->file_path);
+	if (params_.watermark_fast_path) {
+		core_watermark_ptr const watermark = core_watermarks().find(hd.fi->file_path);
+		boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+		watermark_ = watermark;
+	} // if
+	return (write_content() != hs_chunked_ostream_impl::io_failed);
+}
 
-		{ // start file io scope	
-		io::file_descriptor_source file_handle(hd.fi->file_path, open_mode);
-		if (!file_handle.is_open()) { 
-			HCORE_WARNING("failed to open file '%s'", hd.fi->file_path.c_str())
-			return false;
+/**
+ * Private hs_chunked_ostream_impl api
+ */
+
+hs_chunked_ostream_impl::io_state hs_chunked_ostream_impl::write_content() 
+{
+	/*  Single range written as is, for multipart/byteranges each range prefixed with the part header 
+	 	and the body ended by the closing boundary. Position kept by the cursor_, 
+		so the resumed request continues from the place where it was parked */
+	http_data & hd = *cursor_.hd;
+	bool const multipart = (hd.ranges.size() > 1);
+	std::size_t const ranges = multipart ? hd.ranges.size() : 1;
+	for (; cursor_.range < ranges; ++cursor_.range, cursor_.range_started = false) {
+		if (!cursor_.range_started) {
+			boost::int64_t const read_start = multipart ? hd.ranges[cursor_.range].first : hd.read_start, 
+				read_end = multipart ? hd.ranges[cursor_.range].last : hd.read_end;
+			if (multipart) {
+				hc_reply_headers part_header;
+				multipart_part_header(part_header, hd.multipart_boundary, hd.ranges[cursor_.range], hd.fi->file_size);
+				if (write_body(part_header.data(), part_header.size()) != part_header.size())
+					return hs_chunked_ostream_impl::io_failed;
+			} // if
+			cursor_.start = cursor_.seek_pos = read_start;
+			cursor_.end = (read_end + 1 > hd.fi->file_size) ? hd.fi->file_size : read_end + 1;
+			cursor_.range_started = true;
 		} // if
+
+		io_state const state = write_range();
+		if (state != hs_chunked_ostream_impl::io_completed)
+			return state;
+	} // for
 	
-		if (io::seek(file_handle, seek_pos, BOOST_IOS::beg) < 0) { 
-			HCORE_WARNING("failed to seek to pos '%i' file '%s'", 
-				seek_pos, hd.fi->file_path.c_str())
-			return false;
+	if (!multipart)
+		return hs_chunked_ostream_impl::io_completed;
+	hc_reply_headers closing;
+	multipart_closing(closing, hd.multipart_boundary);
+	return (write_body(closing.data(), closing.size()) == closing.size()) ? 
+		hs_chunked_ostream_impl::io_completed : hs_chunked_ostream_impl::io_failed;
+}
+
+hs_chunked_ostream_impl::io_state hs_chunked_ostream_impl::write_range() 
+{
+	/*  First we must to ensure about we have needed bytes in file(real file size could be less then bytes_end), 
+	 	request parked till bytes come(or thread blocked if parking not avaliable). Then each chunk sended 
+		from the first source which has it : piece cache, mapping, zero-copy, block cache, pipeline or copy */
+	using boost::posix_time::ptime;
+	using boost::posix_time::microsec_clock;
+	http_data & hd = *cursor_.hd;
+	for (boost::int64_t writed = 0, bytes_size = 0; 
+		ex_data_.state != hs_chunked_ostream_impl::is_breaked;) 
+	{
+		if (cursor_.seek_pos >= cursor_.end)
+			return hs_chunked_ostream_impl::io_completed;
+		
+		io_state state = hs_chunked_ostream_impl::io_completed;
+		if (params_.stream_as_avaliable && 
+			(state = ensure_bytes(cursor_.seek_pos, cursor_.seek_pos + 1)) != hs_chunked_ostream_impl::io_completed) 
+		{
+			if (state == hs_chunked_ostream_impl::io_failed)
+				HCORE_WARNING("failed for bytes waiting for file '%s'", 
+					hd.fi->file_path.c_str())		
+			return state;
 		} // if
+
+		bytes_size = get_chunk_size(cursor_.seek_pos, cursor_.end);
+		if ((state = ensure_bytes(cursor_.seek_pos, cursor_.seek_pos + bytes_size)) != hs_chunked_ostream_impl::io_completed) {
+			if (state == hs_chunked_ostream_impl::io_failed)
+				HCORE_WARNING("failed for bytes waiting for file '%s'", 
+					hd.fi->file_path.c_str())		
+			return state;
+		} // if	
 		
-		if ((readed =
-			io::read(file_handle, &iobuffer.at(0), read_offset)) <= 0) 
-		{ 
-			HCORE_WARNING("failed to read file '%s' from '%i' to '%i'", 
-				hd.fi->file_path.c_str(), seek_pos, readed)
-			return false;
+		/*  Mapping is the fallback of the transports without zero-copy(or with hc_zero_copy off) : 
+		 	sendfile of the completed file is already served from the page cache without copies */
+		if (!cursor_.zero_copy && !cursor_.mapping_tried && params_.mmap_completed && is_file_completed(hd)) {
+			cursor_.file_mapping = hd.fi_buffer->acquire_file_mapping(hd.fi);
+			cursor_.mapping_tried = true;
 		} // if
-		} // end file io scope
 		
-		if ((writed = ostream_impl_->write(&iobuffer.at(0), readed)) != readed) {
-			HCORE_WARNING("failed to write data for '%s', writed %i", 
-				hd.fi->file_path.c_str(), writed)
-			return false;
-		}
+		hc_cached_piece_ptr cached_piece;
+		if (!cursor_.file_mapping) 
+			cached_piece = hd.fi_buffer->find_cached_piece(hd.fi, cursor_.seek_pos);
+
+		if (!cached_piece && !cursor_.file_mapping && !cursor_.file_handle && 
+			!(cursor_.file_handle = hd.fi_buffer->acquire_file_handle(hd.fi))) 
+			return hs_chunked_ostream_impl::io_failed;
 		
-		if (eof)  
-			return true;
-	
-		seek_pos = seek_pos + writed;
+		std::size_t throttle_ms = 0;
+		boost::int64_t const granted = acquire_egress(bytes_size, throttle_ms);
+		if (granted == 0)
+			return park_throttled(throttle_ms);
+		bytes_size = granted;
+		ptime const write_start = microsec_clock::universal_time();
+
+		if (cached_piece)
+			writed = write_chunk_cached(*cached_piece, cursor_.seek_pos, bytes_size);
+		else if (cursor_.file_mapping) 
+			writed = write_chunk_mapped(hd, *cursor_.file_mapping, cursor_.seek_pos, bytes_size);
+		else if (cursor_.zero_copy) {
+			if ((writed = write_body_file(cursor_.file_handle->native_handle(), cursor_.seek_pos, bytes_size)) == 0 
+				&& cursor_.seek_pos == cursor_.start) 
+			{ 
+				/* Nothing was sended yet, so we can fall back to copy */
+				HCORE_TRACE("zero-copy transfer not avaliable for '%s', fall back to copy", 
+					hd.fi->file_path.c_str())
+				cursor_.zero_copy = false;
+				settle_egress(granted, 0);
+				continue;
+			} // if
+			if (params_.read_ahead)
+				advise_read_ahead(*cursor_.file_handle, cursor_.seek_pos + bytes_size, cursor_.end);
+		} else if ((writed = write_chunk_blocks(hd, *cursor_.file_handle, cursor_.seek_pos, bytes_size)) != 0) {
+			if (params_.read_ahead && writed > 0)
+				advise_read_ahead(*cursor_.file_handle, cursor_.seek_pos + writed, cursor_.end);
+		} else if (params_.read_ahead_pool) {
+			if (!cursor_.pipeline)
+				cursor_.pipeline.reset(new read_ahead_pipeline(
+					cursor_.file_handle, *params_.io_buffers, *params_.read_ahead_pool, params_.read_ahead_buffers));
+			writed = write_chunk_pipelined(hd, *cursor_.pipeline, *cursor_.file_handle, cursor_.seek_pos, bytes_size, cursor_.end);
+		} else 
+			writed = write_chunk_copy(hd, *cursor_.file_handle, cursor_.seek_pos, bytes_size);
+
+		settle_egress(granted, writed);
+		if (writed <= 0) {
+			HCORE_WARNING("failed to write data for '%s', writed %lld", 
+				hd.fi->file_path.c_str(), (long long)writed)
+			return hs_chunked_ostream_impl::io_failed;
+		} // if
+		
+		if (params_.adaptive_chunk)
+			update_chunk_size(writed, microsec_clock::universal_time() - write_start);
+		cursor_.seek_pos += writed;
+		if (params_.reader_progress)
+			update_reading(writed);
 	} // for
 
-	return false;
+	return hs_chunked_ostream_impl::io_failed;
 } 
 
-/**
- * Private hs_chunked_ostream_impl api
- */
+boost::int64_t hs_chunked_ostream_impl::write_chunk_copy(
+	http_data & hd, hc_file_handle & file_handle, boost::int64_t seek_pos, boost::int64_t bytes_size) 
+{
+	/*  The buffer owned only while the chunk in flight, 
+	 	so the waiting for bytes requests does not hold any IO memory. Reads batched via io_uring if it enabled */
+	boost::int64_t readed = 0;
+	io_buffer_guard iobuffer(*params_.io_buffers);
+	BOOST_ASSERT(bytes_size <= (boost::int64_t)params_.io_buffers->buffer_size());
+
+	if (params_.io_reader && params_.io_reader->is_open())
+		readed = params_.io_reader->read_at(file_handle.native_handle(), iobuffer.get(), bytes_size, seek_pos);
+	else 
+		readed = file_handle.read_at(iobuffer.get(), bytes_size, seek_pos);
+
+	if (readed <= 0) { 
+		HCORE_WARNING("failed to read file '%s' from '%lld' to '%lld'", 
+			hd.fi->file_path.c_str(), (long long)seek_pos, (long long)readed)
+		return -1;
+	} // if
+
+	if (write_body(iobuffer.get(), readed) != (std::size_t)readed) 
+		return -1;
+	return readed;
+}
+
+boost::int64_t hs_chunked_ostream_impl::write_chunk_pipelined(http_data & hd, 
+	read_ahead_pipeline & pipeline, 
+	hc_file_handle & file_handle, 
+	boost::int64_t seek_pos, 
+	boost::int64_t bytes_size, 
+	boost::int64_t end) 
+{
+	/*  Next chunks(only verified bytes) readed by the shared IO pool 
+	 	while the current chunk is writing to the client */
+	boost::int64_t readed = 0;
+	char const * data = pipeline.take(seek_pos, bytes_size, readed);
+	if (!data || readed <= 0) { 
+		HCORE_WARNING("failed to read file '%s' from '%lld' to '%lld'", 
+			hd.fi->file_path.c_str(), (long long)seek_pos, (long long)readed)
+		pipeline.release();
+		return -1;
+	} // if
+	
+	schedule_read_ahead(pipeline, file_handle, seek_pos + readed, end);
+	bool const writed = (write_body(data, readed) == (std::size_t)readed);
+	pipeline.release();
+	return writed ? readed : -1;
+}
+
+void hs_chunked_ostream_impl::schedule_read_ahead(
+	read_ahead_pipeline & pipeline, hc_file_handle & file_handle, boost::int64_t next_pos, boost::int64_t end) 
+{
+	/*  Chunks must be scheduled contiguously from the current read position,
+	 	otherwise the pipeline will be reseted at next take */
+	boost::int64_t pos = pipeline.scheduled_end();
+	if (pos < next_pos)
+		pos = next_pos;
+	boost::int64_t const avaliable_end = get_avaliable_end(pos);
+	
+	for (boost::int64_t bytes_size = 0; pos < end && pipeline.free_buffers() > 0; pos += bytes_size) {
+		bytes_size = (end - pos > adaptive_.chunk_size) ? adaptive_.chunk_size : end - pos;
+		if (pos + bytes_size > avaliable_end || !pipeline.schedule(pos, bytes_size))
+			break;
+	} // for
+	
+	advise_read_ahead(file_handle, pos, end);
+}
+
+void hs_chunked_ostream_impl::advise_read_ahead(hc_file_handle & file_handle, boost::int64_t next_pos, boost::int64_t end) 
+{
+	/*  Verified bytes beyond the chunk only hinted to the kernel, the page cache reads them ahead */
+	boost::int64_t const avaliable_end = get_avaliable_end(next_pos);
+	boost::int64_t const window_end = 
+		std::min(std::min(end, avaliable_end), next_pos + (boost::int64_t)params_.read_ahead_depth * params_.max_chunk_size);
+	if (window_end > next_pos)
+		file_handle.advise_willneed(next_pos, window_end - next_pos);
+}
+
+boost::int64_t hs_chunked_ostream_impl::write_chunk_cached(
+	hc_cached_piece const & piece, boost::int64_t seek_pos, boost::int64_t bytes_size) 
+{
+	/*  Recently verified piece sended from memory(up to the end of the piece), without any file read */
+	boost::int64_t const size = std::min(bytes_size, piece.end() - seek_pos);
+	if (write_body(piece.data + (seek_pos - piece.offset), size) != (std::size_t)size) 
+		return -1;
+	return size;
+}
+
+boost::int64_t hs_chunked_ostream_impl::write_chunk_blocks(
+	http_data & hd, hc_file_handle & file_handle, boost::int64_t seek_pos, boost::int64_t bytes_size) 
+{
+	/*  The block readed from the disk once(via io_uring if it enabled) and shared by all streams of the file. 
+	 	Chunk could span a few blocks, all of them writed before the next bytes waiting. 
+		Returns 0 if the block cache could not give the first block(off or read failed), 
+		so the caller falls back to own copy */
+	boost::int64_t writed = 0;
+	boost::int64_t const avaliable_end = get_avaliable_end(seek_pos);
+	for (boost::int64_t size = 0; writed < bytes_size; writed += size) {
+		hc_cached_block_ptr const block = 
+			hd.fi_buffer->acquire_cached_block(hd.fi, file_handle, params_.io_reader.get(), seek_pos + writed, avaliable_end);
+		if (!block)
+			break;
+		size = std::min(bytes_size - writed, block->last - (seek_pos + writed));
+		if (write_body(block->bytes_at(seek_pos + writed), size) != (std::size_t)size) 
+			return -1;
+	} // for
+	return writed;
+}
+
+boost::int64_t hs_chunked_ostream_impl::write_chunk_mapped(
+	http_data & hd, hc_file_mapping & file_mapping, boost::int64_t seek_pos, boost::int64_t bytes_size) 
+{
+	/*  Completed files served from the shared memory mapping */
+	if (seek_pos + bytes_size > file_mapping.size()) {
+		HCORE_WARNING("mapping of file '%s' less than requested range", hd.fi->file_path.c_str())
+		return -1;
+	} // if
+	
+	file_mapping.advise(seek_pos, bytes_size, hc_file_mapping::advice_willneed);
+	if (write_body(file_mapping.data() + seek_pos, bytes_size) != (std::size_t)bytes_size) 
+		return -1;
+	return bytes_size;
+}
+
+boost::int64_t hs_chunked_ostream_impl::get_chunk_size(boost::int64_t seek_pos, boost::int64_t end) 
+{
+	/*  In adaptive mode if verified bytes ahead of the read position less than the chunk 
+	 	(but not less than min chunk) send them right away, instead of waiting the whole chunk.
+		In stream as avaliable mode any count of the verified bytes is enough */
+	boost::int64_t bytes_size = adaptive_.chunk_size;
+	if (params_.adaptive_chunk || params_.stream_as_avaliable) {
+		boost::int64_t const gap = get_avaliable_end(seek_pos) - seek_pos, 
+			min_gap = params_.stream_as_avaliable ? 1 : params_.min_chunk_size;
+		if (gap >= min_gap && gap < bytes_size)
+			bytes_size = gap;
+	} // if
+	return (end - seek_pos > bytes_size) ? bytes_size : end - seek_pos;
+}
+
+void hs_chunked_ostream_impl::update_chunk_size(boost::int64_t writed, boost::posix_time::time_duration const & elapsed) 
+{
+	/*  Chunk size is amount of bytes which client drain for HCORE_ADAPTIVE_CHUNK_TARGET_SECS :
+	 	slow clients get small chunks(less waiting for bytes), fast clients get big chunks(less syscalls) */
+	double const secs = std::max(elapsed.total_microseconds(), (boost::int64_t)1) / 1000000.0;
+	double const sample = writed / secs;
+	adaptive_.drain_rate = (adaptive_.drain_rate == 0) ? 
+		sample : HCORE_ADAPTIVE_DRAIN_RATE_WEIGHT * sample + (1 - HCORE_ADAPTIVE_DRAIN_RATE_WEIGHT) * adaptive_.drain_rate;
+	
+	double const chunk_size = adaptive_.drain_rate * HCORE_ADAPTIVE_CHUNK_TARGET_SECS;
+	if (chunk_size >= (double)params_.max_chunk_size)
+		adaptive_.chunk_size = params_.max_chunk_size;
+	else if (chunk_size <= (double)params_.min_chunk_size)
+		adaptive_.chunk_size = params_.min_chunk_size;
+	else 
+		adaptive_.chunk_size = (boost::int64_t)chunk_size;
+}
+
+void hs_chunked_ostream_impl::update_reading(boost::int64_t writed) 
+{
+	/*  Consumption rate is bytes which client drained per interval excluding time of the waiting for 
+	 	torrent bytes, client which does not read(paused player) blocks the write, so does not report at all */
+	using boost::posix_time::microsec_clock;
+	boost::posix_time::ptime const now = microsec_clock::universal_time();
+	if (reading_.since.is_not_a_date_time()) {
+		reading_.since = now;
+		reading_.waited = boost::posix_time::time_duration();
+		reading_.bytes = 0;
+	} // if
+	reading_.bytes += writed;
+	
+	if (now - reading_.since < boost::posix_time::seconds(HCORE_READER_PROGRESS_SECS))
+		return;
+	boost::int64_t const elapsed = 
+		std::max((now - reading_.since - reading_.waited).total_microseconds(), (boost::int64_t)1);
+	params_.reader_progress(cursor_.hd->fi->file_path, cursor_.seek_pos, reading_.bytes * 1000000.0 / elapsed);
+	reading_.since = now;
+	reading_.waited = boost::posix_time::time_duration();
+	reading_.bytes = 0;
+}
+
+void hs_chunked_ostream_impl::reading_wait_started() 
+{
+	if ((params_.reader_progress && !reading_.since.is_not_a_date_time()) || egress_.attached)
+		reading_.wait_start = boost::posix_time::microsec_clock::universal_time();
+}
+
+void hs_chunked_ostream_impl::reading_wait_finished() 
+{
+	/*  Bytes waiting is the starved time of the egress stream */
+	if (reading_.wait_start.is_not_a_date_time())
+		return;
+	boost::posix_time::time_duration const waited = 
+		boost::posix_time::microsec_clock::universal_time() - reading_.wait_start;
+	reading_.waited += waited;
+	egress_.starved += waited;
+	reading_.wait_start = boost::posix_time::ptime();
+}
+
+boost::int64_t hs_chunked_ostream_impl::acquire_egress(boost::int64_t bytes_size, std::size_t & delay_ms) 
+{
+	/*  Called only for the avaliable bytes, so time of the budget waiting 
+	 	and time of the bytes waiting never overlap. Request which could be parked 
+		never sleeps for the budget(the thread could be the resume pool one) : 0 returned 
+		with the delay and the request parked till it */
+	if (!params_.egress)
+		return bytes_size;
+	if (is_throttling_enabled())
+		return params_.egress->try_acquire(egress_, bytes_size, delay_ms);
+	return params_.egress->acquire(egress_, bytes_size);
+}
 
-bool hs_chunked_ostream_impl::wait_for_bytes(boost::int64_t bytes) 
+void hs_chunked_ostream_impl::settle_egress(boost::int64_t granted, boost::int64_t writed) 
+{
+	if (params_.egress)
+		params_.egress->settle(egress_, granted, writed);
+}
+
+bool hs_chunked_ostream_impl::is_file_completed(http_data & hd) 
+{
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	return (avaliable_prefix_unsafe() >= hd.fi->file_size);
+}
+
+boost::int64_t hs_chunked_ostream_impl::get_avaliable_end(boost::int64_t pos) 
+{
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	return avaliable_end_unsafe(pos);
+}
+
+boost::int64_t hs_chunked_ostream_impl::avaliable_end_unsafe(boost::int64_t pos) const
+{
+	/*  End of the verified bytes which go from pos without holes : 
+	 	the prefix, or the out of order range(seek far beyond the prefix) */
+	boost::int64_t const avaliable_bytes = avaliable_prefix_unsafe();
+	return (pos < avaliable_bytes) ? 
+		avaliable_bytes : ex_data_.avaliable_ranges.contiguous_end(pos);
+}
+
+boost::int64_t hs_chunked_ostream_impl::avaliable_prefix_unsafe() const
+{
+	/*  Watermark is ahead of the notified bytes while the notification goes through the notification center, 
+	 	closed watermark belongs to the removed file */
+	if (watermark_ && !watermark_->is_closed()) {
+		boost::int64_t const watermark = watermark_->get();
+		if (watermark > ex_data_.avaliable_bytes)
+			return watermark;
+	} // if
+	return ex_data_.avaliable_bytes;
+}
+
+hs_chunked_ostream_impl::io_state hs_chunked_ostream_impl::ensure_bytes(boost::int64_t first, boost::int64_t last) 
+{
+	/*  Request parked only if its thread could be returned to the transport, 
+	 	otherwise the thread blocked till the bytes come. Read ahead ring dropped before parking, 
+		so the parked request holds only own position and the file handle. Held reply headers 
+		sended before any waiting : the client gets them while the bytes are downloading */
+	bool const avaliable = (get_avaliable_end(first) >= last);
+	if (!avaliable && !flush_headers())
+		return hs_chunked_ostream_impl::io_failed;
+
+	if (!is_parking_enabled())
+		return wait_for_bytes(first, last) ? hs_chunked_ostream_impl::io_completed : hs_chunked_ostream_impl::io_failed;
+
+	if (!avaliable)
+		cursor_.pipeline.reset();
+
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	if (ex_data_.state == hs_chunked_ostream_impl::is_breaked || ex_data_.timed_out)
+		return hs_chunked_ostream_impl::io_failed;
+
+	if (last <= avaliable_end_unsafe(first))
+		return hs_chunked_ostream_impl::io_completed;
+	
+	suspend_unsafe();
+	ex_data_.state = hs_chunked_ostream_impl::is_parked;
+	ex_data_.needed_from = first;
+	ex_data_.needed_bytes = last;
+	arm_deadline_unsafe();
+	reading_wait_started();
+	return hs_chunked_ostream_impl::io_parked;
+}
+
+bool hs_chunked_ostream_impl::wait_for_bytes(boost::int64_t first, boost::int64_t last) 
 {
-	using boost::posix_time::seconds;
 	/*  Wait for notifications(with do extra test of bytes) till deadline not came,
-	 	deadline update each update of ex_data_.avaliable_bytes*/
+	 	deadline armed on the shared wheel and restarted if ex_data_.avaliable_bytes updated while waiting.
+		With the watermark the thread sleeps on it : the epoch taken before the test of bytes, so the publish 
+		after the test is not lost, notifications of the file info buffer wake it via the watermark too */
+	bool avaliable = false, armed = false;
 	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
 	for (;;) {
-		if (ex_data_.state == hs_chunked_ostream_impl::is_breaked)
-			return false;
-
-		if (bytes <= ex_data_.avaliable_bytes)
-			return true;
+		bool const fast_path = (watermark_ && !watermark_->is_closed());
+		int const epoch = fast_path ? watermark_->prepare_wait() : 0;
+		if (ex_data_.state == hs_chunked_ostream_impl::is_breaked || ex_data_.timed_out || 
+			(avaliable = (last <= avaliable_end_unsafe(first)))) 
+		{
+			if (fast_path)
+				watermark_->cancel_wait();
+			break;
+		} // if
 		
-		boost::system_time const waiter_deadline = boost::get_system_time() + seconds(params_.cores_sync_timeout); 
-		if (!ex_data_.waiter.timed_wait(guard, waiter_deadline))
-			return false;
+		if (!armed) {
+			ex_data_.needed_from = first;
+			ex_data_.needed_bytes = last;
+			arm_deadline_unsafe();
+			reading_wait_started();
+			armed = true;
+		} // if
+		if (!fast_path) {
+			ex_data_.waiter.wait(guard);
+			continue;
+		} // if
+		ex_data_.fast_waiting = true;
+		guard.unlock();
+		watermark_->wait(epoch, boost::posix_time::milliseconds(HCORE_WATERMARK_WAIT_SLICE_MS));
+		guard.lock();
+		ex_data_.fast_waiting = false;
 	} // wait loop
-	return true;
+	guard.unlock();
+	
+	if (armed) {
+		disarm_deadline();
+		reading_wait_finished();
+	}
+	return avaliable;
+}
+
+void hs_chunked_ostream_impl::check_parked_unsafe() 
+{
+	if (ex_data_.state == hs_chunked_ostream_impl::is_parked && 
+		ex_data_.needed_bytes <= avaliable_end_unsafe(ex_data_.needed_from)) 
+	{
+		ex_data_.state = hs_chunked_ostream_impl::state_default;
+		post_resume_unsafe();
+	} // if
+}
+
+void hs_chunked_ostream_impl::suspend_unsafe() 
+{
+	/*  Stack of the handler gone after the first parking, so the request data copied */
+	if (suspended_)
+		return;
+	parked_hd_ = *cursor_.hd;
+	cursor_.hd = &parked_hd_;
+	ostream_impl_->suspend();
+	suspended_ = true;
+}
+
+void hs_chunked_ostream_impl::arm_deadline_unsafe() 
+{
+	ex_data_.progressed = false;
+	ex_data_.armed_watermark = avaliable_prefix_unsafe();
+	boost::weak_ptr<hs_chunked_ostream_impl> const ostream = shared_from_this();
+	ex_data_.deadline = params_.deadlines->schedule(params_.cores_sync_timeout, 
+		boost::bind(&hs_chunked_ostream_impl::on_deadline_weak, ostream));
+}
+
+void hs_chunked_ostream_impl::disarm_deadline() 
+{
+	/*  Must be called without ex_data_ lock : cancel waits for the running callback, which takes the lock */
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	deadline_wheel::timer_id const deadline = ex_data_.deadline;
+	ex_data_.deadline = deadline_wheel::invalid_timer;
+	ex_data_.needed_bytes = 0;
+	guard.unlock();
+	
+	if (deadline != deadline_wheel::invalid_timer)
+		params_.deadlines->cancel(deadline);
+}
+
+void hs_chunked_ostream_impl::on_deadline_weak(boost::weak_ptr<hs_chunked_ostream_impl> const & ostream) 
+{
+	/*  Released policy could be still in the destructor(which cancels the deadline), 
+	 	so it must not be touched : post of the resume task takes a reference of it */
+	if (boost::shared_ptr<hs_chunked_ostream_impl> const locked = ostream.lock())
+		locked->on_deadline();
+}
+
+void hs_chunked_ostream_impl::on_deadline() 
+{
+	/*  Called by the wheel thread. If bytes were updated since the deadline armed, waiting continues 
+	 	with the new deadline, otherwise waiting(parked) request failed */
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	if (ex_data_.needed_bytes == 0)
+		return;
+
+	if (ex_data_.progressed || avaliable_prefix_unsafe() > ex_data_.armed_watermark) {
+		arm_deadline_unsafe();
+		return;
+	} // if
+	
+	ex_data_.timed_out = true;
+	ex_data_.deadline = deadline_wheel::invalid_timer;
+	if (ex_data_.state == hs_chunked_ostream_impl::is_parked) {
+		ex_data_.state = hs_chunked_ostream_impl::state_default;
+		post_resume_unsafe();
+	} // if
+	bool const fast_waiting = ex_data_.fast_waiting;
+	guard.unlock();
+	notify_waiter(fast_waiting);
+}
+
+hs_chunked_ostream_impl::io_state hs_chunked_ostream_impl::park_throttled(std::size_t delay_ms) 
+{
+	/*  Stream keeps its place in the waiting streams of the shaper, 
+	 	so the next try after the delay is served in FIFO order */
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	if (ex_data_.state == hs_chunked_ostream_impl::is_breaked) {
+		guard.unlock();
+		params_.egress->cancel_wait(egress_);
+		return hs_chunked_ostream_impl::io_failed;
+	} // if
+
+	suspend_unsafe();
+	ex_data_.state = hs_chunked_ostream_impl::is_throttled;
+	boost::weak_ptr<hs_chunked_ostream_impl> const ostream = shared_from_this();
+	ex_data_.throttle = params_.egress_deadlines->schedule_ms(delay_ms, 
+		boost::bind(&hs_chunked_ostream_impl::on_throttle_weak, ostream));
+	return hs_chunked_ostream_impl::io_parked;
+}
+
+void hs_chunked_ostream_impl::disarm_throttle() 
+{
+	/*  Same as disarm_deadline, must be called without ex_data_ lock */
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	deadline_wheel::timer_id const throttle = ex_data_.throttle;
+	ex_data_.throttle = deadline_wheel::invalid_timer;
+	guard.unlock();
+	
+	if (throttle != deadline_wheel::invalid_timer)
+		params_.egress_deadlines->cancel(throttle);
+}
+
+void hs_chunked_ostream_impl::on_throttle_weak(boost::weak_ptr<hs_chunked_ostream_impl> const & ostream) 
+{
+	if (boost::shared_ptr<hs_chunked_ostream_impl> const locked = ostream.lock())
+		locked->on_throttle();
+}
+
+void hs_chunked_ostream_impl::on_throttle() 
+{
+	/*  Called by the egress wheel thread, broken request already resumed by the on_break */
+	boost::mutex::scoped_lock guard(ex_data_.waiter_lock);
+	ex_data_.throttle = deadline_wheel::invalid_timer;
+	if (ex_data_.state == hs_chunked_ostream_impl::is_throttled) {
+		ex_data_.state = hs_chunked_ostream_impl::state_default;
+		post_resume_unsafe();
+	} // if
+}
+
+void hs_chunked_ostream_impl::notify_waiter(bool fast_waiting) 
+{
+	/*  Watermark could not be reset while the request in progress, so it is safe without the lock */
+	if (fast_waiting)
+		watermark_->notify_all();
+	else
+		ex_data_.waiter.notify_one();
+}
+
+void hs_chunked_ostream_impl::post_resume_unsafe() 
+{
+	/*  Resume task holds the request, so it alive even if file_info_buffer already dropped the subscriber */
+	if (!params_.resume_pool->post(boost::bind(&hs_chunked_ostream_impl::resume, shared_from_this())))
+		HCORE_WARNING("resume pool stopped, parked request dropped")
+}
+
+void hs_chunked_ostream_impl::resume() 
+{
+	disarm_deadline();
+	disarm_throttle();
+	reading_wait_finished();
+	io_state const state = write_content();
+	if (state != hs_chunked_ostream_impl::io_parked)
+		finish_parked(state == hs_chunked_ostream_impl::io_completed);
+}
+
+void hs_chunked_ostream_impl::finish_parked(bool performed) 
+{
+	/*  Same as http_server_core does for the not parked request : unsubscribe, 
+	 	then give the reply back to the transport */
+	http_data & hd = *cursor_.hd;
+	if (!performed) 
+		HCORE_WARNING("send content of the parked request failed, file '%s'", hd.fi->file_path.c_str())
+	
+	cursor_.pipeline.reset();
+	cursor_.file_mapping.reset();
+	cursor_.file_handle.reset();
+	if (params_.egress)
+		params_.egress->cancel_wait(egress_);
+	hd.fi_buffer->unregistr_subscriber(hd.fi, shared_from_this());
+	
+	finished_ = true;
+	ostream_impl_->complete();
+	end_of_io();
 }
 
 } } // namespace t2h_core, details
 
+#undef HCORE_ADAPTIVE_CHUNK_TARGET_SECS
+#undef HCORE_ADAPTIVE_DRAIN_RATE_WEIGHT
+#undef HCORE_READER_PROGRESS_SECS
+#undef HCORE_WATERMARK_WAIT_SLICE_MS
+
@@ -1,42 +1,165 @@
 #ifndef HS_CHUNKED_OSTREAM_IMPL_HPP_INCLUDED
 #define HS_CHUNKED_OSTREAM_IMPL_HPP_INCLUDED
 
+#include "core_watermark.hpp"
+#include "byte_interval_set.hpp"
 #include "base_chunked_ostream.hpp"
+#include "read_ahead_pipeline.hpp"
 
 #include <boost/thread.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
 
 namespace t2h_core { namespace details {
 
 /**
- *
+ * hs_chunked_ostream_impl writes content of the file to the client chunk by chunk, waiting for the torrent bytes.
+ * If the transport can suspend the reply and the resume pool set, request which waits for the bytes 
+ * parked : the write position saved, the thread returned to the transport and the request 
+ * continued by the resume pool then file_info_buffer notify about new bytes. 
+ * Otherwise the thread blocked till the bytes come. In both cases waiting limited by the deadline wheel.
+ * Request throttled by the egress shaper parked the same way and resumed by the egress timer.
+ * Blocked thread could wait on the watermark of the file, which the torrent core publishes directly 
+ * from the piece handler, so it woken without the notification center delay.
  */
-class hs_chunked_ostream_impl : public base_chunked_ostream {
+class hs_chunked_ostream_impl : 
+	public base_chunked_ostream, 
+	public boost::enable_shared_from_this<hs_chunked_ostream_impl> 
+{
 public :
-	enum { is_breaked = 1, state_default = 2 };
+	enum { is_breaked = 1, state_default = 2, is_parked = 3, is_throttled = 4 };
 
 	hs_chunked_ostream_impl(http_server_ostream_policy_params const & base_params, hs_chunked_ostream_params const & params);
 	~hs_chunked_ostream_impl();
 
 	/* From async_file_info_subscriber */
 	virtual void on_bytes_avaliable_change(boost::int64_t avaliable_bytes);
+	virtual void on_range_avaliable(boost::int64_t first, boost::int64_t last);
 	virtual void on_break();
 	virtual async_file_info_subscriber * clone() 
 		{ return NULL; }
 
+	/* From http_server_ostream_policy */
+	virtual bool is_suspended() const 
+		{ return suspended_; }
+
 protected :
 	virtual bool write_content_impl(http_data & hd);
 
 private :
-	bool wait_for_bytes(boost::int64_t bytes);
+	enum io_state { io_completed, io_failed, io_parked };
+
+	io_state write_content();
+	io_state write_range();
+	boost::int64_t write_chunk_copy(http_data & hd, 
+		hc_file_handle & file_handle, 
+		boost::int64_t seek_pos, 
+		boost::int64_t bytes_size);
+	boost::int64_t write_chunk_pipelined(http_data & hd, 
+		read_ahead_pipeline & pipeline, 
+		hc_file_handle & file_handle, 
+		boost::int64_t seek_pos, 
+		boost::int64_t bytes_size, 
+		boost::int64_t end);
+	void schedule_read_ahead(read_ahead_pipeline & pipeline, 
+		hc_file_handle & file_handle, 
+		boost::int64_t next_pos, 
+		boost::int64_t end);
+	void advise_read_ahead(hc_file_handle & file_handle, boost::int64_t next_pos, boost::int64_t end);
+	boost::int64_t write_chunk_cached(hc_cached_piece const & piece, boost::int64_t seek_pos, boost::int64_t bytes_size);
+	boost::int64_t write_chunk_blocks(http_data & hd, 
+		hc_file_handle & file_handle, 
+		boost::int64_t seek_pos, 
+		boost::int64_t bytes_size);
+	boost::int64_t write_chunk_mapped(http_data & hd, 
+		hc_file_mapping & file_mapping, 
+		boost::int64_t seek_pos, 
+		boost::int64_t bytes_size);
+	boost::int64_t get_chunk_size(boost::int64_t seek_pos, boost::int64_t end);
+	void update_chunk_size(boost::int64_t writed, boost::posix_time::time_duration const & elapsed);
+	void update_reading(boost::int64_t writed);
+	void reading_wait_started();
+	void reading_wait_finished();
+	boost::int64_t acquire_egress(boost::int64_t bytes_size, std::size_t & delay_ms);
+	void settle_egress(boost::int64_t granted, boost::int64_t writed);
+	bool is_file_completed(http_data & hd);
+	boost::int64_t get_avaliable_end(boost::int64_t pos);
+	boost::int64_t avaliable_end_unsafe(boost::int64_t pos) const;
+	boost::int64_t avaliable_prefix_unsafe() const;
+	io_state ensure_bytes(boost::int64_t first, boost::int64_t last);
+	bool wait_for_bytes(boost::int64_t first, boost::int64_t last);
+	void check_parked_unsafe();
+	void suspend_unsafe();
+	
+	/* Parking */
+	inline bool is_parking_enabled() const 
+		{ return (params_.resume_pool && ostream_impl_->is_suspend_supported()); }
+	void arm_deadline_unsafe();
+	void disarm_deadline();
+	void on_deadline();
+	static void on_deadline_weak(boost::weak_ptr<hs_chunked_ostream_impl> const & ostream);
+	inline bool is_throttling_enabled() const 
+		{ return (params_.egress && params_.egress_deadlines && is_parking_enabled()); }
+	io_state park_throttled(std::size_t delay_ms);
+	void disarm_throttle();
+	void on_throttle();
+	static void on_throttle_weak(boost::weak_ptr<hs_chunked_ostream_impl> const & ostream);
+	void notify_waiter(bool fast_waiting);
+	void post_resume_unsafe();
+	void resume();
+	void finish_parked(bool performed);
 
 	hs_chunked_ostream_params mutable params_;
 	
 	struct {
 		boost::mutex waiter_lock;				// 
 		boost::condition_variable waiter;		//
-		boost::int64_t avaliable_bytes;			//
+		boost::int64_t avaliable_bytes;			// Verified prefix of the file
+		byte_interval_set avaliable_ranges;		// Verified bytes beyond the prefix
 		int state;								//
+		boost::int64_t needed_from;				// Start of the bytes which the waiting(parked) request needs
+		boost::int64_t needed_bytes;			// End of the bytes which the waiting(parked) request needs, 0 if not waiting
+		bool progressed;						// Avaliable bytes changed since the deadline armed
+		bool timed_out;							// Deadline came without any progress
+		bool fast_waiting;						// Blocked thread waits on the watermark_, not on the waiter
+		boost::int64_t armed_watermark;			// Watermark then the deadline armed
+		deadline_wheel::timer_id deadline;		// Armed deadline of the waiting
+		deadline_wheel::timer_id throttle;		// Armed egress timer of the throttled request
 	} ex_data_;
+	
+	struct {
+		http_data * hd;							// Data of the request(points to the parked_hd_ since first parking)
+		std::size_t range;						// Index of the current range(multipart/byteranges)
+		bool range_started;						// Part header of the current range written, seek_pos/end are set
+		boost::int64_t start;					// Start of the current range
+		boost::int64_t seek_pos;				// Next byte of the current range
+		boost::int64_t end;						// End(exclusive) of the current range
+		bool zero_copy;							// Zero-copy transfer still avaliable
+		bool mapping_tried;						// Mapping of the completed file already acquired(or failed)
+		hc_file_handle_ptr file_handle;			//
+		hc_file_mapping_ptr file_mapping;		//
+		read_ahead_pipeline_ptr pipeline;		// Dropped at parking, so parked request does not hold IO buffers
+	} cursor_;
+	
+	core_watermark_ptr watermark_;				// Watermark of the file, set(under the waiter_lock) only if the fast path enabled
+	http_data parked_hd_;						// Copy of the request data, stack of the handler gone after parking
+	bool suspended_;							// Transport ostream suspended by the first parking
+	bool finished_;								// Parked request finished(transport ostream completed)
+	
+	struct {
+		boost::int64_t chunk_size;				// Current chunk size, in bytes
+		double drain_rate;						// Smoothed client drain rate, in bytes per sec
+	} adaptive_;
+
+	struct {
+		boost::posix_time::ptime since;			// Start of the current measure interval
+		boost::posix_time::ptime wait_start;	// Start of the bytes waiting(parking), not_a_date_time if not waiting
+		boost::posix_time::time_duration waited;// Time of the bytes waiting in the current interval
+		boost::int64_t bytes;					// Bytes writed in the current interval
+	} reading_;
+
+	egress_stream egress_;						// Budgets and throttled/starved time of the reply
 
 };
 
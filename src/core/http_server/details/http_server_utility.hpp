@@ -3,21 +3,59 @@
 
 #include "misc_utility.hpp"
 #include "http_utility.hpp"
+#include "http_core_reply.hpp"
 #include "file_info_buffer.hpp"
 #include "http_server_macroses.hpp"
 
 namespace t2h_core { namespace details {
 
-inline static void add_etag_date_headers(std::string & out, details::hc_file_info_ptr const fi) 
+inline static void add_etag_date_headers(hc_reply_headers & out, http_data const & hd) 
 {
-	std::string const gtm_time = utility::http_get_gmt_time_string(),
-		etag = utility::http_etag(fi->file_size, std::time(NULL));
-	if (!gtm_time.empty())
-		out += "Date: " + gtm_time + "\r\n";
-	if (!etag.empty())
-		out += "Etag: " + etag + "\r\n";
+	hc_file_validators const validators = hd.fi_buffer->get_validators(hd.fi);
+	out.append("Date: ").append_current_date().append("\r\n");
+	if (!validators.etag.empty())
+		out.append("Etag: ").append(validators.etag).append("\r\n");
+	if (validators.last_modified != 0)
+		out.append("Last-Modified: ").append_date(validators.last_modified).append("\r\n");
 }
 
+/* If-None-Match(weak comparison) or, if it not present, If-Modified-Since evaluation 
+ 	(Last-Modified known only for completed files), true means reply with 304 */
+inline static bool is_not_modified(hc_file_validators const & validators, utility::conditional_header const & conditions) 
+{
+	if (!conditions.if_none_match.empty())
+		return utility::http_etag_match(conditions.if_none_match, validators.etag, true);
+	if (!conditions.if_modified_since.empty() && validators.last_modified != 0) {
+		std::time_t const since = utility::http_parse_gmt_time(conditions.if_modified_since);
+		return (since != (std::time_t)-1 && validators.last_modified <= since);
+	}
+	return false;
+}
+
+/* If-Range evaluation, entity tag requires strong comparison and date requires exact match, 
+ 	true means the range could be sent, otherwise whole content must be sent with 200 */
+inline static bool is_range_applicable(hc_file_validators const & validators, utility::conditional_header const & conditions) 
+{
+	if (conditions.if_range.empty())
+		return true;
+	if (conditions.if_range[0] == '"' || conditions.if_range.compare(0, 2, "W/") == 0)
+		return utility::http_etag_match(conditions.if_range, validators.etag, false);
+	std::time_t const date = utility::http_parse_gmt_time(conditions.if_range);
+	return (validators.last_modified != 0 && date != (std::time_t)-1 && validators.last_modified == date);
+}
+
+inline static void multipart_part_header(hc_reply_headers & out, 
+	std::string const & boundary, utility::byte_range const & range, boost::int64_t file_size) 
+{
+	out.append("\r\n--").append(boundary).append("\r\n"
+		"Content-Type: application/octet-stream\r\n"
+		"Content-Range: bytes ").append_int(range.first).append("-").append_int(range.last)
+		.append("/").append_int(file_size).append("\r\n\r\n");
+}
+
+inline static void multipart_closing(hc_reply_headers & out, std::string const & boundary) 
+	{ out.append("\r\n--").append(boundary).append("--\r\n"); }
+
 } } // namespace t2h_core, details
 
 #endif 
@@ -0,0 +1,119 @@
+#include "io_buffers_pool.hpp"
+
+#include "http_server_macroses.hpp"
+
+#include <algorithm>
+
+namespace t2h_core { namespace details {
+
+namespace {
+
+/* True for the buffers of the one slab */
+struct is_slab_buffer {
+	is_slab_buffer(char const * first, char const * last) : first_(first), last_(last) { }
+
+	inline bool operator()(char const * buffer) const
+		{ return (buffer >= first_ && buffer < last_); }
+
+	char const * first_;
+	char const * last_;
+};
+
+} // namespace
+
+/**
+ * Public io_buffers_pool api
+ */
+
+io_buffers_pool::io_buffers_pool(std::size_t buffer_size, std::size_t buffers_per_slab, std::size_t max_free_slabs) 
+	: buffer_size_(buffer_size), 
+	buffers_per_slab_(buffers_per_slab == 0 ? 1 : buffers_per_slab), 
+	max_free_slabs_(max_free_slabs), 
+	free_slabs_(0), 
+	slabs_(), 
+	free_(), 
+	stat_(), 
+	lock_()
+{
+	stat_.buffer_size = buffer_size_;
+	stat_.slabs = stat_.buffers = stat_.in_use = stat_.peak_in_use = 0;
+	stat_.acquires = 0;
+}
+
+io_buffers_pool::~io_buffers_pool() 
+{
+	if (stat_.in_use != 0) 
+		HCORE_WARNING("io buffers pool destroyed with '%lu' buffers in use", (unsigned long)stat_.in_use)
+	for (slabs_type::iterator first = slabs_.begin(), last = slabs_.end(); first != last; ++first) 
+		delete [] first->first;
+}
+
+char * io_buffers_pool::acquire() 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (free_.empty()) {
+		/*  Slab carved into buffers, slab returned to the heap only when all its buffers are free */
+		char * slab = new char[buffer_size_ * buffers_per_slab_];
+		slabs_.insert(std::make_pair(slab, buffers_per_slab_));
+		++free_slabs_;
+		for (std::size_t it = buffers_per_slab_; it > 0; --it)
+			free_.push_back(slab + (it - 1) * buffer_size_);
+		++stat_.slabs;
+		stat_.buffers += buffers_per_slab_;
+	} // if
+
+	char * buffer = free_.back();
+	free_.pop_back();
+	slabs_type::iterator const slab = find_slab_unsafe(buffer);
+	if (slab->second-- == buffers_per_slab_)
+		--free_slabs_;
+	++stat_.acquires;
+	if (++stat_.in_use > stat_.peak_in_use)
+		stat_.peak_in_use = stat_.in_use;
+	return buffer;
+}
+
+void io_buffers_pool::release(char * buffer) 
+{
+	if (!buffer)
+		return;
+	boost::mutex::scoped_lock guard(lock_);
+	free_.push_back(buffer);
+	--stat_.in_use;
+	slabs_type::iterator const slab = find_slab_unsafe(buffer);
+	if (++slab->second == buffers_per_slab_ && ++free_slabs_ > max_free_slabs_)
+		release_slab_unsafe(slab);
+}
+
+io_buffers_pool_stat io_buffers_pool::get_stat() const 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return stat_;
+}
+
+/**
+ * Private io_buffers_pool api
+ */
+
+io_buffers_pool::slabs_type::iterator io_buffers_pool::find_slab_unsafe(char * buffer) 
+{
+	/*  Slab with the greatest first byte which is not above the buffer */
+	slabs_type::iterator slab = slabs_.upper_bound(buffer);
+	BOOST_ASSERT(slab != slabs_.begin());
+	return --slab;
+}
+
+void io_buffers_pool::release_slab_unsafe(slabs_type::iterator slab) 
+{
+	char * const first = slab->first;
+	free_.erase(std::remove_if(free_.begin(), free_.end(),
+		is_slab_buffer(first, first + buffer_size_ * buffers_per_slab_)), free_.end());
+	delete [] first;
+	slabs_.erase(slab);
+	--free_slabs_;
+	--stat_.slabs;
+	stat_.buffers -= buffers_per_slab_;
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,88 @@
+#ifndef IO_BUFFERS_POOL_HPP_INCLUDED
+#define IO_BUFFERS_POOL_HPP_INCLUDED
+
+#include <map>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * io_buffers_pool_stat occupancy of the io buffers pool
+ */
+struct io_buffers_pool_stat {
+	std::size_t buffer_size;			// Size of one buffer, in bytes
+	std::size_t slabs;					// Count of allocated(not yet released) slabs
+	std::size_t buffers;				// Count of buffers in all slabs
+	std::size_t in_use;					// Count of buffers handed out now
+	std::size_t peak_in_use;			// Max count of buffers handed out at the same time
+	boost::uint64_t acquires;			// Total count of acquires
+};
+
+/**
+ * io_buffers_pool global pool of the fixed size(max chunk size) IO buffers. 
+ * Buffers allocated by slabs and handed out only while the chunk in flight,
+ * so resident memory bounded by count of concurrent chunk IO, not by count of connections.
+ * Slabs which buffers are all free returned to the heap above max_free_slabs, 
+ * so the memory of the peak load not held forever.
+ */
+class io_buffers_pool : boost::noncopyable {
+public :
+	io_buffers_pool(std::size_t buffer_size, std::size_t buffers_per_slab, std::size_t max_free_slabs);
+	~io_buffers_pool();
+
+	char * acquire();
+	void release(char * buffer);
+	
+	inline std::size_t buffer_size() const 
+		{ return buffer_size_; }
+
+	io_buffers_pool_stat get_stat() const;
+
+private :
+	/* Slab by the first byte, value is the count of free buffers of the slab */
+	typedef std::map<char *, std::size_t> slabs_type;
+
+	slabs_type::iterator find_slab_unsafe(char * buffer);
+	void release_slab_unsafe(slabs_type::iterator slab);
+
+	std::size_t const buffer_size_;
+	std::size_t const buffers_per_slab_;
+	std::size_t const max_free_slabs_;
+	std::size_t free_slabs_;
+	slabs_type slabs_;
+	std::vector<char *> free_;
+	io_buffers_pool_stat stat_;
+	boost::mutex mutable lock_;
+
+};
+
+typedef boost::shared_ptr<io_buffers_pool> io_buffers_pool_ptr;
+
+/**
+ * io_buffer_guard scoped owner of the one pool buffer
+ */
+class io_buffer_guard : boost::noncopyable {
+public :
+	explicit io_buffer_guard(io_buffers_pool & pool) 
+		: pool_(pool), buffer_(pool.acquire()) { }
+	
+	~io_buffer_guard() 
+		{ pool_.release(buffer_); }
+	
+	inline char * get() const 
+		{ return buffer_; }
+
+private :
+	io_buffers_pool & pool_;
+	char * buffer_;
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -0,0 +1,387 @@
+#include "io_uring_reader.hpp"
+
+#include "http_server_macroses.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <boost/bind.hpp>
+
+#if defined(T2H_HAVE_IO_URING)
+#	include <errno.h>
+#	include <string.h>
+#	include <unistd.h>
+#	include <sys/uio.h>
+#	include <sys/mman.h>
+#	include <sys/syscall.h>
+#	include <linux/io_uring.h>
+#endif // T2H_HAVE_IO_URING
+
+namespace t2h_core { namespace details {
+
+/**
+ * Private io_uring_reader::ring_impl api
+ */
+
+#if defined(T2H_HAVE_IO_URING)
+
+/*  Minimal io_uring ring(without liburing) : one submission queue of readv operations,
+ 	submitted and reaped by the one thread, so only kernel/user memory ordering matters */
+struct io_uring_reader::ring_impl : boost::noncopyable {
+	
+	explicit ring_impl(std::size_t ring_entries) 
+		: ring_fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED), sqes(NULL), sq_size(0), cq_size(0), sqes_size(0), 
+		entries(0), unsubmitted(0), iovecs()
+	{
+		struct io_uring_params params;
+		::memset(&params, 0, sizeof(params));
+		if ((ring_fd = ::syscall(__NR_io_uring_setup, (unsigned)ring_entries, &params)) < 0) {
+			ring_fd = -1;
+			return;
+		}
+		
+		sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+		cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+		sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+		if (params.features & IORING_FEAT_SINGLE_MMAP) 
+			sq_size = cq_size = std::max(sq_size, cq_size);
+		
+		sq_ptr = ::mmap(NULL, sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+		cq_ptr = (params.features & IORING_FEAT_SINGLE_MMAP) ? 
+			sq_ptr : ::mmap(NULL, cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		void * sqes_ptr = ::mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+		if (sq_ptr == MAP_FAILED || cq_ptr == MAP_FAILED || sqes_ptr == MAP_FAILED) {
+			if (sqes_ptr != MAP_FAILED)
+				::munmap(sqes_ptr, sqes_size);
+			close();
+			return;
+		}
+
+		char * sq = static_cast<char *>(sq_ptr), * cq = static_cast<char *>(cq_ptr);
+		sq_head = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+		sq_tail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+		sq_mask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+		sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+		cq_head = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+		cq_tail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+		cq_mask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+		cqes = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+		sqes = static_cast<struct io_uring_sqe *>(sqes_ptr);
+		entries = params.sq_entries;
+		iovecs.resize(entries);
+	}
+
+	~ring_impl() 
+	{
+		close();
+	}
+
+	inline bool is_open() const 
+		{ return (ring_fd != -1); }
+	
+	void close() 
+	{
+		if (sqes)
+			::munmap(sqes, sqes_size);
+		if (cq_ptr != MAP_FAILED && cq_ptr != sq_ptr)
+			::munmap(cq_ptr, cq_size);
+		if (sq_ptr != MAP_FAILED)
+			::munmap(sq_ptr, sq_size);
+		if (ring_fd != -1)
+			::close(ring_fd);
+		sqes = NULL; 
+		sq_ptr = cq_ptr = MAP_FAILED;
+		ring_fd = -1;
+	}
+	
+	/* Caller guarantee about SQ has free entry(count of inflight requests <= entries) */
+	void push(read_request * request) 
+	{
+		unsigned const tail = *sq_tail, index = tail & sq_mask;
+		struct io_uring_sqe * sqe = &sqes[index];
+		iovecs[index].iov_base = request->buffer;
+		iovecs[index].iov_len = request->bytes_size;
+		::memset(sqe, 0, sizeof(*sqe));
+		sqe->opcode = IORING_OP_READV;
+		sqe->fd = request->fd;
+		sqe->addr = reinterpret_cast<unsigned long>(&iovecs[index]);
+		sqe->len = 1;
+		sqe->off = request->offset;
+		sqe->user_data = reinterpret_cast<unsigned long>(request);
+		sq_array[index] = index;
+		__sync_synchronize();
+		*sq_tail = tail + 1;
+		++unsubmitted;
+	}
+	
+	/* Submit all pushed requests and wait for min_complete completions, 
+	 	returns false on the unrecoverable ring error */
+	bool enter(unsigned min_complete) 
+	{
+		int const submitted = ::syscall(__NR_io_uring_enter, 
+			ring_fd, unsubmitted, min_complete, min_complete > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+		if (submitted >= 0) {
+			unsubmitted -= submitted;
+			return true;
+		}
+		return (errno == EINTR || errno == EAGAIN || errno == EBUSY);
+	}
+
+	/* Wait for one completion without submission, false on the ring error */
+	bool wait_completion() 
+	{
+		if (::syscall(__NR_io_uring_enter, ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0) >= 0)
+			return true;
+		return (errno == EINTR || errno == EAGAIN || errno == EBUSY);
+	}
+	
+	/* Pushed but not submitted requests are not seen by the kernel, they never will be submitted */
+	unsigned drop_unsubmitted() 
+	{
+		unsigned const dropped = unsubmitted;
+		unsubmitted = 0;
+		return dropped;
+	}
+
+	/* Pop one completion, false if CQ is empty */
+	bool pop(read_request *& request, boost::int64_t & result) 
+	{
+		unsigned const head = *cq_head;
+		__sync_synchronize();
+		if (head == *cq_tail)
+			return false;
+		struct io_uring_cqe const * cqe = &cqes[head & cq_mask];
+		request = reinterpret_cast<read_request *>(cqe->user_data);
+		result = cqe->res < 0 ? -1 : cqe->res;
+		__sync_synchronize();
+		*cq_head = head + 1;
+		return true;
+	}
+
+	int ring_fd;
+	void * sq_ptr, * cq_ptr;
+	struct io_uring_sqe * sqes;
+	std::size_t sq_size, cq_size, sqes_size;
+	unsigned * sq_head, * sq_tail, * sq_array, sq_mask;
+	unsigned * cq_head, * cq_tail, cq_mask;
+	struct io_uring_cqe * cqes;
+	std::size_t entries;
+	unsigned unsubmitted;
+	std::vector<struct iovec> iovecs;
+
+};
+
+#else
+
+struct io_uring_reader::ring_impl : boost::noncopyable {
+	
+	explicit ring_impl(std::size_t) : entries(0) { }
+	
+	inline bool is_open() const 
+		{ return false; }
+	
+	void push(read_request *) { }
+	
+	void close() { }
+	
+	bool enter(unsigned) 
+		{ return false; }
+	
+	bool wait_completion() 
+		{ return false; }
+	
+	unsigned drop_unsubmitted() 
+		{ return 0; }
+	
+	bool pop(read_request *&, boost::int64_t &) 
+		{ return false; }
+	
+	std::size_t entries;
+
+};
+
+#endif // T2H_HAVE_IO_URING
+
+/**
+ * Helpers
+ */
+
+static boost::int64_t fallback_read(int fd, char * buffer, std::size_t bytes_size, boost::int64_t offset) 
+{
+#if defined(T2H_HAVE_IO_URING)
+	ssize_t readed = -1;
+	while ((readed = ::pread(fd, buffer, bytes_size, offset)) < 0 && errno == EINTR) { }
+	return readed;
+#else
+	return -1;
+#endif // T2H_HAVE_IO_URING
+}
+
+/**
+ * Public io_uring_reader api
+ */
+
+io_uring_reader::io_uring_reader(std::size_t entries) 
+	: ring_(new ring_impl(entries)), 
+	pending_(), 
+	inflight_(), 
+	stop_(false), 
+	failed_(false), 
+	lock_(), 
+	submit_waiter_(), 
+	done_waiter_(), 
+	ring_thread_()
+{
+	if (!ring_->is_open()) {
+		HCORE_WARNING("io_uring not avaliable, reads will be performed via pread")
+		return;
+	}
+	ring_thread_.reset(new boost::thread(boost::bind(&io_uring_reader::ring_loop, this)));
+}
+
+io_uring_reader::~io_uring_reader() 
+{
+	stop();
+}
+
+bool io_uring_reader::is_open() const 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	return (ring_thread_ && !failed_ && !stop_);
+}
+
+boost::int64_t io_uring_reader::read_at(int fd, char * buffer, std::size_t bytes_size, boost::int64_t offset) 
+{
+	read_request request = { fd, buffer, bytes_size, offset, -1, false, false };
+	boost::mutex::scoped_lock guard(lock_);
+	if (!ring_thread_ || stop_)
+		return -1;
+	
+	if (!failed_) {
+		pending_.push_back(&request);
+		submit_waiter_.notify_one();
+		while (!request.done)
+			done_waiter_.wait(guard);
+		if (!request.fallback)
+			return request.result;
+	} // if
+	
+	guard.unlock();
+	return fallback_read(fd, buffer, bytes_size, offset);
+}
+
+void io_uring_reader::stop() 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (!ring_thread_ || stop_)
+		return;
+	stop_ = true;
+	guard.unlock();
+	submit_waiter_.notify_one();
+	ring_thread_->join();
+}
+
+/**
+ * Private io_uring_reader api
+ */
+
+void io_uring_reader::complete_unsafe(read_request * request, boost::int64_t result) 
+{
+	request->result = result;
+	request->fallback = (result < 0);
+	request->done = true;
+	requests_type::iterator const found = std::find(inflight_.begin(), inflight_.end(), request);
+	if (found != inflight_.end())
+		inflight_.erase(found);
+}
+
+void io_uring_reader::fail_unsubmitted_unsafe() 
+{
+	/*  Requests pushed to SQ after the last successful submission are the tail of inflight_, 
+	 	callers of all not submitted requests retry them via pread */
+	for (requests_type::iterator first = pending_.begin(), last = pending_.end(); first != last; ++first) 
+		(*first)->fallback = (*first)->done = true;
+	pending_.clear(); 
+	for (unsigned dropped = ring_->drop_unsubmitted(); dropped > 0 && !inflight_.empty(); --dropped) {
+		inflight_.back()->fallback = inflight_.back()->done = true;
+		inflight_.pop_back();
+	} // for
+	done_waiter_.notify_all();
+}
+
+void io_uring_reader::fail_inflight_unsafe() 
+{
+	for (requests_type::iterator first = inflight_.begin(), last = inflight_.end(); first != last; ++first) 
+		(*first)->fallback = (*first)->done = true;
+	inflight_.clear();
+	done_waiter_.notify_all();
+}
+
+void io_uring_reader::reap_inflight(boost::mutex::scoped_lock & guard) 
+{
+	/*  Kernel could write to the buffers of the submitted requests till their completions, 
+	 	so callers(and their buffers) wait for them even if the ring is broken. If the completions 
+		could not be waited, the ring closed first and the rest retried via pread(same bytes to the same buffer) */
+	read_request * request = NULL;
+	while (!inflight_.empty()) {
+		guard.unlock();
+		bool const waited = ring_->wait_completion();
+		guard.lock();
+		for (boost::int64_t result = 0; ring_->pop(request, result);)
+			complete_unsafe(request, result);
+		done_waiter_.notify_all();
+		if (!waited) {
+			HCORE_ERROR("io_uring completions waiting failed, %u reads fall back to pread", 
+				(unsigned)inflight_.size())
+			ring_->close();
+			fail_inflight_unsafe();
+			return;
+		} // if
+	} // while
+}
+
+void io_uring_reader::ring_loop() 
+{
+	/*  Each round : move all pending requests(up to the ring size) to SQ,
+	 	submit them and wait at least one completion with one io_uring_enter, then reap CQ. 
+		New requests, which came while waiting, submitted at next round as one batch. */
+	boost::mutex::scoped_lock guard(lock_);
+	for (read_request * request = NULL; ; request = NULL) {
+		while (!stop_ && pending_.empty() && inflight_.empty())
+			submit_waiter_.wait(guard);
+		
+		if (stop_) {
+			/*  Drop not submitted requests, but wait for requests owned by kernel */
+			for (requests_type::iterator first = pending_.begin(), last = pending_.end(); first != last; ++first) 
+				(*first)->done = true;
+			pending_.clear();
+			done_waiter_.notify_all();
+			if (inflight_.empty())
+				return;
+		} // if
+
+		for (; !pending_.empty() && inflight_.size() < ring_->entries; pending_.pop_front()) {
+			ring_->push(pending_.front());
+			inflight_.push_back(pending_.front());
+		} // for
+		
+		guard.unlock();
+		bool const entered = ring_->enter(1);
+		guard.lock();
+		
+		if (!entered) {
+			HCORE_ERROR("io_uring submission failed, fall back to pread")
+			failed_ = true;
+			fail_unsubmitted_unsafe();
+			reap_inflight(guard);
+			ring_->close();
+			return;
+		} // if
+
+		for (boost::int64_t result = 0; ring_->pop(request, result);)
+			complete_unsafe(request, result);
+		done_waiter_.notify_all();
+	} // for
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,73 @@
+#ifndef IO_URING_READER_HPP_INCLUDED
+#define IO_URING_READER_HPP_INCLUDED
+
+#include <deque>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * io_uring_reader batched file reader, shared by all streams of the http core.
+ * Reads of all active streams queued to the one submission ring(linux io_uring) 
+ * and submitted by the own thread with one syscall, callers blocks till their read completes.
+ * Avaliable only if the library built with T2H_HAVE_IO_URING, 
+ * on other platforms/kernels is_open return false and callers should use pread.
+ */
+class io_uring_reader : boost::noncopyable {
+public :
+	explicit io_uring_reader(std::size_t entries);
+	~io_uring_reader();
+
+	/* Check about ring is set up and reader thread run */
+	bool is_open() const;
+	
+	/* Positional read via the ring, same semantic as pread. If the ring failed(before or while the read queued) 
+	 	or the read completed with error, the read retried via pread on the same fd.
+		Returns count of readed bytes or -1 on error(also on stop) */
+	boost::int64_t read_at(int fd, char * buffer, std::size_t bytes_size, boost::int64_t offset);
+
+	void stop();
+
+private :
+	struct ring_impl;
+	
+	struct read_request {
+		int fd;
+		char * buffer;
+		std::size_t bytes_size;
+		boost::int64_t offset;
+		boost::int64_t result;
+		bool done;
+		bool fallback;						// Not readed by the ring, caller retries via pread
+	};
+	
+	typedef std::deque<read_request *> requests_type;
+	
+	void complete_unsafe(read_request * request, boost::int64_t result);
+	void fail_unsubmitted_unsafe();
+	void fail_inflight_unsafe();
+	void reap_inflight(boost::mutex::scoped_lock & guard);
+	void ring_loop();
+
+	boost::scoped_ptr<ring_impl> ring_;
+	requests_type pending_;
+	requests_type inflight_;
+	bool stop_;
+	bool failed_;
+	boost::mutex mutable lock_;
+	boost::condition_variable submit_waiter_;
+	boost::condition_variable done_waiter_;
+	boost::scoped_ptr<boost::thread> ring_thread_;
+
+};
+
+typedef boost::shared_ptr<io_uring_reader> io_uring_reader_ptr;
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -0,0 +1,129 @@
+#include "piece_cache.hpp"
+
+#include "file_info_buffer.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public piece_cache api
+ */
+
+piece_cache::piece_cache(std::size_t max_bytes) 
+	: lock_(), lru_(), stat_()
+{
+	stat_.pieces = stat_.bytes = 0;
+	stat_.max_bytes = max_bytes;
+	stat_.hits = stat_.misses = 0;
+}
+
+piece_cache::~piece_cache() 
+{
+	clear();
+}
+
+void piece_cache::insert(hc_file_info_ptr fi, hc_cached_piece_ptr piece) 
+{
+	/*  Pieces of the one file never overlap, so the piece at the same offset 
+	 	is the same piece verified again(eg after the recheck) */
+	BOOST_ASSERT(fi != NULL && piece != NULL);
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (stat_.max_bytes == 0 || piece->size == 0 || piece->size > stat_.max_bytes)
+		return;
+
+	pieces_type::iterator found = fi->cached_pieces.find(piece->offset);
+	if (found != fi->cached_pieces.end())
+		erase_unsafe(*fi, found);
+
+	lru_item const item = { fi, piece->offset, piece->size };
+	fi->cached_pieces[piece->offset] = std::make_pair(piece, lru_.insert(lru_.begin(), item));
+	++stat_.pieces;
+	stat_.bytes += piece->size;
+	evict_unsafe();
+}
+
+hc_cached_piece_ptr piece_cache::find(hc_file_info_ptr fi, boost::int64_t pos) 
+{
+	/* Hit moves the piece to the front of lru */
+	BOOST_ASSERT(fi != NULL);
+	boost::lock_guard<boost::mutex> guard(lock_);
+	if (stat_.max_bytes == 0)
+		return hc_cached_piece_ptr();
+
+	pieces_type::iterator found = fi->cached_pieces.upper_bound(pos);
+	if (found == fi->cached_pieces.begin() || pos >= (--found)->second.first->end()) {
+		++stat_.misses;
+		return hc_cached_piece_ptr();
+	} // if
+
+	++stat_.hits;
+	lru_.splice(lru_.begin(), lru_, found->second.second);
+	return found->second.first;
+}
+
+void piece_cache::invalidate(hc_file_info_ptr fi) 
+{
+	/* Readers which still own the piece continue to work with it */
+	BOOST_ASSERT(fi != NULL);
+	boost::lock_guard<boost::mutex> guard(lock_);
+	while (!fi->cached_pieces.empty())
+		erase_unsafe(*fi, fi->cached_pieces.begin());
+}
+
+void piece_cache::clear() 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	for (lru_type::iterator first = lru_.begin(), last = lru_.end(); 
+		first != last; 
+		++first) 
+	{
+		if (hc_file_info_ptr fi = first->fi.lock())
+			fi->cached_pieces.clear();
+	}
+	lru_.clear();
+	stat_.pieces = stat_.bytes = 0;
+}
+
+void piece_cache::set_max_bytes(std::size_t max_bytes) 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	stat_.max_bytes = max_bytes;
+	evict_unsafe();
+}
+
+piece_cache_stat piece_cache::get_stat() const 
+{
+	boost::lock_guard<boost::mutex> guard(lock_);
+	return stat_;
+}
+
+/**
+ * Private piece_cache api
+ */
+
+void piece_cache::erase_unsafe(hc_file_info & fi, pieces_type::iterator it) 
+{
+	--stat_.pieces;
+	stat_.bytes -= it->second.first->size;
+	lru_.erase(it->second.second);
+	fi.cached_pieces.erase(it);
+}
+
+void piece_cache::evict_unsafe() 
+{
+	/*  Piece of the file which already gone(removed without invalidate) 
+	 	still counted till it reach the end of lru */
+	while (stat_.bytes > stat_.max_bytes && !lru_.empty()) {
+		hc_file_info_ptr fi = lru_.back().fi.lock();
+		pieces_type::iterator found;
+		if (fi && (found = fi->cached_pieces.find(lru_.back().offset)) != fi->cached_pieces.end()) {
+			erase_unsafe(*fi, found);
+			continue;
+		} // if
+		--stat_.pieces;
+		stat_.bytes -= lru_.back().size;
+		lru_.pop_back();
+	} // while
+}
+
+} } // namespace t2h_core, details
+
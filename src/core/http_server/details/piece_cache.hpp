@@ -0,0 +1,87 @@
+#ifndef PIECE_CACHE_HPP_INCLUDED
+#define PIECE_CACHE_HPP_INCLUDED
+
+#include <map>
+#include <list>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/weak_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/shared_array.hpp>
+
+namespace t2h_core { namespace details {
+
+struct hc_file_info;
+
+/**
+ * hc_cached_piece part of the verified torrent piece which belongs to the file, held in memory.
+ * Bytes shared with the piece buffer of the torrent core, so the piece which overlaps several files stored once.
+ */
+struct hc_cached_piece : boost::noncopyable {
+	hc_cached_piece(boost::shared_array<char> const & buffer_, char const * data_, boost::int64_t offset_, std::size_t size_)
+		: buffer(buffer_), data(data_), offset(offset_), size(size_) { }
+
+	inline boost::int64_t end() const
+		{ return offset + (boost::int64_t)size; }
+
+	boost::shared_array<char> buffer;	// Whole piece
+	char const * data;					// First byte of the file part in the buffer
+	boost::int64_t offset;				// Offset of the part in the file
+	std::size_t size;					// Size of the part
+};
+
+typedef boost::shared_ptr<hc_cached_piece const> hc_cached_piece_ptr;
+
+/**
+ * piece_cache_stat counters of the piece cache
+ */
+struct piece_cache_stat {
+	std::size_t pieces;					// Count of cached pieces
+	std::size_t bytes;					// Bytes held by the cached pieces
+	std::size_t max_bytes;				// Limit of the cached bytes, 0 = cache off
+	boost::uint64_t hits;				// Reads served from memory
+	boost::uint64_t misses;				// Reads which went to the file
+};
+
+/**
+ * piece_cache LRU cache of the recently verified pieces, bounded by the bytes.
+ * Each cached piece attached to hc_file_info by its offset in the file,
+ * so readers of the live downloading file do not read back the pieces just written by the torrent core.
+ */
+class piece_cache : boost::noncopyable {
+public :
+	struct lru_item {
+		boost::weak_ptr<hc_file_info> fi;
+		boost::int64_t offset;
+		std::size_t size;
+	};
+	typedef std::list<lru_item> lru_type;
+	typedef std::map<boost::int64_t, std::pair<hc_cached_piece_ptr, lru_type::iterator> > pieces_type;
+
+	explicit piece_cache(std::size_t max_bytes);
+	~piece_cache();
+
+	void insert(boost::shared_ptr<hc_file_info> fi, hc_cached_piece_ptr piece);
+	/* Cached piece which contains the byte at pos, empty if there is no such piece */
+	hc_cached_piece_ptr find(boost::shared_ptr<hc_file_info> fi, boost::int64_t pos);
+	void invalidate(boost::shared_ptr<hc_file_info> fi);
+	void clear();
+
+	void set_max_bytes(std::size_t max_bytes);
+	piece_cache_stat get_stat() const;
+
+private :
+	void erase_unsafe(hc_file_info & fi, pieces_type::iterator it);
+	void evict_unsafe();
+
+	boost::mutex mutable lock_;
+	lru_type lru_;
+	piece_cache_stat stat_;
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -0,0 +1,164 @@
+#include "read_ahead_pipeline.hpp"
+
+#include "http_server_macroses.hpp"
+
+#include <boost/bind.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public read_ahead_pipeline api
+ */
+
+read_ahead_pipeline::read_ahead_pipeline(hc_file_handle_ptr file_handle, 
+	io_buffers_pool & buffers_pool, 
+	resume_pool & io_pool, 
+	std::size_t buffers) 
+	: file_handle_(file_handle), 
+	buffers_pool_(buffers_pool), 
+	io_pool_(io_pool), 
+	free_buffers_(buffers < 2 ? 2 : buffers), 
+	chunks_(), 
+	stop_(false), 
+	io_posted_(false), 
+	lock_(), 
+	ready_waiter_()
+{
+	BOOST_ASSERT(file_handle_ != NULL);
+}
+
+read_ahead_pipeline::~read_ahead_pipeline() 
+{
+	/*  Queued task must see the stop before the pipeline gone */
+	boost::mutex::scoped_lock guard(lock_);
+	stop_ = true;
+	while (io_posted_)
+		ready_waiter_.wait(guard);
+	reset_unsafe(guard);
+}
+
+bool read_ahead_pipeline::schedule(boost::int64_t offset, boost::int64_t bytes_size) 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return schedule_unsafe(offset, bytes_size);
+}
+
+char const * read_ahead_pipeline::take(boost::int64_t offset, boost::int64_t bytes_size, boost::int64_t & readed) 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (chunks_.empty() || chunks_.front().offset != offset) {
+		reset_unsafe(guard);
+		if (!schedule_unsafe(offset, bytes_size)) {
+			readed = -1;
+			return NULL;
+		}
+	} // if
+
+	while (chunks_.front().state != chunk_ready) {
+		if (io_posted_ || !read_pending_unsafe(guard))
+			ready_waiter_.wait(guard);
+	} // while
+	
+	readed = chunks_.front().readed;
+	return chunks_.front().buffer;
+}
+
+void read_ahead_pipeline::release() 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (!chunks_.empty() && chunks_.front().state == chunk_ready) {
+		buffers_pool_.release(chunks_.front().buffer);
+		chunks_.pop_front();
+		++free_buffers_;
+	}
+}
+
+std::size_t read_ahead_pipeline::free_buffers() const 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return free_buffers_;
+}
+
+boost::int64_t read_ahead_pipeline::scheduled_end() const 
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return chunks_.empty() ? -1 : chunks_.back().offset + chunks_.back().bytes_size;
+}
+
+/**
+ * Private read_ahead_pipeline api
+ */
+
+bool read_ahead_pipeline::schedule_unsafe(boost::int64_t offset, boost::int64_t bytes_size) 
+{
+	if (free_buffers_ == 0 || bytes_size > (boost::int64_t)buffers_pool_.buffer_size())
+		return false;
+	chunk const new_chunk = { offset, bytes_size, 0, buffers_pool_.acquire(), chunk_pending };
+	--free_buffers_;
+	chunks_.push_back(new_chunk);
+	if (!io_posted_) 
+		io_posted_ = io_pool_.post(boost::bind(&read_ahead_pipeline::io_task, this));
+	return true;
+}
+
+void read_ahead_pipeline::reset_unsafe(boost::mutex::scoped_lock & guard) 
+{
+	/*  Chunk could be in reading state(the IO thread own its buffer), 
+	 	so wait till all scheduled reads done, then drop them */
+	for (chunks_type::iterator first = chunks_.begin(), last = chunks_.end(); 
+		first != last; 
+		++first) 
+	{
+		while (first->state == chunk_reading)
+			ready_waiter_.wait(guard);
+		buffers_pool_.release(first->buffer);
+		++free_buffers_;
+	} // for
+	chunks_.clear();
+}
+
+bool read_ahead_pipeline::read_pending_unsafe(boost::mutex::scoped_lock & guard) 
+{
+	/*  Read the first pending chunk, false if there is none. 
+	 	Lock not held while reading, the chunk buffer owned by the reader in reading state */
+	chunks_type::iterator pending = chunks_.begin();
+	for (; pending != chunks_.end() && pending->state != chunk_pending; ++pending) 
+		{ /**/ }
+	if (pending == chunks_.end())
+		return false;
+		
+	pending->state = chunk_reading;
+	chunk reading = *pending;
+	guard.unlock();
+
+	reading.readed = file_handle_->read_at(reading.buffer, reading.bytes_size, reading.offset);
+	
+	guard.lock();
+	/*  deque iterators might be invalidated by push_back, find chunk by its buffer */
+	for (chunks_type::iterator first = chunks_.begin(), last = chunks_.end(); 
+		first != last; 
+		++first) 
+	{
+		if (first->buffer == reading.buffer && first->state == chunk_reading) {
+			first->readed = reading.readed;
+			first->state = chunk_ready;
+			break;
+		}
+	} // for
+	ready_waiter_.notify_all();
+	return true;
+}
+
+void read_ahead_pipeline::io_task() 
+{
+	/*  Read pending chunks in the order of scheduling till there are none, 
+	 	chunks scheduled after the task finished post the new one */
+	boost::mutex::scoped_lock guard(lock_);
+	while (!stop_ && read_pending_unsafe(guard))
+		{ /**/ }
+	io_posted_ = false;
+	ready_waiter_.notify_all();
+}
+
+} } // namespace t2h_core, details
+
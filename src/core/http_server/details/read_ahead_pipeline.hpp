@@ -0,0 +1,79 @@
+#ifndef READ_AHEAD_PIPELINE_HPP_INCLUDED
+#define READ_AHEAD_PIPELINE_HPP_INCLUDED
+
+#include "resume_pool.hpp"
+#include "io_buffers_pool.hpp"
+#include "file_handles_cache.hpp"
+
+#include <deque>
+#include <boost/thread.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * read_ahead_pipeline the IO stage of the chunked ostream.
+ * Reads of the scheduled chunks performed by the shared IO pool into the ring of buffers,
+ * so chunk N+1 readed from the disk while chunk N is writing to the socket.
+ * Each pipeline has at most one task in the pool, if the pool stopped chunks readed by the taker.
+ * Buffers taken from the io buffers pool on schedule and returned on release.
+ */
+class read_ahead_pipeline : boost::noncopyable {
+public :
+	read_ahead_pipeline(hc_file_handle_ptr file_handle, 
+		io_buffers_pool & buffers_pool, 
+		resume_pool & io_pool, 
+		std::size_t buffers);
+	~read_ahead_pipeline();
+	
+	/* Schedule read of chunk, false if all buffers in use */
+	bool schedule(boost::int64_t offset, boost::int64_t bytes_size);
+	
+	/* Wait for the head chunk and return its data, if the head does not start at offset 
+	 	pipeline reseted and the chunk(offset, bytes_size) scheduled. The head might be sized 
+		different than bytes_size, so caller must use readed. readed set to -1 in case of IO error */
+	char const * take(boost::int64_t offset, boost::int64_t bytes_size, boost::int64_t & readed);
+	/* Return buffer of the taken chunk back to the pipeline */
+	void release();
+	
+	std::size_t free_buffers() const;
+	/* End offset of the last scheduled chunk, or -1 if nothing scheduled */
+	boost::int64_t scheduled_end() const;
+
+private :
+	enum chunk_state { chunk_pending, chunk_reading, chunk_ready };
+
+	struct chunk {
+		boost::int64_t offset;
+		boost::int64_t bytes_size;
+		boost::int64_t readed;
+		char * buffer;
+		chunk_state state;
+	};
+	
+	typedef std::deque<chunk> chunks_type;
+
+	bool schedule_unsafe(boost::int64_t offset, boost::int64_t bytes_size);
+	void reset_unsafe(boost::mutex::scoped_lock & guard);
+	bool read_pending_unsafe(boost::mutex::scoped_lock & guard);
+	void io_task();
+
+	hc_file_handle_ptr file_handle_;
+	io_buffers_pool & buffers_pool_;
+	resume_pool & io_pool_;
+	std::size_t free_buffers_;
+	chunks_type chunks_;
+	bool stop_;
+	bool io_posted_;					// Task of the pipeline queued or running in the IO pool
+	boost::mutex mutable lock_;
+	boost::condition_variable ready_waiter_;
+
+};
+
+typedef boost::shared_ptr<read_ahead_pipeline> read_ahead_pipeline_ptr;
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -13,7 +13,7 @@ public :
 	head_reply();
 	~head_reply();
 	
-	virtual boost::tuple<std::string, bool> get_reply_headers(http_data & hd);
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers);
 
 }; 
 
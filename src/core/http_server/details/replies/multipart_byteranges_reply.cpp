@@ -0,0 +1,55 @@
+#include "multipart_byteranges_reply.hpp"
+
+#include "mime_types.hpp"
+#include "http_server_utility.hpp"
+
+#include <cstdio>
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public multipart_byteranges_reply api
+ */
+
+multipart_byteranges_reply::multipart_byteranges_reply() : http_core_reply() 
+{
+
+}
+
+multipart_byteranges_reply::~multipart_byteranges_reply() 
+{
+
+}
+
+bool multipart_byteranges_reply::get_reply_headers(http_data & hd, hc_reply_headers & headers) 
+{
+	/*  Boundary must be unique enough to not appear in the file bytes(time and address of the request data), 
+	 	Content-Length counts all part headers, bytes of ranges and the closing boundary */
+	char boundary[64] = { '\0' };
+	std::sprintf(boundary, "T2H_BYTERANGES_%08lx%08lx", (unsigned long)std::time(NULL), (unsigned long)&hd);
+	hd.multipart_boundary = boundary;
+
+	hc_reply_headers part;
+	multipart_closing(part, hd.multipart_boundary);
+	boost::int64_t content_size = part.size();
+	for (utility::byte_ranges_type::const_iterator first = hd.ranges.begin(), last = hd.ranges.end(); 
+		first != last; 
+		++first) 
+	{
+		part.clear();
+		multipart_part_header(part, hd.multipart_boundary, *first, hd.fi->file_size);
+		content_size += part.size();
+		content_size += (first->last - first->first) + 1;
+	} // for
+	
+	headers.append("HTTP/1.1 206 Partial-Content\r\n");
+	add_etag_date_headers(headers, hd);
+	headers.append("Content-Type: multipart/byteranges; boundary=").append(hd.multipart_boundary).append("\r\n"
+		"Accept-Ranges: bytes\r\n"
+		"Content-Length: ").append_int(content_size).append("\r\n\r\n");
+	
+	return true;
+}
+
+} } // namesapce t2h_core, details
+
@@ -0,0 +1,24 @@
+#ifndef MULTIPART_BYTERANGES_REPLY_HPP_INCLUDED
+#define MULTIPART_BYTERANGES_REPLY_HPP_INCLUDED
+
+#include "http_core_reply.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * multipart_byteranges_reply  
+ * Create 206(Partial-Content) multipart/byteranges http header for http_data::ranges,
+ * parts(part header + bytes of the range) written by the ostream policy.
+ */	
+class multipart_byteranges_reply : public http_core_reply {
+public :
+	multipart_byteranges_reply();
+	~multipart_byteranges_reply();
+	
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers);
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
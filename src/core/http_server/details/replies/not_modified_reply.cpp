@@ -0,0 +1,30 @@
+#include "not_modified_reply.hpp"
+
+#include "http_server_utility.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public not_modified_reply api
+ */
+
+not_modified_reply::not_modified_reply() : http_core_reply() 
+{
+}
+
+not_modified_reply::~not_modified_reply() 
+{
+}
+
+bool not_modified_reply::get_reply_headers(http_data & hd, hc_reply_headers & headers) 
+{
+	/*  NOTE : 304 must not contain a body, but must contain the same validators as 200 would */
+	headers.append("HTTP/1.1 304 Not Modified\r\n");
+	add_etag_date_headers(headers, hd);
+	headers.append("\r\n");
+	
+	return false;
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,23 @@
+#ifndef NOT_MODIFIED_REPLY_HPP_INCLUDED
+#define NOT_MODIFIED_REPLY_HPP_INCLUDED
+
+#include "http_core_reply.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * not_modified_reply  
+ * Create 304(Not Modified) http header, for conditional requests with the valid cached entity.
+ */	
+class not_modified_reply : public http_core_reply {
+public :
+	not_modified_reply();
+	~not_modified_reply();
+	
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers);
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -14,7 +14,7 @@ public :
 	partial_content_reply();
 	~partial_content_reply();
 	
-	virtual boost::tuple<std::string, bool> get_reply_headers(http_data & hd);
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers);
 };
 
 } } // namespace t2h_core, details
@@ -0,0 +1,30 @@
+#include "range_not_satisfiable_reply.hpp"
+
+#include "http_server_utility.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public range_not_satisfiable_reply api
+ */
+
+range_not_satisfiable_reply::range_not_satisfiable_reply() : http_core_reply() 
+{
+}
+
+range_not_satisfiable_reply::~range_not_satisfiable_reply() 
+{
+}
+
+bool range_not_satisfiable_reply::get_reply_headers(http_data & hd, hc_reply_headers & headers) 
+{
+	headers.append("HTTP/1.1 416 Requested Range Not Satisfiable\r\n");
+	add_etag_date_headers(headers, hd);
+	headers.append("Content-Range: bytes */").append_int(hd.fi->file_size);
+	headers.append("\r\nContent-Length: 0\r\n\r\n");
+	
+	return false;
+}
+
+} } // namespace t2h_core, details
+
@@ -0,0 +1,23 @@
+#ifndef RANGE_NOT_SATISFIABLE_REPLY_HPP_INCLUDED
+#define RANGE_NOT_SATISFIABLE_REPLY_HPP_INCLUDED
+
+#include "http_core_reply.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * range_not_satisfiable_reply  
+ * Create 416(Requested Range Not Satisfiable) http header.
+ */	
+class range_not_satisfiable_reply : public http_core_reply {
+public :
+	range_not_satisfiable_reply();
+	~range_not_satisfiable_reply();
+	
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers);
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -8,6 +8,9 @@
 #include "partial_content_reply.hpp"
 #include "head_reply.hpp"
 #include "send_content_reply.hpp"
+#include "multipart_byteranges_reply.hpp"
+#include "range_not_satisfiable_reply.hpp"
+#include "not_modified_reply.hpp"
 
 #endif
 
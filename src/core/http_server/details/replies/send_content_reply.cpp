@@ -19,20 +19,18 @@ send_content_reply::~send_content_reply()
 
 }
 
-boost::tuple<std::string, bool> send_content_reply::get_reply_headers(http_data & hd) 
+bool send_content_reply::get_reply_headers(http_data & hd, hc_reply_headers & headers) 
 {
-	std::string const gmt_time = utility::http_get_gmt_time_string();
-	
 	/*  NOTE : Prepare Etag, Date, Last-Modified headers. Must be in UTC, according to 
 	 	http://www.w3.org/Protocols/rfc2616/rfc2616-sec3.html#sec3.3.*/
-	std::string reply_headers = "HTTP/1.1 200 OK\r\n";
-	add_etag_date_headers(reply_headers, hd.fi);
-	reply_headers += "Content-Type: application/octet-stream\r\n";	
-	reply_headers += "Accept-Ranges: bytes\r\n";
-	reply_headers += "Content-Length: " + boost::lexical_cast<std::string>(hd.fi->file_size);
-	reply_headers += "\r\n\r\n";
+	headers.append("HTTP/1.1 200 OK\r\n");
+	add_etag_date_headers(headers, hd);
+	headers.append(
+		"Content-Type: application/octet-stream\r\n"
+		"Accept-Ranges: bytes\r\n"
+		"Content-Length: ").append_int(hd.fi->file_size).append("\r\n\r\n");
 	
-	return boost::make_tuple(reply_headers, true);
+	return true;
 }
 
 } } // namespace t2h_core, details
@@ -0,0 +1,30 @@
+#include "reply_headers.hpp"
+
+#include <boost/thread.hpp>
+
+namespace t2h_core { namespace details {
+
+namespace {
+
+/* Date of the current second, readers copy it under the lock(29 bytes), only one reader per second formats it */
+boost::mutex cached_date_lock;
+std::time_t cached_date_time = (std::time_t)-1;
+char cached_date[utility::http_gmt_time_size + 1] = { '\0' };
+std::size_t cached_date_size = 0;
+
+} // namespace
+
+std::size_t get_cached_http_date(char * out)
+{
+	std::time_t const now = std::time(NULL);
+	boost::lock_guard<boost::mutex> guard(cached_date_lock);
+	if (now != cached_date_time) {
+		cached_date_size = utility::http_format_gmt_time(now, cached_date);
+		cached_date_time = now;
+	} // if
+	std::memcpy(out, cached_date, cached_date_size + 1);
+	return cached_date_size;
+}
+
+} } // namespace t2h_core, details
+
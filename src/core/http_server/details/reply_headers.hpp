@@ -0,0 +1,86 @@
+#ifndef REPLY_HEADERS_HPP_INCLUDED
+#define REPLY_HEADERS_HPP_INCLUDED
+
+#include "http_utility.hpp"
+
+#include <ctime>
+#include <string>
+#include <cstring>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace t2h_core { namespace details {
+
+/* Current HTTP-date, formatted once per second and shared by all replies.
+ 	out must have at least utility::http_gmt_time_size + 1 bytes, returns size of the date */
+std::size_t get_cached_http_date(char * out);
+
+/**
+ * hc_reply_headers fixed size buffer of the reply headers, lives on the stack of the reply.
+ * Headers formatted in place : literals copied with the known size, integers and dates formatted
+ * without allocation. If headers do not fit to the buffer it marked as overflowed, such reply must not be sended.
+ */
+class hc_reply_headers : boost::noncopyable {
+public :
+	enum { capacity = 1024 };
+
+	hc_reply_headers() : size_(0), overflowed_(false) { buffer_[0] = '\0'; }
+
+	template <std::size_t Size>
+	inline hc_reply_headers & append(char const (&literal)[Size])
+		{ return append(literal, Size - 1); }
+
+	inline hc_reply_headers & append(std::string const & str)
+		{ return append(str.data(), str.size()); }
+
+	inline hc_reply_headers & append(char const * bytes, std::size_t bytes_size)
+	{
+		if (overflowed_ || size_ + bytes_size >= capacity) {
+			overflowed_ = true;
+			return *this;
+		}
+		std::memcpy(buffer_ + size_, bytes, bytes_size);
+		size_ += bytes_size;
+		buffer_[size_] = '\0';
+		return *this;
+	}
+
+	inline hc_reply_headers & append_int(boost::int64_t value)
+	{
+		char number[utility::http_int_max_size + 1];
+		return append(number, utility::http_format_int(value, number));
+	}
+
+	inline hc_reply_headers & append_date(std::time_t const & time)
+	{
+		char date[utility::http_gmt_time_size + 1];
+		return append(date, utility::http_format_gmt_time(time, date));
+	}
+
+	inline hc_reply_headers & append_current_date()
+	{
+		char date[utility::http_gmt_time_size + 1];
+		return append(date, get_cached_http_date(date));
+	}
+
+	inline void clear()
+		{ size_ = 0; overflowed_ = false; buffer_[0] = '\0'; }
+
+	inline char const * data() const
+		{ return buffer_; }
+	inline std::size_t size() const
+		{ return size_; }
+	inline bool is_overflowed() const
+		{ return overflowed_; }
+
+private :
+	char buffer_[capacity];
+	std::size_t size_;
+	bool overflowed_;
+
+};
+
+} } // namespace t2h_core, details
+
+#endif
+
@@ -0,0 +1,88 @@
+#include "resume_pool.hpp"
+
+#include "http_server_macroses.hpp"
+
+#include <boost/bind.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public resume_pool api
+ */
+
+resume_pool::resume_pool(std::size_t threads)
+	: lock_(), waiter_(), stop_(false), tasks_(), threads_()
+{
+	for (std::size_t it = 0; it < (threads == 0 ? 1 : threads); ++it)
+		threads_.push_back(boost::shared_ptr<boost::thread>(
+			new boost::thread(boost::bind(&resume_pool::worker_loop, this))));
+}
+
+resume_pool::~resume_pool()
+{
+	stop();
+}
+
+bool resume_pool::post(task_type task)
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (stop_)
+		return false;
+	tasks_.push_back(task);
+	guard.unlock();
+	waiter_.notify_one();
+	return true;
+}
+
+void resume_pool::stop()
+{
+	boost::mutex::scoped_lock guard(lock_);
+	if (stop_)
+		return;
+	stop_ = true;
+	guard.unlock();
+	waiter_.notify_all();
+	for (std::size_t it = 0; it < threads_.size(); ++it)
+		threads_[it]->join();
+}
+
+std::size_t resume_pool::pending() const
+{
+	boost::mutex::scoped_lock guard(lock_);
+	return tasks_.size();
+}
+
+/**
+ * Private resume_pool api
+ */
+
+void resume_pool::worker_loop()
+{
+	boost::mutex::scoped_lock guard(lock_);
+	for (;;) {
+		if (tasks_.empty()) {
+			if (stop_)
+				return;
+			waiter_.wait(guard);
+			continue;
+		} // if
+
+		task_type task;
+		task.swap(tasks_.front());
+		tasks_.pop_front();
+		guard.unlock();
+		try
+		{
+			task();
+		}
+		catch (std::exception const & expt)
+		{
+			HCORE_ERROR("resume of the parked request failed, with message '%s'", expt.what())
+		}
+		task.clear();
+		guard.lock();
+	} // for
+}
+
+} } // namespace t2h_core, details
+
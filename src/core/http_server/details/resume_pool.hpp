@@ -0,0 +1,50 @@
+#ifndef RESUME_POOL_HPP_INCLUDED
+#define RESUME_POOL_HPP_INCLUDED
+
+#include <deque>
+#include <vector>
+#include <boost/thread.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace t2h_core { namespace details {
+
+/**
+ * resume_pool small fixed pool of threads which continue parked requests.
+ * Tasks posted by the file_info_buffer notifications(and by the deadline wheel)
+ * and performed in FIFO order, so the notifier never does the request IO itself.
+ * The read ahead pipelines of all replies share the own pool of the same kind.
+ */
+class resume_pool : boost::noncopyable {
+public :
+	typedef boost::function<void ()> task_type;
+
+	explicit resume_pool(std::size_t threads);
+	~resume_pool();
+
+	/* Queue the task, false if the pool stopped */
+	bool post(task_type task);
+
+	/* Perform already queued tasks and join threads */
+	void stop();
+
+	std::size_t pending() const;
+
+private :
+	void worker_loop();
+
+	boost::mutex mutable lock_;
+	boost::condition_variable waiter_;
+	bool stop_;
+	std::deque<task_type> tasks_;
+	std::vector<boost::shared_ptr<boost::thread> > threads_;
+
+};
+
+typedef boost::shared_ptr<resume_pool> resume_pool_ptr;
+
+} } // namespace t2h_core, details
+
+#endif
+
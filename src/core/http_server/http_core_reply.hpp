@@ -1,11 +1,12 @@
 #ifndef HTTP_CORE_REPLY_HPP_INCLUDED
 #define HTTP_CORE_REPLY_HPP_INCLUDED
 
+#include "http_utility.hpp"
+#include "reply_headers.hpp"
 #include "file_info_buffer.hpp"
 
 #include <boost/cstdint.hpp>
 #include <boost/noncopyable.hpp>
-#include <boost/tuple/tuple.hpp>
 
 namespace t2h_core { namespace details {
 
@@ -18,6 +19,9 @@ struct http_data {
 
 	boost::int64_t read_start;					// Read start offset
 	boost::int64_t read_end;					// Read end offset
+
+	utility::byte_ranges_type ranges;			// Ranges of the multipart/byteranges reply(empty for the single range)
+	std::string multipart_boundary;				// Boundary of the multipart/byteranges reply(set by the reply)
 };
 
 /**
@@ -28,8 +32,8 @@ class http_core_reply : boost::noncopyable {
 public :
 	http_core_reply() : boost::noncopyable() { }
 	virtual ~http_core_reply() { }
-	/* std::string containt headers, bool means is need send content from file or not */
-	virtual boost::tuple<std::string, bool> get_reply_headers(http_data & hd) = 0;
+	/* Headers formatted to the buffer, true means is need send content from file or not */
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers) = 0;
 
 private :
 
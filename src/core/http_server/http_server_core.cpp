@@ -2,10 +2,15 @@
 
 #include "replies_types.hpp"
 #include "transport_types.hpp"
+#include "http_server_utility.hpp"
 #include "http_server_macroses.hpp"
+#include "core_seek_notification.hpp"
 #include "hs_chunked_ostream_impl.hpp"
+#include "core_notification_center.hpp"
 
 #include <ctime>
+#include <boost/bind.hpp>
+#include <boost/make_shared.hpp>
 
 #include <boost/filesystem.hpp>
 #include <boost/iostreams/operations.hpp>  
@@ -17,6 +22,9 @@
 
 //#define T2H_DEEP_DEBUG
 
+/* Tick of the egress wheel, in ms : delays of the egress shaper are 1..100 ms */
+#define HCORE_EGRESS_TICK_MS 10
+
 namespace t2h_core {
 
 /**
@@ -25,12 +33,15 @@ namespace t2h_core {
 
 inline static common::transport_config from_setting_manager(setting_manager_ptr setting_manager) 
 {
+	/*  min_workers above the workers just pins the pool size, transports clamp it */
 	common::transport_config const config = { 
 		setting_manager->get_value<std::string>("doc_root"),
 		setting_manager->get_value<std::string>("server_addr"),
 		setting_manager->get_value<std::string>("server_port"),
 		setting_manager->get_value<std::size_t>("workers"),
-		common::http_transport_event_handler_ptr()
+		common::http_transport_event_handler_ptr(),
+		setting_manager->get_value<std::size_t>("min_workers"),
+		setting_manager->get_value<std::size_t>("workers_idle_timeout")
 	};
 	
 	if (config.max_threads == 0)
@@ -45,7 +56,32 @@ inline static details::hsc_local_config hcs_from_setting_manager(setting_manager
 		setting_manager->get_value<std::string>("doc_root"),
 		true,
 		setting_manager->get_value<boost::int64_t>("hc_max_chunk_size"),
-		setting_manager->get_value<std::size_t>("cores_sync_timeout")
+		setting_manager->get_value<std::size_t>("cores_sync_timeout"),
+		setting_manager->get_value<bool>("hc_adaptive_chunk"),
+		setting_manager->get_value<boost::int64_t>("hc_min_chunk_size"),
+		setting_manager->get_value<bool>("hc_stream_as_avaliable"),
+		setting_manager->get_value<bool>("hc_zero_copy"),
+		setting_manager->get_value<std::size_t>("hc_max_cached_fds"),
+		setting_manager->get_value<bool>("hc_mmap_completed"),
+		setting_manager->get_value<bool>("hc_read_ahead"),
+		setting_manager->get_value<std::size_t>("hc_read_ahead_buffers"),
+		setting_manager->get_value<std::size_t>("hc_read_ahead_depth"),
+		setting_manager->get_value<std::size_t>("hc_read_ahead_threads"),
+		setting_manager->get_value<bool>("hc_io_uring"),
+		setting_manager->get_value<std::size_t>("hc_io_uring_entries"),
+		setting_manager->get_value<std::size_t>("hc_io_buffers_per_slab"),
+		setting_manager->get_value<std::size_t>("hc_io_max_free_slabs"),
+		setting_manager->get_value<std::string>("hc_transport"),
+		setting_manager->get_value<bool>("hc_park_stalled"),
+		setting_manager->get_value<std::size_t>("hc_resume_threads"),
+		setting_manager->get_value<std::size_t>("hc_piece_cache_size"),
+		setting_manager->get_value<std::size_t>("hc_block_cache_size"),
+		setting_manager->get_value<std::size_t>("hc_block_cache_block_size"),
+		setting_manager->get_value<std::size_t>("hc_egress_rate"),
+		setting_manager->get_value<std::size_t>("hc_egress_file_rate"),
+		setting_manager->get_value<std::size_t>("hc_egress_connection_rate"),
+		setting_manager->get_value<std::size_t>("hc_egress_quantum"),
+		setting_manager->get_value<bool>("hc_watermark_fast_path")
 	};
 
 	boost::system::error_code error;
@@ -58,6 +94,24 @@ inline static details::hsc_local_config hcs_from_setting_manager(setting_manager
 	if (hcsc.chunked_ostream && hcsc.max_chunk_size < 1000)
 		throw common::transport_exception("chunked ostream is enable but max_chunk_size value low for correct work");
 
+	if (hcsc.adaptive_chunk && (hcsc.min_chunk_size < 1000 || hcsc.min_chunk_size > hcsc.max_chunk_size))
+		throw common::transport_exception("adaptive chunk is enable but min_chunk_size value not in [1000, max_chunk_size]");
+
+	if (hcsc.transport != "mongoose" && hcsc.transport != "epoll")
+		throw common::transport_exception("invalid settings transport must be 'mongoose' or 'epoll'");
+
+	if (hcsc.block_cache_size > 0 && (hcsc.block_cache_block_size < 4096 || hcsc.block_cache_block_size > hcsc.block_cache_size))
+		throw common::transport_exception("block cache is enable but block_size value not in [4096, block_cache_size]");
+
+	if (hcsc.egress_quantum < 4096)
+		throw common::transport_exception("egress quantum value low for correct work(< 4096)");
+
+	if (hcsc.park_stalled && hcsc.resume_threads == 0)
+		throw common::transport_exception("parking of stalled requests is enable but resume_threads value is 0");
+
+	if (hcsc.read_ahead && hcsc.read_ahead_threads == 0)
+		throw common::transport_exception("read ahead is enable but read_ahead_threads value is 0");
+
 	return hcsc;
 } 
 
@@ -74,6 +128,13 @@ http_server_core::http_server_core(setting_manager_ptr setting_manager) :
 	setting_manager_(setting_manager),
 	cur_state_(),
 	file_info_buffer_(),
+	io_reader_(),
+	io_buffers_(),
+	deadlines_(),
+	resume_pool_(),
+	read_ahead_pool_(),
+	egress_(),
+	egress_deadlines_(),
 	local_config_()
 { 
 }  
@@ -96,8 +157,46 @@ bool http_server_core::launch_service()
 		
 		file_info_buffer_ = details::shared_file_info_buffer();
 		BOOST_ASSERT(file_info_buffer_ != NULL);
-
+		file_info_buffer_->set_max_cached_file_handles(local_config_.max_cached_fds);
+		file_info_buffer_->set_max_cached_piece_bytes(local_config_.piece_cache_size);
+		file_info_buffer_->set_block_cache_limits(local_config_.block_cache_size, local_config_.block_cache_block_size);
+		
+		io_buffers_.reset(new details::io_buffers_pool(
+			local_config_.max_chunk_size, local_config_.io_buffers_per_slab, local_config_.io_max_free_slabs));
+
+		/*  Deadlines of the all waiting requests served by the one wheel, parked requests 
+		 	continued by the resume pool(only if transport can suspend reply, see perform_reply) */
+		deadlines_.reset(new details::deadline_wheel());
+		if (local_config_.park_stalled)
+			resume_pool_.reset(new details::resume_pool(local_config_.resume_threads));
+		/* Read ahead of all replies performed by the bounded pool, not by the thread per reply */
+		if (local_config_.read_ahead)
+			read_ahead_pool_.reset(new details::resume_pool(local_config_.read_ahead_threads));
+		
+		/*  Shaper exists even without limits, so the limits could be set at runtime */
+		details::egress_limits const limits = { 
+			local_config_.egress_rate, local_config_.egress_file_rate, local_config_.egress_connection_rate };
+		egress_.reset(new details::egress_shaper(limits, local_config_.egress_quantum));
+		/*  Throttled parked requests wait for the budget on the own wheel, its tick is close to the shaper delays */
+		if (resume_pool_)
+			egress_deadlines_.reset(new details::deadline_wheel(details::deadline_wheel::default_slots, HCORE_EGRESS_TICK_MS));
+
+		if (local_config_.io_uring) {
+			io_reader_.reset(new details::io_uring_reader(local_config_.io_uring_entries));
+			if (!io_reader_->is_open()) 
+				io_reader_.reset();
+		} // if
+
+#if defined(USE_EPOLL_HTTP_TRANSPORT)
+		if (local_config_.transport == "epoll")
+			transport_.reset(new common::http_epoll_transport(tr_config));
+		else
+			transport_.reset(new common::http_mongoose_transport(tr_config));
+#else
+		if (local_config_.transport == "epoll")
+			HCORE_WARNING("epoll transport not avaliable on this platform, mongoose transport used")
 		transport_.reset(new common::http_mongoose_transport(tr_config));
+#endif // USE_EPOLL_HTTP_TRANSPORT
 		BOOST_ASSERT(transport_ != NULL);
 		
 		transport_->initialize();	
@@ -119,8 +218,48 @@ void http_server_core::stop_service()
 	{
 		if (cur_state_ == base_service::service_running) {
 			cur_state_ = base_service::service_stoped;
+#if defined(T2H_DEBUG)
+			details::piece_cache_stat const pieces = file_info_buffer_->get_piece_cache_stat();
+			HCORE_TRACE("piece cache : pieces '%lu', bytes '%lu' of '%lu', hits '%lu', misses '%lu'", 
+				(unsigned long)pieces.pieces, (unsigned long)pieces.bytes, (unsigned long)pieces.max_bytes, 
+				(unsigned long)pieces.hits, (unsigned long)pieces.misses)
+			details::block_cache_stat const blocks = file_info_buffer_->get_block_cache_stat();
+			HCORE_TRACE("block cache : blocks '%lu', bytes '%lu' of '%lu', hits '%lu', misses '%lu', evictions '%lu', pinned skips '%lu', coalesced '%lu'", 
+				(unsigned long)blocks.blocks, (unsigned long)blocks.bytes, (unsigned long)blocks.max_bytes, 
+				(unsigned long)blocks.hits, (unsigned long)blocks.misses, 
+				(unsigned long)blocks.evictions, (unsigned long)blocks.pinned_skips, (unsigned long)blocks.coalesced)
+#endif // T2H_DEBUG
 			file_info_buffer_->stop_graceful();
+			/* Throttled replies must not wait for the budget while the service stopping */
+			egress_->stop();
+			/* The file info buffer shared and outlives the core, so it must not hold pieces(blocks) for nobody */
+			file_info_buffer_->set_max_cached_piece_bytes(0);
+			file_info_buffer_->set_block_cache_limits(0, local_config_.block_cache_block_size);
+			/* Broken parked requests must give replies back before the transport stop */
+			if (resume_pool_)
+				resume_pool_->stop();
+#if defined(T2H_DEBUG)
+			common::transport_workers_stat const workers = transport_->get_workers_stat();
+			HCORE_TRACE("http workers : peak '%lu' of '%lu', dequeued '%lu', queue wait avg '%f' ms, max '%f' ms",
+				(unsigned long)workers.peak_threads, (unsigned long)workers.max_threads, (unsigned long)workers.dequeued, 
+				workers.dequeued ? workers.wait_ms_total / workers.dequeued : 0.0, workers.wait_ms_max)
+#endif // T2H_DEBUG
 			transport_->stop_connection();	
+			deadlines_->stop();
+			if (egress_deadlines_)
+				egress_deadlines_->stop();
+			if (read_ahead_pool_)
+				read_ahead_pool_->stop();
+			if (io_reader_) 
+				io_reader_->stop();
+#if defined(T2H_DEBUG)
+			details::egress_shaper_stat const egress = egress_->get_stat();
+			HCORE_TRACE("egress : replies '%lu', sended '%lu', throttled '%f' ms, starved '%f' ms", 
+				(unsigned long)egress.finished, (unsigned long)egress.bytes, egress.throttled_ms, egress.starved_ms)
+			details::io_buffers_pool_stat const stat = io_buffers_->get_stat();
+			HCORE_TRACE("io buffers pool : slabs '%lu', buffers '%lu', peak in use '%lu'", 
+				(unsigned long)stat.slabs, (unsigned long)stat.buffers, (unsigned long)stat.peak_in_use)
+#endif // T2H_DEBUG
 		}
 	}
 	catch (common::transport_exception const & expt) 
@@ -153,48 +292,123 @@ common::base_service::service_state http_server_core::get_service_state() const
 	return cur_state_;
 }
 
+details::io_buffers_pool_stat http_server_core::get_io_buffers_stat() const 
+{
+	if (!io_buffers_) {
+		details::io_buffers_pool_stat const empty = { 0, 0, 0, 0, 0, 0 };
+		return empty;
+	}
+	return io_buffers_->get_stat();
+}
+
+details::piece_cache_stat http_server_core::get_piece_cache_stat() const 
+{
+	if (!file_info_buffer_) {
+		details::piece_cache_stat const empty = { 0, 0, 0, 0, 0 };
+		return empty;
+	}
+	return file_info_buffer_->get_piece_cache_stat();
+}
+
+details::block_cache_stat http_server_core::get_block_cache_stat() const 
+{
+	if (!file_info_buffer_) {
+		details::block_cache_stat const empty = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+		return empty;
+	}
+	return file_info_buffer_->get_block_cache_stat();
+}
+
+common::transport_workers_stat http_server_core::get_workers_stat() const 
+{
+	if (!transport_) {
+		common::transport_workers_stat const empty = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+		return empty;
+	}
+	return transport_->get_workers_stat();
+}
+
+void http_server_core::set_egress_limits(details::egress_limits const & limits) 
+{
+	if (egress_)
+		egress_->set_limits(limits);
+}
+
+details::egress_shaper_stat http_server_core::get_egress_stat() const 
+{
+	if (!egress_) {
+		details::egress_shaper_stat const empty = { { 0, 0, 0 }, 0, 0, 0, 0, 0, 0 };
+		return empty;
+	}
+	return egress_->get_stat();
+}
+
 /**
  * Inherited http_server_core api
  */
 
-void http_server_core::on_partial_content_request(
-	common::base_transport_ostream_ptr ostream, std::string const & uri, utility::range_header const & range) 
+void http_server_core::on_partial_content_request(common::base_transport_ostream_ptr ostream, 
+	std::string const & uri, utility::range_header const & range, utility::conditional_header const & conditions) 
 {	
-	boost::int64_t start = range.bstart_1, end = range.bend_1;
-	std::string const req_path = local_config_.doc_root + uri;
-	details::hc_file_info_ptr fi = file_info_buffer_->get_info(req_path);
+	details::hc_file_info_ptr fi = find_file(uri);
 	
 	if (!fi) {
-		HCORE_WARNING("can not find path '%s' in buffer", req_path.c_str())
+		HCORE_WARNING("can not find file '%s' in buffer", uri.c_str())
 		return;
 	}
 	
-	if (range.bstart_1 == utility::range_header::all)
-		start = 0;
-	if (range.bend_1 == utility::range_header::all)
-		end = fi->file_size;
+	/*  If the client cached entity is still valid reply with 304, 
+	 	if the If-Range validator does not match the range ignored and whole content sent with 200 */
+	details::hc_file_validators const validators = file_info_buffer_->get_validators(fi);
+	details::http_data hdata = { fi, file_info_buffer_, 0, 0, utility::byte_ranges_type(), std::string() };
+	if (details::is_not_modified(validators, conditions)) {
+		details::not_modified_reply nmr;
+		if (!perform_reply(ostream, nmr, hdata))
+			HCORE_WARNING("send not modified reply to the client failed")
+		return;
+	} // if
+	if (!details::is_range_applicable(validators, conditions)) {
+		utility::conditional_header const no_conditions;
+		on_content_request(ostream, uri, no_conditions);
+		return;
+	} // if
+
+	/*  Ranges resolved against the file size(suffix/open ranges, merging), 
+	 	single range replied with 206, several ranges with 206 multipart/byteranges 
+		and if there are no satisfiable ranges with 416 */
+	details::partial_content_reply pcr;
+	details::multipart_byteranges_reply mbr;
+	details::range_not_satisfiable_reply rnsr;
+	details::http_core_reply * reply = &rnsr;
+	utility::byte_ranges_type ranges;
+	if (utility::http_resolve_ranges(range, fi->file_size, ranges)) {
+		hdata.read_start = ranges.front().first;
+		hdata.read_end = ranges.back().last;
+		if (ranges.size() > 1) {
+			hdata.ranges.swap(ranges);
+			reply = &mbr;
+		} else 
+			reply = &pcr;
+	} // if
 
 #if defined(T2H_DEEP_DEBUG)
-	HCORE_TRACE("range request perform : uri '%s', start range '%i', end range '%i', file size '%i'", 
-		uri.c_str(), start, end, fi->file_size)
+	HCORE_TRACE("range request perform : uri '%s', start range '%i', end range '%i', ranges '%u', file size '%i'", 
+		uri.c_str(), hdata.read_start, hdata.read_end, hdata.ranges.size(), fi->file_size)
 #endif // T2H_DEEP_DEBUG
 	
-	details::partial_content_reply pcr;
-	details::http_data hdata = { fi, file_info_buffer_, start, end };
-	details::chunked_ostream_ptr ostream_policy = get_ostream_policy(ostream);
-	int const sid = file_info_buffer_->registr_subscriber(fi, ostream_policy);
-	if (!ostream_policy->perform(pcr, hdata))
+	if (reply != &rnsr)
+		notify_seek(fi, hdata.read_start);
+	if (!perform_reply(ostream, *reply, hdata))
 		HCORE_WARNING("send partial content to the client failed")
-	file_info_buffer_->unregistr_subscriber(fi, sid);
 }
 
-void http_server_core::on_head_request(common::base_transport_ostream_ptr ostream, std::string const & uri) 
+void http_server_core::on_head_request(
+	common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions) 
 {
-	std::string const req_path = local_config_.doc_root + uri;
-	details::hc_file_info_ptr fi = file_info_buffer_->get_info(req_path);
+	details::hc_file_info_ptr fi = find_file(uri);
 
 	if (!fi) {
-		HCORE_WARNING("can not find path '%s' in buffer", req_path.c_str())
+		HCORE_WARNING("can not find file '%s' in buffer", uri.c_str())
 		return;
 	}
 	
@@ -203,21 +417,20 @@ void http_server_core::on_head_request(common::base_transport_ostream_ptr ostrea
 #endif // T2H_DEEP_DEBUG
 	
 	details::head_reply hr;
-	details::http_data hdata = { fi, file_info_buffer_, 0, fi->file_size };
-	details::chunked_ostream_ptr ostream_policy = get_ostream_policy(ostream);
-	int const sid = file_info_buffer_->registr_subscriber(fi, ostream_policy);
-	if (!ostream_policy->perform(hr, hdata))
+	details::not_modified_reply nmr;
+	details::http_data hdata = { fi, file_info_buffer_, 0, fi->file_size, utility::byte_ranges_type(), std::string() };
+	bool const not_modified = details::is_not_modified(file_info_buffer_->get_validators(fi), conditions);
+	if (!perform_reply(ostream, not_modified ? static_cast<details::http_core_reply &>(nmr) : hr, hdata))
 		HCORE_WARNING("send reply to the client failed")
-	file_info_buffer_->unregistr_subscriber(fi, sid);
 }
 
-void http_server_core::on_content_request(common::base_transport_ostream_ptr ostream, std::string const & uri) 
+void http_server_core::on_content_request(
+	common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions) 
 {
-	std::string const req_path = local_config_.doc_root + uri;
-	details::hc_file_info_ptr fi = file_info_buffer_->get_info(req_path);
+	details::hc_file_info_ptr fi = find_file(uri);
 
 	if (!fi) {
-		HCORE_WARNING("can not find path '%s' in buffer", req_path.c_str())
+		HCORE_WARNING("can not find file '%s' in buffer", uri.c_str())
 		return;
 	}
 
@@ -226,30 +439,122 @@ void http_server_core::on_content_request(common::base_transport_ostream_ptr ost
 #endif // T2H_DEEP_DEBUG
 	
 	details::send_content_reply scr;
-	details::http_data hdata = { fi, file_info_buffer_, 0, fi->file_size };
-	details::chunked_ostream_ptr ostream_policy = get_ostream_policy(ostream);
-	int const sid = file_info_buffer_->registr_subscriber(fi, ostream_policy);
-	if (!ostream_policy->perform(scr, hdata))
+	details::not_modified_reply nmr;
+	details::http_data hdata = { fi, file_info_buffer_, 0, fi->file_size, utility::byte_ranges_type(), std::string() };
+	bool const not_modified = details::is_not_modified(file_info_buffer_->get_validators(fi), conditions);
+	if (!perform_reply(ostream, not_modified ? static_cast<details::http_core_reply &>(nmr) : scr, hdata))
 		HCORE_WARNING("send reply to the client failed")
-	file_info_buffer_->unregistr_subscriber(fi, sid);
 }
 	
 /**
  * Private http_server_core api
  */
 
-details::chunked_ostream_ptr http_server_core::get_ostream_policy(common::base_transport_ostream_ptr tostream) 
+details::hc_file_info_ptr http_server_core::find_file(std::string const & uri) const 
+{
+	/*  File route(see utility::http_file_route) resolved by the torrent identity without the path lookup, 
+	 	other uri(and the route of the unknown file) looked up by the path for compatibility */
+	details::hc_torrent_id id;
+	int file_index = -1;
+	if (utility::http_parse_file_route(uri, id.bytes, file_index)) {
+		details::hc_file_info_ptr fi = file_info_buffer_->get_info(id, file_index);
+		if (fi)
+			return fi;
+	} // if
+	return file_info_buffer_->get_info(local_config_.doc_root + uri);
+}
+
+void http_server_core::notify_seek(details::hc_file_info_ptr fi, boost::int64_t offset) 
+{
+	/*  Torrent core downloads the file from its own position, so it must know about 
+	 	the request of bytes which are not downloaded yet, otherwise the request waits till the timeout */
+	if (file_info_buffer_->get_avaliable_end(fi, offset) > offset)
+		return;
+	
+	core_seek_notification_ptr seek_notification(new core_seek_notification());
+	seek_notification->file_path = fi->file_path;
+	seek_notification->offset = offset;
+	seek_notification->file_size = fi->file_size;
+	if (!core_notification_center()->send_message(core_seek_notification::receiver_name(), seek_notification))
+		HCORE_TRACE("seek notification for '%s' not delivered, torrent core not running", fi->file_path.c_str())
+}
+
+void http_server_core::notify_reading(std::string const & file_path, boost::int64_t offset, double bytes_per_sec) const
+{
+	/*  Torrent core sizes the download window ahead of the reader by its rate */
+	core_seek_notification_ptr reading_notification(new core_seek_notification());
+	reading_notification->event_type = core_seek_notification::reading;
+	reading_notification->file_path = file_path;
+	reading_notification->offset = offset;
+	reading_notification->bytes_per_sec = bytes_per_sec;
+	core_notification_center()->send_message(core_seek_notification::receiver_name(), reading_notification);
+}
+
+details::hs_chunked_ostream_params http_server_core::get_ostream_params() const 
+{
+	details::hs_chunked_ostream_params const hcsp = { 
+		local_config_.max_chunk_size, 
+		local_config_.cores_sync_timeout, 
+		local_config_.adaptive_chunk, 
+		local_config_.min_chunk_size, 
+		local_config_.stream_as_avaliable, 
+		local_config_.zero_copy, 
+		local_config_.mmap_completed, 
+		local_config_.read_ahead, 
+		local_config_.read_ahead_buffers, 
+		local_config_.read_ahead_depth, 
+		local_config_.watermark_fast_path, 
+		io_reader_, 
+		io_buffers_, 
+		deadlines_, 
+		resume_pool_, 
+		read_ahead_pool_, 
+		egress_, 
+		egress_deadlines_, 
+		boost::bind(&http_server_core::notify_reading, this, _1, _2, _3)
+	};
+	return hcsp;
+}
+
+details::chunked_ostream_ptr http_server_core::get_ostream_policy(
+	details::hc_request_arena & arena, common::base_transport_ostream_ptr tostream) 
 {
-	details::hs_chunked_ostream_params const hcsp = 
-		{ local_config_.max_chunk_size, local_config_.cores_sync_timeout };
 	details::http_server_ostream_policy_params const hsopp = { true };
+	details::chunked_ostream_ptr ostream_impl = boost::allocate_shared<details::hs_chunked_ostream_impl>(
+		utility::arena_allocator<details::hs_chunked_ostream_impl, details::hc_request_arena>(arena), 
+		hsopp, 
+		get_ostream_params());
+	ostream_impl->set_ostream(tostream);
 	
-	details::chunked_ostream_ptr ostream_impl;
-	ostream_impl.reset(new details::hs_chunked_ostream_impl(hsopp, hcsp));
+	return ostream_impl;
+}
+
+details::chunked_ostream_ptr http_server_core::get_parkable_ostream_policy(common::base_transport_ostream_ptr tostream) 
+{
+	details::http_server_ostream_policy_params const hsopp = { true };
+	details::chunked_ostream_ptr ostream_impl = 
+		boost::make_shared<details::hs_chunked_ostream_impl>(hsopp, get_ostream_params());
 	ostream_impl->set_ostream(tostream);
 	
 	return ostream_impl;
 }
 
+bool http_server_core::perform_reply(
+	common::base_transport_ostream_ptr ostream, details::http_core_reply & reply, details::http_data & hdata) 
+{
+	/*  The ostream policy allocated from the request arena, so it must be unregistered before return.
+	 	If the request could be parked the policy outlives the handler : it allocated from the heap and 
+		held by the file info subscribers till the parked request finished(unregistered by the policy itself) */
+	details::hc_request_arena arena;
+	details::chunked_ostream_ptr ostream_policy = (resume_pool_ && ostream->is_suspend_supported()) ? 
+		get_parkable_ostream_policy(ostream) : get_ostream_policy(arena, ostream);
+	file_info_buffer_->registr_subscriber(hdata.fi, ostream_policy);
+	bool const performed = ostream_policy->perform(reply, hdata);
+	if (!ostream_policy->is_suspended())
+		file_info_buffer_->unregistr_subscriber(hdata.fi, ostream_policy);
+	return performed;
+}
+
 } // namespace t2h_core
 
+#undef HCORE_EGRESS_TICK_MS
@@ -6,6 +6,7 @@
 #include "base_transport.hpp"
 #include "setting_manager.hpp"
 #include "transport_types.hpp"
+#include "request_arena.hpp"
 #include "base_chunked_ostream.hpp"
 #include "http_server_ostream_policy.hpp"
 
@@ -23,8 +24,36 @@ struct hsc_local_config {
 	bool chunked_ostream;								// on/off chunked ostream 
 	boost::int64_t max_chunk_size;						// max readed offset per transport IO
 	std::size_t cores_sync_timeout;						// filesystem cores timeout, in secs
+	bool adaptive_chunk;								// on/off chunk sizing by the client drain rate
+	boost::int64_t min_chunk_size;						// min readed offset per transport IO in adaptive mode
+	bool stream_as_avaliable;							// on/off sending of any new verified bytes without waiting the whole chunk
+	bool zero_copy;										// on/off zero-copy(sendfile) transfer of the file content
+	std::size_t max_cached_fds;							// max count of cached(shared between readers) file descriptors
+	bool mmap_completed;								// on/off serving of the completed files from memory mapping(if zero-copy not used)
+	bool read_ahead;									// on/off pipelined(dedicated IO thread) read of the next chunks
+	std::size_t read_ahead_buffers;						// count of buffers in the read ahead ring 
+	std::size_t read_ahead_depth;						// count of chunks hinted to the kernel beyond the ring
+	std::size_t read_ahead_threads;						// count of threads which read ahead chunks of all replies
+	bool io_uring;										// on/off batched file reads via io_uring(pread if not avaliable)
+	std::size_t io_uring_entries;						// size of the io_uring submission queue
+	std::size_t io_buffers_per_slab;					// count of chunk buffers allocated by the one pool slab
+	std::size_t io_max_free_slabs;						// count of totally free slabs kept by the pool, others returned to the heap
+	std::string transport;								// http transport : 'mongoose' or 'epoll'(Linux only)
+	bool park_stalled;									// on/off parking of the requests which wait for bytes(if transport can suspend reply)
+	std::size_t resume_threads;							// count of threads which continue parked requests
+	std::size_t piece_cache_size;						// max bytes of the recently verified pieces held in memory, 0 = off
+	std::size_t block_cache_size;						// max bytes of the file blocks shared between readers, 0 = off
+	std::size_t block_cache_block_size;					// size of the one shared file block
+	std::size_t egress_rate;							// max bytes per sec of the all replies content, 0 = unlimited
+	std::size_t egress_file_rate;						// max bytes per sec of the all replies of the one file, 0 = unlimited
+	std::size_t egress_connection_rate;					// max bytes per sec of the one reply, 0 = unlimited
+	std::size_t egress_quantum;							// max bytes which the shaper grants to the reply at once
+	bool watermark_fast_path;							// on/off waiting of the blocked readers on the torrent core watermark of the file
 };
 
+/* Per request arena for the request objects(ostream policy etc), lives on stack of the request handler */
+typedef utility::request_arena<2048> hc_request_arena;
+
 } // namespace details
 
 /**
@@ -53,18 +82,53 @@ public :
 	 { return shared_from_this(); }
 
 	/* Over HTTP headers operations. Inherited for common::http_transport_event_handler */
-	virtual void on_partial_content_request(
-		common::base_transport_ostream_ptr ostream, std::string const & uri, utility::range_header const & range);
-	virtual void on_head_request(common::base_transport_ostream_ptr ostream, std::string const & uri);
-	virtual void on_content_request(common::base_transport_ostream_ptr ostream, std::string const & uri);
+	virtual void on_partial_content_request(common::base_transport_ostream_ptr ostream, 
+		std::string const & uri, utility::range_header const & range, utility::conditional_header const & conditions);
+	virtual void on_head_request(
+		common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions);
+	virtual void on_content_request(
+		common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions);
+	
+	/* Occupancy of the chunk buffers pool */
+	details::io_buffers_pool_stat get_io_buffers_stat() const;
+
+	/* Size and hit rate of the verified pieces cache */
+	details::piece_cache_stat get_piece_cache_stat() const;
+
+	/* Size, hit rate and evictions of the shared file blocks cache */
+	details::block_cache_stat get_block_cache_stat() const;
+
+	/* Workers pool size, queue length and the queue wait time of the transport */
+	common::transport_workers_stat get_workers_stat() const;
+
+	/* Egress rate limits(bytes per sec, 0 = unlimited), could be changed while the service is running */
+	void set_egress_limits(details::egress_limits const & limits);
+	
+	/* Egress limits and the time which replies spent throttled(waiting for the budget) and starved(waiting for the bytes) */
+	details::egress_shaper_stat get_egress_stat() const;
 
 private :
-	details::chunked_ostream_ptr get_ostream_policy(common::base_transport_ostream_ptr tostream);
+	details::hc_file_info_ptr find_file(std::string const & uri) const;
+	void notify_seek(details::hc_file_info_ptr fi, boost::int64_t offset);
+	void notify_reading(std::string const & file_path, boost::int64_t offset, double bytes_per_sec) const;
+	details::hs_chunked_ostream_params get_ostream_params() const;
+	details::chunked_ostream_ptr get_ostream_policy(
+		details::hc_request_arena & arena, common::base_transport_ostream_ptr tostream);
+	details::chunked_ostream_ptr get_parkable_ostream_policy(common::base_transport_ostream_ptr tostream);
+	bool perform_reply(
+		common::base_transport_ostream_ptr ostream, details::http_core_reply & reply, details::http_data & hdata);
 
 	common::base_transport_ptr transport_;
 	setting_manager_ptr setting_manager_;
 	common::base_service::service_state volatile mutable cur_state_;
 	details::file_info_buffer_ptr file_info_buffer_;
+	details::io_uring_reader_ptr io_reader_;
+	details::io_buffers_pool_ptr io_buffers_;
+	details::deadline_wheel_ptr deadlines_;
+	details::resume_pool_ptr resume_pool_;
+	details::resume_pool_ptr read_ahead_pool_;
+	details::egress_shaper_ptr egress_;
+	details::deadline_wheel_ptr egress_deadlines_;
 	details::hsc_local_config local_config_;
 
 };
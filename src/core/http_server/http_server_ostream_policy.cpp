@@ -1,5 +1,7 @@
 #include "http_server_ostream_policy.hpp"
 
+#include "http_server_macroses.hpp"
+
 namespace t2h_core { namespace details {
 
 /**
@@ -7,7 +9,7 @@ namespace t2h_core { namespace details {
  */
 
 http_server_ostream_policy::http_server_ostream_policy(http_server_ostream_policy_params const & params) 
-	: ostream_impl_(), base_params_(params) 
+	: ostream_impl_(), base_params_(params), held_headers_(NULL), held_headers_size_(0) 
 { 
 
 }	
@@ -19,21 +21,72 @@ http_server_ostream_policy::~http_server_ostream_policy()
 
 bool http_server_ostream_policy::perform(http_core_reply & reply, http_data & hd) 
 {
-	std::string reply_headers;
-	bool is_need_perform_content = false, state = false;
+	/*  Headers formatted on the stack without allocations. If the reply has content, headers held 
+	 	till the first content write, so headers and the first chunk go to the client together 
+		(small ranges of the seeking players fit to one packet). Before any waiting for bytes 
+		write_content_impl flushes them itself, so the held headers never outlive this frame */
+	hc_reply_headers headers;
+	bool state = false;
 
 	if (ostream_impl_) {
-		boost::tie(reply_headers, is_need_perform_content) = reply.get_reply_headers(hd);	
-		state = (ostream_impl_->write(reply_headers.c_str(), reply_headers.size()) > 0);
-
-		if (is_need_perform_content && state)  
+		bool const is_need_perform_content = reply.get_reply_headers(hd, headers);	
+		if (headers.is_overflowed()) 
+			HCORE_WARNING("reply headers for '%s' too long", hd.fi->file_path.c_str())
+		else if (!is_need_perform_content)
+			state = (ostream_impl_->write(headers.data(), headers.size()) == headers.size());
+		else {
+			held_headers_ = headers.data();
+			held_headers_size_ = headers.size();
 			state = write_content_impl(hd);
+			if (held_headers_)
+				state = flush_headers() && state;
+		} // if
 	} // if
 	
+	if (!is_suspended())
+		end_of_io();
+
+	return state;
+}
+
+/**
+ * Protected http_server_ostream_policy api
+ */
+
+void http_server_ostream_policy::end_of_io() 
+{
 	if (base_params_.reset_stream_at_end_of_io)
 		ostream_impl_.reset();
+}
 
-	return state;
+std::size_t http_server_ostream_policy::write_body(char const * bytes, std::size_t bytes_size) 
+{
+	if (!held_headers_)
+		return ostream_impl_->write(bytes, bytes_size);
+	
+	char const * const head = held_headers_;
+	held_headers_ = NULL;
+	return ostream_impl_->write_gather(head, held_headers_size_, bytes, bytes_size);
+}
+
+std::size_t http_server_ostream_policy::write_body_file(int fd, boost::int64_t offset, std::size_t bytes_size) 
+{
+	if (!held_headers_)
+		return ostream_impl_->write_file(fd, offset, bytes_size);
+
+	char const * const head = held_headers_;
+	held_headers_ = NULL;
+	return ostream_impl_->write_file_gather(head, held_headers_size_, fd, offset, bytes_size);
+}
+
+bool http_server_ostream_policy::flush_headers() 
+{
+	if (!held_headers_)
+		return true;
+
+	char const * const head = held_headers_;
+	held_headers_ = NULL;
+	return (ostream_impl_->write(head, held_headers_size_) == held_headers_size_);
 }
 
 } } // namespace t2h_core, details
@@ -33,13 +33,27 @@ public :
 
 	bool perform(http_core_reply & reply, http_data & hd);
 
+	/* Content of the reply still writing after perform returned(see base_transport_ostream::suspend), 
+	 	policy finishes the reply itself */
+	virtual bool is_suspended() const 
+		{ return false; }
+
 protected :
 	virtual bool write_content_impl(http_data & hd) = 0;
+	void end_of_io();
+	
+	/* Content writes : the first one carries the held reply headers(see perform) */
+	std::size_t write_body(char const * bytes, std::size_t bytes_size);
+	std::size_t write_body_file(int fd, boost::int64_t offset, std::size_t bytes_size);
+	/* Send the held reply headers right away, must be called before any waiting in write_content_impl */
+	bool flush_headers();
 
 	common::base_transport_ostream_ptr ostream_impl_;
 
 private :
 	http_server_ostream_policy_params mutable base_params_;
+	char const * held_headers_;			// Reply headers not sended yet(points to the perform frame), NULL if sended
+	std::size_t held_headers_size_;
 
 };
 
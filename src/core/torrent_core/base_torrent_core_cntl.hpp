@@ -49,6 +49,10 @@ public :
 	virtual bool add_torrent(details::torrent_ex_info_ptr ex_info) = 0;
 	
 	virtual void dispatch_alert(libtorrent::alert * alert) = 0;
+	/* Client requested not downloaded bytes of the file from offset(called from the core loop thread) */
+	virtual void on_seek_request(std::string const & file_path, boost::int64_t offset) { }
+	/* Reader of the file is at offset and consumes bytes_per_sec(called from the core loop thread) */
+	virtual void on_reader_progress(std::string const & file_path, boost::int64_t offset, double bytes_per_sec) { }
 	virtual bool handle_with_critical_errors() { return false; }
 
 private :
@@ -0,0 +1,31 @@
+#include "seek_requests_receiver.hpp"
+
+namespace t2h_core { namespace details {
+
+/**
+ * Public seek_requests_receiver api
+ */
+seek_requests_receiver::seek_requests_receiver(std::string const & recv_name, seek_routine_type seek_routine) 
+	: common::notification_receiver(recv_name), seek_routine_(seek_routine) 
+{ 
+}
+
+seek_requests_receiver::~seek_requests_receiver() 
+{
+}
+	
+void seek_requests_receiver::on_notify(common::notification_ptr notification) 
+{
+	core_seek_notification_ptr seek_notification = common::notification_cast<core_seek_notification>(notification);
+	if (seek_notification) {
+		seek_routine_(seek_notification);
+		seek_notification->set_state(common::base_notification::done);
+	}
+}
+
+void seek_requests_receiver::on_notify_failed(common::notification_ptr notification, int reason) 
+{
+}
+
+} } // namespace t2h_core, details
+
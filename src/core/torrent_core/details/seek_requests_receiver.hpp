@@ -0,0 +1,31 @@
+#ifndef SEEK_REQUESTS_RECEIVER_HPP_INCLUDED
+#define SEEK_REQUESTS_RECEIVER_HPP_INCLUDED
+
+#include "notification_receiver.hpp"
+#include "core_seek_notification.hpp"
+
+#include <boost/function.hpp>
+
+namespace t2h_core { namespace details { 
+
+/**
+ * seek_requests_receiver, event receiver which passes seeks and reading progress of the http server core 
+ * readers to the torrent core 
+ */
+struct seek_requests_receiver : public common::notification_receiver {
+	typedef boost::function<void (core_seek_notification_ptr)> seek_routine_type;
+
+	seek_requests_receiver(std::string const & recv_name, seek_routine_type seek_routine);
+	~seek_requests_receiver();
+	
+	virtual void on_notify(common::notification_ptr notification);	
+	virtual void on_notify_failed(common::notification_ptr notification, int reason);
+
+	seek_routine_type seek_routine_;
+
+}; 
+
+} } // namespace t2h_core, details
+
+#endif
+
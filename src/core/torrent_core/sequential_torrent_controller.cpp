@@ -4,6 +4,8 @@
 #include "misc_utility.hpp"
 #include "torrent_core_utility.hpp"
 
+#include <algorithm>
+
 #include <libtorrent/file.hpp>
 #include <libtorrent/entry.hpp>
 #include <libtorrent/bencode.hpp>
@@ -36,6 +38,22 @@ static inline void log_state_update_alerts(libtorrent::torrent_status const & st
 		status.num_complete)
 }
 
+/* Search the file in all torrents of the shared buffer */
+struct file_info_search_f {
+	file_info_search_f(std::string const & path_, torrent_ex_info_ptr & ex_info_, file_info_ptr & info_) 
+		: path(path_), ex_info(ex_info_), info(info_) { }
+
+	inline void operator()(shared_buffer::torrents_type::value_type const & torrent) 
+	{
+		if (!info && (info = file_info_search(torrent.second->avaliables_files, path)))
+			ex_info = torrent.second;
+	}
+	
+	std::string const & path;
+	torrent_ex_info_ptr & ex_info;
+	file_info_ptr & info;
+};
+
 } // namespace details
 
 /**
@@ -142,6 +160,8 @@ void sequential_torrent_controller::dispatch_alert(libtorrent::alert * alert)
 		on_finished(tor_finised_alert);
 	if (piece_finished_alert * piece_fin_alert = alert_cast<piece_finished_alert>(alert)) 
 		on_piece_finished(piece_fin_alert);
+	if (read_piece_alert * read_alert = alert_cast<read_piece_alert>(alert)) 
+		on_read_piece(read_alert);
 	if (state_changed_alert * state_ched_alert = alert_cast<state_changed_alert>(alert))  
 		on_state_change(state_ched_alert);
 	if (torrent_deleted_alert * deleted_alert = alert_cast<torrent_deleted_alert>(alert)) 
@@ -152,6 +172,58 @@ void sequential_torrent_controller::dispatch_alert(libtorrent::alert * alert)
 		on_tracker_error(te_alert);
 }
 
+void sequential_torrent_controller::on_seek_request(std::string const & file_path, boost::int64_t offset) 
+{
+	/*  Move the high priority window to the pieces at the requested offset : libtorrent requests 
+	 	pieces with deadlines first(and from the fastest peers), so the sequential download continues from here. 
+		Short reads near the end of the file are players probes(index, moov atom), they must not move the window */
+	details::file_info_ptr info;
+	details::torrent_ex_info_ptr ex_info;
+	details::for_each(*shared_buffer_ref_, details::file_info_search_f(file_path, ex_info, info));
+	if (!info) {
+		TCORE_WARNING("seek failed, can not find file '%s'", file_path.c_str())
+		return;
+	} // if
+
+	if (offset < 0 || offset >= info->size || info->size - offset <= settings_.seek_probe_bytes) {
+#if defined(T2H_DEEP_DEBUG)
+		TCORE_TRACE("seek to the '%i' of the file '%s' ignored(probe)", (int)offset, file_path.c_str())
+#endif // T2H_DEEP_DEBUG
+		return;
+	} // if
+	
+	move_deadline_window(ex_info, info, offset, settings_.seek_window_pieces, 0.0);
+	TCORE_TRACE("seek of the file '%s', pieces from '%i' to '%i' got deadlines", 
+		file_path.c_str(), info->deadline_window_first, info->deadline_window_last)
+}
+
+void sequential_torrent_controller::on_reader_progress(
+	std::string const & file_path, boost::int64_t offset, double bytes_per_sec) 
+{
+	/*  Reader consumes the file with the playback rate, so it needs only the pieces it reaches in the 
+	 	next read_ahead_secs seconds, each one before the playback gets there. Slow readers(low bitrate) 
+		leave the bandwidth to others, fast readers(or readers after the seek) get the wider window */
+	if (settings_.read_ahead_secs <= 0 || bytes_per_sec <= 0.0)
+		return;
+
+	details::file_info_ptr info;
+	details::torrent_ex_info_ptr ex_info;
+	details::for_each(*shared_buffer_ref_, details::file_info_search_f(file_path, ex_info, info));
+	if (!info || offset < 0 || offset >= info->size)
+		return;
+
+	libtorrent::torrent_info const & ti = ex_info->handle.get_torrent_info();
+	double const window_pieces = bytes_per_sec * settings_.read_ahead_secs / ti.piece_length() + 1.0;
+	int const pieces = (window_pieces < settings_.read_ahead_max_pieces) ? 
+		static_cast<int>(window_pieces) : settings_.read_ahead_max_pieces;
+	move_deadline_window(ex_info, info, offset, pieces, bytes_per_sec);
+
+#if defined(T2H_DEEP_DEBUG)
+	TCORE_TRACE("reader of the file '%s' at '%i', rate '%f' bytes/s, pieces from '%i' to '%i' got deadlines", 
+		file_path.c_str(), (int)offset, bytes_per_sec, info->deadline_window_first, info->deadline_window_last)
+#endif // T2H_DEEP_DEBUG
+}
+
 void sequential_torrent_controller::setup_torrent(libtorrent::torrent_handle & handle) 
 {
 	if (settings_.partial_files_download) {
@@ -179,6 +251,102 @@ void sequential_torrent_controller::setup_torrent(libtorrent::torrent_handle & h
 #endif
 }
 
+void sequential_torrent_controller::move_deadline_window(details::torrent_ex_info_ptr ex_info, 
+	details::file_info_ptr info, 
+	boost::int64_t offset, 
+	int pieces, 
+	double bytes_per_sec) 
+{
+	/*  Deadline of each piece is the time the reader needs to get there with its rate(but not 
+	 	later than the read ahead horizon), without rate(seek) pieces just get growing deadlines. 
+		Deadlines of the previous window of the file(which out of the new one) dropped */
+	libtorrent::torrent_handle & handle = ex_info->handle;
+	libtorrent::torrent_info const & ti = handle.get_torrent_info();
+	boost::int64_t const reader_pos = ti.file_at(info->file_index).offset + offset;
+	int const first_piece = ti.map_file(info->file_index, offset, 0).piece;
+	int const last_piece = (std::min)(first_piece + pieces - 1, info->pieces_range_last);
+	int const horizon_ms = (std::max)(settings_.read_ahead_secs, 1) * 1000;
+
+	if (info->deadline_window_first >= 0) {
+		for (int piece = info->deadline_window_first; piece <= info->deadline_window_last; ++piece) {
+			if (piece < first_piece || piece > last_piece)
+				handle.reset_piece_deadline(piece);
+		} // for
+	} // if
+
+	for (int piece = first_piece, nth = 1; piece <= last_piece; ++piece, ++nth) {
+		if (handle.have_piece(piece))
+			continue;
+		int deadline = settings_.seek_deadline * nth;
+		if (bytes_per_sec > 0.0) {
+			double const ahead_ms = 
+				(static_cast<boost::int64_t>(piece) * ti.piece_length() - reader_pos) * 1000.0 / bytes_per_sec;
+			deadline = (ahead_ms < horizon_ms) ? static_cast<int>(ahead_ms) : horizon_ms;
+			deadline = (std::max)(deadline, settings_.seek_deadline);
+		} // if
+		handle.set_piece_deadline(piece, deadline);
+	} // for
+	info->deadline_window_first = first_piece;
+	info->deadline_window_last = last_piece;
+	info->reader_seen = utility::get_current_time();
+}
+
+void sequential_torrent_controller::expire_deadline_windows(details::torrent_ex_info_ptr ex_info) 
+{
+	/* Reader gone(player closed, paused for a long time), its pieces must not hold the bandwidth */
+	boost::posix_time::time_duration const now = utility::get_current_time();
+	for (details::file_info::list_type::const_iterator first = ex_info->avaliables_files.begin(), 
+			last = ex_info->avaliables_files.end();
+		first != last; 
+		++first) 
+	{
+		details::file_info_ptr info = *first;
+		if (info->deadline_window_first < 0 || 
+			now - info->reader_seen < boost::posix_time::seconds(settings_.reader_idle_timeout))
+			continue;
+		for (int piece = info->deadline_window_first; piece <= info->deadline_window_last; ++piece)
+			ex_info->handle.reset_piece_deadline(piece);
+		info->deadline_window_first = info->deadline_window_last = -1;
+	} // for
+}
+
+void sequential_torrent_controller::publish_finished_piece(details::torrent_ex_info_ptr ex_info, 
+	libtorrent::torrent_handle & handle, 
+	int piece_index) 
+{
+	/*  Piece verified, so its bytes could be served right away even if the sequential prefix 
+	 	is far behind(seek). Watermark wakes the blocked readers at once, the notification keeps 
+		the http core state */
+	publish_piece_ranges(ex_info, handle, piece_index, boost::shared_array<char>());
+	details::file_info_ptr const info = details::file_info_update(ex_info->avaliables_files, handle, piece_index);
+	if (info) {
+		boost::int64_t const avaliable_bytes = (info->avaliable_bytes > info->size) ? info->size : info->avaliable_bytes;
+		if (info->watermark)
+			info->watermark->publish(avaliable_bytes);
+		event_handler_->on_progress_update(info->path, avaliable_bytes);
+	} // if
+}
+
+void sequential_torrent_controller::publish_piece_ranges(details::torrent_ex_info_ptr ex_info, 
+	libtorrent::torrent_handle & handle, 
+	int piece_index, 
+	boost::shared_array<char> const & piece) 
+{
+	/*  Piece could overlap a few files, each file gets own part. Range which is already 
+	 	avaliable only attaches the bytes to the http core piece cache */
+	details::file_info_ptr info;
+	libtorrent::torrent_info const & ti = handle.get_torrent_info();
+	std::vector<libtorrent::file_slice> const slices = ti.map_block(piece_index, 0, ti.piece_size(piece_index));
+	std::size_t piece_offset = 0;
+	for (std::vector<libtorrent::file_slice>::const_iterator first = slices.begin(), last = slices.end();
+		first != last; 
+		piece_offset += first->size, ++first) 
+	{
+		if ((info = details::file_info_search_by_index(ex_info->avaliables_files, first->file_index)))
+			event_handler_->on_range_verified(info->path, first->offset, first->size, piece, piece_offset);
+	} // for
+}
+
 void sequential_torrent_controller::update_settings() 
 {
 	/* Just get all settings from the settings manager */
@@ -194,6 +362,17 @@ void sequential_torrent_controller::update_settings()
 	settings_.max_connections_per_torrent = setting_manager_->get_value<std::size_t>("tc_max_connections_per_torrent");
 	settings_.partial_files_download = setting_manager_->get_value<bool>("tc_partial_files_download");
 	settings_.futures_timeouts.torrent_add_timeout = setting_manager_->get_value<std::size_t>("tc_futures_timeout");
+	settings_.seek_window_pieces = setting_manager_->get_value<int>("tc_seek_window_pieces");
+	settings_.seek_deadline = setting_manager_->get_value<int>("tc_seek_deadline");
+	settings_.seek_probe_bytes = setting_manager_->get_value<boost::int64_t>("tc_seek_probe_bytes");
+	settings_.read_ahead_secs = setting_manager_->get_value<int>("tc_read_ahead_secs");
+	settings_.read_ahead_max_pieces = setting_manager_->get_value<int>("tc_read_ahead_max_pieces");
+	settings_.reader_idle_timeout = setting_manager_->get_value<std::size_t>("tc_reader_idle_timeout");
+	settings_.read_finished_pieces = setting_manager_->get_value<std::size_t>("hc_piece_cache_size") > 0;
+	if (settings_.seek_window_pieces <= 0)
+		settings_.seek_window_pieces = 1;
+	if (settings_.read_ahead_max_pieces <= 0)
+		settings_.read_ahead_max_pieces = 1;
 }
 
 /**
@@ -253,6 +432,7 @@ void sequential_torrent_controller::on_add_torrent(libtorrent::add_torrent_alert
 	
 	int index = 0;
 	torrent_info const & ti = handle.get_torrent_info();
+	std::string const info_hash = libtorrent::to_hex(ti.info_hash().to_string());
 	for (torrent_info::file_iterator first = ti.begin_files(); 
 		first != ti.end_files(); 
 		++first, ++index) 
@@ -264,7 +444,8 @@ void sequential_torrent_controller::on_add_torrent(libtorrent::add_torrent_alert
 				handle, 
 				index,
 				settings_.max_partial_download_size);
-		event_handler_->on_file_add(fi->path, fi->size);
+		fi->watermark = core_watermarks().acquire(fi->path);
+		event_handler_->on_file_add(fi->path, fi->size, info_hash, index);
 	} // for
 	
 	details::scoped_future_release future_release(ex_info->future);	
@@ -327,6 +508,7 @@ void sequential_torrent_controller::on_update(libtorrent::state_update_alert * a
 			details::lookup_error lookuper(ex_info, *it);
 		}
 
+		expire_deadline_windows(ex_info);
 		on_torrent_status_changes(ex_info);	
 	} // for
 }
@@ -344,8 +526,6 @@ void sequential_torrent_controller::on_torrent_status_changes(details::torrent_e
 void sequential_torrent_controller::on_piece_finished(libtorrent::piece_finished_alert * alert) 
 {
 	// TODO may be in case of failure better way it resresh torrent not remove?
-	details::file_info_ptr info;
-
 	details::torrent_ex_info_ptr ex_info = shared_buffer_ref_->get(alert->handle.save_path());
 	if (!ex_info) {
 		TCORE_WARNING("get extended info failed, args '%s', '%i'", 
@@ -354,10 +534,29 @@ void sequential_torrent_controller::on_piece_finished(libtorrent::piece_finished
 		return;
 	} // if
 	
-	info = details::file_info_update(ex_info->avaliables_files, alert->handle, alert->piece_index);
-	if (info)  
-		event_handler_->on_progress_update(info->path, 
-			(info->avaliable_bytes > info->size) ? info->size : info->avaliable_bytes);
+	/*  Piece published at once, the readers must not wait for the disk read of it. With the piece cache 
+	 	its bytes readed back(mostly from the libtorrent disk cache) and attached later(see on_read_piece) */
+	publish_finished_piece(ex_info, alert->handle, alert->piece_index);
+	if (settings_.read_finished_pieces)
+		alert->handle.read_piece(alert->piece_index);
+}
+
+void sequential_torrent_controller::on_read_piece(libtorrent::read_piece_alert * alert) 
+{
+	details::torrent_ex_info_ptr ex_info = shared_buffer_ref_->get(alert->handle.save_path());
+	if (!ex_info) {
+		TCORE_WARNING("get extended info failed, args '%s', '%i'", 
+			alert->handle.save_path().c_str(), alert->piece)
+		return;
+	} // if
+
+	/* Piece already published by the on_piece_finished, so only its bytes go to the cache */
+	libtorrent::torrent_info const & ti = alert->handle.get_torrent_info();
+	if (!alert->buffer || alert->size != ti.piece_size(alert->piece)) {
+		TCORE_WARNING("read of the finished piece '%i' failed, piece not cached", alert->piece)
+		return;
+	} // if
+	publish_piece_ranges(ex_info, alert->handle, alert->piece, alert->buffer);
 }
 
 void sequential_torrent_controller::on_file_complete(libtorrent::file_completed_alert * alert)
@@ -374,6 +573,8 @@ void sequential_torrent_controller::on_file_complete(libtorrent::file_completed_
 	// add update file_info
 	info = details::file_info_search_by_index(ex_info->avaliables_files, alert->index);
 	if (info) { 
+		if (info->watermark)
+			info->watermark->publish(info->size);
 		event_handler_->on_file_complete(info->path, info->size);
 		details::file_info_reinit(info);
 	}
@@ -392,6 +593,7 @@ void sequential_torrent_controller::on_deleted(libtorrent::torrent_deleted_alert
 			first != last; 
 			++first) 
 		{
+			core_watermarks().release((*first)->path);
 			event_handler_->on_file_remove((*first)->path);
 		} // for
 		shared_buffer_ref_->remove(alert->handle.save_path());
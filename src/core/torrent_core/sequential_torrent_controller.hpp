@@ -29,6 +29,13 @@ struct static_settings {
 	int upload_limit;								// Unpload rate limit 0 = unlimit, in kb
 	int max_uploads;								// Max upload limit
 	int max_connections_per_torrent;				// Max allow connection per torrent
+	int seek_window_pieces;							// Count of pieces which get deadlines after the seek
+	int seek_deadline;								// Deadline of the first piece after the seek(next pieces get N * deadline), in ms
+	boost::int64_t seek_probe_bytes;				// Requests which start so close to the end of the file are probes, not seeks
+	int read_ahead_secs;							// Seconds of the playback which get deadlines ahead of the reader, 0 = off
+	int read_ahead_max_pieces;						// Upper limit of the read ahead window, in pieces
+	std::size_t reader_idle_timeout;				// Deadlines of the file dropped then its reader silent so long, in seconds
+	bool read_finished_pieces;						// Finished pieces readed back(after the publish) for the http core piece cache(hc_piece_cache_size > 0)
 	struct {
 		std::size_t torrent_add_timeout;		 	// Torrent add promise timeout, in seconds
 	} futures_timeouts;
@@ -54,6 +61,8 @@ public :
 	virtual void set_shared_buffer(details::shared_buffer * buffer_ref);
 	virtual bool add_torrent(details::torrent_ex_info_ptr ex_info);
 	virtual void dispatch_alert(libtorrent::alert * alert);
+	virtual void on_seek_request(std::string const & file_path, boost::int64_t offset);
+	virtual void on_reader_progress(std::string const & file_path, boost::int64_t offset, double bytes_per_sec);
 
 private :
 	
@@ -64,6 +73,7 @@ private :
 	void on_pause(libtorrent::torrent_paused_alert * alert);
 	void on_update(libtorrent::state_update_alert * alert);
 	void on_piece_finished(libtorrent::piece_finished_alert * alert);	
+	void on_read_piece(libtorrent::read_piece_alert * alert);
 	void on_file_complete(libtorrent::file_completed_alert * alert);
 	void on_deleted(libtorrent::torrent_deleted_alert * alert);
 	void on_state_change(libtorrent::state_changed_alert * alert);	
@@ -74,6 +84,19 @@ private :
 
 	/** Others funtions */	
 	void setup_torrent(libtorrent::torrent_handle & handle);
+	void move_deadline_window(details::torrent_ex_info_ptr ex_info, 
+		details::file_info_ptr info, 
+		boost::int64_t offset, 
+		int pieces, 
+		double bytes_per_sec);
+	void expire_deadline_windows(details::torrent_ex_info_ptr ex_info);
+	void publish_finished_piece(details::torrent_ex_info_ptr ex_info, 
+		libtorrent::torrent_handle & handle, 
+		int piece_index);
+	void publish_piece_ranges(details::torrent_ex_info_ptr ex_info, 
+		libtorrent::torrent_handle & handle, 
+		int piece_index, 
+		boost::shared_array<char> const & piece);
 	void update_settings();
 	void torrent_remove(libtorrent::torrent_handle & handle);
 
@@ -1,8 +1,11 @@
 #include "core_version.hpp"
 #include "torrent_core.hpp"
 #include "misc_utility.hpp"
+#include "http_utility.hpp"
 #include "torrent_core_macros.hpp"
 #include "torrent_core_utility.hpp"
+#include "seek_requests_receiver.hpp"
+#include "core_notification_center.hpp"
 
 #include <libtorrent/file.hpp>
 #include <libtorrent/entry.hpp>
@@ -25,7 +28,10 @@ torrent_core::torrent_core(torrent_core_params const & params) :
 		core_lock_(),
 		shared_buffer_(NULL),
 		core_session_(NULL),
-		core_session_loop_()
+		core_session_loop_(),
+		seeks_lock_(),
+		seeks_(),
+		seek_receiver_()
 {
 }
 
@@ -72,6 +78,10 @@ bool torrent_core::launch_service()
 		
 		cur_state_ = base_service::service_running;
 		core_session_loop_.reset(new boost::thread(&torrent_core::core_main_loop, this));
+		
+		seek_receiver_.reset(new details::seek_requests_receiver(core_seek_notification::receiver_name(), 
+			boost::bind(&torrent_core::on_seek_request, this, _1)));
+		core_notification_center()->add_notification_receiver(seek_receiver_);
 	}
 	catch (libtorrent::libtorrent_exception const & expt) 
 	{
@@ -86,7 +96,12 @@ bool torrent_core::launch_service()
 void torrent_core::stop_service() 
 {
 	/** Stop core_session_ subsytems, then core_session_ main loop. 
-		NOTE: To stop all 'trackers' session need to call dtor of core_session_ */
+		NOTE: To stop all 'trackers' session need to call dtor of core_session_.
+		Seek receiver removed first(without lock), removing waits till its thread gone */
+	if (seek_receiver_) {
+		core_notification_center()->remove_notification_receiver(seek_receiver_->get_name());
+		seek_receiver_.reset();
+	}
 	boost::lock_guard<boost::mutex> guard(core_lock_);
 	if (cur_state_ == base_service::service_running) {
 		if (settings_.loadable_session) 
@@ -259,6 +274,30 @@ std::string torrent_core::start_torrent_download(torrent_core::size_type torrent
 	return std::string();
 }
 
+std::string torrent_core::get_file_route(torrent_core::size_type torrent_id, int file_id) const 
+{
+	/** Route made of the same info hash and file index as the http server gets with the file add */
+	LIBTORRENT_EXCEPTION_SAFE_BEGIN	
+	
+	boost::lock_guard<boost::mutex> guard(core_lock_);
+
+	if (cur_state_ != base_service::service_running) {
+		TCORE_WARNING("get file route by id "SL_SIZE_T" failed torrent core not runing", torrent_id)
+		return std::string();
+	}
+	
+	details::torrent_ex_info_ptr ex_info = shared_buffer_->get(torrent_id);
+	if (ex_info) {
+		libtorrent::torrent_info const & info = ex_info->handle.get_torrent_info();
+		if (info.num_files() > file_id && file_id >= 0) 
+			return utility::http_file_route(libtorrent::to_hex(info.info_hash().to_string()), file_id);
+	} // if
+
+	LIBTORRENT_EXCEPTION_SAFE_END
+	
+	return std::string();
+}
+
 void torrent_core::pause_download(torrent_core::size_type torrent_id, int file_id) 
 {		
 	/** To pause download just set off prior to req. file, 
@@ -459,10 +498,9 @@ void torrent_core::core_main_loop()
 	{
 		LIBTORRENT_EXCEPTION_SAFE_BEGIN
 		core_session_->post_torrent_updates();
-		if (core_session_->wait_for_alert(wait_alert_time) != NULL) { 
+		if (core_session_->wait_for_alert(wait_alert_time) != NULL) 
 			handle_core_notifications();
-			continue;
-		}
+		handle_seek_requests();
 		LIBTORRENT_EXCEPTION_SAFE_END_(continue)
 	} // !loop
 	
@@ -508,6 +546,42 @@ void torrent_core::handle_core_notifications()
 	} // !for
 }
 
+void torrent_core::handle_seek_requests() 
+{
+	/** Seeks(reading progress) of the same file which came between loop iterations merged, 
+		only the last position of the reader matters */
+	typedef boost::unordered_map<std::string, core_seek_notification_ptr> seeks_type;
+	seeks_type seeks;
+	{
+		boost::lock_guard<boost::mutex> guard(seeks_lock_);
+		seeks.swap(seeks_);
+	}
+	for (seeks_type::const_iterator it = seeks.begin(), end = seeks.end();
+		it != end;
+		++it)
+	{
+		core_seek_notification const & seek = *it->second;
+		if (seek.event_type == core_seek_notification::seek)
+			params_.controller->on_seek_request(seek.file_path, seek.offset);
+		else
+			params_.controller->on_reader_progress(seek.file_path, seek.offset, seek.bytes_per_sec);
+	} // !for
+}
+
+void torrent_core::on_seek_request(core_seek_notification_ptr seek_notification) 
+{
+	/** Called by the notification thread, request queued for the main loop thread(all controller calls made there). 
+		Posted updates wake the main loop if it waits for alerts, reading progress does not need to hurry */
+	{
+		boost::lock_guard<boost::mutex> guard(seeks_lock_);
+		seeks_[seek_notification->file_path] = seek_notification;
+	}
+	if (seek_notification->event_type != core_seek_notification::seek)
+		return;
+	if (cur_state_ == base_service::service_running)
+		core_session_->post_torrent_updates();
+}
+
 bool torrent_core::is_critical_error(libtorrent::alert * alert) 
 {
 	using namespace libtorrent;
@@ -2,6 +2,8 @@
 #define TORRENT_CORE_HPP_INCLUDED
 
 #include "base_service.hpp"
+#include "notification_receiver.hpp"
+#include "core_seek_notification.hpp"
 #include "shared_buffer.hpp"
 #include "setting_manager.hpp"
 #include "torrent_core_config.hpp"
@@ -16,6 +18,7 @@
 #include <libtorrent/session.hpp>
 
 #include <boost/thread.hpp>
+#include <boost/unordered_map.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
 namespace t2h_core {
@@ -75,6 +78,8 @@ public :
 	std::string get_torrent_info(size_type torrent_id) const;
 
 	std::string start_torrent_download(size_type torrent_id, int file_id);
+	/* Route of the file which does not depend on its path(see utility::http_file_route), empty on fail */
+	std::string get_file_route(size_type torrent_id, int file_id) const;
 	void pause_download(size_type torrent_id, int file_id);
 	void resume_download(size_type torrent_id, int file_id);	
 	void remove_torrent(size_type torrent_id);
@@ -88,6 +93,8 @@ private :
 
 	void core_main_loop();
 	void handle_core_notifications();	
+	void handle_seek_requests();
+	void on_seek_request(core_seek_notification_ptr seek_notification);
 	bool is_critical_error(libtorrent::alert * alert);
 	void handle_critical_error_notification(libtorrent::alert * alert);
 
@@ -99,6 +106,9 @@ private :
 	libtorrent::session * core_session_;
 	boost::condition_variable core_session_loop_wait_;
 	boost::scoped_ptr<boost::thread> core_session_loop_;
+	boost::mutex seeks_lock_;
+	boost::unordered_map<std::string, core_seek_notification_ptr> seeks_;	// Last seek(reading) per file, not handled yet
+	common::notification_receiver_ptr seek_receiver_;
 
 };
 
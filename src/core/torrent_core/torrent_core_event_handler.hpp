@@ -4,6 +4,7 @@
 #include <string>
 #include <boost/cstdint.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
 
 namespace t2h_core { 
 
@@ -16,12 +17,26 @@ public :
 	 * Good notifications
 	 */
 	virtual void on_file_add(std::string const & file_path, boost::int64_t file_size) = 0;
+	/* Same as above, but also with the torrent identity of the file(hex info hash, index in the torrent) */
+	virtual void on_file_add(
+		std::string const & file_path, boost::int64_t file_size, std::string const & info_hash, int file_index) 
+		{ on_file_add(file_path, file_size); }
 	virtual void on_file_remove(std::string const & file_path) = 0;
 
 	virtual void on_file_complete(std::string const & file_path, boost::int64_t avaliable_bytes) = 0; 
 	virtual void on_pause(std::string const & file_path) = 0;
 	
 	virtual void on_progress_update(std::string const & file_path, boost::int64_t avaliable_bytes) = 0;
+	/* Bytes [offset, offset + size) of the file verified(piece finished), could be beyond the avaliable bytes */
+	virtual void on_range_verified(std::string const & file_path, boost::int64_t offset, boost::int64_t size) 
+		{ }
+	/* Same as above, but also with the bytes of the verified piece(range starts at piece_offset of the piece) */
+	virtual void on_range_verified(std::string const & file_path, 
+		boost::int64_t offset, 
+		boost::int64_t size, 
+		boost::shared_array<char> const & piece, 
+		std::size_t piece_offset) 
+		{ on_range_verified(file_path, offset, size); }
 
 	/**
 	 * Bad notifications
@@ -131,6 +131,8 @@ file_info_ptr file_info_add(file_info::list_type & flist,
 	info->pieces_range_last = pieces_range_last;
 	info->end_av_pos = info->chocked_range = file_info_get_download_offset(info, max_partial_download_size);
 	info->recheck_av = file_info::off_recheck;
+	info->deadline_window_first = info->deadline_window_last = -1;
+	info->reader_seen = utility::get_current_time();
 	info->last_av_pos = info->last_av_pieces_pos = info->pieces_download_count = info->avaliable_bytes = info->total_pieces_download_count = 0;
 	// Just for sure make vector of avaliable pieces more than pieces for this file  
 	info->av_pieces.resize(info->pieces + 1);
@@ -2,6 +2,7 @@
 #define TORRENTS_INFO_EX_HPP_INCLUDED
 
 #include "base_resolver.hpp"
+#include "core_watermark.hpp"
 #include "torrent_core_future.hpp"
 
 #include <map>
@@ -66,6 +67,10 @@ struct file_info {
 	std::size_t end_av_pos;							// Last position + chocked_range -1 of av_pieces set
 	std::size_t last_av_pieces_pos;					// Last position of pieces
 	int recheck_av;									// set to off_recheck then sequential_download complete, else updater check current seq. each call
+	int deadline_window_first;						// First piece with the deadline set by the last seek(reading), -1 if no readers
+	int deadline_window_last;						// Last piece with the deadline set by the last seek(reading), -1 if no readers
+	boost::posix_time::time_duration reader_seen;	// Last time the reader of the file moved the deadline window
+	core_watermark_ptr watermark;					// Avaliable bytes published right to the http core waiters(see core_watermark)
 };
 
 typedef file_info::ptr_type file_info_ptr;
@@ -0,0 +1,189 @@
+#include "transport_types.hpp"
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <boost/thread.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/minimal.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+/**
+ * Helpers
+ */
+#define TEST_PORT 18099
+#define TEST_RECV_TIMEOUT_SECS 3
+#define TEST_EXHAUSTED_MS 1500			// Time the transport stays without descriptors
+#define TEST_MAX_CPU_MS 300				// Spinning event loop burns the whole exhausted time
+
+namespace {
+
+/* Replies with the decoded uri as the body */
+class echo_handler : public common::http_transport_event_handler {
+public :
+	virtual void on_partial_content_request(common::base_transport_ostream_ptr ostream,
+		std::string const & uri, utility::range_header const & range, utility::conditional_header const & conditions)
+		{ reply(ostream, uri); }
+
+	virtual void on_head_request(
+		common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions)
+		{ reply(ostream, uri); }
+
+	virtual void on_content_request(
+		common::base_transport_ostream_ptr ostream, std::string const & uri, utility::conditional_header const & conditions)
+		{ reply(ostream, uri); }
+
+private :
+	static void reply(common::base_transport_ostream_ptr ostream, std::string const & uri)
+	{
+		std::string const reply = "HTTP/1.1 200 OK\r\nContent-Length: " +
+			boost::lexical_cast<std::string>(uri.size()) + "\r\n\r\n" + uri;
+		ostream->write(reply.c_str(), reply.size());
+	}
+};
+
+static bool connect_client(int sock)
+{
+	struct timeval const timeout = { TEST_RECV_TIMEOUT_SECS, 0 };
+	::setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	struct sockaddr_in addr;
+	std::memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(TEST_PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	return (::connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+}
+
+/* Sends the request and reads the reply till the server closes the connection(or timeout) */
+static std::string perform_request(int sock, std::string const & request)
+{
+	std::string reply;
+	if (::send(sock, request.c_str(), request.size(), 0) != (ssize_t)request.size())
+		return reply;
+	char buffer[4096];
+	ssize_t readed = 0;
+	while ((readed = ::recv(sock, buffer, sizeof(buffer), 0)) > 0)
+		reply.append(buffer, readed);
+	return reply;
+}
+
+static std::string perform_request(std::string const & request)
+{
+	int const sock = ::socket(AF_INET, SOCK_STREAM, 0);
+	if (sock == -1)
+		return std::string();
+	std::string const reply = connect_client(sock) ? perform_request(sock, request) : std::string();
+	::close(sock);
+	return reply;
+}
+
+static inline std::string get_request(std::string const & uri)
+{
+	return "GET " + uri + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+}
+
+static inline bool is_status(std::string const & reply, char const * status)
+{
+	return (reply.compare(0, 9 + std::strlen(status), std::string("HTTP/1.1 ") + status) == 0);
+}
+
+static double get_cpu_ms()
+{
+	struct rusage usage;
+	::getrusage(RUSAGE_SELF, &usage);
+	return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000.0 +
+		(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1000.0;
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_dot_segments()
+{
+	/*  Only the whole '..' segment rejected */
+	std::string reply = perform_request(get_request("/a..b.mkv"));
+	BOOST_CHECK(is_status(reply, "200") && reply.find("\r\n\r\n/a..b.mkv") != std::string::npos);
+	reply = perform_request(get_request("/dir..x/..name"));
+	BOOST_CHECK(is_status(reply, "200"));
+	BOOST_CHECK(is_status(perform_request(get_request("/../etc/passwd")), "400"));
+	BOOST_CHECK(is_status(perform_request(get_request("/dir/..")), "400"));
+	BOOST_CHECK(is_status(perform_request(get_request("/dir/%2e%2e/file")), "400"));
+}
+
+static void check_chunked_body()
+{
+	/*  Chunked body could not be skipped, so the request refused and the connection closed */
+	std::string const request = "POST /file HTTP/1.1\r\nHost: localhost\r\n"
+		"Transfer-Encoding: chunked\r\n\r\n5\r\nhello\r\n0\r\n\r\n";
+	BOOST_CHECK(is_status(perform_request(request), "501"));
+	std::string const sized = "POST /file HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n"
+		"Content-Length: 5\r\n\r\nhello";
+	BOOST_CHECK(is_status(perform_request(sized), "200"));
+}
+
+static void check_descriptors_exhausted()
+{
+	/*  Pending client must not spin the event loop while descriptors are exhausted,
+	 	it served after the descriptors released. Socket of the client created before the exhaustion */
+	int const client = ::socket(AF_INET, SOCK_STREAM, 0);
+	BOOST_REQUIRE(client != -1);
+	std::vector<int> exhausted;
+	for (int fd = -1; (fd = ::open("/dev/null", O_RDONLY)) != -1;)
+		exhausted.push_back(fd);
+	BOOST_CHECK(errno == EMFILE);
+	BOOST_CHECK(connect_client(client));
+
+	double const cpu_started = get_cpu_ms();
+	boost::this_thread::sleep(boost::posix_time::milliseconds(TEST_EXHAUSTED_MS));
+	double const cpu_ms = get_cpu_ms() - cpu_started;
+	for (std::size_t it = 0; it < exhausted.size(); ++it)
+		::close(exhausted[it]);
+	std::cerr << "cpu while descriptors exhausted : " << cpu_ms << " ms" << std::endl;
+	BOOST_CHECK(cpu_ms < TEST_MAX_CPU_MS);
+
+	BOOST_CHECK(is_status(perform_request(client, get_request("/after")), "200"));
+	::close(client);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	/*  Low descriptors limit, so the exhaustion is fast */
+	struct rlimit limit;
+	::getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = std::min<rlim_t>(limit.rlim_cur, 256);
+	::setrlimit(RLIMIT_NOFILE, &limit);
+
+	common::transport_config const config = {
+		"", "127.0.0.1", boost::lexical_cast<std::string>(TEST_PORT), 2, boost::make_shared<echo_handler>(), 0, 0 };
+	common::http_epoll_transport transport(config);
+	transport.initialize();
+	transport.establish_connection();
+
+	check_dot_segments();
+	check_chunked_body();
+	check_descriptors_exhausted();
+
+	transport.stop_connection();
+	return 0;
+}
+
+#undef TEST_PORT
+#undef TEST_RECV_TIMEOUT_SECS
+#undef TEST_EXHAUSTED_MS
+#undef TEST_MAX_CPU_MS
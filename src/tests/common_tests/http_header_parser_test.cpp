@@ -1,6 +1,7 @@
 #include "http_utility.hpp"
 
 #include <iostream>
+#include <boost/lexical_cast.hpp>
 #include <boost/test/minimal.hpp>
 
 #define FIRST_TEST_CASE(value, f, l, x, x1) 		\
@@ -20,7 +21,7 @@ do {														\
 #define THIRD_TEST_CASE(value, x) 							\
 do {														\
 	init_header_list_with_header(value);					\
-	BOOST_CHECK(x() == true);								\
+	BOOST_CHECK(x() == false);								\
 	reset_header_list();									\
 } while(0);
 
@@ -65,6 +66,20 @@ static inline bool test_3()
 	return http_translate_range_header(rheader, headers);
 }
 
+static inline bool test_4(std::size_t expected_ranges, boost::int64_t file_size, 
+	boost::int64_t eb_1, boost::int64_t ee_1, std::size_t expected_resolved) 
+{
+	using namespace utility;
+	range_header rheader;
+	byte_ranges_type resolved;
+	if (!http_translate_range_header(rheader, headers) || rheader.ranges.size() != expected_ranges)
+		return false;
+	if (!http_resolve_ranges(rheader, file_size, resolved))
+		return (expected_resolved == 0);
+	return (resolved.size() == expected_resolved && 
+			resolved.front().first == eb_1 && resolved.front().last == ee_1);
+}
+
 } // namespace
 
 struct helper_1 {
@@ -129,7 +144,69 @@ struct helper_3 {
 	{"bytes=YYY-10"},
 	{"bytes=10-YYY"},
 	{"bytes=10-YYY,"},
-	{"bytes=-,10-YYY"}
+	{"bytes=-,10-YYY"},
+	{"bytes=10-20,"},
+	{"bytes=,10-20"},
+	{"bytes=0-1,,2-3"},
+	{"bytes=5-3"},
+	{"bytes=0-1,20-10"},
+	{"bytes=1-2-3"},
+	{"bytes=0-1;x"},
+	{"bytes=99999999999999999999-"},
+	{"bytes0-1"},
+	{"items=0-1"},
+	{"=0-1"}
+};
+
+struct helper_4 {
+	char const * range_header;
+	std::size_t ex_ranges;
+	boost::int64_t file_size;
+	boost::int64_t ex_beg_1;
+	boost::int64_t ex_end_1;
+	std::size_t ex_resolved;
+} test_data_case_4[] = {
+	{"bytes=-100", 1, 1000, 900, 999, 1},
+	{"bytes=-2000", 1, 1000, 0, 999, 1},
+	{"bytes=100-", 1, 1000, 100, 999, 1},
+	{"bytes=100-5000", 1, 1000, 100, 999, 1},
+	{"bytes=1000-", 1, 1000, 0, 0, 0},
+	{"bytes=0-99,200-299,400-499", 3, 1000, 0, 99, 3},
+	{"bytes=0-99, 100-199, 150-299", 3, 1000, 0, 299, 1},
+	{"bytes=500-599,0-99,-100", 3, 1000, 0, 99, 3},
+	{"bytes=0-10,5-20,2000-3000,900-", 4, 1000, 0, 20, 2},
+	{"bytes=-", 1, 1000, 0, 0, 0},
+	{"bytes=*-*", 1, 1000, 0, 0, 0},
+	{"bytes=-,0-99", 2, 1000, 0, 99, 1},
+	{"bytes=0-0", 1, 1000, 0, 0, 1},
+	{"bytes=999-", 1, 1000, 999, 999, 1},
+	{"bytes=998-1500", 1, 1000, 998, 999, 1},
+	{"bytes=-0", 1, 1000, 0, 0, 0},
+	{"bytes=-1000", 1, 1000, 0, 999, 1},
+	{"bytes=0-99,100-199", 2, 1000, 0, 199, 1},
+	{"bytes=0-99,101-199", 2, 1000, 0, 99, 2},
+	{"bytes=0-499,-500", 2, 1000, 0, 999, 1},
+	{"bytes=-1,0-0", 2, 1000, 0, 0, 2},
+	{"bytes=900-,0-", 2, 1000, 0, 999, 1},
+	{"bytes=0- 1 , 2 -3", 2, 1000, 0, 3, 1},
+	{"Bytes = 0-1", 1, 1000, 0, 1, 1},
+	{"bytes=0-0", 1, 0, 0, 0, 0},
+	{"bytes=-10", 1, 0, 0, 0, 0}
+};
+
+struct helper_5 {
+	char const * etags;
+	char const * etag;
+	bool weak_comparison;
+	bool ex_result;
+} test_data_case_5[] = {
+	{"\"abc-1\"", "\"abc-1\"", false, true},
+	{"\"xyz-0\", \"abc-1\"", "\"abc-1\"", false, true},
+	{"*", "\"abc-1\"", false, true},
+	{"W/\"abc-1\"", "\"abc-1\"", false, false},
+	{"W/\"abc-1\"", "\"abc-1\"", true, true},
+	{"\"abc-1-partial\"", "\"abc-1\"", true, false},
+	{"\"abc-1\"", "", true, false}
 };
 
 int test_main(int argc, char ** argv) 
@@ -155,9 +232,88 @@ int test_main(int argc, char ** argv)
 	}
 
 	for (std::size_t it = 0; it < sizeof(test_data_case_3)/sizeof(test_data_case_3[0]); ++it) 
-		THIRD_TEST_CASE(test_data_case_2[it].range_header, test_3); 
+		THIRD_TEST_CASE(test_data_case_3[it].range_header, test_3); 
+
+	for (std::size_t it = 0; it < sizeof(test_data_case_4)/sizeof(test_data_case_4[0]); ++it) 
+	{
+		init_header_list_with_header(test_data_case_4[it].range_header);
+		BOOST_CHECK(test_4(test_data_case_4[it].ex_ranges, 
+			test_data_case_4[it].file_size, 
+			test_data_case_4[it].ex_beg_1, 
+			test_data_case_4[it].ex_end_1, 
+			test_data_case_4[it].ex_resolved));
+		reset_header_list();
+	}
 
+	/* Negative values and too many ranges are not valid */
+	utility::range_header rheader;
+	BOOST_CHECK(!utility::http_translate_range_header(rheader, std::string("bytes=--1")));
+	BOOST_CHECK(!utility::http_translate_range_header(rheader, std::string("bytes=5--1")));
+	std::string many_ranges = "bytes=0-0";
+	for (std::size_t it = 1; it < utility::http_max_ranges; ++it)
+		many_ranges += "," + boost::lexical_cast<std::string>(it * 2) + "-" + boost::lexical_cast<std::string>(it * 2);
+	BOOST_CHECK(utility::http_translate_range_header(rheader, many_ranges) && 
+		rheader.ranges.size() == utility::http_max_ranges);
+	BOOST_CHECK(!utility::http_translate_range_header(rheader, many_ranges + ",1000-1000") && rheader.ranges.empty());
+
+	for (std::size_t it = 0; it < sizeof(test_data_case_5)/sizeof(test_data_case_5[0]); ++it) 
+		BOOST_CHECK(utility::http_etag_match(test_data_case_5[it].etags, 
+			test_data_case_5[it].etag, test_data_case_5[it].weak_comparison) == test_data_case_5[it].ex_result);
+	
+	BOOST_CHECK(utility::http_parse_gmt_time("Sun, 06 Nov 1994 08:49:37 GMT") == 784111777);
+	BOOST_CHECK(utility::http_parse_gmt_time("Sunday, 06-Nov-94 08:49:37 GMT") == (std::time_t)-1);
+	BOOST_CHECK(utility::http_parse_gmt_time(utility::http_get_gmt_time_string(1234567890)) == 1234567890);
+
+	char formatted[utility::http_gmt_time_size + 1] = { '\0' };
+	BOOST_CHECK(utility::http_format_gmt_time(784111777, formatted) == utility::http_gmt_time_size && 
+		std::string(formatted) == "Sun, 06 Nov 1994 08:49:37 GMT");
+	for (std::time_t time = 0; time < 4102444800; time += 86399 * 17) {
+		utility::http_format_gmt_time(time, formatted);
+		BOOST_CHECK(std::string(formatted) == utility::http_get_gmt_time_string(time));
+	}
+	
+	char number[utility::http_int_max_size + 1] = { '\0' };
+	BOOST_CHECK(utility::http_format_int(0, number) == 1 && std::string(number) == "0");
+	BOOST_CHECK(utility::http_format_int(-1024, number) == 5 && std::string(number) == "-1024");
+	BOOST_CHECK(utility::http_format_int(9223372036854775807LL, number) == 19 && 
+		std::string(number) == "9223372036854775807");
+	BOOST_CHECK(utility::http_format_int(-9223372036854775807LL - 1, number) == 20 && 
+		std::string(number) == "-9223372036854775808");
 
+	std::string const info_hash = "0123456789abcdefABCDEF0123456789abcdef01";
+	unsigned char raw_info_hash[utility::http_info_hash_size] = { 0 };
+	int file_index = -1;
+	BOOST_CHECK(utility::http_file_route(info_hash, 7) == "/f/" + info_hash + "/7");
+	BOOST_CHECK(utility::http_file_route(std::string(), 7).empty());
+	BOOST_CHECK(utility::http_parse_file_route(utility::http_file_route(info_hash, 7), raw_info_hash, file_index) && 
+		file_index == 7 && raw_info_hash[0] == 0x01 && raw_info_hash[7] == 0xef && raw_info_hash[19] == 0x01);
+	BOOST_CHECK(utility::http_parse_file_route("/f/" + info_hash + "/123456789", raw_info_hash, file_index) && 
+		file_index == 123456789);
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/1234567890", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/1a", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash.substr(1) + "/1", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash.substr(1) + "x/1", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/g/" + info_hash + "/1", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/some/file.avi", raw_info_hash, file_index));
+	BOOST_CHECK(utility::http_file_route(info_hash, -1).empty());
+	BOOST_CHECK(utility::http_parse_file_route("/f/" + info_hash + "/0", raw_info_hash, file_index) && file_index == 0);
+	BOOST_CHECK(utility::http_parse_file_route("/f/" + info_hash + "/007", raw_info_hash, file_index) && file_index == 7);
+	BOOST_CHECK(utility::http_parse_file_route("/f/" + info_hash + "/999999999", raw_info_hash, file_index) && 
+		file_index == 999999999);
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/-1", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/7/", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/7/file.avi", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "/7 ", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash, raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/" + info_hash + "1/7", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/F/" + info_hash + "/7", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("f/" + info_hash + "/7", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("/f/", raw_info_hash, file_index));
+	BOOST_CHECK(!utility::http_parse_file_route("", raw_info_hash, file_index));
+	BOOST_CHECK(utility::http_parse_info_hash(info_hash, raw_info_hash) && raw_info_hash[5] == 0xab);
+	BOOST_CHECK(!utility::http_parse_info_hash(info_hash + "0", raw_info_hash));
+	BOOST_CHECK(!utility::http_parse_info_hash("g" + info_hash.substr(1), raw_info_hash));
 
 	return 0;
 }
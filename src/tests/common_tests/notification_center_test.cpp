@@ -1,7 +1,10 @@
 #include "notification_center.hpp"
 
 #include <iostream>
+#include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/test/minimal.hpp>
 
 /**
@@ -9,6 +12,9 @@
  */
 #define TEST_COUNTER_MAX 500	// generated events	size value
 #define WAIT_TIMEOUT 5			// waitng for a good result timeout value(in ms)
+#define TEST_QUEUE_MAX 10		// pending notifications limit of the full queue test
+#define TEST_DELIVERY_ROUNDS 200	// notifications of the prompt delivery test
+#define TEST_DELIVERY_MAX_MS 1000	// max delivery time, less than the notification check timeout
 
 // create custom event(+custom data)
 #define MAKE_CUSTOM_NOTIFICATION(name, udata)											\
@@ -93,6 +99,58 @@ struct check_recv_t1 : public common::notification_receiver {
 	static const int excpected_count_value = TEST_COUNTER_MAX;
 };
 
+/*  Receiver which holds the notification loop in on_notify till the gate opened */
+struct gated_recv : public common::notification_receiver {
+	
+	gated_recv() 
+		: common::notification_receiver("gated_recv"), lock(), changed(), opened(false), entered(false), delivered(0) 
+	{ 
+	}
+	
+	virtual void on_notify(common::notification_ptr notification)
+	{ 
+		boost::unique_lock<boost::mutex> guard(lock);
+		entered = true;
+		changed.notify_all();
+		while (!opened) 
+			changed.wait(guard);
+		++delivered;
+		changed.notify_all();
+	}
+	
+	virtual void on_notify_failed(common::notification_ptr notification, int reason) { }
+
+	void wait_entered() 
+	{
+		boost::unique_lock<boost::mutex> guard(lock);
+		while (!entered)
+			changed.wait(guard);
+	}
+
+	void open() 
+	{
+		boost::lock_guard<boost::mutex> guard(lock);
+		opened = true;
+		changed.notify_all();
+	}
+
+	bool wait_delivered(int expected_delivered, boost::posix_time::time_duration const & timeout) 
+	{
+		boost::system_time const deadline = boost::get_system_time() + timeout;
+		boost::unique_lock<boost::mutex> guard(lock);
+		while (delivered < expected_delivered)
+			if (!changed.timed_wait(guard, deadline))
+				break;
+		return (delivered >= expected_delivered);
+	}
+
+	boost::mutex lock;
+	boost::condition_variable changed;
+	bool opened;
+	bool entered;
+	int delivered;
+};
+
 static bool wait_for_finish(int expected_event_execution_value) 
 {
 	for (int ticks = 0; ;sleep(1), ++ticks) {
@@ -156,6 +214,60 @@ static inline bool multi_threaded_check_events_recv()
 	return state;
 }
 
+static inline bool check_full_queue_drops() 
+{
+	/*  Receiver holds the first notification, so the next ones stay in the queue till it full */
+	bool state = false; std::size_t id = 0;
+	common::notification_center_config const ncc = { TEST_QUEUE_MAX, false };
+	common::notification_center center(ncc);
+	boost::shared_ptr<gated_recv> recv(new gated_recv());
+	boost::tie(id, state) = center.add_notification_receiver(recv);
+	if (!state) return false;
+
+	if (!center.send_message(recv->get_name(), event_tcount_ptr(new event_tcount()))) 
+		return false;
+	recv->wait_entered();
+
+	int accepted = 1;
+	for (int count = 0; count != TEST_QUEUE_MAX * 2; ++count) 
+		if (center.send_message(recv->get_name(), event_tcount_ptr(new event_tcount())))
+			++accepted;
+	state = (accepted > TEST_QUEUE_MAX && accepted < TEST_QUEUE_MAX * 2 + 1);
+	
+	/*  Dropped notifications are never delivered, the queue accepts again after the drain */
+	recv->open();
+	state = recv->wait_delivered(accepted, boost::posix_time::seconds(WAIT_TIMEOUT)) && state;
+	state = center.send_message(recv->get_name(), event_tcount_ptr(new event_tcount())) && state;
+	state = recv->wait_delivered(accepted + 1, boost::posix_time::seconds(WAIT_TIMEOUT)) && state;
+	boost::this_thread::sleep(boost::posix_time::milliseconds(100));
+	state = (recv->delivered == accepted + 1) && state;
+	center.remove_notification_receiver(recv->get_name());
+	
+	return state;
+}
+
+static inline bool check_prompt_delivery() 
+{
+	/*  Each notification sent right after the previous one delivered, so it comes
+	 	while the loop copies the queue, it must not wait for the notification check timeout */
+	bool state = false; std::size_t id = 0;
+	boost::shared_ptr<gated_recv> recv(new gated_recv());
+	recv->open();
+	boost::tie(id, state) = envt.center->add_notification_receiver(recv);
+	if (!state) return false;
+	
+	boost::posix_time::time_duration max_delivery;
+	for (int count = 1; count <= TEST_DELIVERY_ROUNDS && state; ++count) {
+		boost::posix_time::ptime const started = boost::posix_time::microsec_clock::universal_time();
+		state = envt.center->send_message(recv->get_name(), event_tcount_ptr(new event_tcount())) && 
+			recv->wait_delivered(count, boost::posix_time::seconds(WAIT_TIMEOUT));
+		max_delivery = std::max(max_delivery, boost::posix_time::microsec_clock::universal_time() - started);
+	} // for
+	envt.center->remove_notification_receiver(recv->get_name());
+	
+	return (state && max_delivery.total_milliseconds() < TEST_DELIVERY_MAX_MS);
+}
+
 /**
  * Entry point
  */
@@ -166,6 +278,8 @@ try
 	environment_init();
 	CHECK_ENTITY(check_events_recv())
 	CHECK_ENTITY(multi_threaded_check_events_recv())
+	CHECK_ENTITY(check_full_queue_drops())
+	CHECK_ENTITY(check_prompt_delivery())
 	std::cout << "End ..." << std::endl;
 	environment_destroy();
 	return EXIT_SUCCESS;
@@ -0,0 +1,231 @@
+#include "block_cache.hpp"
+#include "io_uring_reader.hpp"
+#include "file_info_buffer.hpp"
+#include "file_handles_cache.hpp"
+
+#include <cstdio>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_BLOCK_SIZE 4096
+#define TEST_FILE_BLOCKS 64
+#define TEST_FILE_PATH "block_cache_test.data"
+#define TEST_READERS 8
+/* Load of the big block lasts long enough, so other readers come while it in flight */
+#define TEST_FLIGHT_BLOCK_SIZE (16 * 1024 * 1024)
+#define TEST_FLIGHT_BLOCKS 2
+#define TEST_FLIGHT_FILE_PATH "block_cache_test.sparse"
+
+namespace {
+
+using namespace t2h_core::details;
+
+static inline char byte_at(boost::int64_t pos)
+{
+	return (char)(pos % 251);
+}
+
+static void create_test_file()
+{
+	std::ofstream file(TEST_FILE_PATH, std::ios::out | std::ios::binary | std::ios::trunc);
+	for (boost::int64_t pos = 0; pos < TEST_BLOCK_SIZE * TEST_FILE_BLOCKS; ++pos)
+		file.put(byte_at(pos));
+}
+
+static void create_sparse_file()
+{
+	std::ofstream file(TEST_FLIGHT_FILE_PATH, std::ios::out | std::ios::binary | std::ios::trunc);
+	file.seekp(TEST_FLIGHT_BLOCK_SIZE * TEST_FLIGHT_BLOCKS - 1);
+	file.put('\0');
+}
+
+static bool check_bytes(hc_cached_block_ptr block, boost::int64_t first, boost::int64_t last)
+{
+	if (!block || block->first > first || block->last < last)
+		return false;
+	for (boost::int64_t pos = first; pos < last; ++pos)
+		if (*block->bytes_at(pos) != byte_at(pos))
+			return false;
+	return true;
+}
+
+static void coalesced_reader(block_cache & cache, 
+	hc_file_info_ptr fi, 
+	hc_file_handle & file_handle, 
+	boost::barrier & start, 
+	std::vector<hc_cached_block_ptr> & blocks)
+{
+	boost::int64_t const file_end = TEST_FLIGHT_BLOCK_SIZE * TEST_FLIGHT_BLOCKS;
+	for (boost::int64_t pos = 0; pos < file_end; pos += TEST_FLIGHT_BLOCK_SIZE) {
+		start.wait();
+		blocks.push_back(cache.acquire(fi, file_handle, NULL, pos, file_end));
+	} // for
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_hits_and_misses(hc_file_info_ptr fi, hc_file_handle & file_handle)
+{
+	block_cache cache(TEST_BLOCK_SIZE * TEST_FILE_BLOCKS, TEST_BLOCK_SIZE);
+	boost::int64_t const file_end = TEST_BLOCK_SIZE * TEST_FILE_BLOCKS;
+
+	hc_cached_block_ptr const block = cache.acquire(fi, file_handle, NULL, 100, file_end);
+	BOOST_CHECK(check_bytes(block, 100, TEST_BLOCK_SIZE));
+	BOOST_CHECK(cache.acquire(fi, file_handle, NULL, TEST_BLOCK_SIZE - 1, file_end) == block);
+
+	/*  Bytes before the first readed one are not in the block, the block reloaded */
+	hc_cached_block_ptr const whole = cache.acquire(fi, file_handle, NULL, 0, file_end);
+	BOOST_CHECK(whole != block && check_bytes(whole, 0, TEST_BLOCK_SIZE));
+
+	/*  Only avaliable bytes readed, new bytes appended to the already readed ones */
+	hc_cached_block_ptr const part = cache.acquire(fi, file_handle, NULL, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE + 10);
+	BOOST_CHECK(check_bytes(part, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE + 10) && part->last == TEST_BLOCK_SIZE + 10);
+	BOOST_CHECK(!cache.acquire(fi, file_handle, NULL, TEST_BLOCK_SIZE + 10, TEST_BLOCK_SIZE + 10));
+	hc_cached_block_ptr const grown = cache.acquire(fi, file_handle, NULL, TEST_BLOCK_SIZE + 10, file_end);
+	BOOST_CHECK(grown != part && check_bytes(grown, TEST_BLOCK_SIZE, TEST_BLOCK_SIZE * 2));
+
+	block_cache_stat const stat = cache.get_stat();
+	BOOST_CHECK(stat.hits == 1 && stat.misses == 4 && stat.blocks == 2);
+}
+
+static void check_disabled(hc_file_info_ptr fi, hc_file_handle & file_handle)
+{
+	block_cache cache(0, TEST_BLOCK_SIZE);
+	BOOST_CHECK(!cache.acquire(fi, file_handle, NULL, 0, TEST_BLOCK_SIZE));
+	cache.set_limits(TEST_BLOCK_SIZE * 16, TEST_BLOCK_SIZE);
+	BOOST_CHECK(check_bytes(cache.acquire(fi, file_handle, NULL, 0, TEST_BLOCK_SIZE), 0, TEST_BLOCK_SIZE));
+
+	/*  Block size changed : all blocks dropped */
+	cache.set_limits(TEST_BLOCK_SIZE * 16, TEST_BLOCK_SIZE * 2);
+	BOOST_CHECK(cache.get_stat().blocks == 0);
+}
+
+static void check_epoch_invalidation(hc_file_info_ptr fi, hc_file_handle & file_handle)
+{
+	/*  Owners of the invalidated block still could use it, but the next reader loads own */
+	block_cache cache(TEST_BLOCK_SIZE * TEST_FILE_BLOCKS, TEST_BLOCK_SIZE);
+	boost::int64_t const file_end = TEST_BLOCK_SIZE * TEST_FILE_BLOCKS;
+	hc_cached_block_ptr const block = cache.acquire(fi, file_handle, NULL, 0, file_end);
+	cache.invalidate(fi);
+	BOOST_CHECK(cache.get_stat().blocks == 0);
+	BOOST_CHECK(check_bytes(block, 0, TEST_BLOCK_SIZE));
+
+	hc_cached_block_ptr const reloaded = cache.acquire(fi, file_handle, NULL, 0, file_end);
+	BOOST_CHECK(reloaded != block && check_bytes(reloaded, 0, TEST_BLOCK_SIZE));
+	BOOST_CHECK(cache.get_stat().misses == 2);
+
+	/*  Blocks of the other file are not touched */
+	hc_file_info_ptr const other(new hc_file_info(TEST_FILE_PATH, file_end, file_end));
+	hc_cached_block_ptr const other_block = cache.acquire(other, file_handle, NULL, 0, file_end);
+	cache.invalidate(fi);
+	BOOST_CHECK(cache.acquire(other, file_handle, NULL, 0, file_end) == other_block);
+}
+
+static void check_pinned_eviction(hc_file_info_ptr fi, hc_file_handle & file_handle)
+{
+	/*  Each shard holds one block, but the blocks which readers own are never evicted */
+	block_cache cache(TEST_BLOCK_SIZE, TEST_BLOCK_SIZE);
+	boost::int64_t const file_end = TEST_BLOCK_SIZE * TEST_FILE_BLOCKS;
+	std::vector<hc_cached_block_ptr> pinned;
+	for (boost::int64_t pos = 0; pos < file_end; pos += TEST_BLOCK_SIZE)
+		pinned.push_back(cache.acquire(fi, file_handle, NULL, pos, file_end));
+
+	block_cache_stat stat = cache.get_stat();
+	BOOST_CHECK(stat.blocks == TEST_FILE_BLOCKS && stat.evictions == 0 && stat.pinned_skips > 0);
+	for (std::size_t it = 0; it < pinned.size(); ++it)
+		BOOST_CHECK(cache.acquire(fi, file_handle, NULL, it * TEST_BLOCK_SIZE, file_end) == pinned[it]);
+
+	/*  Unpinned blocks evicted down to the limit, the last owner keeps own block */
+	hc_cached_block_ptr const kept = pinned.back();
+	pinned.clear();
+	cache.set_limits(TEST_BLOCK_SIZE, TEST_BLOCK_SIZE);
+	stat = cache.get_stat();
+	BOOST_CHECK(stat.blocks <= stat.max_bytes / TEST_BLOCK_SIZE &&
+		stat.evictions == TEST_FILE_BLOCKS - stat.blocks);
+	BOOST_CHECK(cache.acquire(fi, file_handle, NULL, file_end - 1, file_end) == kept);
+}
+
+static void check_io_reader(hc_file_info_ptr fi, hc_file_handle & file_handle)
+{
+	/*  Blocks loaded via the shared reader, the closed(or not built) ring falls back to pread */
+	block_cache cache(TEST_BLOCK_SIZE * TEST_FILE_BLOCKS, TEST_BLOCK_SIZE);
+	boost::int64_t const file_end = TEST_BLOCK_SIZE * TEST_FILE_BLOCKS;
+	io_uring_reader reader(8);
+	BOOST_CHECK(check_bytes(cache.acquire(fi, file_handle, &reader, 0, file_end), 0, TEST_BLOCK_SIZE));
+	reader.stop();
+	BOOST_CHECK(!reader.is_open());
+	BOOST_CHECK(check_bytes(cache.acquire(fi, file_handle, &reader, file_end - 1, file_end), file_end - 1, file_end));
+	BOOST_CHECK(cache.get_stat().misses == 2);
+}
+
+static void check_single_flight()
+{
+	/*  All readers of the block started at once : the block loaded once, 
+	 	each other reader takes the same block(from the load or from the cache) */
+	create_sparse_file();
+	boost::int64_t const file_end = TEST_FLIGHT_BLOCK_SIZE * TEST_FLIGHT_BLOCKS;
+	hc_file_info_ptr const fi(new hc_file_info(TEST_FLIGHT_FILE_PATH, file_end, file_end));
+	hc_file_handle file_handle(TEST_FLIGHT_FILE_PATH);
+	BOOST_REQUIRE(file_handle.is_open());
+
+	block_cache cache(TEST_FLIGHT_BLOCK_SIZE * TEST_FLIGHT_BLOCKS, TEST_FLIGHT_BLOCK_SIZE);
+	boost::barrier start(TEST_READERS);
+	std::vector<std::vector<hc_cached_block_ptr> > blocks(TEST_READERS);
+	boost::thread_group threads;
+	for (std::size_t it = 0; it < TEST_READERS; ++it)
+		threads.create_thread(boost::bind(coalesced_reader, 
+			boost::ref(cache), fi, boost::ref(file_handle), boost::ref(start), boost::ref(blocks[it])));
+	threads.join_all();
+
+	for (std::size_t block = 0; block < TEST_FLIGHT_BLOCKS; ++block) {
+		BOOST_CHECK(blocks[0][block] && blocks[0][block]->last == (boost::int64_t)(block + 1) * TEST_FLIGHT_BLOCK_SIZE);
+		for (std::size_t it = 1; it < TEST_READERS; ++it)
+			BOOST_CHECK(blocks[it][block] == blocks[0][block]);
+	} // for
+	block_cache_stat const stat = cache.get_stat();
+	BOOST_CHECK(stat.misses == TEST_FLIGHT_BLOCKS && stat.coalesced > 0 && 
+		stat.hits + stat.coalesced == TEST_FLIGHT_BLOCKS * (TEST_READERS - 1));
+	std::remove(TEST_FLIGHT_FILE_PATH);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	create_test_file();
+	boost::int64_t const file_end = TEST_BLOCK_SIZE * TEST_FILE_BLOCKS;
+	hc_file_info_ptr const fi(new hc_file_info(TEST_FILE_PATH, file_end, file_end));
+	hc_file_handle file_handle(TEST_FILE_PATH);
+	BOOST_REQUIRE(file_handle.is_open());
+
+	check_hits_and_misses(fi, file_handle);
+	check_io_reader(fi, file_handle);
+	check_disabled(fi, file_handle);
+	check_epoch_invalidation(fi, file_handle);
+	check_pinned_eviction(fi, file_handle);
+	check_single_flight();
+
+	std::remove(TEST_FILE_PATH);
+	return 0;
+}
+
+#undef TEST_BLOCK_SIZE
+#undef TEST_FILE_BLOCKS
+#undef TEST_FILE_PATH
+#undef TEST_READERS
+#undef TEST_FLIGHT_BLOCK_SIZE
+#undef TEST_FLIGHT_BLOCKS
+#undef TEST_FLIGHT_FILE_PATH
@@ -0,0 +1,143 @@
+#include "byte_interval_set.hpp"
+
+#include <vector>
+#include <cstdlib>
+#include <iostream>
+#include <algorithm>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_BYTES 512					// Bytes of the file for the random test
+#define TEST_ROUNDS 10000
+
+namespace {
+
+using namespace t2h_core::details;
+
+static bool check_intervals(byte_interval_set const & set, boost::int64_t const * intervals, std::size_t size)
+{
+	if (set.size() != size / 2)
+		return false;
+	byte_interval_set::const_iterator it = set.begin();
+	for (std::size_t pos = 0; pos < size; pos += 2, ++it)
+		if (it->first != intervals[pos] || it->second != intervals[pos + 1])
+			return false;
+	return true;
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_insert()
+{
+	byte_interval_set set;
+	set.insert(10, 10);
+	set.insert(20, 10);
+	BOOST_CHECK(set.empty());
+
+	set.insert(10, 20);
+	set.insert(30, 40);
+	set.insert(50, 60);
+	boost::int64_t const disjoint[] = { 10, 20, 30, 40, 50, 60 };
+	BOOST_CHECK(check_intervals(set, disjoint, 6));
+
+	/*  Touching intervals merged, interval inside of the other one changes nothing */
+	set.insert(20, 25);
+	set.insert(12, 18);
+	set.insert(45, 50);
+	boost::int64_t const touched[] = { 10, 25, 30, 40, 45, 60 };
+	BOOST_CHECK(check_intervals(set, touched, 6));
+
+	/*  Interval which covers a few of them swallows all */
+	set.insert(5, 70);
+	boost::int64_t const swallowed[] = { 5, 70 };
+	BOOST_CHECK(check_intervals(set, swallowed, 2));
+	set.insert(0, 5);
+	set.insert(69, 80);
+	boost::int64_t const extended[] = { 0, 80 };
+	BOOST_CHECK(check_intervals(set, extended, 2));
+}
+
+static void check_contains()
+{
+	byte_interval_set set;
+	set.insert(10, 20);
+	set.insert(30, 40);
+	BOOST_CHECK(set.contiguous_end(10) == 20 && set.contiguous_end(19) == 20);
+	BOOST_CHECK(set.contiguous_end(20) == 20 && set.contiguous_end(5) == 5 && set.contiguous_end(45) == 45);
+	BOOST_CHECK(set.contains(10, 20) && set.contains(35, 40) && set.contains(50, 50));
+	BOOST_CHECK(!set.contains(10, 21) && !set.contains(15, 35) && !set.contains(0, 1));
+}
+
+static void check_erase_before()
+{
+	byte_interval_set set;
+	set.insert(10, 20);
+	set.insert(30, 40);
+	set.insert(50, 60);
+	set.erase_before(5);
+	BOOST_CHECK(set.size() == 3);
+
+	/*  Interval which contains the bound cut, intervals before it dropped */
+	set.erase_before(35);
+	boost::int64_t const cut[] = { 35, 40, 50, 60 };
+	BOOST_CHECK(check_intervals(set, cut, 4));
+	set.erase_before(40);
+	boost::int64_t const dropped[] = { 50, 60 };
+	BOOST_CHECK(check_intervals(set, dropped, 2));
+	set.erase_before(100);
+	BOOST_CHECK(set.empty());
+}
+
+static void check_random()
+{
+	/*  Set compared with the plain bitmap of the bytes */
+	byte_interval_set set;
+	std::vector<bool> bytes(TEST_BYTES, false);
+	std::srand(7);
+	for (std::size_t round = 0; round < TEST_ROUNDS; ++round) {
+		boost::int64_t const first = std::rand() % TEST_BYTES, size = std::rand() % 16;
+		boost::int64_t const last = std::min<boost::int64_t>(first + size, TEST_BYTES);
+		if (round % 1000 == 999) {
+			set.erase_before(first);
+			std::fill(bytes.begin(), bytes.begin() + first, false);
+		} else {
+			set.insert(first, last);
+			std::fill(bytes.begin() + first, bytes.begin() + last, true);
+		} // if
+
+		boost::int64_t const pos = std::rand() % TEST_BYTES;
+		boost::int64_t end = pos;
+		while (end < TEST_BYTES && bytes[end])
+			++end;
+		BOOST_CHECK(set.contiguous_end(pos) == end);
+	} // for
+
+	/*  Intervals are disjoint and not touching */
+	boost::int64_t previous_end = -1;
+	for (byte_interval_set::const_iterator it = set.begin(); it != set.end(); ++it) {
+		BOOST_CHECK(it->first > previous_end && it->first < it->second);
+		previous_end = it->second;
+	} // for
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_insert();
+	check_contains();
+	check_erase_before();
+	check_random();
+	return 0;
+}
+
+#undef TEST_BYTES
+#undef TEST_ROUNDS
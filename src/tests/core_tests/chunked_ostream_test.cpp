@@ -0,0 +1,295 @@
+#include "hs_chunked_ostream_impl.hpp"
+#include "multipart_byteranges_reply.hpp"
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_FILE_SIZE (256 * 1024)
+#define TEST_CHUNK_SIZE (16 * 1024)
+#define TEST_FILE_PATH "chunked_ostream_test.data"
+#define TEST_HEADERS "HTTP/1.1 200 OK\r\n\r\n"
+
+namespace {
+
+using namespace t2h_core::details;
+
+static inline char byte_at(boost::int64_t pos)
+{
+	return (char)(pos % 251);
+}
+
+static void create_test_file()
+{
+	std::ofstream file(TEST_FILE_PATH, std::ios::out | std::ios::binary | std::ios::trunc);
+	for (boost::int64_t pos = 0; pos < TEST_FILE_SIZE; ++pos)
+		file.put(byte_at(pos));
+}
+
+/* Transport which collects the reply, zero-copy(sendfile) emulated by pread */
+class test_transport_ostream : public common::base_transport_ostream {
+public :
+	explicit test_transport_ostream(bool zero_copy)
+		: common::base_transport_ostream(), reply(), file_writes(0), zero_copy_(zero_copy) { }
+
+	virtual std::size_t write(char const * bytes, std::size_t bytes_size)
+	{
+		reply.append(bytes, bytes_size);
+		return bytes_size;
+	}
+
+	virtual void async_write(
+		char const * bytes, std::size_t bytes_size, write_compeletion_routine_type com_routine)
+		{ com_routine(-1, write(bytes, bytes_size)); }
+
+	virtual bool is_zero_copy_supported() const
+		{ return zero_copy_; }
+
+	virtual std::size_t write_file(int fd, boost::int64_t offset, std::size_t bytes_size)
+	{
+		std::vector<char> bytes(bytes_size);
+		ssize_t const readed = ::pread(fd, &bytes[0], bytes_size, offset);
+		if (readed <= 0)
+			return 0;
+		++file_writes;
+		return write(&bytes[0], readed);
+	}
+
+	std::string reply;
+	std::size_t file_writes;
+
+private :
+	bool const zero_copy_;
+
+};
+
+class test_reply : public http_core_reply {
+public :
+	virtual bool get_reply_headers(http_data & hd, hc_reply_headers & headers)
+	{
+		headers.append(TEST_HEADERS);
+		return true;
+	}
+};
+
+static hs_chunked_ostream_params make_params(bool zero_copy, bool mmap_completed)
+{
+	hs_chunked_ostream_params const params = {
+		TEST_CHUNK_SIZE,
+		1,
+		false,
+		TEST_CHUNK_SIZE,
+		false,
+		zero_copy,
+		mmap_completed,
+		false,
+		0,
+		0,
+		false,
+		io_uring_reader_ptr(),
+		io_buffers_pool_ptr(new io_buffers_pool(TEST_CHUNK_SIZE, 4, 1)),
+		deadline_wheel_ptr(new deadline_wheel()),
+		resume_pool_ptr(),
+		resume_pool_ptr(),
+		egress_shaper_ptr(),
+		deadline_wheel_ptr(),
+		reader_progress_routine_type()
+	};
+	return params;
+}
+
+static bool check_reply(std::string const & reply, boost::int64_t first, boost::int64_t last)
+{
+	std::string const headers(TEST_HEADERS);
+	if (reply.size() != headers.size() + (last - first) || reply.compare(0, headers.size(), headers) != 0)
+		return false;
+	for (boost::int64_t pos = first; pos < last; ++pos)
+		if (reply[headers.size() + (pos - first)] != byte_at(pos))
+			return false;
+	return true;
+}
+
+/* Performs the reply the same way http_server_core does, returns the transport with the reply */
+static boost::shared_ptr<test_transport_ostream> perform(http_core_reply & reply,
+	http_data & hd,
+	hs_chunked_ostream_params const & params,
+	bool zero_copy_transport,
+	bool & performed)
+{
+	boost::shared_ptr<test_transport_ostream> const transport(new test_transport_ostream(zero_copy_transport));
+	http_server_ostream_policy_params const base_params = { false };
+	boost::shared_ptr<hs_chunked_ostream_impl> const ostream(new hs_chunked_ostream_impl(base_params, params));
+	ostream->set_ostream(transport);
+
+	hd.fi_buffer->registr_subscriber(hd.fi, ostream);
+	performed = ostream->perform(reply, hd);
+	hd.fi_buffer->unregistr_subscriber(hd.fi, ostream);
+	params.deadlines->stop();
+	return transport;
+}
+
+static boost::shared_ptr<test_transport_ostream> perform(file_info_buffer_ptr fi_buffer,
+	hc_file_info_ptr fi,
+	hs_chunked_ostream_params const & params,
+	bool zero_copy_transport,
+	boost::int64_t first,
+	boost::int64_t last,
+	bool & performed)
+{
+	http_data hd = { fi, fi_buffer, first, last - 1, utility::byte_ranges_type(), std::string() };
+	test_reply reply;
+	return perform(reply, hd, params, zero_copy_transport, performed);
+}
+
+static std::string header_value(std::string const & reply, std::string const & name)
+{
+	std::string::size_type const first = reply.find("\r\n" + name + ": ");
+	if (first == std::string::npos)
+		return std::string();
+	std::string::size_type const value = first + name.size() + 4;
+	return reply.substr(value, reply.find("\r\n", value) - value);
+}
+
+/* Body of the multipart/byteranges reply has the same size as Content-Length, 
+ 	each part has its Content-Range with the bytes of the range, body closed by the boundary */
+static bool check_multipart_reply(std::string const & reply, utility::byte_ranges_type const & ranges)
+{
+	std::string::size_type const headers_end = reply.find("\r\n\r\n");
+	std::string const content_type = header_value(reply, "Content-Type"), 
+		length = header_value(reply, "Content-Length");
+	std::string::size_type const boundary_pos = content_type.find("boundary=");
+	if (reply.compare(0, 13, "HTTP/1.1 206 ") != 0 || headers_end == std::string::npos || 
+		length.empty() || boundary_pos == std::string::npos)
+		return false;
+	std::string const body = reply.substr(headers_end + 4), boundary = content_type.substr(boundary_pos + 9);
+	if ((boost::int64_t)body.size() != boost::lexical_cast<boost::int64_t>(length))
+		return false;
+
+	std::string::size_type pos = 0;
+	for (std::size_t it = 0; it < ranges.size(); ++it) {
+		std::string const part = "\r\n--" + boundary + "\r\nContent-Type: application/octet-stream\r\n"
+			"Content-Range: bytes " + boost::lexical_cast<std::string>(ranges[it].first) + "-" + 
+			boost::lexical_cast<std::string>(ranges[it].last) + "/" + 
+			boost::lexical_cast<std::string>(TEST_FILE_SIZE) + "\r\n\r\n";
+		if (body.compare(pos, part.size(), part) != 0)
+			return false;
+		pos += part.size();
+		for (boost::int64_t byte = ranges[it].first; byte <= ranges[it].last; ++byte, ++pos)
+			if (pos >= body.size() || body[pos] != byte_at(byte))
+				return false;
+	} // for
+	return (body.substr(pos) == "\r\n--" + boundary + "--\r\n");
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_mapped_without_zero_copy()
+{
+	/*  Mapping is the path of the transports without zero-copy(or hc_zero_copy off) :
+	 	completed file sended from the mapping, which stays cached for the next readers */
+	file_info_buffer_ptr const fi_buffer(new file_info_buffer());
+	fi_buffer->on_file_add(TEST_FILE_PATH, TEST_FILE_SIZE, TEST_FILE_SIZE);
+	hc_file_info_ptr const fi = fi_buffer->get_info(TEST_FILE_PATH);
+	BOOST_REQUIRE(fi);
+
+	bool performed = false;
+	boost::shared_ptr<test_transport_ostream> transport =
+		perform(fi_buffer, fi, make_params(true, true), false, 1000, TEST_FILE_SIZE - 1000, performed);
+	BOOST_CHECK(performed && check_reply(transport->reply, 1000, TEST_FILE_SIZE - 1000));
+	BOOST_CHECK(transport->file_writes == 0 && fi->file_mapping);
+
+	transport = perform(fi_buffer, fi, make_params(false, true), true, 0, TEST_FILE_SIZE, performed);
+	BOOST_CHECK(performed && check_reply(transport->reply, 0, TEST_FILE_SIZE));
+	BOOST_CHECK(transport->file_writes == 0);
+	fi_buffer->stop_graceful();
+}
+
+static void check_zero_copy_preferred()
+{
+	/*  Zero-copy transport sends the completed file by sendfile, the mapping is not created */
+	file_info_buffer_ptr const fi_buffer(new file_info_buffer());
+	fi_buffer->on_file_add(TEST_FILE_PATH, TEST_FILE_SIZE, TEST_FILE_SIZE);
+	hc_file_info_ptr const fi = fi_buffer->get_info(TEST_FILE_PATH);
+	BOOST_REQUIRE(fi);
+
+	bool performed = false;
+	boost::shared_ptr<test_transport_ostream> const transport =
+		perform(fi_buffer, fi, make_params(true, true), true, 0, TEST_FILE_SIZE, performed);
+	BOOST_CHECK(performed && check_reply(transport->reply, 0, TEST_FILE_SIZE));
+	BOOST_CHECK(transport->file_writes > 0 && !fi->file_mapping);
+	fi_buffer->stop_graceful();
+}
+
+static void check_growing_not_mapped()
+{
+	/*  Growing file keeps the read path even without zero-copy */
+	file_info_buffer_ptr const fi_buffer(new file_info_buffer());
+	fi_buffer->on_file_add(TEST_FILE_PATH, TEST_FILE_SIZE, TEST_FILE_SIZE / 2);
+	hc_file_info_ptr const fi = fi_buffer->get_info(TEST_FILE_PATH);
+	BOOST_REQUIRE(fi);
+
+	bool performed = false;
+	boost::shared_ptr<test_transport_ostream> const transport =
+		perform(fi_buffer, fi, make_params(false, true), false, 0, TEST_FILE_SIZE / 2, performed);
+	BOOST_CHECK(performed && check_reply(transport->reply, 0, TEST_FILE_SIZE / 2));
+	BOOST_CHECK(!fi->file_mapping);
+	fi_buffer->stop_graceful();
+}
+
+static void check_multipart()
+{
+	/*  Parts cross the chunk bounds and end at the last byte of the file, 
+	 	the same body by the read path and by the mapping */
+	file_info_buffer_ptr const fi_buffer(new file_info_buffer());
+	fi_buffer->on_file_add(TEST_FILE_PATH, TEST_FILE_SIZE, TEST_FILE_SIZE);
+	hc_file_info_ptr const fi = fi_buffer->get_info(TEST_FILE_PATH);
+	BOOST_REQUIRE(fi);
+
+	utility::byte_ranges_type ranges;
+	utility::byte_range const first = { 0, 0 }, crossed = { TEST_CHUNK_SIZE - 10, 2 * TEST_CHUNK_SIZE + 5 }, 
+		tail = { TEST_FILE_SIZE - 100, TEST_FILE_SIZE - 1 };
+	ranges.push_back(first);
+	ranges.push_back(crossed);
+	ranges.push_back(tail);
+	for (int zero_copy = 0; zero_copy < 2; ++zero_copy) {
+		http_data hd = { fi, fi_buffer, first.first, tail.last, ranges, std::string() };
+		multipart_byteranges_reply reply;
+		bool performed = false;
+		boost::shared_ptr<test_transport_ostream> const transport = 
+			perform(reply, hd, make_params(zero_copy == 1, true), zero_copy == 1, performed);
+		BOOST_CHECK(performed && check_multipart_reply(transport->reply, ranges));
+	} // for
+	fi_buffer->stop_graceful();
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	create_test_file();
+	check_mapped_without_zero_copy();
+	check_zero_copy_preferred();
+	check_growing_not_mapped();
+	check_multipart();
+	std::remove(TEST_FILE_PATH);
+	return 0;
+}
+
+#undef TEST_FILE_SIZE
+#undef TEST_CHUNK_SIZE
+#undef TEST_FILE_PATH
+#undef TEST_HEADERS
@@ -0,0 +1,141 @@
+#include "http_server_utility.hpp"
+
+#include <iostream>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_INFO_HASH "0123456789abcdef0123456789abcdef01234567"
+#define TEST_FILE_INDEX 3
+#define TEST_LAST_MODIFIED 784111777		// Sun, 06 Nov 1994 08:49:37 GMT
+
+#define TEST_SAME_DATE "Sun, 06 Nov 1994 08:49:37 GMT"
+#define TEST_LATER_DATE "Mon, 07 Nov 1994 08:49:37 GMT"
+#define TEST_EARLIER_DATE "Sat, 05 Nov 1994 08:49:37 GMT"
+#define TEST_BAD_DATE "Sunday, 06-Nov-94 08:49:37 GMT"
+#define TEST_ETAG "\"" TEST_INFO_HASH "-3\""
+#define TEST_PARTIAL_ETAG "\"" TEST_INFO_HASH "-3-partial\""
+
+namespace {
+
+using namespace t2h_core::details;
+
+enum file_state { completed, partial, unknown };
+
+/* Validators as file_info_buffer::get_validators gives them for the file in the state */
+static hc_file_validators make_validators(file_state state)
+{
+	bool const is_completed = (state == completed);
+	hc_file_validators const validators = {
+		utility::http_etag(state == unknown ? std::string() : std::string(TEST_INFO_HASH), TEST_FILE_INDEX, is_completed),
+		is_completed ? TEST_LAST_MODIFIED : 0,
+		is_completed };
+	return validators;
+}
+
+struct conditional_case {
+	file_state state;
+	char const * if_none_match;
+	char const * if_modified_since;
+	char const * if_range;
+	bool ex_not_modified;			// 304 instead of the content
+	bool ex_range_applicable;		// 206 instead of 200 with the whole content
+} conditional_cases[] = {
+	/*  No conditions */
+	{ completed, "", "", "", false, true },
+	{ partial, "", "", "", false, true },
+	{ unknown, "", "", "", false, true },
+
+	/*  If-None-Match, weak comparison */
+	{ completed, TEST_ETAG, "", "", true, true },
+	{ completed, "W/" TEST_ETAG, "", "", true, true },
+	{ completed, "\"other-1\", " TEST_ETAG, "", "", true, true },
+	{ completed, "*", "", "", true, true },
+	{ completed, TEST_PARTIAL_ETAG, "", "", false, true },
+	{ partial, TEST_ETAG, "", "", false, true },
+	{ partial, TEST_PARTIAL_ETAG, "", "", true, true },
+	{ unknown, "*", "", "", false, true },
+
+	/*  If-Modified-Since, only for the completed file and only without If-None-Match */
+	{ completed, "", TEST_SAME_DATE, "", true, true },
+	{ completed, "", TEST_LATER_DATE, "", true, true },
+	{ completed, "", TEST_EARLIER_DATE, "", false, true },
+	{ completed, "", TEST_BAD_DATE, "", false, true },
+	{ partial, "", TEST_SAME_DATE, "", false, true },
+	{ completed, "\"other-1\"", TEST_SAME_DATE, "", false, true },
+	{ completed, TEST_ETAG, TEST_EARLIER_DATE, "", true, true },
+
+	/*  If-Range, strong comparison of the entity tag or exact date */
+	{ completed, "", "", TEST_ETAG, false, true },
+	{ completed, "", "", "W/" TEST_ETAG, false, false },
+	{ completed, "", "", TEST_PARTIAL_ETAG, false, false },
+	{ partial, "", "", TEST_PARTIAL_ETAG, false, true },
+	{ partial, "", "", TEST_ETAG, false, false },
+	{ unknown, "", "", TEST_ETAG, false, false },
+	{ completed, "", "", TEST_SAME_DATE, false, true },
+	{ completed, "", "", TEST_LATER_DATE, false, false },
+	{ completed, "", "", TEST_EARLIER_DATE, false, false },
+	{ completed, "", "", TEST_BAD_DATE, false, false },
+	{ partial, "", "", TEST_SAME_DATE, false, false },
+
+	/*  Conditions together */
+	{ completed, TEST_ETAG, "", TEST_ETAG, true, true },
+	{ completed, "\"other-1\"", "", TEST_PARTIAL_ETAG, false, false }
+};
+
+/**
+ *	Test cases
+ */
+
+static void check_etags()
+{
+	/*  Entity tag does not depend on the time, completion changes it */
+	BOOST_CHECK(make_validators(completed).etag == TEST_ETAG);
+	BOOST_CHECK(make_validators(partial).etag == TEST_PARTIAL_ETAG);
+	BOOST_CHECK(make_validators(unknown).etag.empty());
+	BOOST_CHECK(utility::http_parse_gmt_time(TEST_SAME_DATE) == TEST_LAST_MODIFIED);
+}
+
+static void check_matrix()
+{
+	for (std::size_t it = 0; it < sizeof(conditional_cases) / sizeof(conditional_cases[0]); ++it) {
+		conditional_case const & test_case = conditional_cases[it];
+		hc_file_validators const validators = make_validators(test_case.state);
+		utility::conditional_header conditions;
+		conditions.if_none_match = test_case.if_none_match;
+		conditions.if_modified_since = test_case.if_modified_since;
+		conditions.if_range = test_case.if_range;
+
+		bool const not_modified = is_not_modified(validators, conditions),
+			range_applicable = is_range_applicable(validators, conditions);
+		if (not_modified != test_case.ex_not_modified || range_applicable != test_case.ex_range_applicable)
+			std::cerr << "case " << it << " : not modified '" << not_modified
+				<< "', range applicable '" << range_applicable << "'" << std::endl;
+		BOOST_CHECK(not_modified == test_case.ex_not_modified);
+		BOOST_CHECK(range_applicable == test_case.ex_range_applicable);
+	} // for
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_etags();
+	check_matrix();
+	return 0;
+}
+
+#undef TEST_INFO_HASH
+#undef TEST_FILE_INDEX
+#undef TEST_LAST_MODIFIED
+#undef TEST_SAME_DATE
+#undef TEST_LATER_DATE
+#undef TEST_EARLIER_DATE
+#undef TEST_BAD_DATE
+#undef TEST_ETAG
+#undef TEST_PARTIAL_ETAG
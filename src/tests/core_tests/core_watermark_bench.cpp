@@ -0,0 +1,88 @@
+#include "core_watermark.hpp"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Watermark wakeup latency benchmark.
+ * Publisher moves the watermark of the file once per interval, waiter threads sleep on it
+ * and measure the time from the publish to own wakeup.
+ * Usage : core_watermark_bench [waiter threads] [publishes] [interval us]
+ */
+
+namespace {
+
+using namespace t2h_core;
+using namespace boost::posix_time;
+
+static void waiter_loop(core_watermark & watermark,
+	std::vector<ptime> const & published,
+	std::size_t publishes,
+	std::vector<boost::int64_t> & latencies)
+{
+	/*  Each step waits for the next value, slow waiter could see a few publishes at once, 
+	 	each of them measured from own publish time */
+	for (boost::int64_t needed = 1; needed <= (boost::int64_t)publishes; ++needed) {
+		for (;;) {
+			int const epoch = watermark.prepare_wait();
+			if (watermark.get() >= needed) {
+				watermark.cancel_wait();
+				break;
+			} // if
+			watermark.wait(epoch, seconds(1));
+		} // for
+		latencies.push_back((microsec_clock::universal_time() - published[needed - 1]).total_microseconds());
+	} // for
+}
+
+static void print_latencies(std::vector<std::vector<boost::int64_t> > const & all_latencies)
+{
+	std::vector<boost::int64_t> latencies;
+	for (std::size_t it = 0; it < all_latencies.size(); ++it)
+		latencies.insert(latencies.end(), all_latencies[it].begin(), all_latencies[it].end());
+	if (latencies.empty())
+		return;
+	std::sort(latencies.begin(), latencies.end());
+	std::cout << "wakeups : " << latencies.size()
+		<< ", p50 " << latencies[latencies.size() / 2] << " us"
+		<< ", p99 " << latencies[latencies.size() * 99 / 100] << " us"
+		<< ", max " << latencies.back() << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	std::size_t const waiters = argc > 1 ? boost::lexical_cast<std::size_t>(argv[1]) : 4;
+	std::size_t const publishes = argc > 2 ? boost::lexical_cast<std::size_t>(argv[2]) : 1000;
+	std::size_t const interval_us = argc > 3 ? boost::lexical_cast<std::size_t>(argv[3]) : 1000;
+	if (waiters == 0 || publishes == 0) {
+		std::cerr << "at least 1 waiter and 1 publish needed" << std::endl;
+		return 1;
+	}
+
+	core_watermark watermark;
+	std::vector<ptime> published(publishes);
+	std::vector<std::vector<boost::int64_t> > latencies(waiters);
+	boost::thread_group threads;
+	for (std::size_t it = 0; it < waiters; ++it)
+		threads.create_thread(boost::bind(waiter_loop,
+			boost::ref(watermark), boost::cref(published), publishes, boost::ref(latencies[it])));
+
+	for (std::size_t it = 0; it < publishes; ++it) {
+		boost::this_thread::sleep(microseconds(interval_us));
+		published[it] = microsec_clock::universal_time();
+		watermark.publish(it + 1);
+	} // for
+	threads.join_all();
+
+	std::cout << waiters << " waiters, " << publishes << " publishes, interval " << interval_us << " us" << std::endl;
+	print_latencies(latencies);
+	return 0;
+}
+
@@ -0,0 +1,146 @@
+#include "core_watermark.hpp"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <boost/atomic.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_ROUNDS 2000
+#define TEST_WAITERS 4
+#define TEST_WAIT_SECS 5				// Lost wakeup costs the whole wait
+#define TEST_WAKEUP_MS 1000				// Max time of the one round
+
+namespace {
+
+using namespace t2h_core;
+using namespace boost::posix_time;
+
+/* Waits till the watermark reaches the needed value or closed, false on the closed one */
+static bool wait_for(core_watermark & watermark, boost::int64_t needed)
+{
+	for (;;) {
+		int const epoch = watermark.prepare_wait();
+		if (watermark.get() >= needed || watermark.is_closed()) {
+			watermark.cancel_wait();
+			return (watermark.get() >= needed);
+		} // if
+		/* Publish could come between the check and the sleep */
+		boost::this_thread::yield();
+		watermark.wait(epoch, seconds(TEST_WAIT_SECS));
+	} // for
+}
+
+static void round_waiter(core_watermark & watermark, boost::atomic<int> & acked)
+{
+	for (int round = 1; round <= TEST_ROUNDS; ++round) {
+		if (!wait_for(watermark, round))
+			return;
+		acked.fetch_add(1);
+	} // for
+}
+
+static void closed_waiter(core_watermark & watermark, bool & result)
+{
+	result = wait_for(watermark, 1);
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_publish()
+{
+	/*  Watermark never goes back */
+	core_watermark watermark;
+	BOOST_CHECK(watermark.get() == 0 && !watermark.is_closed());
+	watermark.publish(100);
+	watermark.publish(50);
+	BOOST_CHECK(watermark.get() == 100);
+	watermark.publish(200);
+	BOOST_CHECK(watermark.get() == 200);
+
+	/*  Epoch taken before the publish is changed by it, so the wait returns at once */
+	int const epoch = watermark.prepare_wait();
+	watermark.publish(300);
+	ptime const started = microsec_clock::universal_time();
+	watermark.wait(epoch, seconds(TEST_WAIT_SECS));
+	BOOST_CHECK((microsec_clock::universal_time() - started).total_milliseconds() < TEST_WAKEUP_MS);
+}
+
+static void check_lost_wakeup()
+{
+	/*  Each round published right after all waiters saw the previous one, so the publish
+	 	races with their prepare_wait/check/wait. Lost wakeup stalls the round for the whole wait */
+	core_watermark watermark;
+	boost::atomic<int> acked(0);
+	boost::thread_group threads;
+	for (std::size_t it = 0; it < TEST_WAITERS; ++it)
+		threads.create_thread(boost::bind(round_waiter, boost::ref(watermark), boost::ref(acked)));
+
+	/*  First stalled round stops the test, waiters of the closed watermark return at once */
+	boost::int64_t max_round_ms = 0;
+	for (int round = 1; round <= TEST_ROUNDS && max_round_ms < TEST_WAKEUP_MS; ++round) {
+		ptime const started = microsec_clock::universal_time();
+		watermark.publish(round);
+		while (acked.load() < round * TEST_WAITERS)
+			boost::this_thread::yield();
+		max_round_ms = std::max(max_round_ms, (microsec_clock::universal_time() - started).total_milliseconds());
+	} // for
+	watermark.close();
+	threads.join_all();
+	BOOST_CHECK(max_round_ms < TEST_WAKEUP_MS);
+}
+
+static void check_close()
+{
+	/*  Close wakes the waiter, which never gets its bytes */
+	core_watermark watermark;
+	bool result = true;
+	ptime const started = microsec_clock::universal_time();
+	boost::thread waiter(boost::bind(closed_waiter, boost::ref(watermark), boost::ref(result)));
+	boost::this_thread::sleep(milliseconds(100));
+	watermark.close();
+	waiter.join();
+	BOOST_CHECK(!result && watermark.is_closed());
+	BOOST_CHECK((microsec_clock::universal_time() - started).total_milliseconds() < TEST_WAKEUP_MS);
+}
+
+static void check_table()
+{
+	/*  New add of the file closes the watermark of the previous add */
+	core_watermark_table table;
+	core_watermark_ptr const first = table.acquire("file");
+	BOOST_CHECK(first && table.find("file") == first && !table.find("other"));
+	core_watermark_ptr const second = table.acquire("file");
+	BOOST_CHECK(first->is_closed() && !second->is_closed() && table.find("file") == second);
+	table.release("file");
+	BOOST_CHECK(second->is_closed() && !table.find("file"));
+	table.release("file");
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_publish();
+	check_lost_wakeup();
+	check_close();
+	check_table();
+	return 0;
+}
+
+#undef TEST_ROUNDS
+#undef TEST_WAITERS
+#undef TEST_WAIT_SECS
+#undef TEST_WAKEUP_MS
@@ -0,0 +1,167 @@
+#include "deadline_wheel.hpp"
+
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_CALLBACK_MS 500			// Duration of the slow callback
+
+namespace {
+
+using namespace t2h_core::details;
+using namespace boost::posix_time;
+
+struct callback_state {
+	callback_state() : lock(), started(false), finished(false), calls(0) { }
+
+	boost::mutex lock;
+	bool started;
+	bool finished;
+	int calls;
+};
+
+static void count_callback(callback_state & state)
+{
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	++state.calls;
+}
+
+static void slow_callback(callback_state & state, boost::shared_ptr<int> owner)
+{
+	{
+		boost::lock_guard<boost::mutex> guard(state.lock);
+		state.started = true;
+	}
+	boost::this_thread::sleep(milliseconds(TEST_CALLBACK_MS));
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	state.finished = true;
+}
+
+static void self_cancel_callback(deadline_wheel & wheel, deadline_wheel::timer_id const & id, callback_state & state)
+{
+	bool const canceled = wheel.cancel(id);
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	state.finished = !canceled;
+}
+
+static int get_calls(callback_state & state)
+{
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	return state.calls;
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_cancel()
+{
+	deadline_wheel wheel;
+	callback_state state;
+	deadline_wheel::timer_id const id = wheel.schedule(1, boost::bind(count_callback, boost::ref(state)));
+	BOOST_CHECK(id != deadline_wheel::invalid_timer && wheel.size() == 1);
+	BOOST_CHECK(wheel.cancel(id) && wheel.size() == 0);
+	BOOST_CHECK(!wheel.cancel(id));
+	boost::this_thread::sleep(milliseconds(2500));
+	BOOST_CHECK(get_calls(state) == 0);
+}
+
+static void check_cancel_running()
+{
+	/*  Cancel of the fired timer waits for its running callback, after the cancel 
+	 	the callback does not own the bound state, even if the next timer of the tick is running */
+	callback_state state, next_state;
+	boost::shared_ptr<int> owner(new int(0));
+	deadline_wheel wheel;
+	deadline_wheel::timer_id const id = wheel.schedule(1, boost::bind(slow_callback, boost::ref(state), owner));
+	wheel.schedule(1, boost::bind(slow_callback, boost::ref(next_state), boost::shared_ptr<int>()));
+	for (;; boost::this_thread::sleep(milliseconds(10))) {
+		boost::lock_guard<boost::mutex> guard(state.lock);
+		if (state.started)
+			break;
+	} // for
+
+	BOOST_CHECK(!wheel.cancel(id));
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	BOOST_CHECK(state.finished && owner.unique());
+}
+
+static void check_self_cancel()
+{
+	/*  Callback which cancels own timer does not wait for itself */
+	callback_state state;
+	deadline_wheel::timer_id id = deadline_wheel::invalid_timer;
+	deadline_wheel wheel;
+	id = wheel.schedule(1, boost::bind(self_cancel_callback, boost::ref(wheel), boost::cref(id), boost::ref(state)));
+	boost::this_thread::sleep(milliseconds(2500));
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	BOOST_CHECK(state.finished);
+}
+
+static void check_rounds()
+{
+	/*  Two slots : timers of 1 and 3 secs share the slot, the later one fires at its own round */
+	deadline_wheel wheel(2);
+	callback_state first, second;
+	wheel.schedule(1, boost::bind(count_callback, boost::ref(first)));
+	wheel.schedule(3, boost::bind(count_callback, boost::ref(second)));
+	wheel.schedule(5, boost::bind(count_callback, boost::ref(second)));
+
+	boost::this_thread::sleep(milliseconds(1500));
+	BOOST_CHECK(get_calls(first) == 1 && get_calls(second) == 0 && wheel.size() == 2);
+	boost::this_thread::sleep(milliseconds(2000));
+	BOOST_CHECK(get_calls(first) == 1 && get_calls(second) == 1 && wheel.size() == 1);
+	boost::this_thread::sleep(milliseconds(2000));
+	BOOST_CHECK(get_calls(second) == 2 && wheel.size() == 0);
+}
+
+static void check_fine_tick()
+{
+	/*  Delay in ms rounded up to the tick, secs counted by ticks too */
+	deadline_wheel wheel(deadline_wheel::default_slots, 10);
+	callback_state fast, slow;
+	wheel.schedule_ms(25, boost::bind(count_callback, boost::ref(fast)));
+	wheel.schedule(1, boost::bind(count_callback, boost::ref(slow)));
+	boost::this_thread::sleep(milliseconds(200));
+	BOOST_CHECK(get_calls(fast) == 1 && get_calls(slow) == 0 && wheel.size() == 1);
+	boost::this_thread::sleep(milliseconds(1000));
+	BOOST_CHECK(get_calls(slow) == 1 && wheel.size() == 0);
+}
+
+static void check_stop()
+{
+	/*  Timers dropped by the stop are never called */
+	callback_state state;
+	{
+		deadline_wheel wheel;
+		wheel.schedule(1, boost::bind(count_callback, boost::ref(state)));
+		wheel.stop();
+		BOOST_CHECK(wheel.size() == 0);
+	}
+	BOOST_CHECK(get_calls(state) == 0);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_cancel();
+	check_cancel_running();
+	check_self_cancel();
+	check_rounds();
+	check_fine_tick();
+	check_stop();
+	return 0;
+}
+
+#undef TEST_CALLBACK_MS
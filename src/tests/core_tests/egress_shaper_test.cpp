@@ -0,0 +1,245 @@
+#include "egress_shaper.hpp"
+
+#include <vector>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_QUANTUM 10000
+#define TEST_RATE 100000				// One quantum per 100 ms
+#define TEST_FAST_MS 50					// Grant without waiting
+#define TEST_WAIT_MS 5000				// Waiting for the result timeout value
+
+namespace {
+
+using namespace t2h_core::details;
+using namespace boost::posix_time;
+
+static egress_limits make_limits(std::size_t global_rate, std::size_t file_rate, std::size_t connection_rate)
+{
+	egress_limits const limits = { global_rate, file_rate, connection_rate };
+	return limits;
+}
+
+static inline boost::int64_t elapsed_ms(ptime const & started)
+{
+	return (microsec_clock::universal_time() - started).total_milliseconds();
+}
+
+struct grants_order {
+	grants_order() : lock(), order() { }
+
+	boost::mutex lock;
+	std::vector<int> order;
+};
+
+static void ordered_acquire(egress_shaper & shaper, egress_stream & stream, int id, grants_order & grants)
+{
+	shaper.acquire(stream, TEST_QUANTUM);
+	boost::lock_guard<boost::mutex> guard(grants.lock);
+	grants.order.push_back(id);
+}
+
+static void timed_acquire(egress_shaper & shaper, egress_stream & stream, boost::int64_t & granted_ms)
+{
+	ptime const started = microsec_clock::universal_time();
+	shaper.acquire(stream, TEST_QUANTUM);
+	granted_ms = elapsed_ms(started);
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_unlimited()
+{
+	egress_shaper shaper(make_limits(0, 0, 0), TEST_QUANTUM);
+	egress_stream stream;
+	shaper.attach(stream, "file");
+	BOOST_CHECK(shaper.acquire(stream, TEST_QUANTUM * 10) == TEST_QUANTUM * 10);
+	shaper.settle(stream, TEST_QUANTUM * 10, TEST_QUANTUM * 10);
+	shaper.detach(stream);
+
+	egress_shaper_stat const stat = shaper.get_stat();
+	BOOST_CHECK(stat.streams == 0 && stat.finished == 1 && stat.bytes == TEST_QUANTUM * 10);
+}
+
+static void check_quantum()
+{
+	/*  Full bucket grants at once, each grant not more than the quantum */
+	egress_shaper shaper(make_limits(0, 0, TEST_RATE), TEST_QUANTUM);
+	egress_stream stream;
+	shaper.attach(stream, "file");
+	ptime const started = microsec_clock::universal_time();
+	BOOST_CHECK(shaper.acquire(stream, TEST_QUANTUM * 10) == TEST_QUANTUM);
+	BOOST_CHECK(shaper.acquire(stream, TEST_QUANTUM / 2) == TEST_QUANTUM / 2);
+	BOOST_CHECK(elapsed_ms(started) < TEST_FAST_MS);
+	shaper.detach(stream);
+}
+
+static void check_settle_debt()
+{
+	/*  Bytes sended beyond the grant paid by the next waiting,
+	 	not sended bytes of the grant returned to the budget */
+	egress_shaper shaper(make_limits(0, 0, TEST_RATE), TEST_QUANTUM);
+	egress_stream stream;
+	shaper.attach(stream, "file");
+
+	boost::int64_t granted = shaper.acquire(stream, TEST_QUANTUM);
+	shaper.settle(stream, granted, 0);
+	ptime started = microsec_clock::universal_time();
+	granted = shaper.acquire(stream, TEST_QUANTUM);
+	BOOST_CHECK(elapsed_ms(started) < TEST_FAST_MS);
+
+	shaper.settle(stream, granted, granted + TEST_RATE / 2);
+	started = microsec_clock::universal_time();
+	shaper.acquire(stream, TEST_QUANTUM);
+	boost::int64_t const waited_ms = elapsed_ms(started);
+	BOOST_CHECK(waited_ms >= 450 && waited_ms < TEST_WAIT_MS);
+	BOOST_CHECK(stream.bytes == granted + TEST_RATE / 2);
+	shaper.detach(stream);
+}
+
+static void check_fifo()
+{
+	/*  Global budget goes to the streams in the order of their waiting, 
+	 	both of them wait for the debt of the first one */
+	egress_shaper shaper(make_limits(TEST_RATE, 0, 0), TEST_QUANTUM);
+	egress_stream first, second;
+	shaper.attach(first, "first");
+	shaper.attach(second, "second");
+	shaper.settle(first, shaper.acquire(first, TEST_QUANTUM), TEST_RATE / 2);
+
+	grants_order grants;
+	boost::thread first_waiter(boost::bind(ordered_acquire, boost::ref(shaper), boost::ref(first), 1, boost::ref(grants)));
+	boost::this_thread::sleep(milliseconds(20));
+	boost::thread second_waiter(boost::bind(ordered_acquire, boost::ref(shaper), boost::ref(second), 2, boost::ref(grants)));
+	first_waiter.join();
+	second_waiter.join();
+	BOOST_CHECK(grants.order.size() == 2 && grants.order[0] == 1 && grants.order[1] == 2);
+	shaper.detach(first);
+	shaper.detach(second);
+}
+
+static void check_own_budget_does_not_block()
+{
+	/*  First waiting stream limited by own budget, the next one must not wait for it */
+	egress_shaper shaper(make_limits(0, 0, TEST_RATE), TEST_QUANTUM);
+	egress_stream limited, other;
+	shaper.attach(limited, "file");
+	shaper.attach(other, "file");
+	shaper.settle(limited, shaper.acquire(limited, TEST_QUANTUM), TEST_RATE);
+
+	boost::int64_t limited_ms = 0, other_ms = 0;
+	boost::thread limited_waiter(boost::bind(timed_acquire, boost::ref(shaper), boost::ref(limited), boost::ref(limited_ms)));
+	boost::this_thread::sleep(milliseconds(20));
+	boost::thread other_waiter(boost::bind(timed_acquire, boost::ref(shaper), boost::ref(other), boost::ref(other_ms)));
+	other_waiter.join();
+	limited_waiter.join();
+	BOOST_CHECK(other_ms < TEST_FAST_MS && limited_ms >= 800);
+	shaper.detach(limited);
+	shaper.detach(other);
+}
+
+static void check_limits_change()
+{
+	/*  Waiting stream sees new limits : shaping off, raised limit and stop release it */
+	egress_shaper shaper(make_limits(0, 0, 1), TEST_QUANTUM);
+	egress_stream streams[3];
+	boost::int64_t granted_ms[3] = { 0, 0, 0 };
+	for (std::size_t it = 0; it < 3; ++it) {
+		shaper.attach(streams[it], "file");
+		shaper.settle(streams[it], shaper.acquire(streams[it], TEST_QUANTUM), TEST_QUANTUM * 2);
+	} // for
+
+	boost::thread off_waiter(boost::bind(timed_acquire, boost::ref(shaper), boost::ref(streams[0]), boost::ref(granted_ms[0])));
+	boost::this_thread::sleep(milliseconds(200));
+	BOOST_CHECK(shaper.get_stat().waiting == 1);
+	shaper.set_limits(make_limits(0, 0, 0));
+	off_waiter.join();
+	BOOST_CHECK(granted_ms[0] >= 200 && granted_ms[0] < TEST_WAIT_MS);
+	BOOST_CHECK(shaper.get_limits().connection_rate == 0 && shaper.get_stat().waiting == 0);
+
+	shaper.set_limits(make_limits(0, 0, 1));
+	boost::thread raised_waiter(boost::bind(timed_acquire, boost::ref(shaper), boost::ref(streams[1]), boost::ref(granted_ms[1])));
+	boost::this_thread::sleep(milliseconds(200));
+	shaper.set_limits(make_limits(0, 0, TEST_RATE * 10));
+	raised_waiter.join();
+	BOOST_CHECK(granted_ms[1] >= 200 && granted_ms[1] < TEST_WAIT_MS);
+
+	shaper.set_limits(make_limits(0, 0, 1));
+	boost::thread stopped_waiter(boost::bind(timed_acquire, boost::ref(shaper), boost::ref(streams[2]), boost::ref(granted_ms[2])));
+	boost::this_thread::sleep(milliseconds(200));
+	shaper.stop();
+	stopped_waiter.join();
+	BOOST_CHECK(granted_ms[2] >= 200 && granted_ms[2] < TEST_WAIT_MS);
+	BOOST_CHECK(shaper.acquire(streams[2], TEST_QUANTUM * 10) == TEST_QUANTUM * 10);
+	for (std::size_t it = 0; it < 3; ++it)
+		shaper.detach(streams[it]);
+}
+
+static void check_try_acquire()
+{
+	/*  Not granted stream gets the delay and keeps its place : the blocking waiter behind it 
+	 	waits till the stream takes its grant or cancels the waiting */
+	egress_shaper shaper(make_limits(TEST_RATE, 0, 0), TEST_QUANTUM);
+	egress_stream parked, blocked;
+	shaper.attach(parked, "first");
+	shaper.attach(blocked, "second");
+	std::size_t delay_ms = 0;
+	BOOST_CHECK(shaper.try_acquire(parked, TEST_QUANTUM, delay_ms) == TEST_QUANTUM);
+	shaper.settle(parked, TEST_QUANTUM, TEST_RATE / 2);
+	BOOST_CHECK(shaper.try_acquire(parked, TEST_QUANTUM, delay_ms) == 0);
+	BOOST_CHECK(delay_ms >= 1 && delay_ms <= 100 && shaper.get_stat().waiting == 1);
+
+	grants_order grants;
+	boost::thread blocked_waiter(boost::bind(ordered_acquire, boost::ref(shaper), boost::ref(blocked), 2, boost::ref(grants)));
+	ptime const started = microsec_clock::universal_time();
+	boost::int64_t granted = 0;
+	while ((granted = shaper.try_acquire(parked, TEST_QUANTUM, delay_ms)) == 0 && elapsed_ms(started) < TEST_WAIT_MS)
+		boost::this_thread::sleep(milliseconds(delay_ms));
+	{
+		boost::lock_guard<boost::mutex> guard(grants.lock);
+		grants.order.push_back(1);
+	}
+	blocked_waiter.join();
+	BOOST_CHECK(granted == TEST_QUANTUM && grants.order.size() == 2 && grants.order[0] == 1 && grants.order[1] == 2);
+
+	/*  Cancelled(or detached) waiting stream does not block others */
+	shaper.settle(blocked, TEST_QUANTUM, TEST_RATE / 2);
+	BOOST_CHECK(shaper.try_acquire(parked, TEST_QUANTUM, delay_ms) == 0);
+	shaper.cancel_wait(parked);
+	BOOST_CHECK(shaper.get_stat().waiting == 0 && parked.throttled.total_milliseconds() >= 400);
+	BOOST_CHECK(shaper.try_acquire(parked, TEST_QUANTUM, delay_ms) == 0);
+	shaper.detach(parked);
+	BOOST_CHECK(shaper.get_stat().waiting == 0);
+	shaper.detach(blocked);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_unlimited();
+	check_quantum();
+	check_settle_debt();
+	check_fifo();
+	check_own_budget_does_not_block();
+	check_limits_change();
+	check_try_acquire();
+	return 0;
+}
+
+#undef TEST_QUANTUM
+#undef TEST_RATE
+#undef TEST_FAST_MS
+#undef TEST_WAIT_MS
@@ -0,0 +1,167 @@
+#include "file_info_buffer.hpp"
+
+#include <vector>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * File info buffer contention benchmark.
+ * Lookup threads take random files(get_info + get_avaliable_end), updater threads move
+ * the avaliable bytes of random files, each file has own subscribers.
+ * Subscribers of the first file are slow, lookups and updates of other files must not wait for them.
+ * Usage : file_info_buffer_bench [files] [subscribers per file] [lookup threads] [secs] [slow subscriber ms]
+ */
+
+namespace {
+
+using namespace t2h_core::details;
+
+class bench_subscriber : public async_file_info_subscriber {
+public :
+	explicit bench_subscriber(std::size_t slow_ms)
+		: async_file_info_subscriber(), notifications(0), slow_ms_(slow_ms) { }
+
+	virtual void on_bytes_avaliable_change(boost::int64_t avaliable_bytes)
+	{
+		++notifications;
+		if (slow_ms_ > 0)
+			boost::this_thread::sleep(boost::posix_time::milliseconds(slow_ms_));
+	}
+
+	virtual void on_break() { }
+
+	virtual async_file_info_subscriber * clone()
+		{ return new bench_subscriber(slow_ms_); }
+
+	boost::uint64_t volatile notifications;
+
+private :
+	std::size_t slow_ms_;
+
+};
+
+struct bench_counters {
+	bench_counters() : operations(0), max_latency_us(0) { }
+
+	boost::uint64_t operations;
+	boost::int64_t max_latency_us;		// Max latency of the sampled operations
+};
+
+bool volatile bench_stop = false;
+
+static inline std::size_t next_random(std::size_t & seed)
+{
+	seed = seed * 1103515245 + 12345;
+	return (seed >> 16);
+}
+
+static void lookup_loop(file_info_buffer & fib, std::vector<std::string> const & paths, bench_counters & counters, std::size_t seed)
+{
+	using namespace boost::posix_time;
+	while (!bench_stop) {
+		bool const sampled = (counters.operations % 1024 == 0);
+		ptime const start = sampled ? microsec_clock::universal_time() : ptime();
+		hc_file_info_ptr fi = fib.get_info(paths[next_random(seed) % paths.size()]);
+		if (fi)
+			fib.get_avaliable_end(fi, 0);
+		if (sampled)
+			counters.max_latency_us = std::max(counters.max_latency_us,
+				(microsec_clock::universal_time() - start).total_microseconds());
+		++counters.operations;
+	} // while
+}
+
+static void update_loop(file_info_buffer & fib, std::vector<std::string> const & paths, bench_counters & counters, std::size_t seed)
+{
+	/*  First file(with slow subscribers) skipped, only lookups could touch it */
+	using namespace boost::posix_time;
+	while (!bench_stop) {
+		bool const sampled = (counters.operations % 64 == 0);
+		ptime const start = sampled ? microsec_clock::universal_time() : ptime();
+		std::size_t const index = 1 + next_random(seed) % (paths.size() - 1);
+		fib.update_info(paths[index], (boost::int64_t)(counters.operations + 1) * 16384);
+		if (sampled)
+			counters.max_latency_us = std::max(counters.max_latency_us,
+				(microsec_clock::universal_time() - start).total_microseconds());
+		++counters.operations;
+	} // while
+}
+
+static void slow_update_loop(file_info_buffer & fib, std::string const & path)
+{
+	for (boost::int64_t avaliable_bytes = 16384; !bench_stop; avaliable_bytes += 16384)
+		fib.update_info(path, avaliable_bytes);
+}
+
+static void print_counters(char const * name, std::vector<bench_counters> const & counters, double secs)
+{
+	boost::uint64_t operations = 0;
+	boost::int64_t max_latency_us = 0;
+	for (std::size_t it = 0; it < counters.size(); ++it) {
+		operations += counters[it].operations;
+		max_latency_us = std::max(max_latency_us, counters[it].max_latency_us);
+	}
+	std::cout << name << " : " << operations << " in " << secs << " s, "
+		<< (boost::uint64_t)(operations / secs) << " per sec, max sampled latency "
+		<< max_latency_us << " us" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	std::size_t const files = argc > 1 ? boost::lexical_cast<std::size_t>(argv[1]) : 4096;
+	std::size_t const subscribers = argc > 2 ? boost::lexical_cast<std::size_t>(argv[2]) : 4;
+	std::size_t const lookup_threads = argc > 3 ? boost::lexical_cast<std::size_t>(argv[3]) : 8;
+	std::size_t const secs = argc > 4 ? boost::lexical_cast<std::size_t>(argv[4]) : 5;
+	std::size_t const slow_ms = argc > 5 ? boost::lexical_cast<std::size_t>(argv[5]) : 50;
+	std::size_t const update_threads = 2;
+	if (files < 2) {
+		std::cerr << "at least 2 files needed" << std::endl;
+		return 1;
+	}
+
+	file_info_buffer fib;
+	std::vector<std::string> paths;
+	std::vector<boost::shared_ptr<bench_subscriber> > all_subscribers;
+	for (std::size_t it = 0; it < files; ++it) {
+		paths.push_back("file_info_buffer_bench_" + boost::lexical_cast<std::string>(it));
+		fib.on_file_add(paths.back(), (boost::int64_t)1 << 40, 0);
+		hc_file_info_ptr fi = fib.get_info(paths.back());
+		for (std::size_t sub = 0; sub < subscribers; ++sub) {
+			all_subscribers.push_back(boost::shared_ptr<bench_subscriber>(new bench_subscriber(it == 0 ? slow_ms : 0)));
+			fib.registr_subscriber(fi, all_subscribers.back());
+		}
+	} // for
+
+	std::vector<bench_counters> lookups(lookup_threads), updates(update_threads);
+	boost::thread_group threads;
+	threads.create_thread(boost::bind(slow_update_loop, boost::ref(fib), boost::cref(paths[0])));
+	for (std::size_t it = 0; it < lookup_threads; ++it)
+		threads.create_thread(boost::bind(lookup_loop, boost::ref(fib), boost::cref(paths), boost::ref(lookups[it]), it + 1));
+	for (std::size_t it = 0; it < update_threads; ++it)
+		threads.create_thread(boost::bind(update_loop, boost::ref(fib), boost::cref(paths), boost::ref(updates[it]), it + 101));
+
+	boost::posix_time::ptime const start = boost::posix_time::microsec_clock::universal_time();
+	boost::this_thread::sleep(boost::posix_time::seconds(secs));
+	bench_stop = true;
+	threads.join_all();
+	double const elapsed = (boost::posix_time::microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+
+	boost::uint64_t notifications = 0;
+	for (std::size_t it = 0; it < all_subscribers.size(); ++it)
+		notifications += all_subscribers[it]->notifications;
+
+	std::cout << files << " files, " << subscribers << " subscribers per file, "
+		<< lookup_threads << " lookup threads, slow subscriber " << slow_ms << " ms" << std::endl;
+	print_counters("lookups", lookups, elapsed);
+	print_counters("updates", updates, elapsed);
+	std::cout << "notifications : " << notifications << std::endl;
+
+	fib.stop_force();
+	return 0;
+}
+
@@ -0,0 +1,145 @@
+#include "file_info_buffer.hpp"
+
+#include <string>
+#include <iostream>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_INFO_HASH "0123456789abcdef0123456789abcdef01234567"
+#define TEST_OTHER_INFO_HASH "fedcba9876543210fedcba9876543210fedcba98"
+#define TEST_FILE_SIZE 1000
+
+namespace {
+
+using namespace t2h_core::details;
+
+/* File by the uri, the same way http_server_core looks up the route */
+static hc_file_info_ptr find_by_route(file_info_buffer const & fi_buffer, std::string const & uri)
+{
+	hc_torrent_id id;
+	int file_index = -1;
+	if (!utility::http_parse_file_route(uri, id.bytes, file_index))
+		return hc_file_info_ptr();
+	return fi_buffer.get_info(id, file_index);
+}
+
+static inline hc_file_info_ptr find_by_route(file_info_buffer const & fi_buffer, char const * info_hash, int file_index)
+	{ return find_by_route(fi_buffer, utility::http_file_route(info_hash, file_index)); }
+
+static std::string upper(std::string value)
+{
+	for (std::size_t it = 0; it < value.size(); ++it)
+		if (value[it] >= 'a' && value[it] <= 'f')
+			value[it] = value[it] - 'a' + 'A';
+	return value;
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_lookup()
+{
+	/*  Files of the torrent indexed by the file index, holes of the index have no file */
+	file_info_buffer fi_buffer;
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 0);
+	fi_buffer.on_file_add("b.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 2);
+	hc_file_info_ptr const a = fi_buffer.get_info("a.mkv"), b = fi_buffer.get_info("b.mkv");
+	BOOST_REQUIRE(a && b);
+
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_INFO_HASH, 0) == a);
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_INFO_HASH, 2) == b);
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 1));
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 3));
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 0));
+
+	/*  Hex of the route is case insensitive, index could have leading zeros */
+	BOOST_CHECK(find_by_route(fi_buffer, "/f/" + upper(TEST_INFO_HASH) + "/2") == b);
+	BOOST_CHECK(find_by_route(fi_buffer, "/f/" TEST_INFO_HASH "/002") == b);
+	BOOST_CHECK(!find_by_route(fi_buffer, "/f/" TEST_INFO_HASH "/2/"));
+	BOOST_CHECK(!find_by_route(fi_buffer, "/f/" TEST_INFO_HASH "/2/b.mkv"));
+	fi_buffer.stop_graceful();
+}
+
+static void check_readd()
+{
+	/*  Re-added file moves its route, the previous route has no file */
+	file_info_buffer fi_buffer;
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 1);
+	hc_file_info_ptr const a = fi_buffer.get_info("a.mkv");
+	BOOST_REQUIRE(a);
+
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 5);
+	BOOST_CHECK(fi_buffer.get_info("a.mkv") == a);
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 1) && find_by_route(fi_buffer, TEST_INFO_HASH, 5) == a);
+
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, TEST_OTHER_INFO_HASH, 5);
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 5) && find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 5) == a);
+
+	/*  Without the identity the file has only the path */
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0);
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 5) && fi_buffer.get_info("a.mkv") == a);
+	fi_buffer.stop_graceful();
+}
+
+static void check_remove()
+{
+	/*  Removed file drops its route, but not the route which already points to the other file */
+	file_info_buffer fi_buffer;
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 0);
+	fi_buffer.on_file_add("c.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 7);
+	fi_buffer.on_file_add("d.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, 7);
+	hc_file_info_ptr const d = fi_buffer.get_info("d.mkv");
+	BOOST_REQUIRE(d);
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_INFO_HASH, 7) == d);
+
+	fi_buffer.on_file_remove("c.mkv");
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_INFO_HASH, 7) == d);
+	fi_buffer.on_file_remove("a.mkv");
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 0) && find_by_route(fi_buffer, TEST_INFO_HASH, 7) == d);
+	fi_buffer.on_file_remove("d.mkv");
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 7));
+	fi_buffer.stop_graceful();
+}
+
+static void check_invalid_identity()
+{
+	/*  File with the invalid identity has no route. Graceful stop keeps the routes(the buffer is shared), 
+	 	force stop drops them */
+	file_info_buffer fi_buffer;
+	fi_buffer.on_file_add("a.mkv", TEST_FILE_SIZE, 0, "0123", 0);
+	fi_buffer.on_file_add("b.mkv", TEST_FILE_SIZE, 0, TEST_INFO_HASH, -1);
+	fi_buffer.on_file_add("c.mkv", TEST_FILE_SIZE, 0, TEST_OTHER_INFO_HASH, 0);
+	BOOST_CHECK(fi_buffer.get_info("a.mkv") && fi_buffer.get_info("b.mkv"));
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_INFO_HASH, 0));
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 0));
+
+	hc_torrent_id id;
+	BOOST_REQUIRE(utility::http_parse_info_hash(TEST_OTHER_INFO_HASH, id.bytes));
+	BOOST_CHECK(!fi_buffer.get_info(id, -1));
+	fi_buffer.stop_graceful();
+	BOOST_CHECK(find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 0));
+	fi_buffer.stop_force();
+	BOOST_CHECK(!find_by_route(fi_buffer, TEST_OTHER_INFO_HASH, 0) && !fi_buffer.get_info("c.mkv"));
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_lookup();
+	check_readd();
+	check_remove();
+	check_invalid_identity();
+	return 0;
+}
+
+#undef TEST_INFO_HASH
+#undef TEST_OTHER_INFO_HASH
+#undef TEST_FILE_SIZE
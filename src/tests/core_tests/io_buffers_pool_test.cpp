@@ -0,0 +1,112 @@
+#include "io_buffers_pool.hpp"
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <boost/test/minimal.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_BUFFER_SIZE 1024
+#define TEST_BUFFERS_PER_SLAB 4
+#define TEST_MAX_FREE_SLABS 2
+#define TEST_PEAK_SLABS 8
+
+namespace {
+
+using namespace t2h_core::details;
+
+static void release_all(io_buffers_pool & pool, std::vector<char *> & buffers)
+{
+	for (std::size_t it = 0; it < buffers.size(); ++it)
+		pool.release(buffers[it]);
+	buffers.clear();
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_reuse()
+{
+	/*  Released buffer handed out again, no new slab for it */
+	io_buffers_pool pool(TEST_BUFFER_SIZE, TEST_BUFFERS_PER_SLAB, TEST_MAX_FREE_SLABS);
+	char * const buffer = pool.acquire();
+	BOOST_REQUIRE(buffer != NULL);
+	std::memset(buffer, 'x', TEST_BUFFER_SIZE);
+	pool.release(buffer);
+	BOOST_CHECK(pool.acquire() == buffer);
+	pool.release(buffer);
+	pool.release(NULL);
+
+	io_buffers_pool_stat const stat = pool.get_stat();
+	BOOST_CHECK(stat.slabs == 1 && stat.buffers == TEST_BUFFERS_PER_SLAB);
+	BOOST_CHECK(stat.in_use == 0 && stat.peak_in_use == 1 && stat.acquires == 2);
+}
+
+static void check_free_slabs_released()
+{
+	/*  Slabs of the peak load returned to the heap above the cap, the rest kept */
+	io_buffers_pool pool(TEST_BUFFER_SIZE, TEST_BUFFERS_PER_SLAB, TEST_MAX_FREE_SLABS);
+	std::vector<char *> buffers;
+	for (std::size_t it = 0; it < TEST_PEAK_SLABS * TEST_BUFFERS_PER_SLAB; ++it)
+		buffers.push_back(pool.acquire());
+	io_buffers_pool_stat stat = pool.get_stat();
+	BOOST_CHECK(stat.slabs == TEST_PEAK_SLABS && stat.in_use == buffers.size());
+
+	release_all(pool, buffers);
+	stat = pool.get_stat();
+	BOOST_CHECK(stat.slabs == TEST_MAX_FREE_SLABS && stat.buffers == TEST_MAX_FREE_SLABS * TEST_BUFFERS_PER_SLAB);
+	BOOST_CHECK(stat.in_use == 0 && stat.peak_in_use == TEST_PEAK_SLABS * TEST_BUFFERS_PER_SLAB);
+
+	/*  Kept slabs serve the next load without new slabs */
+	for (std::size_t it = 0; it < TEST_MAX_FREE_SLABS * TEST_BUFFERS_PER_SLAB; ++it)
+		buffers.push_back(pool.acquire());
+	BOOST_CHECK(pool.get_stat().slabs == TEST_MAX_FREE_SLABS);
+	release_all(pool, buffers);
+}
+
+static void check_partly_used_kept()
+{
+	/*  Slab with the buffer in use never released, even without the free slabs cap */
+	io_buffers_pool pool(TEST_BUFFER_SIZE, TEST_BUFFERS_PER_SLAB, 0);
+	std::vector<char *> buffers;
+	for (std::size_t it = 0; it < 2 * TEST_BUFFERS_PER_SLAB; ++it)
+		buffers.push_back(pool.acquire());
+	char * const kept = buffers.back();
+	buffers.pop_back();
+	release_all(pool, buffers);
+	io_buffers_pool_stat const stat = pool.get_stat();
+	BOOST_CHECK(stat.slabs == 1 && stat.buffers == TEST_BUFFERS_PER_SLAB && stat.in_use == 1);
+
+	/*  Buffers handed out are the buffers of the kept slab only */
+	std::memset(kept, 'x', TEST_BUFFER_SIZE);
+	for (std::size_t it = 1; it < TEST_BUFFERS_PER_SLAB; ++it) {
+		buffers.push_back(pool.acquire());
+		std::memset(buffers.back(), 'y', TEST_BUFFER_SIZE);
+	} // for
+	BOOST_CHECK(pool.get_stat().slabs == 1 && kept[0] == 'x');
+	release_all(pool, buffers);
+	pool.release(kept);
+	BOOST_CHECK(pool.get_stat().slabs == 0);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_reuse();
+	check_free_slabs_released();
+	check_partly_used_kept();
+	return 0;
+}
+
+#undef TEST_BUFFER_SIZE
+#undef TEST_BUFFERS_PER_SLAB
+#undef TEST_MAX_FREE_SLABS
+#undef TEST_PEAK_SLABS
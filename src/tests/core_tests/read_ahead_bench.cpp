@@ -0,0 +1,158 @@
+#include "read_ahead_pipeline.hpp"
+
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+/**
+ * Read ahead pipeline benchmark.
+ * Compare of the sequential chunk loop(read chunk then write it) with the pipelined one
+ * on the cold page cache, chunks written to the socket pair drained by the own thread.
+ * Usage : read_ahead_bench [file size in MB] [chunk size in KB] [ring buffers]
+ */
+
+namespace {
+
+using namespace t2h_core::details;
+
+boost::filesystem::path const test_file_path = "read_ahead_bench_data";
+
+static void create_test_file(boost::int64_t file_size)
+{
+	std::vector<char> buffer(1024 * 1024);
+	for (std::size_t it = 0; it < buffer.size(); ++it)
+		buffer[it] = (char)(it % 251);
+	std::ofstream file(test_file_path.string().c_str(), std::ios::binary);
+	for (boost::int64_t writed = 0; writed < file_size; writed += buffer.size())
+		file.write(&buffer[0], buffer.size());
+}
+
+static void drop_page_cache()
+{
+	/*  Only clean pages could be dropped, so sync data first */
+	int const fd = ::open(test_file_path.string().c_str(), O_RDONLY);
+	if (fd == -1)
+		return;
+	::fdatasync(fd);
+#if defined(POSIX_FADV_DONTNEED)
+	::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+	::close(fd);
+}
+
+static void drain_socket(int sock)
+{
+	std::vector<char> buffer(256 * 1024);
+	while (::read(sock, &buffer[0], buffer.size()) > 0)
+		{ /**/ }
+}
+
+static bool write_all(int sock, char const * data, boost::int64_t bytes_size)
+{
+	for (ssize_t writed = 0; bytes_size > 0; data += writed, bytes_size -= writed)
+		if ((writed = ::write(sock, data, bytes_size)) <= 0)
+			return false;
+	return true;
+}
+
+static boost::int64_t sequential_loop(int sock, hc_file_handle & file_handle, boost::int64_t file_size, boost::int64_t chunk_size)
+{
+	std::vector<char> buffer(chunk_size);
+	boost::int64_t seek_pos = 0;
+	for (boost::int64_t readed = 0; seek_pos < file_size; seek_pos += readed) {
+		if ((readed = file_handle.read_at(&buffer[0], chunk_size, seek_pos)) <= 0 ||
+			!write_all(sock, &buffer[0], readed))
+			break;
+	} // for
+	return seek_pos;
+}
+
+static boost::int64_t pipelined_loop(int sock,
+	hc_file_handle_ptr file_handle, boost::int64_t file_size, boost::int64_t chunk_size, std::size_t buffers)
+{
+	/*  Same scheduling as hs_chunked_ostream_impl does :
+	 	take current chunk, schedule next ones, then write current */
+	io_buffers_pool buffers_pool(chunk_size, buffers, 1);
+	resume_pool io_pool(1);
+	read_ahead_pipeline pipeline(file_handle, buffers_pool, io_pool, buffers);
+	boost::int64_t seek_pos = 0;
+	for (boost::int64_t readed = 0, bytes_size = 0; seek_pos < file_size; seek_pos += readed) {
+		bytes_size = (file_size - seek_pos > chunk_size) ? chunk_size : file_size - seek_pos;
+		char const * data = pipeline.take(seek_pos, bytes_size, readed);
+		if (!data || readed <= 0)
+			break;
+
+		boost::int64_t pos = pipeline.scheduled_end();
+		for (boost::int64_t next_size = 0; pos < file_size && pipeline.free_buffers() > 0; pos += next_size) {
+			next_size = (file_size - pos > chunk_size) ? chunk_size : file_size - pos;
+			if (!pipeline.schedule(pos, next_size))
+				break;
+		} // for
+		file_handle->advise_willneed(pos, 2 * chunk_size);
+
+		bool const writed = write_all(sock, data, readed);
+		pipeline.release();
+		if (!writed)
+			break;
+	} // for
+	return seek_pos;
+}
+
+template <class Loop>
+static void run_bench(char const * name, Loop loop, boost::int64_t file_size)
+{
+	using namespace boost::posix_time;
+	int socks[2] = { -1, -1 };
+	if (::socketpair(AF_UNIX, SOCK_STREAM, 0, socks) != 0) {
+		std::cerr << "socketpair failed" << std::endl;
+		return;
+	}
+	drop_page_cache();
+	boost::thread drainer(boost::bind(drain_socket, socks[1]));
+
+	ptime const start = microsec_clock::universal_time();
+	boost::int64_t const transfered = loop(socks[0]);
+	double const secs = (microsec_clock::universal_time() - start).total_microseconds() / 1e6;
+
+	::shutdown(socks[0], SHUT_WR);
+	drainer.join();
+	::close(socks[0]); ::close(socks[1]);
+
+	std::cout << name << " : " << transfered / (1024 * 1024) << " MB in " << secs << " s, "
+		<< (transfered / (1024.0 * 1024.0)) / secs << " MB/s"
+		<< (transfered != file_size ? " (FAILED)" : "") << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char ** argv)
+{
+	boost::int64_t const file_size =
+		(argc > 1 ? boost::lexical_cast<boost::int64_t>(argv[1]) : 256) * 1024 * 1024;
+	boost::int64_t const chunk_size =
+		(argc > 2 ? boost::lexical_cast<boost::int64_t>(argv[2]) : 512) * 1024;
+	std::size_t const buffers = argc > 3 ? boost::lexical_cast<std::size_t>(argv[3]) : 2;
+
+	create_test_file(file_size);
+	hc_file_handle_ptr file_handle(new hc_file_handle(test_file_path.string()));
+	if (!file_handle->is_open()) {
+		std::cerr << "failed to open test file" << std::endl;
+		return 1;
+	}
+
+	run_bench("sequential", boost::bind(sequential_loop, _1, boost::ref(*file_handle), file_size, chunk_size), file_size);
+	run_bench("pipelined ", boost::bind(pipelined_loop, _1, file_handle, file_size, chunk_size, buffers), file_size);
+
+	boost::system::error_code error;
+	boost::filesystem::remove(test_file_path, error);
+	return 0;
+}
+
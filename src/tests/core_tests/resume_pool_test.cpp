@@ -0,0 +1,122 @@
+#include "resume_pool.hpp"
+
+#include <vector>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <boost/test/minimal.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+/**
+ * Helpers
+ */
+#define TEST_TASKS 1000
+
+namespace {
+
+using namespace t2h_core::details;
+
+struct tasks_state {
+	tasks_state() : lock(), order(), threads() { }
+
+	boost::mutex lock;
+	std::vector<int> order;
+	std::vector<boost::thread::id> threads;
+};
+
+static void ordered_task(tasks_state & state, int id)
+{
+	boost::lock_guard<boost::mutex> guard(state.lock);
+	state.order.push_back(id);
+	state.threads.push_back(boost::this_thread::get_id());
+}
+
+static void slow_task(tasks_state & state, int id)
+{
+	boost::this_thread::sleep(boost::posix_time::milliseconds(1));
+	ordered_task(state, id);
+}
+
+static void failed_task()
+{
+	throw std::runtime_error("failed task");
+}
+
+/**
+ *	Test cases
+ */
+
+static void check_fifo()
+{
+	/*  One thread : tasks performed in the order of the post,
+	 	stop performs already queued tasks */
+	tasks_state state;
+	resume_pool pool(1);
+	for (int it = 0; it < TEST_TASKS; ++it)
+		BOOST_CHECK(pool.post(boost::bind(ordered_task, boost::ref(state), it)));
+	pool.stop();
+
+	BOOST_CHECK(pool.pending() == 0 && (int)state.order.size() == TEST_TASKS);
+	for (int it = 0; it < (int)state.order.size(); ++it)
+		BOOST_CHECK(state.order[it] == it);
+	BOOST_CHECK(state.threads.front() != boost::this_thread::get_id());
+}
+
+static void check_stopped()
+{
+	tasks_state state;
+	resume_pool pool(2);
+	pool.stop();
+	pool.stop();
+	BOOST_CHECK(!pool.post(boost::bind(ordered_task, boost::ref(state), 0)));
+	BOOST_CHECK(pool.pending() == 0 && state.order.empty());
+}
+
+static void check_failed_task()
+{
+	/*  Failed task does not stop the thread */
+	tasks_state state;
+	resume_pool pool(1);
+	pool.post(failed_task);
+	pool.post(boost::bind(ordered_task, boost::ref(state), 0));
+	pool.stop();
+	BOOST_CHECK(state.order.size() == 1);
+}
+
+static void check_threads()
+{
+	/*  All threads of the pool perform tasks, each task performed once */
+	tasks_state state;
+	resume_pool pool(4);
+	for (int it = 0; it < TEST_TASKS / 10; ++it)
+		pool.post(boost::bind(slow_task, boost::ref(state), it));
+	pool.stop();
+
+	std::vector<bool> performed(TEST_TASKS / 10, false);
+	for (std::size_t it = 0; it < state.order.size(); ++it) {
+		BOOST_CHECK(!performed[state.order[it]]);
+		performed[state.order[it]] = true;
+	} // for
+	BOOST_CHECK(state.order.size() == TEST_TASKS / 10);
+	std::sort(state.threads.begin(), state.threads.end());
+	BOOST_CHECK(std::unique(state.threads.begin(), state.threads.end()) - state.threads.begin() > 1);
+}
+
+} // namespace
+
+/**
+ * Entry point
+ */
+
+int test_main(int argc, char ** argv)
+{
+	check_fifo();
+	check_stopped();
+	check_failed_task();
+	check_threads();
+	return 0;
+}
+
+#undef TEST_TASKS